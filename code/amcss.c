@@ -46,6 +46,11 @@ static mps_ap_t ap;
 static mps_addr_t exactRoots[exactRootsCOUNT];
 static mps_addr_t ambigRoots[ambigRootsCOUNT];
 static size_t scale;            /* Overall scale factor. */
+static size_t copyDepth;        /* Depth of depth-first copying. */
+static mps_cards_t cards;       /* Card table for the write barrier. */
+static mps_bool_t scanStats;    /* Attributing scans to pools etc.? */
+static mps_bool_t gcBackground; /* Collecting on a thread of its own? */
+static mps_bool_t cardMarking;  /* Card marking write barrier? */
 static unsigned long nCollsStart;
 static unsigned long nCollsDone;
 
@@ -69,16 +74,22 @@ static void report(void)
 
     } else if (type == mps_message_type_gc()) {
       size_t live, condemned, not_condemned;
+      double pause_time, pause_max;
       
       nCollsDone += 1;
       live = mps_message_gc_live_size(arena, message);
       condemned = mps_message_gc_condemned_size(arena, message);
       not_condemned = mps_message_gc_not_condemned_size(arena, message);
+      pause_time = mps_message_gc_pause_time(arena, message);
+      pause_max = mps_message_gc_pause_max(arena, message);
+      Insist(0.0 <= pause_max);
+      Insist(pause_max <= pause_time);
 
       printf("\n  Collection %lu finished:\n", nCollsDone);
       printf("    live %"PRIuLONGEST"\n", (ulongest_t)live);
       printf("    condemned %"PRIuLONGEST"\n", (ulongest_t)condemned);
       printf("    not_condemned %"PRIuLONGEST"\n", (ulongest_t)not_condemned);
+      printf("    pause time %g (max %g)\n", pause_time, pause_max);
       printf("    clock: %"PRIuLONGEST"\n", (ulongest_t)mps_message_clock(arena, message));
       printf("}\n");
     } else {
@@ -91,6 +102,107 @@ static void report(void)
 }
 
 
+/* check_stats -- check the arena statistics after parking
+ *
+ * Also checks that fields beyond the size set by the client are not
+ * stored, as for a client compiled against an older mps.h.
+ */
+
+static void check_stats(void)
+{
+  mps_arena_stats_s stats, old;
+  size_t i, pauses = 0;
+
+  stats.mps_size = sizeof stats;
+  mps_arena_stats(&stats, arena);
+  Insist(stats.mps_size == sizeof stats);
+  printf("Arena stats: %lu collections, %lu flips, %.0f allocated, "
+         "%.0f forwarded, %.0f reclaimed, %lu+%lu barrier hits, "
+         "%g+%g s\n",
+         (unsigned long)stats.mps_collections,
+         (unsigned long)stats.mps_flips, stats.mps_allocated,
+         stats.mps_forwarded, stats.mps_reclaimed,
+         (unsigned long)stats.mps_read_barrier_hits,
+         (unsigned long)stats.mps_write_barrier_hits,
+         stats.mps_pause_total, stats.mps_background_total);
+  Insist(stats.mps_collections >= nCollsDone);
+  Insist(stats.mps_flips >= stats.mps_collections);
+  Insist(stats.mps_gen_collections[0] > 0);
+  Insist(stats.mps_gen_collections[0] <= stats.mps_collections);
+  Insist(stats.mps_gen_collections[genCOUNT] == 0);
+  Insist(stats.mps_allocated > 0.0);
+  Insist(stats.mps_forwarded > 0.0);
+  Insist(stats.mps_reclaimed > 0.0);
+  Insist(stats.mps_pause_total >= 0.0);
+  Insist(stats.mps_background_total >= 0.0);
+  Insist(stats.mps_grey_segs == 0); /* parked */
+  Insist(stats.mps_pauses > 0);
+  Insist(stats.mps_pause_max <= stats.mps_pause_total);
+  for (i = 0; i < MPS_PAUSE_BUCKETS; ++i)
+    pauses += stats.mps_pause_hist[i];
+  Insist(pauses == stats.mps_pauses);
+  for (i = 0; i < MPS_MMU_WINDOWS; ++i) {
+    printf("MMU[%lu] = %g\n", (unsigned long)i, stats.mps_mmu[i]);
+    Insist(0.0 <= stats.mps_mmu[i]);
+    Insist(stats.mps_mmu[i] <= 1.0);
+  }
+
+  old.mps_size = offsetof(mps_arena_stats_s, mps_flips);
+  old.mps_flips = 0;
+  mps_arena_stats(&old, arena);
+  Insist(old.mps_size == offsetof(mps_arena_stats_s, mps_flips));
+  Insist(old.mps_collections == stats.mps_collections);
+  Insist(old.mps_flips == 0);
+}
+
+
+/* check_scan_stats -- check the scans attributed to a pool, its
+ * format and the table roots
+ *
+ * The pool is the only user of the format, so they must agree.
+ * AMCZ doesn't scan, but the roots are scanned whatever the pool.
+ * Objects copied depth-first while fixing a root are scanned as part
+ * of the root, so a root may account for more than its own size.
+ */
+
+static void check_scan_stats(mps_pool_t pool, mps_fmt_t format,
+                             mps_root_t exactRoot, mps_root_t ambigRoot,
+                             mps_bool_t scans)
+{
+  mps_scan_stats_s ps, fs, es, as;
+
+  if (!scanStats) {
+    Insist(!mps_pool_scan_stats(&ps, pool));
+    Insist(!mps_fmt_scan_stats(&fs, format));
+    Insist(!mps_root_scan_stats(&es, exactRoot));
+    return;
+  }
+  Insist(mps_pool_scan_stats(&ps, pool));
+  Insist(mps_fmt_scan_stats(&fs, format));
+  Insist(mps_root_scan_stats(&es, exactRoot));
+  Insist(mps_root_scan_stats(&as, ambigRoot));
+  printf("Scan stats: pool %lu scans, %.0f bytes, %lu fixes, %g s; "
+         "roots %lu+%lu scans, %g+%g s\n",
+         (unsigned long)ps.mps_scans, ps.mps_scanned,
+         (unsigned long)ps.mps_fixed, ps.mps_time,
+         (unsigned long)es.mps_scans, (unsigned long)as.mps_scans,
+         es.mps_time, as.mps_time);
+  Insist(ps.mps_scans == fs.mps_scans);
+  Insist(ps.mps_scanned == fs.mps_scanned);
+  Insist(ps.mps_fixed == fs.mps_fixed);
+  Insist(ps.mps_time == fs.mps_time);
+  Insist(scans ? ps.mps_scans > 0 && ps.mps_scanned > 0.0
+         : ps.mps_scans == 0);
+  Insist(ps.mps_time >= 0.0);
+  Insist(es.mps_scans > 0);
+  Insist(es.mps_scanned >= (double)es.mps_scans * sizeof exactRoots);
+  Insist(es.mps_time >= 0.0);
+  Insist(as.mps_scans > 0);
+  Insist(as.mps_scanned >= (double)as.mps_scans * sizeof ambigRoots);
+  Insist(as.mps_time >= 0.0);
+}
+
+
 /* make -- create one new object */
 
 static mps_addr_t make(size_t rootsCount)
@@ -147,8 +259,13 @@ static void test(mps_pool_class_t pool_class, size_t roots_count)
   die(dylan_fmt(&format, arena), "fmt_create");
   die(mps_chain_create(&chain, arena, genCOUNT, testChain), "chain_create");
 
-  die(mps_pool_create(&pool, arena, pool_class, format, chain),
-      "pool_create(amc)");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
+    MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
+    MPS_ARGS_ADD(args, MPS_KEY_AMC_COPY_DEPTH, copyDepth);
+    die(mps_pool_create_k(&pool, arena, pool_class, args),
+        "pool_create(amc)");
+  } MPS_ARGS_END(args);
 
   die(mps_ap_create(&ap, pool, mps_rank_exact()), "BufferCreate");
   die(mps_ap_create(&busy_ap, pool, mps_rank_exact()), "BufferCreate 2");
@@ -265,8 +382,8 @@ static void test(mps_pool_class_t pool_class, size_t roots_count)
         cdie(dylan_check(exactRoots[i]), "dying root check");
       exactRoots[i] = make(roots_count);
       if (exactRoots[(exactRootsCOUNT-1) - i] != objNULL)
-        dylan_write(exactRoots[(exactRootsCOUNT-1) - i],
-                    exactRoots, exactRootsCOUNT);
+        dylan_write_cards(exactRoots[(exactRootsCOUNT-1) - i],
+                          exactRoots, exactRootsCOUNT, cards);
     } else {
       i = (r >> 1) % ambigRootsCOUNT;
       ambigRoots[(ambigRootsCOUNT-1) - i] = make(roots_count);
@@ -286,8 +403,18 @@ static void test(mps_pool_class_t pool_class, size_t roots_count)
     ++objs;
   }
 
+  /* With background collection and card marking, this thread may
+     never wait for the collector: it does no collection work, and
+     there are no write barrier hits.  So start a collection from
+     this thread, which is always a pause.  This must happen before
+     the busy object is committed, as it is not a valid object. */
+  if (gcBackground && cardMarking)
+    die(mps_arena_start_collect(arena), "start_collect");
   (void)mps_commit(busy_ap, busy_init, 64);
   mps_arena_park(arena);
+  check_stats();
+  check_scan_stats(pool, format, exactRoot, ambigRoot,
+                   pool_class == mps_class_amc());
   mps_ap_destroy(busy_ap);
   mps_ap_destroy(ap);
   mps_root_destroy(exactRoot);
@@ -302,24 +429,46 @@ int main(int argc, char *argv[])
 {
   size_t i, grainSize;
   mps_thr_t thread;
+  mps_root_t reg_root = NULL;
+  void *marker = &marker;
 
   testlib_init(argc, argv);
 
   scale = (size_t)1 << (rnd() % 6);
   for (i = 0; i < genCOUNT; ++i) testChain[i].mps_capacity *= scale;
   grainSize = rnd_grain(scale * testArenaSIZE);
-  printf("Picked scale=%lu grainSize=%lu\n", (unsigned long)scale, (unsigned long)grainSize);
+  gcBackground = rnd() % 2;
+  copyDepth = rnd() % 2 == 0 ? 0 : 1 + rnd() % 16;
+  cardMarking = rnd() % 2;
+  scanStats = rnd() % 2;
+  printf("Picked scale=%lu grainSize=%lu gcBackground=%d "
+         "copyDepth=%lu cardMarking=%d scanStats=%d\n",
+         (unsigned long)scale, (unsigned long)grainSize, (int)gcBackground,
+         (unsigned long)copyDepth, (int)cardMarking, (int)scanStats);
 
   MPS_ARGS_BEGIN(args) {
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, scale * testArenaSIZE);
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_GRAIN_SIZE, grainSize);
+    MPS_ARGS_ADD(args, MPS_KEY_GC_BACKGROUND, gcBackground);
+    MPS_ARGS_ADD(args, MPS_KEY_CARD_MARKING, cardMarking);
+    MPS_ARGS_ADD(args, MPS_KEY_SCAN_STATS, scanStats);
     die(mps_arena_create_k(&arena, mps_arena_class_vm(), args), "arena_create");
   } MPS_ARGS_END(args);
+  /* The card table is harmless if card marking is off. */
+  cards = mps_arena_cards(arena);
   mps_message_type_enable(arena, mps_message_type_gc());
   mps_message_type_enable(arena, mps_message_type_gc_start());
   die(mps_thread_reg(&thread, arena), "thread_reg");
+  /* If collection work is done on the background thread, this thread
+   * may be stopped at any point, holding references in its registers
+   * and on its stack, so these must be scanned. */
+  if (gcBackground)
+    die(mps_root_create_thread(&reg_root, arena, thread, marker),
+        "root_create");
   test(mps_class_amc(), exactRootsCOUNT);
   test(mps_class_amcz(), 0);
+  if (reg_root != NULL)
+    mps_root_destroy(reg_root);
   mps_thread_dereg(thread);
   report();
   mps_arena_destroy(arena);
@@ -8,6 +8,10 @@
  * runs mps_arena_formatted_objects_walk(). This checks that walking
  * works while the other threads continue to allocate in the
  * background.
+ *
+ * The threads also allocate and free in a shared MVFF pool, which
+ * they may do holding only the pool's lock while another thread is
+ * collecting.  See <design/pool/#lock.suspend>.
  */
 
 #include "fmtdy.h"
@@ -16,6 +20,7 @@
 #include "testthr.h"
 #include "mpslib.h"
 #include "mpscamc.h"
+#include "mpscmvff.h"
 #include "mpsavm.h"
 
 #include <stdio.h> /* fflush, printf, putchar */
@@ -32,6 +37,8 @@
 #define collectionsCOUNT  37
 #define rampSIZE          9
 #define initTestFREQ      6000
+#define manualSetSIZE     16
+#define manualSizeMAX     1024
 
 /* testChain -- generation parameters for the test */
 
@@ -49,7 +56,9 @@ static mps_addr_t ambigRoots[ambigRootsCOUNT];
 
 static mps_word_t collections;
 static mps_arena_t arena;
+static mps_thr_t main_thread;
 static mps_root_t exactRoot, ambigRoot;
+static mps_pool_t mvff_pool;
 static unsigned long objs = 0;
 
 
@@ -112,6 +121,44 @@ static void churn(mps_ap_t ap, size_t roots_count)
 }
 
 
+/* manual -- allocate and free in the manual pool
+ *
+ * Each thread keeps its own set of blocks and stamps each one, so that
+ * blocks handed out to two threads at once are detected.
+ */
+
+typedef struct manual_s {
+  mps_word_t *blocks[manualSetSIZE];
+  size_t sizes[manualSetSIZE];
+} manual_s;
+
+static void manual(manual_s *m, mps_word_t stamp)
+{
+  size_t i = (size_t)rnd() % manualSetSIZE;
+  mps_addr_t p;
+
+  if (m->blocks[i] != NULL) {
+    Insist(*m->blocks[i] == stamp + i);
+    mps_free(mvff_pool, m->blocks[i], m->sizes[i]);
+  }
+  m->sizes[i] = sizeof(mps_word_t) + (size_t)rnd() % manualSizeMAX;
+  die(mps_alloc(&p, mvff_pool, m->sizes[i]), "mps_alloc");
+  m->blocks[i] = p;
+  *m->blocks[i] = stamp + i;
+}
+
+static void manual_finish(manual_s *m, mps_word_t stamp)
+{
+  size_t i;
+  for (i = 0; i < manualSetSIZE; ++i)
+    if (m->blocks[i] != NULL) {
+      Insist(*m->blocks[i] == stamp + i);
+      mps_free(mvff_pool, m->blocks[i], m->sizes[i]);
+      m->blocks[i] = NULL;
+    }
+}
+
+
 typedef struct closure_s {
   mps_pool_t pool;
   size_t roots_count;
@@ -124,6 +171,8 @@ static void *kid_thread(void *arg)
   mps_root_t reg_root;
   mps_ap_t ap;
   closure_t cl = arg;
+  manual_s m = {{NULL}, {0}};
+  mps_word_t stamp = (mps_word_t)&m;
 
   /* Register the thread twice to check this is supported -- see
    * <design/thread-manager/#req.register.multi>
@@ -136,8 +185,18 @@ static void *kid_thread(void *arg)
   die(mps_ap_create(&ap, cl->pool, mps_rank_exact()), "BufferCreate(fooey)");
   while(mps_collections(arena) < collectionsCOUNT) {
     churn(ap, cl->roots_count);
+    manual(&m, stamp);
+    /* Only needed with cooperative suspension, but harmless. Use
+       both registrations to check they stop together. */
+    if (rnd() % 2) {
+      mps_thread_safepoint(thread1);
+    } else {
+      mps_thread_enter_native(thread2);
+      mps_thread_leave_native(thread2);
+    }
   }
   mps_ap_destroy(ap);
+  manual_finish(&m, stamp);
 
   mps_root_destroy(reg_root);
   mps_thread_dereg(thread2);
@@ -249,6 +308,7 @@ static void test_pool(const char *name, mps_pool_t pool, size_t roots_count)
     }
 
     churn(ap, roots_count);
+    mps_thread_safepoint(main_thread);
     {
       size_t r = (size_t)rnd();
       if (r % initTestFREQ == 0)
@@ -264,8 +324,12 @@ static void test_pool(const char *name, mps_pool_t pool, size_t roots_count)
   mps_ap_destroy(busy_ap);
   mps_ap_destroy(ap);
 
+  /* With cooperative suspension, a thread that blocks must say so, or
+     a collection started by one of the kids would wait for it. */
+  mps_thread_enter_native(main_thread);
   for (i = 0; i < NELEMS(kids); ++i)
     testthr_join(&kids[i], NULL);
+  mps_thread_leave_native(main_thread);
 }
 
 static void test_arena(void)
@@ -277,10 +341,18 @@ static void test_arena(void)
   mps_root_t reg_root;
   mps_pool_t amc_pool, amcz_pool;
   void *marker = &marker;
+  mps_bool_t cooperative = rnd() % 2;
+  mps_bool_t lockStats = rnd() % 2;
+  mps_lock_stats_s stats;
+
+  printf("Picked cooperative=%d lockStats=%d\n",
+         (int)cooperative, (int)lockStats);
 
   MPS_ARGS_BEGIN(args) {
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, testArenaSIZE);
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_GRAIN_SIZE, rnd_grain(testArenaSIZE));
+    MPS_ARGS_ADD(args, MPS_KEY_COOPERATIVE_SUSPEND, cooperative);
+    MPS_ARGS_ADD(args, MPS_KEY_LOCK_STATS, lockStats);
     die(mps_arena_create_k(&arena, mps_arena_class_vm(), args), "arena_create");
   } MPS_ARGS_END(args);
   mps_message_type_enable(arena, mps_message_type_gc());
@@ -306,18 +378,49 @@ static void test_arena(void)
   die(mps_thread_reg(&thread, arena), "thread_reg");
   die(mps_root_create_thread(&reg_root, arena, thread, marker),
       "root_create");
+  main_thread = thread;
 
   die(mps_pool_create(&amc_pool, arena, mps_class_amc(), format, chain),
       "pool_create(amc)");
   die(mps_pool_create(&amcz_pool, arena, mps_class_amcz(), format, chain),
       "pool_create(amcz)");
+  /* A small extension size and no spare memory make the threads go
+     to the arena often, and so poll, while others use the pool. */
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_EXTEND_BY, 4096);
+    MPS_ARGS_ADD(args, MPS_KEY_SPARE, 0.0);
+    die(mps_pool_create_k(&mvff_pool, arena, mps_class_mvff(), args),
+        "pool_create(mvff)");
+  } MPS_ARGS_END(args);
 
   test_pool("AMC", amc_pool, exactRootsCOUNT);
   test_pool("AMCZ", amcz_pool, 0);
 
+  if (mps_arena_lock_stats(&stats, arena)) {
+    size_t holds = 0;
+    Insist(lockStats);
+    Insist(stats.mps_claims > 0);
+    Insist(stats.mps_contended <= stats.mps_claims);
+    Insist(stats.mps_wait_max <= stats.mps_wait_total);
+    Insist(stats.mps_hold_max <= stats.mps_hold_total);
+    for (i = 0; i < MPS_LOCK_HOLD_BUCKETS; ++i)
+      holds += stats.mps_hold[i];
+    /* The claim made by mps_arena_lock_stats is still held. */
+    Insist(holds + 1 == stats.mps_claims);
+    printf("Lock claims %lu, contended %lu, wait %g s (max %g s), "
+           "hold %g s (max %g s)\n",
+           (unsigned long)stats.mps_claims,
+           (unsigned long)stats.mps_contended,
+           stats.mps_wait_total, stats.mps_wait_max,
+           stats.mps_hold_total, stats.mps_hold_max);
+  } else {
+    Insist(!lockStats);
+  }
+
   mps_arena_park(arena);
   mps_pool_destroy(amc_pool);
   mps_pool_destroy(amcz_pool);
+  mps_pool_destroy(mvff_pool);
   mps_root_destroy(reg_root);
   mps_thread_dereg(thread);
   mps_root_destroy(exactRoot);
@@ -170,6 +170,38 @@ Bool ArenaClassCheck(ArenaClass klass)
 }
 
 
+/* arenaChunkMapCheck -- check that the chunk map agrees with the ring
+ *
+ * Each chunk other than removed must be in the map entries for its
+ * first and last addresses, unless those entries are shared by more
+ * than two chunks, so that ChunkOfAddr finds it without searching the
+ * tree.  This repeats the map lookup of ChunkOfAddr, which can't be
+ * called during an update because it checks the arena.  This walks
+ * the chunk ring, so it is called when the map is rebuilt rather than
+ * from ArenaCheck.  See <design/arena/#chunk.map.update>.
+ */
+
+static Bool arenaChunkMapHas(Arena arena, Addr addr, Chunk chunk)
+{
+  Chunk *entry = arena->chunkMap[ChunkMapIndex(arena, addr)];
+  return entry[0] == ChunkMapMANY || entry[0] == chunk || entry[1] == chunk;
+}
+
+static Bool arenaChunkMapCheck(Arena arena, Chunk removed)
+{
+  Ring node, next;
+
+  RING_FOR(node, ArenaChunkRing(arena), next) {
+    Chunk chunk = RING_ELT(Chunk, arenaRing, node);
+    if (chunk == removed)
+      continue;
+    CHECKL(arenaChunkMapHas(arena, chunk->base, chunk));
+    CHECKL(arenaChunkMapHas(arena, AddrSub(chunk->limit, 1), chunk));
+  }
+  return TRUE;
+}
+
+
 /* ArenaCheck -- check the arena */
 
 Bool ArenaCheck(Arena arena)
@@ -190,7 +222,9 @@ Bool ArenaCheck(Arena arena)
    */
   CHECKL(arena->committed <= arena->commitLimit);
   CHECKL(arena->spareCommitted <= arena->committed);
+  CHECKL(0.0 <= arena->sparePurgeRate);
   CHECKL(0.0 <= arena->pauseTime);
+  CHECKL(BoolCheck(arena->gcBackground));
 
   CHECKL(arena->zoneShift == ZoneShiftUNSET
          || ShiftCheck(arena->zoneShift));
@@ -213,6 +247,7 @@ Bool ArenaCheck(Arena arena)
   /* Can't use CHECKD_NOSIG because TreeEMPTY is NULL. */
   CHECKL(TreeCheck(ArenaChunkTree(arena)));
   /* TODO: check that the chunkRing and chunkTree have identical members */
+  CHECKL(ShiftCheck(arena->chunkMapShift));
   /* nothing to check for chunkSerial */
   
   CHECKL(LocusCheck(arena));
@@ -222,6 +257,15 @@ Bool ArenaCheck(Arena arena)
     CHECKD(Land, ArenaFreeLand(arena));
 
   CHECKL(BoolCheck(arena->zoned));
+  CHECKL(arena->nodes >= 1);
+  CHECKL(BoolCheck(arena->cardMarking));
+  CHECKL(BoolCheck(arena->dirtyTracking));
+  CHECKL(!(arena->cardMarking && arena->dirtyTracking));
+  CHECKL(BoolCheck(arena->cooperativeSuspend));
+  CHECKL(BoolCheck(arena->lockStats));
+  CHECKL(BoolCheck(arena->scanStats));
+  CHECKL(arena->cardTableLength == 0
+         || arena->cardsStruct._mask == arena->cardTableLength - 1);
 
   return TRUE;
 }
@@ -235,8 +279,16 @@ static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args)
   Bool zoned = ARENA_DEFAULT_ZONED;
   Size commitLimit = ARENA_DEFAULT_COMMIT_LIMIT;
   Size spareCommitLimit = ARENA_DEFAULT_SPARE_COMMIT_LIMIT;
+  double sparePurgeRate = ARENA_DEFAULT_SPARE_PURGE_RATE;
   double pauseTime = ARENA_DEFAULT_PAUSE_TIME;
+  Bool gcBackground = ARENA_DEFAULT_GC_BACKGROUND;
+  Bool cardMarking = ARENA_DEFAULT_CARD_MARKING;
+  Bool dirtyTracking = ARENA_DEFAULT_DIRTY_TRACKING;
+  Bool cooperativeSuspend = ARENA_DEFAULT_COOPERATIVE_SUSPEND;
+  Bool lockStats = ARENA_DEFAULT_LOCK_STATS;
+  Bool scanStats = ARENA_DEFAULT_SCAN_STATS;
   mps_arg_s arg;
+  Index i;
 
   AVER(arena != NULL);
   AVERT(ArenaGrainSize, grainSize);
@@ -247,8 +299,30 @@ static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args)
     commitLimit = arg.val.size;
   if (ArgPick(&arg, args, MPS_KEY_SPARE_COMMIT_LIMIT))
     spareCommitLimit = arg.val.size;
+  if (ArgPick(&arg, args, MPS_KEY_SPARE_PURGE_RATE))
+    sparePurgeRate = arg.val.d;
   if (ArgPick(&arg, args, MPS_KEY_PAUSE_TIME))
     pauseTime = arg.val.d;
+  if (ArgPick(&arg, args, MPS_KEY_GC_BACKGROUND))
+    gcBackground = arg.val.b;
+  if (ArgPick(&arg, args, MPS_KEY_CARD_MARKING))
+    cardMarking = arg.val.b;
+  if (ArgPick(&arg, args, MPS_KEY_DIRTY_TRACKING))
+    dirtyTracking = arg.val.b;
+  if (ArgPick(&arg, args, MPS_KEY_COOPERATIVE_SUSPEND))
+    cooperativeSuspend = arg.val.b;
+  if (ArgPick(&arg, args, MPS_KEY_LOCK_STATS))
+    lockStats = arg.val.b;
+  if (ArgPick(&arg, args, MPS_KEY_SCAN_STATS))
+    scanStats = arg.val.b;
+
+  AVER(sparePurgeRate >= 0.0);
+  AVERT(Bool, gcBackground);
+  AVERT(Bool, cardMarking);
+  AVERT(Bool, dirtyTracking);
+  AVERT(Bool, cooperativeSuspend);
+  AVERT(Bool, lockStats);
+  AVERT(Bool, scanStats);
 
   /* Superclass init */
   InstInit(CouldBeA(Inst, arena));
@@ -258,7 +332,10 @@ static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args)
   arena->commitLimit = commitLimit;
   arena->spareCommitted = (Size)0;
   arena->spareCommitLimit = spareCommitLimit;
+  arena->sparePurgeRate = sparePurgeRate;
+  arena->sparePurgeClock = ClockNow();
   arena->pauseTime = pauseTime;
+  arena->gcBackground = gcBackground;
   arena->grainSize = grainSize;
   /* zoneShift must be overridden by arena class init */
   arena->zoneShift = ZoneShiftUNSET;
@@ -268,11 +345,20 @@ static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args)
   arena->hasFreeLand = FALSE;
   arena->freeZones = ZoneSetUNIV;
   arena->zoned = zoned;
+  arena->nodes = 1;             /* set by arena class if NUMA-aware */
 
   arena->primary = NULL;
   RingInit(ArenaChunkRing(arena));
   arena->chunkTree = TreeEMPTY;
+  arena->chunkMapShift = SizeLog2(grainSize);
+  for (i = 0; i < ARENA_CHUNK_MAP_LENGTH; ++i)
+    arena->chunkMap[i][0] = arena->chunkMap[i][1] = NULL;
   arena->chunkSerial = (Serial)0;
+  CardTableInit(arena, cardMarking);
+  arena->dirtyTracking = FALSE;
+  arena->cooperativeSuspend = cooperativeSuspend;
+  arena->lockStats = lockStats;
+  arena->scanStats = scanStats;
   
   LocusInit(arena);
   
@@ -300,6 +386,12 @@ static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args)
   if (res != ResOK)
     goto failMFSInit;
 
+  /* Segments aren't write-protected with card marking, so there's
+     nothing for dirty tracking to do.  If the platform can't track
+     dirty pages, use protection.  <design/prot/#dirty.start> */
+  if (dirtyTracking && !cardMarking)
+    arena->dirtyTracking = ProtDirtyStart();
+
   return ResOK;
 
 failMFSInit:
@@ -319,6 +411,9 @@ failGlobalsInit:
  * exist on all platforms. */
 
 ARG_DEFINE_KEY(VMW3_TOP_DOWN, Bool);
+ARG_DEFINE_KEY(VM_HUGE_PAGES, Bool);
+ARG_DEFINE_KEY(VM_LAZY_PURGE, Bool);
+ARG_DEFINE_KEY(VM_NUMA, Bool);
 
 
 /* ArenaCreate -- create the arena and call initializers */
@@ -328,7 +423,14 @@ ARG_DEFINE_KEY(ARENA_SIZE, Size);
 ARG_DEFINE_KEY(ARENA_ZONED, Bool);
 ARG_DEFINE_KEY(COMMIT_LIMIT, Size);
 ARG_DEFINE_KEY(SPARE_COMMIT_LIMIT, Size);
+ARG_DEFINE_KEY(SPARE_PURGE_RATE, double);
 ARG_DEFINE_KEY(PAUSE_TIME, double);
+ARG_DEFINE_KEY(GC_BACKGROUND, Bool);
+ARG_DEFINE_KEY(CARD_MARKING, Bool);
+ARG_DEFINE_KEY(DIRTY_TRACKING, Bool);
+ARG_DEFINE_KEY(COOPERATIVE_SUSPEND, Bool);
+ARG_DEFINE_KEY(LOCK_STATS, Bool);
+ARG_DEFINE_KEY(SCAN_STATS, Bool);
 
 static Res arenaFreeLandInit(Arena arena)
 {
@@ -405,6 +507,10 @@ Res ArenaCreate(Arena *arenaReturn, ArenaClass klass, ArgList args)
   if (res != ResOK)
     goto failControlInit;
 
+  res = CardTableCreate(arena);
+  if (res != ResOK)
+    goto failCardTableCreate;
+
   res = GlobalsCompleteCreate(ArenaGlobals(arena));
   if (res != ResOK)
     goto failGlobalsCompleteCreate;
@@ -414,6 +520,8 @@ Res ArenaCreate(Arena *arenaReturn, ArenaClass klass, ArgList args)
   return ResOK;
 
 failGlobalsCompleteCreate:
+  CardTableDestroy(arena);
+failCardTableCreate:
   ControlFinish(arena);
 failControlInit:
   arenaFreeLandFinish(arena);
@@ -431,6 +539,8 @@ static void ArenaAbsFinish(Inst inst)
 {
   Arena arena = MustBeA(AbstractArena, inst);
   AVERC(Arena, arena);
+  if (arena->dirtyTracking)
+    ProtDirtyStop();
   PoolFinish(ArenaCBSBlockPool(arena));
   arena->sig = SigInvalid;
   NextMethod(Inst, AbstractArena, finish)(inst);
@@ -479,6 +589,7 @@ void ArenaDestroy(Arena arena)
 
   GlobalsPrepareToDestroy(ArenaGlobals(arena));
 
+  CardTableDestroy(arena);
   ControlFinish(arena);
 
   /* We must tear down the free land before the chunks, because pages
@@ -553,6 +664,7 @@ static Res ArenaAbsDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
                "commitLimit      $W\n", (WriteFW)arena->commitLimit,
                "spareCommitted   $W\n", (WriteFW)arena->spareCommitted,
                "spareCommitLimit $W\n", (WriteFW)arena->spareCommitLimit,
+               "sparePurgeRate   $D\n", (WriteFD)arena->sparePurgeRate,
                "zoneShift        $U\n", (WriteFU)arena->zoneShift,
                "grainSize        $W\n", (WriteFW)arena->grainSize,
                "lastTract        $P\n", (WriteFP)arena->lastTract,
@@ -561,6 +673,15 @@ static Res ArenaAbsDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
                "hasFreeLand      $S\n", WriteFYesNo(arena->hasFreeLand),
                "freeZones        $B\n", (WriteFB)arena->freeZones,
                "zoned            $S\n", WriteFYesNo(arena->zoned),
+               "nodes            $U\n", (WriteFU)arena->nodes,
+               "gcBackground     $S\n", WriteFYesNo(arena->gcBackground),
+               "cardMarking      $S\n", WriteFYesNo(arena->cardMarking),
+               "cardTableLength  $U\n", (WriteFU)arena->cardTableLength,
+               "dirtyTracking    $S\n", WriteFYesNo(arena->dirtyTracking),
+               "cooperativeSuspend $S\n",
+               WriteFYesNo(arena->cooperativeSuspend),
+               "lockStats        $S\n", WriteFYesNo(arena->lockStats),
+               "scanStats        $S\n", WriteFYesNo(arena->scanStats),
                NULL);
   if (res != ResOK)
     return res;
@@ -718,6 +839,58 @@ Res ControlDescribe(Arena arena, mps_lib_FILE *stream, Count depth)
 }
 
 
+/* arenaChunkMapUpdate -- rebuild the arena's chunk map
+ *
+ * Called when the set of chunks changes.  The chunk removed (if not
+ * NULL) is still on the chunk ring, and is left out of the map.  The
+ * stripe size is the largest power of 2 no bigger than the smallest
+ * chunk, so that each chunk covers few stripes, and each stripe meets
+ * at most two chunks.  See <design/arena/#chunk.map>.
+ */
+
+static void arenaChunkMapUpdate(Arena arena, Chunk removed)
+{
+  Ring node, next;
+  Size minSize = 0;
+  Index i;
+
+  RING_FOR(node, ArenaChunkRing(arena), next) {
+    Chunk chunk = RING_ELT(Chunk, arenaRing, node);
+    if (chunk != removed && (minSize == 0 || ChunkSize(chunk) < minSize))
+      minSize = ChunkSize(chunk);
+  }
+
+  for (i = 0; i < ARENA_CHUNK_MAP_LENGTH; ++i)
+    arena->chunkMap[i][0] = arena->chunkMap[i][1] = NULL;
+  if (minSize == 0)
+    return;
+  arena->chunkMapShift = SizeFloorLog2(minSize);
+
+  RING_FOR(node, ArenaChunkRing(arena), next) {
+    Chunk chunk = RING_ELT(Chunk, arenaRing, node);
+    Word stripe, stripeLimit;
+    if (chunk == removed)
+      continue;
+    stripe = (Word)chunk->base >> arena->chunkMapShift;
+    stripeLimit = (((Word)chunk->limit - 1) >> arena->chunkMapShift) + 1;
+    if (stripeLimit - stripe > ARENA_CHUNK_MAP_LENGTH)
+      stripeLimit = stripe + ARENA_CHUNK_MAP_LENGTH;
+    for (; stripe < stripeLimit; ++stripe) {
+      Chunk *entry = arena->chunkMap[stripe & (ARENA_CHUNK_MAP_LENGTH - 1)];
+      if (entry[0] == ChunkMapMANY || entry[0] == chunk || entry[1] == chunk)
+        continue;
+      if (entry[0] == NULL)
+        entry[0] = chunk;
+      else if (entry[1] == NULL)
+        entry[1] = chunk;
+      else
+        entry[0] = ChunkMapMANY;
+    }
+  }
+  AVER(arenaChunkMapCheck(arena, removed));
+}
+
+
 /* ArenaChunkInsert -- insert chunk into arena's chunk tree and ring,
  * update the total reserved address space, and set the primary chunk
  * if not already set.
@@ -738,6 +911,8 @@ void ArenaChunkInsert(Arena arena, Chunk chunk) {
   TreeBalance(&updatedTree);
   arena->chunkTree = updatedTree;
   RingAppend(ArenaChunkRing(arena), &chunk->arenaRing);
+  arenaChunkMapUpdate(arena, NULL);
+  CardTableUpdate(arena, NULL);
 
   arena->reserved += ChunkReserved(chunk);
 
@@ -760,6 +935,9 @@ void ArenaChunkRemoved(Arena arena, Chunk chunk)
   AVERT(Arena, arena);
   AVERT(Chunk, chunk);
 
+  arenaChunkMapUpdate(arena, chunk);
+  CardTableUpdate(arena, chunk);
+
   size = ChunkReserved(chunk);
   AVER(arena->reserved >= size);
   arena->reserved -= size;
@@ -1025,6 +1203,51 @@ void ArenaFreeLandDelete(Arena arena, Addr base, Addr limit)
 }
 
 
+/* arenaAllocRange -- allocate a range deleted from the free land
+ *
+ * Marks the tracts in range as belonging to pool, and sets
+ * *tractReturn to point to the first of them.  If this fails, the
+ * range is returned to the free land.
+ */
+
+static Res arenaAllocRange(Tract *tractReturn, Arena arena, Range range,
+                           Pool pool)
+{
+  RangeStruct oldRange;
+  Chunk chunk = NULL; /* suppress uninit warning */
+  Bool b;
+  Index baseIndex;
+  Count pages;
+  Res res;
+
+  b = ChunkOfAddr(&chunk, arena, RangeBase(range));
+  AVER(b);
+  AVER(RangeIsAligned(range, ChunkPageSize(chunk)));
+  baseIndex = INDEX_OF_ADDR(chunk, RangeBase(range));
+  pages = ChunkSizeToPages(chunk, RangeSize(range));
+
+  res = Method(Arena, arena, pagesMarkAllocated)(arena, chunk, baseIndex, pages, pool);
+  if (res != ResOK)
+    goto failMark;
+
+  arena->freeZones = ZoneSetDiff(arena->freeZones,
+                                 ZoneSetOfRange(arena,
+                                                RangeBase(range),
+                                                RangeLimit(range)));
+
+  *tractReturn = PageTract(ChunkPage(chunk, baseIndex));
+  return ResOK;
+
+failMark:
+   {
+     Res insertRes = arenaFreeLandInsertExtend(&oldRange, arena, range);
+     AVER(insertRes == ResOK); /* We only just deleted it. */
+     /* If the insert does fail, we lose some address space permanently. */
+   }
+   return res;
+}
+
+
 /* ArenaFreeLandAlloc -- allocate a continguous range of tracts of
  * size bytes from the arena's free land.
  *
@@ -1039,10 +1262,7 @@ Res ArenaFreeLandAlloc(Tract *tractReturn, Arena arena, ZoneSet zones,
                        Bool high, Size size, Pool pool)
 {
   RangeStruct range, oldRange;
-  Chunk chunk = NULL; /* suppress uninit warning */
-  Bool found, b;
-  Index baseIndex;
-  Count pages;
+  Bool found;
   Res res;
   
   AVER(tractReturn != NULL);
@@ -1081,31 +1301,116 @@ Res ArenaFreeLandAlloc(Tract *tractReturn, Arena arena, ZoneSet zones,
   
   /* Step 2. Make memory available in the address space range. */
 
-  b = ChunkOfAddr(&chunk, arena, RangeBase(&range));
-  AVER(b);
-  AVER(RangeIsAligned(&range, ChunkPageSize(chunk)));
-  baseIndex = INDEX_OF_ADDR(chunk, RangeBase(&range));
-  pages = ChunkSizeToPages(chunk, RangeSize(&range));
+  return arenaAllocRange(tractReturn, arena, &range, pool);
+}
 
-  res = Method(Arena, arena, pagesMarkAllocated)(arena, chunk, baseIndex, pages, pool);
-  if (res != ResOK)
-    goto failMark;
 
-  arena->freeZones = ZoneSetDiff(arena->freeZones,
-                                 ZoneSetOfRange(arena,
-                                                RangeBase(&range),
-                                                RangeLimit(&range)));
+/* arenaFindInChunk -- find a free range of pages in a chunk
+ *
+ * Searches the chunk's allocation table for a free range of size
+ * bytes in zones, lowest or highest first according to high.
+ */
 
-  *tractReturn = PageTract(ChunkPage(chunk, baseIndex));
-  return ResOK;
+static Bool arenaFindInChunk(Range rangeReturn, Chunk chunk, ZoneSet zones,
+                             Bool high, Size size)
+{
+  Arena arena = ChunkArena(chunk);
+  Count pages = ChunkSizeToPages(chunk, size);
+  Index searchBase = chunk->allocBase, searchLimit = chunk->pages;
+  Index baseIndex, limitIndex;
+  Addr base, limit, stripe;
+
+  while (searchBase < searchLimit && searchLimit - searchBase >= pages) {
+    Bool found;
+    if (high)
+      found = BTFindShortResRangeHigh(&baseIndex, &limitIndex,
+                                      chunk->allocTable,
+                                      searchBase, searchLimit, pages);
+    else
+      found = BTFindShortResRange(&baseIndex, &limitIndex,
+                                  chunk->allocTable,
+                                  searchBase, searchLimit, pages);
+    if (!found)
+      return FALSE;
+    base = PageIndexBase(chunk, baseIndex);
+    limit = PageIndexBase(chunk, limitIndex);
+    if (ZoneSetSub(ZoneSetOfRange(arena, base, limit), zones)) {
+      RangeInit(rangeReturn, base, limit);
+      return TRUE;
+    }
+    /* Any other range that starts (ends) in the same stripe covers at
+       least the same stripes, so skip to the next stripe. */
+    if (high) {
+      stripe = AddrAlignDown(AddrSub(limit, ChunkPageSize(chunk)),
+                             ArenaStripeSize(arena));
+      if (stripe <= PageIndexBase(chunk, searchBase))
+        return FALSE;
+      searchLimit = INDEX_OF_ADDR(chunk, stripe);
+    } else {
+      stripe = AddrAlignUp(AddrAdd(base, ChunkPageSize(chunk)),
+                           ArenaStripeSize(arena));
+      if (stripe >= PageIndexBase(chunk, searchLimit))
+        return FALSE;
+      searchBase = INDEX_OF_ADDR(chunk, stripe);
+    }
+  }
+  return FALSE;
+}
 
-failMark:
-   {
-     Res insertRes = arenaFreeLandInsertExtend(&oldRange, arena, &range);
-     AVER(insertRes == ResOK); /* We only just deleted it. */
-     /* If the insert does fail, we lose some address space permanently. */
-   }
-   return res;
+
+/* ArenaFreeLandAllocOnNode -- allocate from chunks on a NUMA node
+ *
+ * As ArenaFreeLandAlloc, but only from chunks whose memory is on
+ * node.  The free land can't be searched by address range, so this
+ * searches the allocation tables of those chunks instead, and then
+ * deletes the range it found from the free land.  See
+ * <design/arena/#numa.alloc>.
+ */
+
+Res ArenaFreeLandAllocOnNode(Tract *tractReturn, Arena arena, Index node,
+                             ZoneSet zones, Bool high, Size size, Pool pool)
+{
+  Ring chunkNode, nextChunkNode;
+
+  AVER(tractReturn != NULL);
+  AVERT(Arena, arena);
+  AVER(node < arena->nodes);
+  AVER(size > (Size)0);
+  AVERT(Pool, pool);
+  AVER(arena == PoolArena(pool));
+  AVER(SizeIsArenaGrains(size, arena));
+
+  if (!arena->zoned)
+    zones = ZoneSetUNIV;
+
+retry:
+  RING_FOR(chunkNode, ArenaChunkRing(arena), nextChunkNode) {
+    Chunk chunk = RING_ELT(Chunk, arenaRing, chunkNode);
+    RangeStruct range, oldRange;
+    Res res;
+
+    if (ChunkNode(chunk) != node
+        || !arenaFindInChunk(&range, chunk, zones, high, size))
+      continue;
+
+    res = LandDelete(&oldRange, ArenaFreeLand(arena), &range);
+    if (res == ResLIMIT) { /* couldn't split the block */
+      RangeStruct pageRange;
+      res = arenaExtendCBSBlockPool(&pageRange, arena);
+      if (res != ResOK) /* disastrously short on memory */
+        return res;
+      arenaExcludePage(arena, &pageRange);
+      /* The page might have come from the range, so search again. */
+      goto retry;
+    }
+    AVER(res == ResOK); /* free pages are always in the free land */
+    if (res != ResOK) /* defensive return */
+      return res;
+
+    return arenaAllocRange(tractReturn, arena, &range, pool);
+  }
+
+  return ResRESOURCE;
 }
 
 
@@ -1182,8 +1487,10 @@ void ArenaFree(Addr base, Size size, Pool pool)
 
   Method(Arena, arena, free)(RangeBase(&range), RangeSize(&range), pool);
 
-  /* Freeing memory might create spare pages, but not more than this. */
-  CHECKL(arena->spareCommitted <= arena->spareCommitLimit);
+  /* Freeing memory might create spare pages, but not more than this,
+     unless purging is deferred. <design/arena/#spare.deferred> */
+  CHECKL(ArenaSparePurgeDeferred(arena)
+         || arena->spareCommitted <= arena->spareCommitLimit);
 
   EVENT3(ArenaFree, arena, wholeBase, wholeSize);
 }
@@ -1227,6 +1534,54 @@ void ArenaSetSpareCommitLimit(Arena arena, Size limit)
   EVENT2(SpareCommitLimitSet, arena, limit);
 }
 
+/* ArenaPurgeSpareStep -- purge deferred spare memory
+ *
+ * If purging is deferred and there is more spare memory than the spare
+ * commit limit, purge some of it, at no more than the arena's purge
+ * rate over the time since the last call, or over interval (in
+ * seconds) if that is longer.  The clock may not advance while the
+ * process is idle, so callers that know how long they have waited
+ * pass that as interval.  Returns the amount purged.  See
+ * <design/arena/#spare.deferred>.
+ */
+
+Size ArenaPurgeSpareStep(Arena arena, double interval)
+{
+  Clock now;
+  double elapsed, budget;
+  Size excess, purged;
+
+  AVERT(Arena, arena);
+  AVER(interval >= 0.0);
+
+  if (!ArenaSparePurgeDeferred(arena))
+    return 0;
+
+  now = ClockNow();
+  if (arena->spareCommitted <= arena->spareCommitLimit) {
+    /* Don't save up purging while there's nothing to purge. */
+    arena->sparePurgeClock = now;
+    return 0;
+  }
+
+  elapsed = (double)(now - arena->sparePurgeClock) / (double)ClocksPerSec();
+  if (elapsed < interval)
+    elapsed = interval;
+  budget = arena->sparePurgeRate * elapsed;
+  if (budget > arena->sparePurgeRate * ARENA_SPARE_PURGE_BURST)
+    budget = arena->sparePurgeRate * ARENA_SPARE_PURGE_BURST;
+  if (budget < (double)ArenaGrainSize(arena))
+    return 0; /* save up for at least a grain */
+
+  /* Purge down to half the limit, as VMFree would. */
+  excess = arena->spareCommitted - arena->spareCommitLimit / 2;
+  if (budget < (double)excess)
+    excess = (Size)budget;
+  purged = Method(Arena, arena, purgeSpare)(arena, excess);
+  arena->sparePurgeClock = now;
+  return purged;
+}
+
 double ArenaPauseTime(Arena arena)
 {
   AVERT(Arena, arena);
@@ -1335,6 +1690,189 @@ void ArenaAccumulateTime(Arena arena, Clock start, Clock end)
   AVERT(Arena, arena);
   AVER(start <= end);
   arena->tracedTime += (end - start) / (double) ClocksPerSec();
+  if (ArenaGlobals(arena)->insideBackground)
+    arena->backgroundTime += (end - start) / (double) ClocksPerSec();
+}
+
+
+/* arenaMMUUpdate -- update minimum mutator utilization
+ *
+ * Measures the utilization of each window that ends at the end of
+ * the latest pause, by walking back through the log of recent
+ * pauses.  The windows are in increasing order of size, so they can
+ * all be measured in one pass.  See <design/arena/#pause.mmu>.
+ */
+
+static void arenaMMUUpdate(Arena arena, Clock end)
+{
+  Clock window[ArenaMMUWINDOWS];
+  double seconds = 1e-4;
+  Count windows = 0;
+  Clock paused = 0;
+  Index i, n;
+
+  /* Only windows that lie wholly after pause timing began are
+   * measured, and so bound doesn't underflow. */
+  for (i = 0; i < ArenaMMUWINDOWS; ++i) {
+    window[i] = (Clock)(seconds * (double)ClocksPerSec());
+    seconds *= 10.0;
+    if (window[i] > 0 && end - arena->pauseEpoch >= window[i])
+      windows = i + 1;
+  }
+
+#define MMU_FINISH(i, p) \
+  BEGIN \
+    if (window[i] > 0) { \
+      double utilization = 1.0 - (double)(p) / (double)window[i]; \
+      if (utilization < 0.0) \
+        utilization = 0.0; \
+      if (utilization < arena->mmu[i]) \
+        arena->mmu[i] = utilization; \
+    } \
+  END
+
+  i = 0;
+  for (n = 0; n < arena->pauseLogged && i < windows; ++n) {
+    Index k = (arena->pauseNext + ARENA_PAUSE_HISTORY - 1 - n)
+              % ARENA_PAUSE_HISTORY;
+    Clock start = arena->pauseLogStart[k], stop = arena->pauseLogEnd[k];
+    /* Windows that begin after this pause ended are complete. */
+    while (i < windows && stop <= end - window[i]) {
+      MMU_FINISH(i, paused);
+      ++i;
+    }
+    /* Windows that begin during this pause are complete too. */
+    while (i < windows && start < end - window[i]) {
+      MMU_FINISH(i, paused + stop - (end - window[i]));
+      ++i;
+    }
+    paused += stop - start;
+  }
+  /* The rest of the windows extend beyond the log. */
+  for (; i < windows; ++i)
+    MMU_FINISH(i, paused);
+
+#undef MMU_FINISH
+}
+
+
+/* arenaPauseRecord -- record a pause in a client thread */
+
+static void arenaPauseRecord(Arena arena, Clock start, Clock end)
+{
+  double pause = (double)(end - start) / (double)ClocksPerSec();
+  double limit = 1e-5;
+  TraceId ti;
+  Trace trace;
+  Index i;
+
+  ++arena->pauseCount;
+  arena->pauseTotal += pause;
+  if (pause > arena->pauseMax)
+    arena->pauseMax = pause;
+  for (i = 0; i < ArenaPauseBUCKETS - 1 && pause >= limit; ++i)
+    limit *= 10.0;
+  ++arena->pauseHist[i];
+
+  /* For the trace end message.  See TracePostMessage. */
+  TRACE_SET_ITER(ti, trace, arena->busyTraces, arena)
+    trace->pauseTime += pause;
+    if (pause > trace->pauseMax)
+      trace->pauseMax = pause;
+  TRACE_SET_ITER_END(ti, trace, arena->busyTraces, arena);
+
+  arena->pauseLogStart[arena->pauseNext] = start;
+  arena->pauseLogEnd[arena->pauseNext] = end;
+  arena->pauseNext = (arena->pauseNext + 1) % ARENA_PAUSE_HISTORY;
+  if (arena->pauseLogged < ARENA_PAUSE_HISTORY)
+    ++arena->pauseLogged;
+  arenaMMUUpdate(arena, end);
+}
+
+
+/* ArenaPauseBegin, ArenaPauseEnd -- time a pause in a client thread
+ *
+ * These bracket work that the MPS does while a client thread waits
+ * for it: polling, stepping, parking, starting a collection, and
+ * handling a barrier hit.  Calls may nest, in which case only the
+ * outermost pair is timed, and the pause is recorded if any of them
+ * did some work.  Work on the background collector thread is not a
+ * pause.  See <design/arena/#pause>.
+ */
+
+void ArenaPauseBegin(Arena arena)
+{
+  AVERT(Arena, arena);
+  if (ArenaGlobals(arena)->insideBackground)
+    return;
+  if (arena->pauseDepth == 0) {
+    arena->pauseStart = ClockNow();
+    arena->pauseWork = FALSE;
+  }
+  ++arena->pauseDepth;
+}
+
+void ArenaPauseEnd(Arena arena, Bool work)
+{
+  AVERT(Arena, arena);
+  AVERT(Bool, work);
+  if (ArenaGlobals(arena)->insideBackground)
+    return;
+  AVER(arena->pauseDepth > 0);
+  if (work)
+    arena->pauseWork = TRUE;
+  --arena->pauseDepth;
+  if (arena->pauseDepth == 0 && arena->pauseWork)
+    arenaPauseRecord(arena, arena->pauseStart, ClockNow());
+}
+
+
+/* ArenaPauseCurrent -- time so far in the pause being timed, if any */
+
+double ArenaPauseCurrent(Arena arena)
+{
+  AVERT(Arena, arena);
+  if (arena->pauseDepth == 0 || ArenaGlobals(arena)->insideBackground)
+    return 0.0;
+  return (double)(ClockNow() - arena->pauseStart) / (double)ClocksPerSec();
+}
+
+
+/* ArenaStatsGet -- take a snapshot of the arena's statistics
+ *
+ * See <design/arena/#stats>.  All the counters are kept in every
+ * variety, so this is cheap enough to call from a sampling thread.
+ */
+
+void ArenaStatsGet(ArenaStats stats, Arena arena)
+{
+  Globals arenaGlobals;
+  Index i;
+
+  AVER(stats != NULL);
+  AVERT(Arena, arena);
+
+  arenaGlobals = ArenaGlobals(arena);
+  stats->traces = arena->traceCount;
+  for (i = 0; i < NELEMS(stats->genCollections); ++i)
+    stats->genCollections[i] = LocusGenCollections(arena, i);
+  stats->flips = arena->flipCount;
+  stats->allocated = arenaGlobals->fillMutatorSize
+                     - arenaGlobals->emptyMutatorSize;
+  stats->forwarded = arena->forwardedSize;
+  stats->reclaimed = arena->reclaimedSize;
+  stats->readBarrierHits = arena->readBarrierHitCount;
+  stats->writeBarrierHits = arena->writeBarrierHitCount;
+  stats->pauseTime = arena->pauseTotal;
+  stats->backgroundTime = arena->backgroundTime;
+  stats->spareCommitted = arena->spareCommitted;
+  stats->greySegs = arena->greySegCount;
+  stats->pauses = arena->pauseCount;
+  stats->pauseMax = arena->pauseMax;
+  for (i = 0; i < NELEMS(stats->pauseHist); ++i)
+    stats->pauseHist[i] = arena->pauseHist[i];
+  for (i = 0; i < NELEMS(stats->mmu); ++i)
+    stats->mmu[i] = arena->mmu[i];
 }
 
 
@@ -402,7 +402,8 @@ static void testAllocAndIterate(Arena arena, Pool pool,
 }
 
 
-static void testPageTable(ArenaClass klass, Size size, Addr addr, Bool zoned)
+static void testPageTable(ArenaClass klass, Size size, Addr addr, Bool zoned,
+                          Bool huge, Bool lazy)
 {
   Arena arena; Pool pool;
   Size pageSize;
@@ -412,6 +413,8 @@ static void testPageTable(ArenaClass klass, Size size, Addr addr, Bool zoned)
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, size);
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_CL_BASE, addr);
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_ZONED, zoned);
+    MPS_ARGS_ADD(args, MPS_KEY_VM_HUGE_PAGES, huge);
+    MPS_ARGS_ADD(args, MPS_KEY_VM_LAZY_PURGE, lazy);
     die(ArenaCreate(&arena, klass, args), "ArenaCreate");
   } MPS_ARGS_END(args);
 
@@ -433,6 +436,111 @@ static void testPageTable(ArenaClass klass, Size size, Addr addr, Bool zoned)
   die(ArenaDescribeTracts(arena, mps_lib_get_stdout(), 0),
       "ArenaDescribeTracts");
 
+  /* Spare memory must be purgeable even if it is in huge pages that
+     can't be unmapped whole. <design/arenavm/#spare.huge> */
+  ArenaSetSpareCommitLimit(arena, 0);
+  Insist(ArenaSpareCommitted(arena) == 0);
+
+  /* Allocating again must reuse any pages that were purged lazily.
+     <design/arenavm/#spare.lazy> */
+  testAllocAndIterate(arena, pool, pageSize, tractsPerPage,
+                      &allocatorTractStruct);
+
+  PoolDestroy(pool);
+  ArenaDestroy(arena);
+}
+
+
+/* testNUMA -- test allocation on NUMA nodes
+ *
+ * Fakes a topology of four nodes with the calling thread on node 2,
+ * where the platform supports that, and checks that allocations are
+ * placed on the preferred node.  See <design/arena/#numa>.
+ */
+
+static void testNUMA(Size size)
+{
+  Arena arena; Pool pool;
+  Size allocSize;
+  Index node, expected;
+  Addr base;
+  Chunk chunk;
+  LocusPrefStruct pref;
+  int i;
+
+  setenv("MPS_NUMA_FAKE", "4:2", 1);
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, size);
+    MPS_ARGS_ADD(args, MPS_KEY_VM_NUMA, TRUE);
+    die(ArenaCreate(&arena, (ArenaClass)mps_arena_class_vm(), args),
+        "ArenaCreate");
+  } MPS_ARGS_END(args);
+  printf("%lu NUMA nodes.\n", (unsigned long)arena->nodes);
+  Insist(arena->nodes == 1 || arena->nodes == 4);
+  expected = arena->nodes > 1 ? 2 : 0;
+  Insist(ChunkNode(arena->primary) == expected);
+
+  die(PoolCreate(&pool, arena, PoolClassMV(), argsNone), "PoolCreate");
+  allocSize = 16 * ArenaGrainSize(arena);
+
+  /* Twice round, so that the second allocations reuse the chunks
+     created by the first. */
+  for (i = 0; i < 2; ++i) {
+    for (node = 0; node < arena->nodes; ++node) {
+      LocusPrefInit(&pref);
+      LocusPrefExpress(&pref, LocusPrefNODE, &node);
+      die(ArenaAlloc(&base, &pref, allocSize, pool), "ArenaAlloc");
+      Insist(ChunkOfAddr(&chunk, arena, base));
+      Insist(ChunkNode(chunk) == node);
+      ArenaFree(base, allocSize, pool);
+    }
+  }
+
+  /* Without a node, allocation is on the calling thread's node. */
+  die(ArenaAlloc(&base, LocusPrefDefault(), allocSize, pool), "ArenaAlloc");
+  Insist(ChunkOfAddr(&chunk, arena, base));
+  Insist(ChunkNode(chunk) == expected);
+  ArenaFree(base, allocSize, pool);
+
+  PoolDestroy(pool);
+  ArenaDestroy(arena);
+  setenv("MPS_NUMA_FAKE", "", 1);
+}
+
+
+/* testDeferredPurge -- test deferred purging of spare memory
+ *
+ * Frees more than the spare commit limit with purging deferred, and
+ * checks that ArenaPurgeSpareStep eventually purges the excess.  See
+ * <design/arena/#spare.deferred>.
+ */
+
+static void testDeferredPurge(Size size)
+{
+  Arena arena; Pool pool;
+  Size spareLimit, allocSize;
+  Addr base;
+  Count steps;
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, size);
+    MPS_ARGS_ADD(args, MPS_KEY_SPARE_PURGE_RATE, 1e9);
+    die(ArenaCreate(&arena, (ArenaClass)mps_arena_class_vm(), args),
+        "ArenaCreate");
+  } MPS_ARGS_END(args);
+  die(PoolCreate(&pool, arena, PoolClassMV(), argsNone), "PoolCreate");
+
+  spareLimit = 4 * ArenaGrainSize(arena);
+  ArenaSetSpareCommitLimit(arena, spareLimit);
+  allocSize = 64 * ArenaGrainSize(arena);
+  die(ArenaAlloc(&base, LocusPrefDefault(), allocSize, pool), "ArenaAlloc");
+  ArenaFree(base, allocSize, pool);
+  Insist(ArenaSpareCommitted(arena) > spareLimit);
+
+  for (steps = 0; ArenaSpareCommitted(arena) > spareLimit; ++steps)
+    (void)ArenaPurgeSpareStep(arena, 0.001);
+  printf("Deferred purge took %lu steps.\n", (unsigned long)steps);
+
   PoolDestroy(pool);
   ArenaDestroy(arena);
 }
@@ -473,12 +581,22 @@ int main(int argc, char *argv[])
 
   testlib_init(argc, argv);
 
-  testPageTable((ArenaClass)mps_arena_class_vm(), TEST_ARENA_SIZE, 0, TRUE);
-  testPageTable((ArenaClass)mps_arena_class_vm(), TEST_ARENA_SIZE, 0, FALSE);
+  testPageTable((ArenaClass)mps_arena_class_vm(), TEST_ARENA_SIZE, 0, TRUE,
+                FALSE, FALSE);
+  testPageTable((ArenaClass)mps_arena_class_vm(), TEST_ARENA_SIZE, 0, FALSE,
+                FALSE, FALSE);
+  testPageTable((ArenaClass)mps_arena_class_vm(), TEST_ARENA_SIZE, 0, TRUE,
+                TRUE, FALSE);
+  testPageTable((ArenaClass)mps_arena_class_vm(), TEST_ARENA_SIZE, 0, TRUE,
+                FALSE, TRUE);
 
   block = malloc(TEST_ARENA_SIZE);
   cdie(block != NULL, "malloc");
-  testPageTable((ArenaClass)mps_arena_class_cl(), TEST_ARENA_SIZE, block, FALSE);
+  testPageTable((ArenaClass)mps_arena_class_cl(), TEST_ARENA_SIZE, block, FALSE,
+                FALSE, FALSE);
+
+  testNUMA(TEST_ARENA_SIZE);
+  testDeferredPurge(TEST_ARENA_SIZE);
 
   testSize(TEST_ARENA_SIZE);
 
@@ -73,6 +73,8 @@ typedef struct VMArenaStruct {  /* VM arena structure */
   VMStruct vmStruct;            /* VM descriptor for VM containing arena */
   char vmParams[VMParamSize];   /* VM parameter block */
   Size spareSize;               /* total size of spare pages */
+  Bool lazyPurge;               /* purge spare pages without unmapping? */
+  Size releasedSize;            /* total size of released pages */
   Size extendBy;                /* desired arena increment */
   Size extendMin;               /* minimum arena increment */
   ArenaVMExtendedCallback extended;
@@ -88,6 +90,7 @@ typedef struct VMArenaStruct {  /* VM arena structure */
 
 static Size VMPurgeSpare(Arena arena, Size size);
 static void chunkUnmapSpare(Chunk chunk);
+static void chunkUnmapReleased(Chunk chunk);
 DECLARE_CLASS(Arena, VMArena, AbstractArena);
 static void VMCompact(Arena arena, Trace trace);
 
@@ -165,6 +168,9 @@ static Bool VMArenaCheck(VMArena vmArena)
   CHECKD(Arena, arena);
   /* spare pages are committed, so must be less spare than committed. */
   CHECKL(vmArena->spareSize <= arena->committed);
+  CHECKL(BoolCheck(vmArena->lazyPurge));
+  /* <design/arenavm/#spare.lazy> */
+  CHECKL(vmArena->lazyPurge || vmArena->releasedSize == 0);
 
   CHECKL(vmArena->extendBy > 0);
   CHECKL(vmArena->extendMin <= vmArena->extendBy);
@@ -173,8 +179,10 @@ static Bool VMArenaCheck(VMArena vmArena)
     primary = Chunk2VMChunk(arena->primary);
     CHECKD(VMChunk, primary);
     /* We could iterate over all chunks accumulating an accurate */
-    /* count of committed, but we don't have all day. */
-    CHECKL(VMMapped(VMChunkVM(primary)) <= arena->committed);
+    /* count of committed, but we don't have all day. Released pages */
+    /* are mapped but not committed. */
+    CHECKL(VMMapped(VMChunkVM(primary))
+           <= arena->committed + vmArena->releasedSize);
   }
   
   CHECKD_NOSIG(Ring, &vmArena->spareRing);
@@ -204,6 +212,8 @@ static Res VMArenaDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
 
   res = WriteF(stream, depth,
                "  spareSize:     $U\n", (WriteFU)vmArena->spareSize,
+               "  lazyPurge:     $S\n", WriteFYesNo(vmArena->lazyPurge),
+               "  releasedSize:  $U\n", (WriteFU)vmArena->releasedSize,
                NULL);
   if(res != ResOK)
     return res;
@@ -263,7 +273,8 @@ static void vmArenaUnmap(VMArena vmArena, VM vm, Addr base, Addr limit)
  * vmArena, the parent VMArena.
  * size, approximate amount of virtual address that the chunk should reserve.
  */
-static Res VMChunkCreate(Chunk *chunkReturn, VMArena vmArena, Size size)
+static Res VMChunkCreate(Chunk *chunkReturn, VMArena vmArena, Size size,
+                         Index node)
 {
   Arena arena = MustBeA(AbstractArena, vmArena);
   Res res;
@@ -278,10 +289,14 @@ static Res VMChunkCreate(Chunk *chunkReturn, VMArena vmArena, Size size)
   AVER(chunkReturn != NULL);
   AVERT(VMArena, vmArena);
   AVER(size > 0);
+  AVER(node < arena->nodes);
 
   res = VMInit(vm, size, ArenaGrainSize(arena), vmArena->vmParams);
   if (res != ResOK)
     goto failVMInit;
+  /* <design/arenavm/#numa> */
+  if (arena->nodes > 1)
+    VMBind(vm, node);
 
   base = VMBase(vm);
   limit = VMLimit(vm);
@@ -308,6 +323,7 @@ static Res VMChunkCreate(Chunk *chunkReturn, VMArena vmArena, Size size)
                   VMReserved(VMChunkVM(vmChunk)), boot);
   if (res != ResOK)
     goto failChunkInit;
+  VMChunk2Chunk(vmChunk)->node = node;
 
   BootBlockFinish(boot);
 
@@ -407,6 +423,7 @@ static Bool vmChunkDestroy(Tree tree, void *closure)
   AVERT(VMChunk, vmChunk);
   
   chunkUnmapSpare(chunk);
+  chunkUnmapReleased(chunk);
   
   SparseArrayFinish(&vmChunk->pages);
   
@@ -549,6 +566,8 @@ static Res VMArenaCreate(Arena *arenaReturn, ArgList args)
   Size size = VM_ARENA_SIZE_DEFAULT; /* initial arena size */
   Align grainSize = MPS_PF_ALIGN; /* arena grain size */
   Size pageSize = PageSize(); /* operating system page size */
+  Bool lazyPurge = VM_ARENA_LAZY_PURGE_DEFAULT;
+  Bool numa = VM_ARENA_NUMA_DEFAULT;
   Size chunkSize; /* size actually created */
   Size vmArenaSize; /* aligned size of VMArenaStruct */
   Res res;
@@ -576,6 +595,12 @@ static Res VMArenaCreate(Arena *arenaReturn, ArgList args)
     /* There has to be enough room in the chunk for a full complement of
        zones. Make it easier to write portable programs by rounding up. */
     size = grainSize * MPS_WORD_WIDTH;
+
+  if (ArgPick(&arg, args, MPS_KEY_VM_LAZY_PURGE))
+    lazyPurge = arg.val.b;
+
+  if (ArgPick(&arg, args, MPS_KEY_VM_NUMA))
+    numa = arg.val.b;
   
   /* Parse remaining arguments, if any, into VM parameters. We must do
      this into some stack-allocated memory for the moment, since we
@@ -605,10 +630,14 @@ static Res VMArenaCreate(Arena *arenaReturn, ArgList args)
   
   arena->reserved = VMReserved(vm);
   arena->committed = VMMapped(vm);
+  if (numa)
+    arena->nodes = VMNodeCount();
 
   /* Copy VM descriptor into its place in the arena. */
   VMCopy(VMArenaVM(vmArena), vm);
   vmArena->spareSize = 0;
+  vmArena->lazyPurge = lazyPurge;
+  vmArena->releasedSize = 0;
   RingInit(&vmArena->spareRing);
 
   /* Copy the stack-allocated VM parameters into their home in the VMArena. */
@@ -629,7 +658,8 @@ static Res VMArenaCreate(Arena *arenaReturn, ArgList args)
 
   /* have to have a valid arena before calling ChunkCreate */
   vmArena->sig = VMArenaSig;
-  res = VMChunkCreate(&chunk, vmArena, size);
+  res = VMChunkCreate(&chunk, vmArena, size,
+                      PolicyNode(arena, LocusPrefDefault()));
   if (res != ResOK)
     goto failChunkCreate;
 
@@ -693,8 +723,10 @@ static void VMArenaDestroy(Arena arena)
   TreeTraverseAndDelete(&arena->chunkTree, vmChunkDestroy,
                         UNUSED_POINTER);
   
-  /* Destroying the chunks should have purged and removed all spare pages. */
+  /* Destroying the chunks should have purged and removed all spare pages,
+     and unmapped all released pages. */
   RingFinish(&vmArena->spareRing);
+  AVER(vmArena->releasedSize == 0);
 
   /* Destroying the chunks should leave only the arena's own VM. */
   AVER(arena->reserved == VMReserved(VMArenaVM(vmArena)));
@@ -723,11 +755,12 @@ static Res VMArenaGrow(Arena arena, LocusPref pref, Size size)
   Chunk newChunk;
   Size chunkSize;
   Size chunkMin;
+  Index node;
   Res res;
   
   /* TODO: Ensure that extended arena will be able to satisfy pref. */
   AVERT(LocusPref, pref);
-  UNUSED(pref);
+  node = PolicyNode(arena, pref);
 
   res = vmArenaChunkSize(&chunkMin, vmArena, size);
   if (res != ResOK)
@@ -759,7 +792,7 @@ static Res VMArenaGrow(Arena arena, LocusPref pref, Size size)
           EVENT2(vmArenaExtendFail, chunkMin, ArenaReserved(arena));
           return res;
         }
-        res = VMChunkCreate(&newChunk, vmArena, chunkSize);
+        res = VMChunkCreate(&newChunk, vmArena, chunkSize, node);
         if(res == ResOK)
           goto vmArenaGrow_Done;
       }
@@ -835,13 +868,115 @@ static void pageDescUnmap(VMChunk vmChunk, Index basePI, Index limitPI)
 }
 
 
+/* pagesExtendHuge -- extend a range of pages to be mapped to huge pages
+ *
+ * The kernel can only back memory with a huge page if the whole huge
+ * page is mapped when it is first touched, so extend the range of
+ * unmapped pages [*baseIO, *limitIO) to the boundaries of the huge
+ * pages containing it, as far as the adjacent pages are unmapped, and
+ * as long as this would not exceed the commit limit.  See
+ * <design/arenavm/#spare.huge>.
+ */
+
+static void pagesExtendHuge(VMChunk vmChunk, Index *baseIO, Index *limitIO)
+{
+  Chunk chunk = VMChunk2Chunk(vmChunk);
+  Arena arena = ChunkArena(chunk);
+  Size hugePageSize = VMHugePageSize(VMChunkVM(vmChunk));
+  Count hugePages;
+  Index base = *baseIO, limit = *limitIO, hugeBase, hugeLimit;
+
+  if (hugePageSize <= ChunkPageSize(chunk))
+    return;
+
+  /* The chunk base is aligned to huge pages, so page indexes are too.
+     See <design/vm/#impl.ix.huge>. */
+  AVER(AddrIsAligned(chunk->base, hugePageSize));
+  hugePages = ChunkSizeToPages(chunk, hugePageSize);
+  hugeBase = base - base % hugePages;
+  if (hugeBase < chunk->allocBase) /* don't extend into chunk overhead */
+    hugeBase = chunk->allocBase;
+  hugeLimit = limit + (hugePages - limit % hugePages) % hugePages;
+  if (hugeLimit > chunk->pages)
+    hugeLimit = chunk->pages;
+
+  while (base > hugeBase && !BTGet(vmChunk->pages.mapped, base - 1))
+    --base;
+  while (limit < hugeLimit && !BTGet(vmChunk->pages.mapped, limit))
+    ++limit;
+
+  if (arena->commitLimit < arena->committed
+                           + ChunkPagesToSize(chunk, limit - base))
+    return;
+
+  *baseIO = base;
+  *limitIO = limit;
+}
+
+
+/* pageInitSpare -- initialize a newly mapped page as spare */
+
+static void pageInitSpare(VMArena vmArena, Chunk chunk, Index pi)
+{
+  Arena arena = MustBeA(AbstractArena, vmArena);
+  Page page = ChunkPage(chunk, pi);
+
+  /* Compare VMFree. */
+  PageInit(chunk, pi);
+  PageSetPool(page, NULL);
+  PageSetType(page, PageStateSPARE);
+  RingInit(PageSpareRing(page));
+  RingAppend(&vmArena->spareRing, PageSpareRing(page));
+  arena->spareCommitted += ChunkPageSize(chunk);
+}
+
+
+/* pagesAllocMapped -- allocate a range of pages that are already mapped
+ *
+ * The pages are spare, or released (<design/arenavm/#spare.lazy>).
+ * Released pages need committing again, which needs no system call,
+ * but does count against the commit limit.
+ */
+
+static Res pagesAllocMapped(VMArena vmArena, VMChunk vmChunk,
+                            Index basePI, Index limitPI, Pool pool)
+{
+  Chunk chunk = VMChunk2Chunk(vmChunk);
+  Index pi;
+
+  if (vmArena->lazyPurge) {
+    Arena arena = MustBeA(AbstractArena, vmArena);
+    Size released = 0;
+    for (pi = basePI; pi < limitPI; ++pi)
+      if (PageState(ChunkPage(chunk, pi)) == PageStateRELEASED)
+        released += ChunkPageSize(chunk);
+    if (released > 0) {
+      if (arena->commitLimit < arena->committed + released)
+        return ResCOMMIT_LIMIT;
+      arena->committed += released;
+      AVER(vmArena->releasedSize >= released);
+      vmArena->releasedSize -= released;
+    }
+  }
+
+  for (pi = basePI; pi < limitPI; ++pi) {
+    if (PageState(ChunkPage(chunk, pi)) == PageStateSPARE)
+      sparePageRelease(vmChunk, pi);
+    else
+      AVER(PageState(ChunkPage(chunk, pi)) == PageStateRELEASED);
+    PageAlloc(chunk, pi, pool);
+  }
+  return ResOK;
+}
+
+
 /* pagesMarkAllocated -- Mark the pages allocated */
 
 static Res pagesMarkAllocated(VMArena vmArena, VMChunk vmChunk,
                               Index basePI, Count pages, Pool pool)
 {
   Index cursor, i, j, k;
-  Index limitPI;
+  Index limitPI, mapBasePI, mapLimitPI;
   Chunk chunk = VMChunk2Chunk(vmChunk);
   Res res;
   
@@ -854,33 +989,43 @@ static Res pagesMarkAllocated(VMArena vmArena, VMChunk vmChunk,
 
   cursor = basePI;
   while (BTFindLongResRange(&j, &k, vmChunk->pages.mapped, cursor, limitPI, 1)) {
-    for (i = cursor; i < j; ++i) {
-      sparePageRelease(vmChunk, i);
-      PageAlloc(chunk, i, pool);
+    res = pagesAllocMapped(vmArena, vmChunk, cursor, j, pool);
+    if (res != ResOK) {
+      j = cursor;
+      goto failSAMap;
     }
-    res = pageDescMap(vmChunk, j, k);
+    mapBasePI = j;
+    mapLimitPI = k;
+    pagesExtendHuge(vmChunk, &mapBasePI, &mapLimitPI);
+    res = pageDescMap(vmChunk, mapBasePI, mapLimitPI);
     if (res != ResOK)
       goto failSAMap;
     res = vmArenaMap(vmArena, VMChunkVM(vmChunk),
-                     PageIndexBase(chunk, j), PageIndexBase(chunk, k));
+                     PageIndexBase(chunk, mapBasePI),
+                     PageIndexBase(chunk, mapLimitPI));
     if (res != ResOK)
       goto failVMMap;
+    for (i = mapBasePI; i < j; ++i)
+      pageInitSpare(vmArena, chunk, i);
     for (i = j; i < k; ++i) {
       PageInit(chunk, i);
       PageAlloc(chunk, i, pool);
     }
+    for (i = k; i < mapLimitPI; ++i)
+      pageInitSpare(vmArena, chunk, i);
     cursor = k;
     if (cursor == limitPI)
       return ResOK;
   }
-  for (i = cursor; i < limitPI; ++i) {
-    sparePageRelease(vmChunk, i);
-    PageAlloc(chunk, i, pool);
+  res = pagesAllocMapped(vmArena, vmChunk, cursor, limitPI, pool);
+  if (res != ResOK) {
+    j = cursor;
+    goto failSAMap;
   }
   return ResOK;
 
 failVMMap:
-  pageDescUnmap(vmChunk, j, k);
+  pageDescUnmap(vmChunk, mapBasePI, mapLimitPI);
 failSAMap:
   /* region from basePI to j needs deallocating */
   /* TODO: Consider making pages spare instead, then purging. */
@@ -942,6 +1087,75 @@ static Bool VMChunkPageMapped(Chunk chunk, Index index)
 }
 
 
+/* chunkPurgePages -- return a range of spare pages to the OS
+ *
+ * The pages must already have been removed from the spare ring by
+ * sparePageRelease.  They are unmapped, unless the arena purges
+ * lazily, in which case they stay mapped but their contents are
+ * released to the OS.  See <design/arenavm/#spare.lazy>.
+ */
+
+static void chunkPurgePages(VMChunk vmChunk, Index basePI, Index limitPI)
+{
+  Chunk chunk = VMChunk2Chunk(vmChunk);
+  VMArena vmArena = VMChunkVMArena(vmChunk);
+  Addr base = PageIndexBase(chunk, basePI);
+  Addr limit = PageIndexBase(chunk, limitPI);
+
+  if (vmArena->lazyPurge) {
+    Arena arena = MustBeA(AbstractArena, vmArena);
+    Size size = AddrOffset(base, limit);
+    Index pi;
+    VMPurge(VMChunkVM(vmChunk), base, limit);
+    for (pi = basePI; pi < limitPI; ++pi) {
+      Page page = ChunkPage(chunk, pi);
+      PageSetPool(page, NULL);
+      PageSetType(page, PageStateRELEASED);
+    }
+    AVER(arena->committed >= size);
+    arena->committed -= size;
+    vmArena->releasedSize += size;
+  } else {
+    vmArenaUnmap(vmArena, VMChunkVM(vmChunk), base, limit);
+    pageDescUnmap(vmChunk, basePI, limitPI);
+  }
+}
+
+
+/* chunkUnmapReleased -- unmap all released pages in a chunk */
+
+static void chunkUnmapReleased(Chunk chunk)
+{
+  VMChunk vmChunk = Chunk2VMChunk(chunk);
+  VMArena vmArena = VMChunkVMArena(vmChunk);
+  Index basePI, limitPI;
+
+  if (vmArena->releasedSize == 0)
+    return;
+
+  basePI = chunk->allocBase;
+  while (basePI < chunk->pages) {
+    Size size;
+    if (pageState(vmChunk, basePI) != PageStateRELEASED) {
+      ++basePI;
+      continue;
+    }
+    limitPI = basePI + 1;
+    while (limitPI < chunk->pages
+           && pageState(vmChunk, limitPI) == PageStateRELEASED)
+      ++limitPI;
+    /* Released pages are not committed, so don't use vmArenaUnmap. */
+    size = ChunkPagesToSize(chunk, limitPI - basePI);
+    VMUnmap(VMChunkVM(vmChunk), PageIndexBase(chunk, basePI),
+            PageIndexBase(chunk, limitPI));
+    AVER(vmArena->releasedSize >= size);
+    vmArena->releasedSize -= size;
+    pageDescUnmap(vmChunk, basePI, limitPI);
+    basePI = limitPI;
+  }
+}
+
+
 /* chunkUnmapAroundPage -- unmap spare pages in a chunk including this one
  *
  * Unmap the spare page passed, and possibly other pages in the chunk,
@@ -988,12 +1202,81 @@ static Size chunkUnmapAroundPage(Chunk chunk, Size size, Page page)
     purged += pageSize;
   }
 
-  vmArenaUnmap(VMChunkVMArena(vmChunk),
-               VMChunkVM(vmChunk),
-               PageIndexBase(chunk, basePI),
-               PageIndexBase(chunk, limitPI));
+  chunkPurgePages(vmChunk, basePI, limitPI);
+
+  return purged;
+}
+
+
+/* chunkHugePageSpare -- is a huge page of a chunk entirely spare?
+ *
+ * hugePI is the index of the first page in the huge page, and
+ * hugePages is the number of pages in a huge page.
+ */
+
+static Bool chunkHugePageSpare(VMChunk vmChunk, Index hugePI, Count hugePages)
+{
+  Chunk chunk = VMChunk2Chunk(vmChunk);
+  Index pi;
+
+  if (hugePI + hugePages > chunk->pages)
+    return FALSE;
+  for (pi = hugePI; pi < hugePI + hugePages; ++pi)
+    if (pageState(vmChunk, pi) != PageStateSPARE)
+      return FALSE;
+  return TRUE;
+}
+
+
+/* chunkUnmapAroundHugePage -- unmap whole spare huge pages around a page
+ *
+ * Like chunkUnmapAroundPage, but only unmaps whole huge pages, so as
+ * not to split them.  If the huge page containing the page passed is
+ * not entirely spare, nothing is unmapped, the page stays on the
+ * spare ring, and zero is returned.  The amount unmapped may exceed
+ * the size by up to one huge page.  See <design/arenavm/#spare.huge>.
+ */
+
+static Size chunkUnmapAroundHugePage(Chunk chunk, Size size, Page page,
+                                     Size hugePageSize)
+{
+  VMChunk vmChunk;
+  Size purged;
+  Count hugePages;
+  Index pi, basePI, limitPI;
+
+  AVERT(Chunk, chunk);
+  vmChunk = Chunk2VMChunk(chunk);
+  AVERT(VMChunk, vmChunk);
+  AVER(PageState(page) == PageStateSPARE);
+  AVER(SizeIsAligned(hugePageSize, ChunkPageSize(chunk)));
+  /* The chunk base is aligned to huge pages, so page indexes are too.
+     See <design/vm/#impl.ix.huge>. */
+  AVER(AddrIsAligned(chunk->base, hugePageSize));
+
+  hugePages = ChunkSizeToPages(chunk, hugePageSize);
+  pi = (Index)(page - chunk->pageTable);
+  AVER(pi < chunk->pages); /* page is within chunk's page table */
+  basePI = pi - pi % hugePages;
+  if (!chunkHugePageSpare(vmChunk, basePI, hugePages))
+    return 0;
+  limitPI = basePI + hugePages;
+  purged = hugePageSize;
+
+  while (purged < size && chunkHugePageSpare(vmChunk, limitPI, hugePages)) {
+    limitPI += hugePages;
+    purged += hugePageSize;
+  }
+  while (purged < size && basePI >= hugePages
+         && chunkHugePageSpare(vmChunk, basePI - hugePages, hugePages)) {
+    basePI -= hugePages;
+    purged += hugePageSize;
+  }
+
+  for (pi = basePI; pi < limitPI; ++pi)
+    sparePageRelease(vmChunk, pi);
 
-  pageDescUnmap(vmChunk, basePI, limitPI);
+  chunkPurgePages(vmChunk, basePI, limitPI);
 
   return purged;
 }
@@ -1003,10 +1286,12 @@ static Size chunkUnmapAroundPage(Chunk chunk, Size size, Page page)
  *
  * The size is the desired amount to purge, and the amount that was purged is
  * returned.  If filter is not NULL, then only pages within that chunk are
- * unmapped.
+ * unmapped.  If huge is TRUE and the VM uses huge pages, then only
+ * whole huge pages are unmapped, so less than the desired amount may
+ * be purged even if there are enough spare pages.
  */
 
-static Size arenaUnmapSpare(Arena arena, Size size, Chunk filter)
+static Size arenaUnmapSpare(Arena arena, Size size, Chunk filter, Bool huge)
 {
   VMArena vmArena = MustBeA(VMArena, arena);
   Ring node;
@@ -1014,6 +1299,7 @@ static Size arenaUnmapSpare(Arena arena, Size size, Chunk filter)
 
   if (filter != NULL)
     AVERT(Chunk, filter);
+  AVERT(Bool, huge);
 
   /* Start by looking at the oldest page on the spare ring, to try to
      get some LRU behaviour from the spare pages cache. */
@@ -1032,7 +1318,19 @@ static Size arenaUnmapSpare(Arena arena, Size size, Chunk filter)
     b = ChunkOfAddr(&chunk, arena, (Addr)page);
     AVER(b);
     if (filter == NULL || chunk == filter) {
-      purged += chunkUnmapAroundPage(chunk, size - purged, page);
+      Size hugePageSize = VMHugePageSize(VMChunkVM(Chunk2VMChunk(chunk)));
+      if (huge && hugePageSize > ChunkPageSize(chunk)) {
+        Size unmapped = chunkUnmapAroundHugePage(chunk, size - purged, page,
+                                                 hugePageSize);
+        if (unmapped == 0) {
+          /* The rest of the huge page is still in use: skip it. */
+          node = next;
+          continue;
+        }
+        purged += unmapped;
+      } else {
+        purged += chunkUnmapAroundPage(chunk, size - purged, page);
+      }
       /* chunkUnmapAroundPage must delete the page it's passed from the ring,
          or we can't make progress and there will be an infinite loop */
       AVER(RingNext(node) != next);
@@ -1043,9 +1341,18 @@ static Size arenaUnmapSpare(Arena arena, Size size, Chunk filter)
   return purged;
 }
 
+/* VMPurgeSpare -- purge spare memory
+ *
+ * Prefer to unmap whole huge pages, but split them if that's the only
+ * way to purge the size requested. See <design/arenavm/#spare.huge>.
+ */
+
 static Size VMPurgeSpare(Arena arena, Size size)
 {
-  return arenaUnmapSpare(arena, size, NULL);
+  Size purged = arenaUnmapSpare(arena, size, NULL, TRUE);
+  if (purged < size)
+    purged += arenaUnmapSpare(arena, size - purged, NULL, FALSE);
+  return purged;
 }
 
 
@@ -1054,7 +1361,9 @@ static Size VMPurgeSpare(Arena arena, Size size)
 static void chunkUnmapSpare(Chunk chunk)
 {
   AVERT(Chunk, chunk);
-  (void)arenaUnmapSpare(ChunkArena(chunk), ChunkSize(chunk), chunk);
+  /* The chunk is about to be destroyed, so unmap everything, even
+     partial huge pages. */
+  (void)arenaUnmapSpare(ChunkArena(chunk), ChunkSize(chunk), chunk, FALSE);
 }
 
 
@@ -1111,7 +1420,10 @@ static void VMFree(Addr base, Size size, Pool pool)
   /* TODO: Chunks are only destroyed when ArenaCompact is called, and
      that is only called from traceReclaim. Should consider destroying
      chunks here. See job003815. */
-  if (arena->spareCommitted > arena->spareCommitLimit) {
+  /* Unless purging is deferred to ArenaPurgeSpareStep, see
+     <design/arena/#spare.deferred>. */
+  if (!ArenaSparePurgeDeferred(arena)
+      && arena->spareCommitted > arena->spareCommitLimit) {
     /* Purge half of the spare memory, not just the extra sliver, so
        that we return a reasonable amount of memory in one go, and avoid
        lots of small unmappings, each of which has an overhead. */
@@ -285,7 +285,9 @@ void BufferDetach(Buffer buffer, Pool pool)
     limit = buffer->poolLimit;
     /* Ask the owning pool to do whatever it needs to before the */
     /* buffer is detached (e.g. copy buffer state into pool state). */
+    PoolLockClaim(pool);
     Method(Pool, pool, bufferEmpty)(pool, buffer, init, limit);
+    PoolLockRelease(pool);
 
     /* run any class-specific detachment method */
     Method(Buffer, buffer, detach)(buffer);
@@ -550,6 +552,12 @@ void BufferAttach(Buffer buffer, Addr base, Addr limit,
   /* run any class-specific attachment method */
   Method(Buffer, buffer, attach)(buffer, base, limit, init, size);
 
+  /* The mutator doesn't mark cards when initializing new objects, so
+     mark them all now.  <design/write-barrier/#card.buffer> */
+  if (ArenaCardMarking(buffer->arena)
+      && BufferRankSet(buffer) != RankSetEMPTY)
+    CardSetDirty(buffer->arena, base, limit);
+
   AVERT(Buffer, buffer);
   EVENT4(BufferFill, buffer, size, base, filled);
 }
@@ -604,7 +612,9 @@ Res BufferFill(Addr *pReturn, Buffer buffer, Size size)
   BufferDetach(buffer, pool);
 
   /* Ask the pool for some memory. */
+  PoolLockClaim(pool);
   res = Method(Pool, pool, bufferFill)(&base, &limit, pool, buffer, size);
+  PoolLockRelease(pool);
   if (res != ResOK)
     return res;
 
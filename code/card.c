@@ -0,0 +1,329 @@
+/* card.c: CARD MARKING WRITE BARRIER
+ *
+ * $Id$
+ * Copyright (c) 2016 Ravenbrook Limited.  See end of file for license.
+ *
+ * .sources: <design/write-barrier/#card>.
+ *
+ * .purpose: When the client creates an arena with card marking, the
+ * MPS does not protect segments to find out when the mutator writes
+ * references into them.  Instead the mutator marks the card it wrote
+ * to with MPS_WRITE_BARRIER, and the collector treats a segment with
+ * dirty cards as if it might refer to any zone.
+ *
+ * .table: The card table has one byte for each card, indexed by the
+ * card's address modulo the size of the table, so that the client
+ * can mark a card without looking up its chunk.  Chunks whose cards
+ * collide in the table share entries: see .shared.
+ */
+
+#include "bt.h"
+#include "mpm.h"
+
+SRCID(card, "$Id$");
+
+
+/* cardIndex -- index in the card table of the card containing addr */
+
+#define cardIndex(cards, addr) \
+  (((Word)(addr) >> (cards)->_shift) & (cards)->_mask)
+
+
+/* CardTableInit -- initialize the card marking fields of the arena
+ *
+ * Until CardTableCreate is called, and always when card marking is
+ * off, the card table is a single dummy entry, so that
+ * MPS_WRITE_BARRIER is harmless.
+ */
+
+void CardTableInit(Arena arena, Bool cardMarking)
+{
+  AVER(arena != NULL);
+  AVERT(Bool, cardMarking);
+
+  arena->cardMarking = cardMarking;
+  arena->cardDummy = 0;
+  arena->cardsStruct._table = &arena->cardDummy;
+  arena->cardsStruct._shift = 0;
+  arena->cardsStruct._mask = 0;
+  arena->cardTableLength = 0;
+  arena->cardCovered = NULL;
+  arena->cardShared = NULL;
+}
+
+
+/* CardTableCreate -- allocate the card table
+ *
+ * Called once the control pool is ready.  The table covers the
+ * arena's initial reserved address space without collisions.
+ */
+
+Res CardTableCreate(Arena arena)
+{
+  Count length, cards;
+  Shift shift;
+  void *p;
+  Res res;
+
+  AVERT(Arena, arena);
+  AVER(arena->cardTableLength == 0);
+
+  if (!ArenaCardMarking(arena))
+    return ResOK;
+
+  /* Cards must not straddle segments. */
+  shift = SizeLog2(ArenaGrainSize(arena));
+  if (shift > ARENA_CARD_SHIFT)
+    shift = ARENA_CARD_SHIFT;
+
+  cards = ArenaReserved(arena) >> shift;
+  length = ARENA_CARD_TABLE_MAX;
+  if (cards < length) {
+    length = 1;
+    while (length < cards)
+      length <<= 1;
+  }
+
+  res = ControlAlloc(&p, arena, (Size)length);
+  if (res != ResOK)
+    goto failTable;
+  /* Every card starts dirty: nothing is known about it yet. */
+  (void)mps_lib_memset(p, 1, (size_t)length);
+  res = BTCreate(&arena->cardCovered, arena, length);
+  if (res != ResOK)
+    goto failCovered;
+  res = BTCreate(&arena->cardShared, arena, length);
+  if (res != ResOK)
+    goto failShared;
+
+  arena->cardsStruct._table = p;
+  arena->cardsStruct._shift = shift;
+  arena->cardsStruct._mask = length - 1;
+  arena->cardTableLength = length;
+  CardTableUpdate(arena, NULL);
+  return ResOK;
+
+failShared:
+  BTDestroy(arena->cardCovered, arena, length);
+  arena->cardCovered = NULL;
+failCovered:
+  ControlFree(arena, p, (Size)length);
+failTable:
+  return res;
+}
+
+
+/* CardTableDestroy -- free the card table */
+
+void CardTableDestroy(Arena arena)
+{
+  Count length;
+
+  AVERT(Arena, arena);
+
+  length = arena->cardTableLength;
+  if (length == 0)
+    return;
+  BTDestroy(arena->cardShared, arena, length);
+  BTDestroy(arena->cardCovered, arena, length);
+  ControlFree(arena, arena->cardsStruct._table, (Size)length);
+  CardTableInit(arena, arena->cardMarking);
+}
+
+
+/* CardTableUpdate -- recompute which card table entries are shared
+ *
+ * .shared: An entry is shared if it is the entry for cards in more
+ * than one place in the arena's chunks.  Shared entries are never
+ * cleaned, because the collector can't tell which of the cards was
+ * written.  Called when a chunk is inserted or removed.
+ */
+
+void CardTableUpdate(Arena arena, Chunk removed)
+{
+  Ring node, next;
+  Count length = arena->cardTableLength;
+
+  if (length == 0)
+    return;
+
+  BTResRange(arena->cardCovered, 0, length);
+  BTResRange(arena->cardShared, 0, length);
+  RING_FOR(node, ArenaChunkRing(arena), next) {
+    Chunk chunk = RING_ELT(Chunk, arenaRing, node);
+    Count i, n;
+    if (chunk == removed)
+      continue;
+    n = AddrOffset(chunk->base, chunk->limit) >> arena->cardsStruct._shift;
+    if (n >= length) {
+      BTSetRange(arena->cardShared, 0, length);
+      BTSetRange(arena->cardCovered, 0, length);
+      continue;
+    }
+    for (i = 0; i < n; ++i) {
+      Index j = cardIndex(ArenaCards(arena),
+                          AddrAdd(chunk->base,
+                                  i << arena->cardsStruct._shift));
+      if (BTGet(arena->cardCovered, j))
+        BTSet(arena->cardShared, j);
+      else
+        BTSet(arena->cardCovered, j);
+    }
+  }
+}
+
+
+/* CardIsDirty -- is any card overlapping [base, limit) dirty? */
+
+Bool CardIsDirty(Arena arena, Addr base, Addr limit)
+{
+  mps_cards_t cards = ArenaCards(arena);
+  Word i, iLimit;
+
+  AVER_CRITICAL(ArenaCardMarking(arena));
+  AVER_CRITICAL(base < limit);
+
+  iLimit = (((Word)limit - 1) >> cards->_shift) + 1;
+  for (i = (Word)base >> cards->_shift; i < iLimit; ++i)
+    if (cards->_table[i & cards->_mask] != 0)
+      return TRUE;
+  return FALSE;
+}
+
+
+/* CardSetDirty -- mark the cards overlapping [base, limit) as dirty
+ *
+ * This has the same effect as MPS_WRITE_BARRIER on each card.
+ */
+
+void CardSetDirty(Arena arena, Addr base, Addr limit)
+{
+  mps_cards_t cards = ArenaCards(arena);
+  Word i, iLimit;
+
+  AVER(ArenaCardMarking(arena));
+  AVER(base <= limit);
+
+  if (base == limit)
+    return;
+  iLimit = (((Word)limit - 1) >> cards->_shift) + 1;
+  for (i = (Word)base >> cards->_shift; i < iLimit; ++i)
+    cards->_table[i & cards->_mask] = 1;
+}
+
+
+/* CardClean -- mark the cards in [base, limit) as clean
+ *
+ * [base, limit) must be a whole number of cards, and all references
+ * in it must be in the summary of its segment.  Shared entries (see
+ * .shared) are left dirty.
+ */
+
+void CardClean(Arena arena, Addr base, Addr limit)
+{
+  mps_cards_t cards = ArenaCards(arena);
+  Word i, iLimit;
+
+  AVER(ArenaCardMarking(arena));
+  AVER(base < limit);
+  AVER(((Word)base & (((Word)1 << cards->_shift) - 1)) == 0);
+  AVER(((Word)limit & (((Word)1 << cards->_shift) - 1)) == 0);
+
+  if (arena->cardTableLength == 0)
+    return;
+  iLimit = (Word)limit >> cards->_shift;
+  for (i = (Word)base >> cards->_shift; i < iLimit; ++i) {
+    Index j = i & cards->_mask;
+    if (!BTGet(arena->cardShared, j))
+      cards->_table[j] = 0;
+  }
+}
+
+
+/* CardScan -- scan formatted objects, perhaps only on dirty cards
+ *
+ * Like FormatScan, but if ss->cardsOnly is set, scans only those
+ * objects in [base, limit) that overlap a dirty card.  base and limit
+ * are client pointers, as for FormatScan.  Consecutive dirty objects
+ * are scanned in one call to the format.  See
+ * <design/write-barrier/#card.scan>.
+ */
+
+Res CardScan(ScanState ss, Format format, Addr base, Addr limit)
+{
+  Arena arena;
+  Addr p, runBase;
+  Res res;
+
+  AVERT(ScanState, ss);
+  AVERT(Format, format);
+  AVER(base < limit);
+
+  if (!ss->cardsOnly)
+    return FormatScan(format, ss, base, limit);
+
+  arena = ss->arena;
+  AVER(ArenaCardMarking(arena));
+  runBase = NULL;
+  for (p = base; p < limit; ) {
+    Addr next = (*format->skip)(p);
+    AVER(next > p);
+    if (CardIsDirty(arena, AddrSub(p, format->headerSize),
+                    AddrSub(next, format->headerSize))) {
+      if (runBase == NULL)
+        runBase = p;
+    } else if (runBase != NULL) {
+      res = FormatScan(format, ss, runBase, p);
+      if (res != ResOK)
+        return res;
+      runBase = NULL;
+    }
+    p = next;
+  }
+  AVER(p == limit);
+  if (runBase != NULL)
+    return FormatScan(format, ss, runBase, limit);
+  return ResOK;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2016 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
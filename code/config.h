@@ -318,6 +318,73 @@
 #define LIKELY(exp) ((exp) != 0)
 #endif
 
+/* PREFETCH -- prefetch memory that will be read soon
+ *
+ * Use to start loading memory into the cache ahead of a read that
+ * can't be moved earlier, such as the read of an object's header by
+ * a pool's fix method.  See
+ * <https://gcc.gnu.org/onlinedocs/gcc/Other-Builtins.html>.
+ */
+
+#if defined(MPS_BUILD_GC) || defined(MPS_BUILD_LL)
+#define PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define PREFETCH(addr) NOOP
+#endif
+
+/* THREAD_LOCAL -- storage class for thread-local variables
+ *
+ * Not defined if the compiler has no thread-local storage, or if
+ * the MPS is built for the ANSI platform or for single-threaded
+ * execution.  See
+ * <https://gcc.gnu.org/onlinedocs/gcc/Thread-Local.html> and
+ * <https://docs.microsoft.com/en-us/cpp/cpp/thread>.
+ */
+
+#if defined(PLATFORM_ANSI) || defined(LOCK_NONE)
+/* no thread-local storage */
+#elif defined(MPS_BUILD_GC) || defined(MPS_BUILD_LL)
+#define THREAD_LOCAL __thread
+#elif defined(MPS_BUILD_MV) || defined(MPS_BUILD_PC)
+#define THREAD_LOCAL __declspec(thread)
+#endif
+
+/* POINTER_STORE_RELEASE, POINTER_LOAD_ACQUIRE -- publish a pointer
+ *
+ * For a pointer that one thread stores without a lock, after writing
+ * the data it points to, and another thread loads before reading that
+ * data.  The store has release semantics and the load acquire
+ * semantics, so the data is visible before the pointer.  Only needed
+ * where THREAD_LOCAL is defined.  Microsoft Visual C gives volatile
+ * accesses these semantics on x86 and x64 (/volatile:ms).  See
+ * <https://gcc.gnu.org/onlinedocs/gcc/_005f_005fatomic-Builtins.html>.
+ */
+
+#if defined(MPS_BUILD_GC) || defined(MPS_BUILD_LL)
+#define POINTER_STORE_RELEASE(lvalue, value) \
+  __atomic_store_n(&(lvalue), value, __ATOMIC_RELEASE)
+#define POINTER_LOAD_ACQUIRE(lvalue) \
+  __atomic_load_n(&(lvalue), __ATOMIC_ACQUIRE)
+#elif defined(MPS_BUILD_MV) || defined(MPS_BUILD_PC)
+#define POINTER_STORE_RELEASE(lvalue, value) \
+  ((void)(*(void * volatile *)&(lvalue) = (void *)(value)))
+#define POINTER_LOAD_ACQUIRE(lvalue) \
+  ((void *)*(void * volatile *)&(lvalue))
+#else
+#define POINTER_STORE_RELEASE(lvalue, value) ((void)((lvalue) = (value)))
+#define POINTER_LOAD_ACQUIRE(lvalue) (lvalue)
+#endif
+
+/* EVENT_THREAD -- per-thread event buffers
+ *
+ * If thread-local storage is available, each thread writes events
+ * into buffers of its own.  See <design/telemetry/#thread>.
+ */
+
+#if defined(EVENT) && defined(THREAD_LOCAL)
+#define EVENT_THREAD
+#endif
+
 
 /* Buffer Configuration -- see <code/buffer.c> */
 
@@ -342,12 +409,20 @@
 /* AMC treats objects larger than or equal to this as "Large" */
 #define AMC_LARGE_SIZE_DEFAULT ((Size)32768)
 #define AMC_EXTEND_BY_DEFAULT  ((Size)8192)
+/* Depth of depth-first copying, and the number of copies that can be
+ * waiting to be scanned: see <design/poolamc/#fix.depth-first>. */
+#define AMC_COPY_DEPTH_DEFAULT ((Count)0)
+#define AMC_COPY_DEPTH_MAX     ((Count)32)
+#define AMC_COPY_QUEUE_LENGTH  64
 
 
 /* Pool AMS Configuration -- see <code/poolams.c> */
 
 #define AMS_SUPPORT_AMBIGUOUS_DEFAULT TRUE
 #define AMS_GEN_DEFAULT       0
+/* Number of grey objects each segment remembers for scanning: see
+ * <design/poolams/#scan.stack.impl>. */
+#define AMS_MARK_STACK_LENGTH ((Count)16)
 
 
 /* Pool AWL Configuration -- see <code/poolawl.c> */
@@ -416,6 +491,15 @@
  * documentation changes. */
 #define ARENA_DEFAULT_SPARE_COMMIT_LIMIT   ((Size)10uL*1024uL*1024uL)
 
+/* ARENA_DEFAULT_SPARE_PURGE_RATE is the rate (in bytes per second) at
+ * which spare memory above the spare commit limit is returned to the
+ * operating system, or 0 to return it at once, when it is freed.
+ * ARENA_SPARE_PURGE_BURST is the longest time (in seconds) for which
+ * unused purging may be saved up.  See <design/arena/#spare.deferred>. */
+
+#define ARENA_DEFAULT_SPARE_PURGE_RATE (0.0)
+#define ARENA_SPARE_PURGE_BURST (0.1)
+
 /* ARENA_DEFAULT_PAUSE_TIME is the maximum time (in seconds) that
  * operations within the arena may pause the mutator for.  The default
  * is set for typical human interaction.  See mps_arena_pause_time_set
@@ -423,8 +507,73 @@
 
 #define ARENA_DEFAULT_PAUSE_TIME (0.1)
 
+/* ARENA_PAUSE_HISTORY is the number of recent pauses that the arena
+ * remembers in order to measure minimum mutator utilization.  A
+ * window containing more pauses than this is measured over the most
+ * recent ones only.  See <design/arena/#pause.mmu>. */
+
+#define ARENA_PAUSE_HISTORY 256
+
 #define ARENA_DEFAULT_ZONED     TRUE
 
+/* TRACE_FIX_ARRAY_BATCH is the number of references that
+ * mps_fix_array filters by zone before fixing them.  The targets of
+ * the references in a batch are prefetched while the batch is
+ * filtered.  See <design/trace/#fix.array>. */
+
+#define TRACE_FIX_ARRAY_BATCH ((Count)32)
+
+/* ARENA_DEFAULT_GC_BACKGROUND says whether the arena does its
+ * collection work on a background thread.  The thread polls every
+ * ARENA_BACKGROUND_INTERVAL seconds.  If the mutator allocates more
+ * than ARENA_BACKGROUND_LAG bytes beyond the poll threshold, it does
+ * the work itself.  See <design/arena/#poll.background>. */
+
+#define ARENA_DEFAULT_GC_BACKGROUND FALSE
+#define ARENA_BACKGROUND_INTERVAL (0.01)
+#define ARENA_BACKGROUND_LAG (16 * ArenaPollALLOCTIME)
+
+/* ARENA_CHUNK_MAP_LENGTH is the number of entries in the arena's
+ * direct-mapped table from address to chunk.  It must be a power of
+ * 2.  Lookups stay O(1) while the stripes covered by the chunks do
+ * not collide in the table.  See <design/arena/#chunk.map>. */
+
+#define ARENA_CHUNK_MAP_LENGTH ((Count)256)
+
+/* ARENA_DEFAULT_CARD_MARKING says whether the arena uses a software
+ * card-marking write barrier instead of protecting segments.  Cards
+ * are 2^ARENA_CARD_SHIFT bytes (or one grain, if smaller).  The card
+ * table has one byte per card of the arena's initial reserved address
+ * space, rounded up to a power of 2, and at most ARENA_CARD_TABLE_MAX
+ * entries.  See <design/write-barrier/#card>. */
+
+#define ARENA_DEFAULT_CARD_MARKING FALSE
+#define ARENA_CARD_SHIFT ((Shift)9)
+#define ARENA_CARD_TABLE_MAX ((Count)1 << 24)
+
+/* ARENA_DEFAULT_DIRTY_TRACKING says whether the arena keeps its write
+ * barrier using the operating system's dirty page tracking, where
+ * available, instead of protection.  See <design/prot/#dirty>. */
+
+#define ARENA_DEFAULT_DIRTY_TRACKING FALSE
+
+/* ARENA_DEFAULT_COOPERATIVE_SUSPEND says whether registered threads
+ * are suspended at safepoints rather than by the operating system.
+ * See <design/thread-manager/#coop>. */
+
+#define ARENA_DEFAULT_COOPERATIVE_SUSPEND FALSE
+
+/* ARENA_DEFAULT_LOCK_STATS says whether the arena gathers contention
+ * statistics for its lock.  See <design/lock/#stats>. */
+
+#define ARENA_DEFAULT_LOCK_STATS FALSE
+
+/* ARENA_DEFAULT_SCAN_STATS says whether the tracer attributes the
+ * work of scanning to pools, roots and formats.  See
+ * <design/scan/#stats>. */
+
+#define ARENA_DEFAULT_SCAN_STATS FALSE
+
 /* ARENA_MINIMUM_COLLECTABLE_SIZE is the minimum size (in bytes) of
  * collectable memory that might be considered worthwhile to run a
  * full garbage collection. */
@@ -465,6 +614,8 @@
   FALSE,               /* high */ \
   ArenaDefaultZONESET, /* zoneSet */ \
   ZoneSetEMPTY,        /* avoid */ \
+  FALSE,               /* hasNode */ \
+  0,                   /* node */ \
 }
 
 #define LDHistoryLENGTH ((Size)4)
@@ -474,6 +625,13 @@
 
 #define VM_ARENA_SIZE_DEFAULT ((Size)1 << 28)
 
+/* Default value of MPS_KEY_VM_LAZY_PURGE.  See
+ * <design/arenavm/#spare.lazy>. */
+#define VM_ARENA_LAZY_PURGE_DEFAULT FALSE
+
+/* Default value of MPS_KEY_VM_NUMA.  See <design/arenavm/#numa>. */
+#define VM_ARENA_NUMA_DEFAULT FALSE
+
 
 /* Locus configuration -- see <code/locus.c> */
 
@@ -496,7 +654,7 @@
 /* Shield Configuration -- see <code/shield.c> */
 
 #define ShieldQueueLENGTH  512  /* initial length of shield queue */
-#define ShieldDepthWIDTH     4  /* log2(max nested exposes + 1) */
+#define ShieldDepthWIDTH     6  /* log2(max nested exposes + 1) */
 
 
 /* VM Configuration -- see <code/vm*.c> */
@@ -505,6 +663,12 @@
 #define VMJunkBYTE ((unsigned char)0xA9)
 #define VMParamSize (sizeof(Word))
 
+/* Size of a transparent huge page.  When huge pages are requested,
+ * reservations are aligned to this and spare memory is only returned
+ * to the operating system in whole huge pages.  See
+ * <design/vm/#impl.ix.huge>. */
+#define VM_HUGE_PAGE_SIZE ((Size)1 << 21)
+
 
 /* .feature.li: Linux feature specification
  *
@@ -514,12 +678,15 @@
  * Source      Symbols                   Header        Feature
  * =========== ========================= ============= ====================
  * eventtxt.c  setenv                    <stdlib.h>    _GNU_SOURCE
+ * eventcnv.c  nanosleep                 <time.h>      _XOPEN_SOURCE >= 500
  * lockix.c    pthread_mutexattr_settype <pthread.h>   _XOPEN_SOURCE >= 500
+ * mpsioix.c   ftruncate                 <unistd.h>    _XOPEN_SOURCE >= 500
  * prmcix.h    stack_t, siginfo_t        <signal.h>    _XOPEN_SOURCE
  * prmclii3.c  REG_EAX etc.              <ucontext.h>  _GNU_SOURCE
  * prmclii6.c  REG_RAX etc.              <ucontext.h>  _GNU_SOURCE
  * pthrdext.c  sigaction etc.            <signal.h>    _XOPEN_SOURCE
- * vmix.c      MAP_ANON                  <sys/mman.h>  _GNU_SOURCE
+ * vmix.c      MAP_ANON, MADV_HUGEPAGE   <sys/mman.h>  _GNU_SOURCE
+ * vmix.c      syscall                   <unistd.h>    _GNU_SOURCE
  *
  * It is not possible to localize these feature specifications around
  * the individual headers: all headers share a common set of features
@@ -622,7 +789,11 @@
 
 /* Tracer Configuration -- see <code/trace.c> */
 
-#define TraceLIMIT ((size_t)1)
+/* TraceLIMIT is the number of traces that may run at once.  A second
+ * trace may only start while another is running if neither condemns
+ * segments in pools without AttrMULTITRACE.  See <design/trace/#multi>.
+ */
+#define TraceLIMIT ((size_t)2)
 /* I count 4 function calls to scan, 10 to copy. */
 #define TraceCopyScanRATIO (1.5)
 
@@ -634,9 +805,17 @@
 /* Events
  *
  * EventBufferSIZE is the number of words in the global event buffer.
+ * EventThreadCOUNT is the number of sets of per-thread event buffers:
+ * threads beyond this number share the global buffers.  See
+ * <design/telemetry/#thread>.
+ * EventRingSizeMIN is the smallest data size of a telemetry ring file:
+ * it must hold several flushes of a full buffer.  See
+ * <design/io/#ring.size>.
  */
 
 #define EventBufferSIZE ((size_t)4096)
+#define EventThreadCOUNT ((size_t)16)
+#define EventRingSizeMIN ((size_t)1 << 16)
 #define EventStringLengthMAX ((size_t)255) /* Not including NUL */
 
 
@@ -0,0 +1,288 @@
+/* dirtytest.c: DIRTY PAGE TRACKING TEST
+ *
+ * $Id$
+ * Copyright (c) 2018 Ravenbrook Limited.  See end of file for license.
+ *
+ * This test checks the dirty page tracking interface in prot.h
+ * directly, and then checks that the write barrier of an arena
+ * created with MPS_KEY_DIRTY_TRACKING notices the references that
+ * the mutator stores in old objects, so that they survive collections
+ * of the nursery.  See <design/prot/#dirty>.
+ *
+ * If the operating system can't track dirty pages, the test says so,
+ * checks that the arena falls back to write-protecting segments, and
+ * runs the collection test with protection instead.
+ */
+
+#include "mpm.h"
+#include "vm.h"
+#include "fmtdy.h"
+#include "fmtdytst.h"
+#include "testlib.h"
+#include "mpscamc.h"
+#include "mpsavm.h"
+#include "mps.h"
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* free, malloc */
+
+
+#define testArenaSIZE     ((size_t)32 << 20)
+#define oldCOUNT          4096  /* long-lived vectors */
+#define vectorWIDTH       8     /* slots in a vector */
+#define youngCOUNT        200000 /* short-lived vectors allocated */
+#define checkINTERVAL     10000 /* allocations between checks */
+#define genCOUNT          2
+
+/* Slots in a vector. */
+#define slotINDEX         0     /* DYLAN_INT of the old vector's index */
+#define slotYOUNG         1     /* reference to a short-lived vector */
+
+/* testChain -- generation parameters for the test
+ *
+ * The older generation is never full, so only the nursery is
+ * collected once the old vectors have been promoted.
+ */
+
+static mps_gen_param_s testChain[genCOUNT] = {
+  { 256, 0.9 }, { 65536, 0.5 } };
+
+
+static mps_word_t old[oldCOUNT]; /* long-lived vectors (a root) */
+
+
+/* testInterface -- test ProtDirtyStart, Test, Clear and Stop
+ *
+ * Returns FALSE if the operating system can't track dirty pages.
+ */
+
+static Bool testInterface(void)
+{
+  Size pageSize = PageSize();
+  void *block;
+  char *page;
+  Addr base, limit;
+
+  if (!ProtDirtyStart()) {
+#if !defined(CONFIG_PF_ANSI) \
+    && (defined(MPS_PF_LII6GC) || defined(MPS_PF_LII6LL))
+    printf("Soft-dirty page tracking is not available: the kernel may "
+           "have been built without CONFIG_MEM_SOFT_DIRTY.\n");
+#else
+    printf("Dirty page tracking is not available on this platform.\n");
+#endif
+    return FALSE;
+  }
+
+  /* Only one arena can track dirty pages at a time. */
+  Insist(!ProtDirtyStart());
+
+  block = malloc(2 * pageSize);
+  Insist(block != NULL);
+  page = (char *)AddrAlignUp((Addr)block, pageSize);
+  base = (Addr)page;
+  limit = AddrAdd(base, pageSize);
+
+  page[0] = 1;
+  ProtDirtyClear();
+  Insist(!ProtDirtyTest(base, limit));
+  page[pageSize - 1] = 2;
+  Insist(ProtDirtyTest(base, limit));
+  Insist(ProtDirtyTest(AddrAdd(base, pageSize - 1), limit));
+  ProtDirtyClear();
+  Insist(!ProtDirtyTest(base, limit));
+
+  free(block);
+  ProtDirtyStop();
+  printf("Dirty page tracking is available.\n");
+  return TRUE;
+}
+
+
+/* check -- check that the old vectors and their young vectors are intact */
+
+static void check(void)
+{
+  size_t i;
+
+  for (i = 0; i < oldCOUNT; ++i) {
+    mps_word_t v = old[i], y;
+    cdie(dylan_check((mps_addr_t)v), "dylan_check old");
+    Insist(DYLAN_VECTOR_SLOT(v, slotINDEX) == DYLAN_INT(i));
+    y = DYLAN_VECTOR_SLOT(v, slotYOUNG);
+    if (y != DYLAN_INT(0)) {
+      cdie(dylan_check((mps_addr_t)y), "dylan_check young");
+      Insist(DYLAN_VECTOR_SLOT(y, slotINDEX) == DYLAN_INT(i));
+    }
+  }
+}
+
+
+/* makeVector -- make a vector for old vector i */
+
+static mps_word_t makeVector(mps_ap_t ap, size_t i)
+{
+  mps_word_t v;
+  size_t j;
+
+  die(make_dylan_vector(&v, ap, vectorWIDTH), "make_dylan_vector");
+  for (j = 0; j < vectorWIDTH; ++j)
+    DYLAN_VECTOR_SLOT(v, j) = DYLAN_INT(0);
+  DYLAN_VECTOR_SLOT(v, slotINDEX) = DYLAN_INT(i);
+  return v;
+}
+
+
+static void test(mps_arena_t arena, mps_pool_t pool)
+{
+  mps_ap_t ap;
+  size_t i;
+  size_t collections;
+  Count hits;
+  ZoneSet nursery = ZoneSetEMPTY;
+  mps_word_t wrapper;
+
+  die(mps_ap_create_k(&ap, pool, mps_args_none), "ap_create");
+
+  /* Promote the old vectors to the older generation.  They contain no
+     references, so their segments get the write barrier. */
+  mps_arena_park(arena);
+  for (i = 0; i < oldCOUNT; ++i)
+    old[i] = makeVector(ap, i);
+  die(mps_arena_collect(arena), "collect");
+  check();
+  mps_arena_release(arena);
+
+  /* Collect the nursery until the write barrier on the old vectors'
+     segments is no longer deferred.  Each collection scans them, and
+     finds no references to the nursery, unless the format's wrapper
+     is in a nursery zone.  See design.mps.write-barrier.deferral. */
+  collections = mps_collections(arena);
+  while (mps_collections(arena) - collections <= WB_DEFER_INIT) {
+    mps_word_t v = makeVector(ap, 0);
+    nursery = ZoneSetAddAddr((Arena)arena, nursery, (Addr)v);
+  }
+
+  /* Store young vectors in old ones while the nursery is collected.
+     If the write barrier missed a store, the collector would not scan
+     the old vector, and the young one would die or move without the
+     reference being updated. */
+  collections = mps_collections(arena);
+  hits = ((Arena)arena)->writeBarrierHitCount;
+  for (i = 0; i < youngCOUNT; ++i) {
+    size_t k = rnd() % oldCOUNT;
+    mps_word_t v = makeVector(ap, k);
+    nursery = ZoneSetAddAddr((Arena)arena, nursery, (Addr)v);
+    if (rnd() % 8 == 0)
+      DYLAN_VECTOR_SLOT(old[k], slotYOUNG) = v;
+    if (i % checkINTERVAL == 0)
+      check();
+  }
+  mps_arena_park(arena);
+  check();
+  collections = mps_collections(arena) - collections;
+  hits = ((Arena)arena)->writeBarrierHitCount - hits;
+
+  printf("collections: %lu, write barrier hits: %lu\n",
+         (unsigned long)collections, (unsigned long)hits);
+  Insist(collections > 0);
+
+  /* If the wrapper is in a nursery zone, every scan of the old
+     vectors is interesting, so the write barrier stays deferred. */
+  wrapper = ((mps_word_t *)old[0])[0];
+  Insist(hits > 0 || ZoneSetHasAddr((Arena)arena, nursery, (Addr)wrapper));
+
+  mps_ap_destroy(ap);
+}
+
+
+int main(int argc, char *argv[])
+{
+  mps_arena_t arena;
+  mps_fmt_t format;
+  mps_chain_t chain;
+  mps_pool_t pool;
+  mps_root_t root;
+  Bool available;
+  size_t i;
+
+  testlib_init(argc, argv);
+
+  available = testInterface();
+
+  for (i = 0; i < oldCOUNT; ++i)
+    old[i] = DYLAN_INT(0);
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, testArenaSIZE);
+    MPS_ARGS_ADD(args, MPS_KEY_DIRTY_TRACKING, TRUE);
+    die(mps_arena_create_k(&arena, mps_arena_class_vm(), args),
+        "arena_create");
+  } MPS_ARGS_END(args);
+  Insist(ArenaDirtyTracking((Arena)arena) == available);
+
+  die(dylan_fmt(&format, arena), "fmt_create");
+  die(mps_chain_create(&chain, arena, genCOUNT, testChain), "chain_create");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
+    MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
+    die(mps_pool_create_k(&pool, arena, mps_class_amc(), args),
+        "pool_create(amc)");
+  } MPS_ARGS_END(args);
+  die(mps_root_create_area(&root, arena, mps_rank_exact(), 0,
+                           old, old + oldCOUNT, mps_scan_area, NULL),
+      "root_create_area");
+
+  test(arena, pool);
+
+  mps_root_destroy(root);
+  mps_pool_destroy(pool);
+  mps_chain_destroy(chain);
+  mps_fmt_destroy(format);
+  mps_arena_destroy(arena);
+
+  printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
+  return 0;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (c) 2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
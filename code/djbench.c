@@ -55,6 +55,7 @@ static unsigned rmax = 10;        /* maximum recursion depth */
 static mps_bool_t zoned = TRUE;   /* arena allocates using zones */
 static size_t arena_size = 256ul * 1024 * 1024; /* arena size */
 static size_t arena_grain_size = 1; /* arena grain size */
+static mps_bool_t lock_stats = FALSE; /* measure arena lock contention */
 
 #define DJRUN(fname, alloc, free) \
   static unsigned fname##_inner(mps_ap_t ap, unsigned depth, unsigned r) { \
@@ -188,10 +189,19 @@ static void arena_wrap(dj_t dj, mps_pool_class_t pool_class, const char *name)
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, arena_size);
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_GRAIN_SIZE, arena_grain_size);
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_ZONED, zoned);
+    MPS_ARGS_ADD(args, MPS_KEY_LOCK_STATS, lock_stats);
     DJMUST(mps_arena_create_k(&arena, mps_arena_class_vm(), args));
   } MPS_ARGS_END(args);
   DJMUST(mps_pool_create_k(&pool, arena, pool_class, mps_args_none));
   watch(dj, name);
+  if (lock_stats) {
+    mps_lock_stats_s stats;
+    if (mps_arena_lock_stats(&stats, arena))
+      printf("lock: claims %lu, contended %lu, wait %g (max %g)\n",
+             (unsigned long)stats.mps_claims,
+             (unsigned long)stats.mps_contended,
+             stats.mps_wait_total, stats.mps_wait_max);
+  }
   mps_pool_destroy(pool);
   mps_arena_destroy(arena);
 }
@@ -213,6 +223,7 @@ static struct option longopts[] = {
   {"arena-size",       required_argument, NULL, 'm'},
   {"arena-grain-size", required_argument, NULL, 'a'},
   {"arena-unzoned",    no_argument,       NULL, 'z'},
+  {"lock-stats",       no_argument,       NULL, 'L'},
   {NULL,               0,                 NULL, 0  }
 };
 
@@ -232,6 +243,7 @@ static struct {
 } pools[] = {
   {"mvt",   arena_wrap, dj_reserve, mps_class_mvt},
   {"mvff",  arena_wrap, dj_reserve, mps_class_mvff},
+  {"mvffa", arena_wrap, dj_alloc,   mps_class_mvff}, /* mvff with mps_alloc */
   {"mv",    arena_wrap, dj_alloc,   mps_class_mv},
   {"mvb",   arena_wrap, dj_reserve, mps_class_mv}, /* mv with buffers */
   {"an",    wrap,       dj_malloc,  dummy_class},
@@ -247,7 +259,7 @@ int main(int argc, char *argv[]) {
 
   seed = rnd_seed();
   
-  while ((ch = getopt_long(argc, argv, "ht:i:p:b:s:c:r:d:m:a:x:z", longopts, NULL)) != -1)
+  while ((ch = getopt_long(argc, argv, "ht:i:p:b:s:c:r:d:m:a:x:zL", longopts, NULL)) != -1)
     switch (ch) {
     case 't':
       nthreads = (unsigned)strtoul(optarg, NULL, 10);
@@ -280,6 +292,9 @@ int main(int argc, char *argv[]) {
     case 'z':
       zoned = FALSE;
       break;
+    case 'L':
+      lock_stats = TRUE;
+      break;
     case 'm': {
         char *p;
         arena_size = (unsigned)strtoul(optarg, &p, 10);
@@ -346,15 +361,19 @@ int main(int argc, char *argv[]) {
               "    Random number seed (default from entropy).\n"
               "  -z, --arena-unzoned\n"
               "    Disabled zoned allocation in the arena\n"
+              "  -L, --lock-stats\n"
+              "    Report contention for the arena lock\n",
+              pact,
+              rinter,
+              rmax);
+      fprintf(stderr,
               "Tests:\n"
               "  mvt   pool class MVT\n"
               "  mvff  pool class MVFF\n"
+              "  mvffa pool class MVFF with mps_alloc\n"
               "  mv    pool class MV\n"
               "  mvb   pool class MV with buffers\n"
-              "  an    malloc\n",
-              pact,
-              rinter,
-              rmax);
+              "  an    malloc\n");
       return EXIT_FAILURE;
     }
   argc -= optind;
@@ -30,14 +30,18 @@ static Bool eventIOInited = FALSE;
 static mps_io_t eventIO;
 static Serial EventInternSerial;
 
-/* Buffers in which events are recorded, from the top down. */
-char EventBuffer[EventKindLIMIT][EventBufferSIZE];
+/* Buffers in which events are recorded by threads without buffers of
+   their own.  See <design/telemetry/#thread>. */
+EventThreadStruct EventShared;
 
-/* Pointers to last event logged into each buffer. */
-char *EventLast[EventKindLIMIT];
+#if defined(EVENT_THREAD)
 
-/* Pointers to the last even written out of each buffer. */
-static char *EventWritten[EventKindLIMIT];
+/* Per-thread buffers, and the set the current thread writes into, or
+   NULL if it has not written an event yet. */
+static EventThreadStruct eventThreads[EventThreadCOUNT];
+THREAD_LOCAL EventThread EventCurrent = NULL;
+
+#endif /* EVENT_THREAD */
 
 EventControlSet EventKindControl;       /* Bit set used to control output. */
 
@@ -68,30 +72,39 @@ failWrite:
 }
 
 
-/* EventFlush -- flush event buffer (perhaps to the event stream) */
+/* eventThreadInit -- initialize a set of buffers to empty */
 
-void EventFlush(EventKind kind)
+static void eventThreadInit(EventThread et)
 {
-  AVER(eventInited);
-  AVER(NONNEGATIVE(kind));
-  AVER(kind < EventKindLIMIT);
-
-  AVER(EventBuffer[kind] <= EventLast[kind]);
-  AVER(EventLast[kind] <= EventWritten[kind]);
-  AVER(EventWritten[kind] <= EventBuffer[kind] + EventBufferSIZE);
-
-  /* Send all pending events to the event stream. */
-  EventSync();
-
-  /* Flush the in-memory buffer whether or not we send this buffer, so
-     that we can continue to record recent events. */
-  EventLast[kind] = EventWritten[kind] = EventBuffer[kind] + EventBufferSIZE;
+  EventKind kind;
+  for (kind = 0; kind < EventKindLIMIT; ++kind) {
+    AVER(et->last[kind] == NULL);
+    AVER(et->written[kind] == NULL);
+    et->last[kind] = et->written[kind] = et->buffer[kind] + EventBufferSIZE;
+  }
+  et->claimed = FALSE;
 }
 
 
-/* EventSync -- synchronize the event stream with the buffers */
+/* eventWrite -- send the pending events in a set of buffers to the
+ * event stream
+ *
+ * Each set of buffers is followed by its own EventClockSync event, so
+ * that the stream can be converted whichever thread wrote it.  Must
+ * be called with the leaf lock held.  Returns TRUE if any events were
+ * written.
+ *
+ * .write.other: The set may belong to another thread, which may be
+ * writing events into it at the same time, because that needs no
+ * lock.  That thread only ever moves last down, or resets it while
+ * holding the leaf lock.  It moves last down with a release store
+ * after filling in the event (see EVENT_END), and last is read here
+ * with an acquire load, so the events between last and written are
+ * complete, and the thread's later events are left for its next
+ * flush.
+ */
 
-void EventSync(void)
+static Bool eventWrite(EventThread et)
 {
   EventKind kind;
   Bool wrote = FALSE;
@@ -103,12 +116,15 @@ void EventSync(void)
     if (BS_IS_MEMBER(EventKindControl, kind)) {
       size_t size;
       Res res;
+      /* Another thread may be writing into its own set, so read the
+         last event just once.  See .write.other. */
+      char *last = POINTER_LOAD_ACQUIRE(et->last[kind]);
       
-      AVER(EventBuffer[kind] <= EventLast[kind]);
-      AVER(EventLast[kind] <= EventWritten[kind]);
-      AVER(EventWritten[kind] <= EventBuffer[kind] + EventBufferSIZE);
+      AVER(et->buffer[kind] <= last);
+      AVER(last <= et->written[kind]);
+      AVER(et->written[kind] <= et->buffer[kind] + EventBufferSIZE);
 
-      size = (size_t)(EventWritten[kind] - EventLast[kind]);
+      size = (size_t)(et->written[kind] - last);
       if (size > 0) {
 
         /* Ensure the IO stream is open.  We do this late so that no stream is
@@ -117,7 +133,7 @@ void EventSync(void)
           res = (Res)mps_io_create(&eventIO);
           if(res != ResOK) {
             /* TODO: Consider taking some other action if open fails. */
-            return;
+            return FALSE;
           }
           eventIOInited = TRUE;
         }
@@ -126,22 +142,144 @@ void EventSync(void)
            C library or kernel's buffer size.  We could pad out the buffer with
            a marker for this purpose. */
       
-        res = (Res)mps_io_write(eventIO, (void *)EventLast[kind], size);
+        res = (Res)mps_io_write(eventIO, (void *)last, size);
         if (res == ResOK) {
           /* TODO: Consider taking some other action if a write fails. */
-          EventWritten[kind] = EventLast[kind];
+          et->written[kind] = last;
           wrote = TRUE;
         }
       }
     }
   }
 
-  /* If we wrote out events, send an EventClockSync event and flush
-     the telemetry stream. */
-  if (wrote) {
+  if (wrote)
     (void)eventClockSync();
+  return wrote;
+}
+
+
+/* EventFlush -- flush event buffer (perhaps to the event stream)
+ *
+ * Called by the current thread when one of the buffers it writes
+ * into is full.
+ */
+
+void EventFlush(EventThread et, EventKind kind)
+{
+  AVER(eventInited);
+  AVER(et != NULL);
+  AVER(NONNEGATIVE(kind));
+  AVER(kind < EventKindLIMIT);
+
+  LockClaimGlobalLeaf();
+
+  AVER(et->buffer[kind] <= et->last[kind]);
+  AVER(et->last[kind] <= et->written[kind]);
+  AVER(et->written[kind] <= et->buffer[kind] + EventBufferSIZE);
+
+  /* Send all pending events in this set to the event stream. */
+  if (eventWrite(et))
     (void)mps_io_flush(eventIO);
+
+  /* Flush the in-memory buffer whether or not we send this buffer, so
+     that we can continue to record recent events. */
+  et->last[kind] = et->written[kind] = et->buffer[kind] + EventBufferSIZE;
+
+  LockReleaseGlobalLeaf();
+}
+
+
+/* EventSync -- synchronize the event stream with the buffers
+ *
+ * Sends the events in the shared buffers and in every claimed set of
+ * per-thread buffers, whichever thread owns it (see .write.other).
+ */
+
+void EventSync(void)
+{
+  Bool wrote;
+
+  LockClaimGlobalLeaf();
+  wrote = eventWrite(&EventShared);
+#if defined(EVENT_THREAD)
+  {
+    Index i;
+    for (i = 0; i < EventThreadCOUNT; ++i)
+      if (eventThreads[i].claimed && eventWrite(&eventThreads[i]))
+        wrote = TRUE;
+  }
+#endif
+  if (wrote)
+    (void)mps_io_flush(eventIO);
+  LockReleaseGlobalLeaf();
+}
+
+
+/* EventThreadAttach -- choose the buffers for the current thread
+ *
+ * Called the first time a thread writes an event, to claim a free
+ * set of per-thread buffers, or to fall back to the shared buffers if
+ * there are none.  A claimed set is released when the thread exits,
+ * if it has not detached before.  See <design/telemetry/#thread.attach>.
+ */
+
+EventThread EventThreadAttach(void)
+{
+#if defined(EVENT_THREAD)
+  EventThread et = &EventShared;
+  Index i;
+
+  AVER(eventInited);
+  AVER(EventCurrent == NULL);
+
+  LockClaimGlobalLeaf();
+  for (i = 0; i < EventThreadCOUNT; ++i) {
+    if (!eventThreads[i].claimed) {
+      et = &eventThreads[i];
+      et->claimed = TRUE;
+      break;
+    }
   }
+  LockReleaseGlobalLeaf();
+
+  if (et != &EventShared)
+    LockAtThreadExit(EventThreadDetach);
+  EventCurrent = et;
+  return et;
+#else
+  return &EventShared;
+#endif
+}
+
+
+/* EventThreadDetach -- give up the current thread's buffers
+ *
+ * Sends the thread's pending events to the event stream and frees its
+ * set of buffers for another thread.  Called when a thread is
+ * deregistered, when a thread created by the MPS exits, and by the
+ * lock module when any other thread that attached exits.  If the
+ * thread writes another event, it attaches again.  See
+ * <design/telemetry/#thread.detach>.
+ */
+
+void EventThreadDetach(void)
+{
+#if defined(EVENT_THREAD)
+  EventThread et = EventCurrent;
+
+  if (et == NULL)
+    return;
+  EventCurrent = NULL;
+  if (et == &EventShared)
+    return;
+
+  LockClaimGlobalLeaf();
+  AVER(et->claimed);
+  if (eventWrite(et))
+    (void)mps_io_flush(eventIO);
+  et->claimed = FALSE;
+  LockReleaseGlobalLeaf();
+#endif
 }
 
 
@@ -203,12 +341,12 @@ void EventInit(void)
   if (!eventInited) { /* See .trans.log */
     LockClaimGlobalRecursive();
     if (!eventInited) {
-      EventKind kind;
-      for (kind = 0; kind < EventKindLIMIT; ++kind) {
-        AVER(EventLast[kind] == NULL);
-        AVER(EventWritten[kind] == NULL);
-        EventLast[kind] = EventWritten[kind] = EventBuffer[kind] + EventBufferSIZE;
-      }
+#if defined(EVENT_THREAD)
+      Index i;
+      for (i = 0; i < EventThreadCOUNT; ++i)
+        eventThreadInit(&eventThreads[i]);
+#endif
+      eventThreadInit(&EventShared);
       eventInited = TRUE;
       EventKindControl = (Word)mps_lib_telemetry_control();
       EventInternSerial = (Serial)1; /* 0 is reserved */
@@ -224,7 +362,11 @@ void EventInit(void)
 }
 
 
-/* EventFinish -- stop using the event system */
+/* EventFinish -- stop using the event system
+ *
+ * Sends the events in every set of buffers, so that none are lost
+ * from threads that are still attached.
+ */
 
 void EventFinish(void)
 {
@@ -408,11 +550,25 @@ Res EventWrite(Event event, mps_lib_FILE *stream)
 }
 
 
-void EventDump(mps_lib_FILE *stream)
+static void eventDumpThread(EventThread et, mps_lib_FILE *stream)
 {
   Event event;
   EventKind kind;
 
+  for (kind = 0; kind < EventKindLIMIT; ++kind) {
+    for (event = (Event)et->last[kind];
+         (char *)event < et->buffer[kind] + EventBufferSIZE;
+         event = (Event)((char *)event + event->any.size)) {
+      /* Try to keep going even if there's an error, because this is used as a
+         backtrace and we'll take what we can get. */
+      (void)EventWrite(event, stream);
+      (void)WriteF(stream, 0, "\n", NULL);
+    }
+  }
+}
+
+void EventDump(mps_lib_FILE *stream)
+{
   AVER(stream != NULL);
 
   /* This can happen if there's a backtrace very early in the life of
@@ -422,16 +578,16 @@ void EventDump(mps_lib_FILE *stream)
     return;
   }
 
-  for (kind = 0; kind < EventKindLIMIT; ++kind) {
-    for (event = (Event)EventLast[kind];
-         (char *)event < EventBuffer[kind] + EventBufferSIZE;
-         event = (Event)((char *)event + event->any.size)) {
-      /* Try to keep going even if there's an error, because this is used as a
-         backtrace and we'll take what we can get. */
-      (void)EventWrite(event, stream);
-      (void)WriteF(stream, 0, "\n", NULL);
-    }
+  /* Other threads may be writing into their buffers, so this is only
+     reliable in a debugger or after a crash. */
+  eventDumpThread(&EventShared, stream);
+#if defined(EVENT_THREAD)
+  {
+    Index i;
+    for (i = 0; i < EventThreadCOUNT; ++i)
+      eventDumpThread(&eventThreads[i], stream);
   }
+#endif
 }
 
 
@@ -456,6 +612,12 @@ void EventFinish(void)
 }
 
 
+void EventThreadDetach(void)
+{
+  NOOP;
+}
+
+
 EventControlSet EventControl(EventControlSet resetMask,
                              EventControlSet flipMask)
 {
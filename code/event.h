@@ -32,7 +32,7 @@ extern EventControlSet EventControl(EventControlSet resetMask,
 extern EventStringId EventInternString(const char *label);
 extern EventStringId EventInternGenString(size_t, const char *label);
 extern void EventLabelAddr(Addr addr, Word id);
-extern void EventFlush(EventKind kind);
+extern void EventThreadDetach(void);
 extern Res EventDescribe(Event event, mps_lib_FILE *stream, Count depth);
 extern Res EventWrite(Event event, mps_lib_FILE *stream);
 extern void EventDump(mps_lib_FILE *stream);
@@ -42,31 +42,85 @@ extern void EventDump(mps_lib_FILE *stream);
 
 /* Event writing support */
 
-extern char EventBuffer[EventKindLIMIT][EventBufferSIZE];
-extern char *EventLast[EventKindLIMIT];
+/* EventThreadStruct -- a set of event buffers, one for each kind
+ *
+ * Each thread writes events into a set of its own, if there is a set
+ * free, or into EventShared otherwise.  See <design/telemetry/#thread>.
+ */
+
+typedef struct EventThreadStruct *EventThread;
+
+typedef struct EventThreadStruct {
+  char buffer[EventKindLIMIT][EventBufferSIZE]; /* events, from the top down */
+  char *last[EventKindLIMIT];           /* last event logged into each buffer */
+  char *written[EventKindLIMIT];        /* last event written out of each */
+  Bool claimed;                         /* owned by a thread? */
+} EventThreadStruct;
+
+extern EventThreadStruct EventShared;
 extern Word EventKindControl;
+extern EventThread EventThreadAttach(void);
+extern void EventFlush(EventThread et, EventKind kind);
+
+/* EventThreadAttached -- has the current thread buffers of its own?
+ *
+ * True if the current thread writes events into a set of buffers of
+ * its own, rather than EventShared.  Unlike EventThreadCurrent, this
+ * does not attach the thread.
+ */
+
+/* EventThreadRoom -- can the current thread write an event unlocked?
+ *
+ * True if the current thread has buffers of its own with room for
+ * the named event, so that writing it takes no lock and cannot
+ * flush.  Does not attach the thread.  See
+ * <design/telemetry/#thread.room>.
+ */
+
+#if defined(EVENT_THREAD)
+extern THREAD_LOCAL EventThread EventCurrent;
+#define EventThreadCurrent() \
+  (EventCurrent != NULL ? EventCurrent : EventThreadAttach())
+#define EventThreadAttached() \
+  (EventCurrent != NULL && EventCurrent != &EventShared)
+#define EventThreadRoom(name) \
+  (EventThreadAttached() \
+   && size_tAlignUp(sizeof(Event##name##Struct), MPS_PF_ALIGN) \
+      <= (size_t)(EventCurrent->last[Event##name##Kind] \
+                  - EventCurrent->buffer[Event##name##Kind]))
+#else
+#define EventThreadCurrent() (&EventShared)
+#define EventThreadAttached() FALSE
+#define EventThreadRoom(name) FALSE
+#endif
 
 
 /* Events are written into the buffer from the top down, so that a backtrace
-   can find them all starting at EventLast. */
+   can find them all starting at the last pointer. */
 
 #define EVENT_BEGIN(name, structSize) \
   BEGIN \
     if(EVENT_ALL || Event##name##Always) { /* see config.h */ \
+      EventThread _et = EventThreadCurrent(); \
       Event##name##Struct *_event; \
       size_t _size = size_tAlignUp(structSize, MPS_PF_ALIGN); \
-      if (_size > (size_t)(EventLast[Event##name##Kind] \
-                           - EventBuffer[Event##name##Kind])) \
-        EventFlush(Event##name##Kind); \
-      AVER(_size <= (size_t)(EventLast[Event##name##Kind] \
-                             - EventBuffer[Event##name##Kind])); \
-      _event = (void *)(EventLast[Event##name##Kind] - _size); \
+      if (_size > (size_t)(_et->last[Event##name##Kind] \
+                           - _et->buffer[Event##name##Kind])) \
+        EventFlush(_et, Event##name##Kind); \
+      AVER(_size <= (size_t)(_et->last[Event##name##Kind] \
+                             - _et->buffer[Event##name##Kind])); \
+      _event = (void *)(_et->last[Event##name##Kind] - _size); \
       _event->code = Event##name##Code; \
       _event->size = (EventSize)_size; \
       EVENT_CLOCK(_event->clock);
 
+/* EVENT_END publishes the event by moving last down with a release
+   store, because another thread may be writing the buffer out.  See
+   .write.other in event.c. */
+
 #define EVENT_END(name, size) \
-      EventLast[Event##name##Kind] -= _size; \
+      POINTER_STORE_RELEASE(_et->last[Event##name##Kind], \
+                            _et->last[Event##name##Kind] - _size); \
     } \
   END
 
@@ -123,6 +177,9 @@ extern Word EventKindControl;
 #else /* EVENT not */
 
 
+#define EventThreadAttached() FALSE
+#define EventThreadRoom(name) FALSE
+
 #define EVENT0(name) NOOP
 /* The following lines were generated with
    python -c 'for i in range(1,22): print "#define EVENT%d(name, %s) BEGIN %s END" % (i, ", ".join(["p%d" % j for j in range(0, i)]), " ".join(["UNUSED(p%d);" % j for j in range(0, i)]))'
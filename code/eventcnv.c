@@ -20,6 +20,11 @@
  *
  *   eventcnv | sort > mps-events.txt
  *
+ * or, with the -s option, which merges the events written by each
+ * thread into time order itself:
+ *
+ *   eventcnv -s > mps-events.txt
+ *
  * These text-format files have one line per event, and can be
  * manipulated by various programs systems in the usual Unix way.
  * 
@@ -30,6 +35,19 @@
  * variable used to specify the telemetry file to the MPS library).
  * If the environment variable does not exist, the default filename of
  * "mpsio.log" is used.
+ *
+ * If the file is a telemetry ring (written by the MPS when the
+ * environment variable MPS_TELEMETRY_RING is set), the events in the
+ * ring are converted, oldest first.  With the -t option, eventcnv
+ * then waits for the program to write more events and converts them
+ * as they arrive, like "tail -f":
+ *
+ *   MPS_TELEMETRY_RING=1M MPS_TELEMETRY_CONTROL=all myprog &
+ *   eventcnv -t
+ *
+ * On FreeBSD, Linux and macOS, a log file is mapped into memory and
+ * decoded by several threads at once (one per processor, unless the
+ * -j option says otherwise).  The -v option reports the throughput.
  * 
  * $Id$
  */
@@ -46,11 +64,55 @@
 #include <string.h> /* for strcmp */
 #include "mpstd.h"
 
+#if defined(MPS_OS_W3)
+#include "mpswin.h" /* for Sleep */
+#elif defined(MPS_OS_FR) || defined(MPS_OS_LI) || defined(MPS_OS_XC)
+#include <pthread.h> /* for pthread_create */
+#include <sys/mman.h> /* for mmap */
+#include <sys/stat.h> /* for fstat */
+#include <sys/time.h> /* for gettimeofday */
+#include <time.h> /* for nanosleep; see .feature.li in config.h */
+#include <unistd.h> /* for sysconf */
+#endif
+
 #define DEFAULT_TELEMETRY_FILENAME "mpsio.log"
 #define TELEMETRY_FILENAME_ENVAR   "MPS_TELEMETRY_FILENAME"
 
 static EventClock eventTime; /* current event time */
 static const char *prog; /* program name */
+static Bool merge = FALSE; /* merge events into time order? */
+static Bool follow = FALSE; /* wait for more events in ring? */
+static Bool verbose = FALSE; /* report throughput? */
+static unsigned long jobs = 0; /* decoding threads; 0 for one per CPU */
+static ulongest_t eventCount = 0; /* number of events read */
+static ulongest_t eventBytes = 0; /* number of bytes of events read */
+
+
+/* Output buffers
+ *
+ * Events are formatted into buffers in memory rather than with printf,
+ * because this is much faster, and so that parts of the log decoded
+ * in parallel can be written out in order.  The buffer output holds
+ * text for standard output that has not yet been written.
+ */
+
+typedef struct OutStruct {
+  char *base;                   /* formatted text */
+  size_t count;                 /* number of characters in use */
+  size_t size;                  /* number of characters allocated */
+} OutStruct, *Out;
+
+#define OUTPUT_FLUSH ((size_t)1 << 16) /* size at which to write output */
+
+static OutStruct output = {NULL, 0, 0};
+
+static void outputFlush(void)
+{
+  if (output.count > 0) {
+    (void)fwrite(output.base, 1, output.count, stdout);
+    output.count = 0;
+  }
+}
 
 /* Errors and Warnings */
 
@@ -59,6 +121,7 @@ static const char *prog; /* program name */
 ATTRIBUTE_FORMAT((printf, 2, 0))
 static void fevwarn(const char *prefix, const char *format, va_list args)
 {
+  outputFlush();
   (void)fflush(stdout); /* sync */
   (void)fprintf(stderr, "%s: %s @", prog, prefix);
   (void)EVENT_CLOCK_PRINT(stderr, eventTime);
@@ -97,7 +160,8 @@ static void everror(const char *format, ...)
 
 static void usage(void)
 {
-  (void)fprintf(stderr, "Usage: %s [-f logfile] [-h]\n"
+  (void)fprintf(stderr,
+                "Usage: %s [-f logfile] [-s] [-t] [-j jobs] [-v] [-h]\n"
                 "See \"Telemetry\" in the reference manual for instructions.\n",
                 prog);
 }
@@ -134,6 +198,26 @@ static char *parseArgs(int argc, char *argv[])
         else
           name = argv[i];
         break;
+      case 's': /* merge into time order */
+        merge = TRUE;
+        break;
+      case 't': /* follow ring */
+        follow = TRUE;
+        break;
+      case 'j': /* number of threads */
+        ++ i;
+        if (i == argc)
+          usageError();
+        else {
+          char *end;
+          jobs = strtoul(argv[i], &end, 10);
+          if (*end != '\0' || jobs == 0)
+            usageError();
+        }
+        break;
+      case 'v': /* report throughput */
+        verbose = TRUE;
+        break;
       case '?': case 'h': /* help */
         usage();
         exit(EXIT_SUCCESS);
@@ -149,34 +233,97 @@ static char *parseArgs(int argc, char *argv[])
 
 /* Printing routines */
 
-static void printHex(ulongest_t val)
+static char *outReserve(Out out, size_t n)
+{
+  if (out->size - out->count < n) {
+    size_t size = out->size == 0 ? 4096 : out->size;
+    char *base;
+    while (size - out->count < n)
+      size *= 2;
+    base = realloc(out->base, size);
+    if (base == NULL)
+      everror("Out of memory formatting events");
+    out->base = base;
+    out->size = size;
+  }
+  return out->base + out->count;
+}
+
+static void outBytes(Out out, const char *bytes, size_t n)
 {
-  printf(" %"PRIXLONGEST, (ulongest_t)val);
+  memcpy(outReserve(out, n), bytes, n);
+  out->count += n;
+}
+
+static const char hexDigits[] = "0123456789ABCDEF";
+
+/* printClock -- print clock as sixteen hex digits, like EVENT_CLOCK_PRINT */
+
+static void printClock(Out out, EventClock clock)
+{
+  char *p = outReserve(out, 2 * sizeof clock);
+  size_t i;
+  for (i = 2 * sizeof clock; i > 0; --i) {
+    p[i - 1] = hexDigits[(unsigned)(clock & 0xF)];
+    clock >>= 4;
+  }
+  out->count += 2 * sizeof clock;
+}
+
+/* printCode -- print event code like printf(" %4X") */
+
+static void printCode(Out out, EventCode code)
+{
+  char buf[8];
+  size_t i = sizeof buf;
+  do {
+    buf[--i] = hexDigits[code & 0xF];
+    code >>= 4;
+  } while (code != 0);
+  while (i > sizeof buf - 4)
+    buf[--i] = ' ';
+  buf[--i] = ' ';
+  outBytes(out, buf + i, sizeof buf - i);
+}
+
+/* printHex -- print parameter like printf(" %"PRIXLONGEST) */
+
+static void printHex(Out out, ulongest_t val)
+{
+  char buf[2 * sizeof val + 1];
+  size_t i = sizeof buf;
+  do {
+    buf[--i] = hexDigits[val & 0xF];
+    val >>= 4;
+  } while (val != 0);
+  buf[--i] = ' ';
+  outBytes(out, buf + i, sizeof buf - i);
 }
         
-#define printParamP(p) printHex((ulongest_t)p)
-#define printParamA(a) printHex((ulongest_t)a)
-#define printParamU(u) printHex((ulongest_t)u)
-#define printParamW(w) printHex((ulongest_t)w)
-#define printParamB(b) printHex((ulongest_t)b)
+#define printParamP(out, p) printHex(out, (ulongest_t)p)
+#define printParamA(out, a) printHex(out, (ulongest_t)a)
+#define printParamU(out, u) printHex(out, (ulongest_t)u)
+#define printParamW(out, w) printHex(out, (ulongest_t)w)
+#define printParamB(out, b) printHex(out, (ulongest_t)b)
 
-static void printParamD(double d)
+static void printParamD(Out out, double d)
 {
-  printf(" %.10G", d);
+  char buf[40];
+  (void)sprintf(buf, " %.10G", d);
+  outBytes(out, buf, strlen(buf));
 }
 
-static void printParamS(const char *str)
+static void printParamS(Out out, const char *str)
 {
   size_t i;
-  putchar(' ');
-  putchar('"');
+  outBytes(out, " \"", 2);
   for (i = 0; str[i] != '\0'; ++i) {
     char c = str[i];
     if (c == '"' || c == '\\')
-      putchar('\\');
-    putchar(c);
+      outBytes(out, "\\", 1);
+    outBytes(out, &c, 1);
   }
-  putchar('"');
+  outBytes(out, "\"", 1);
 }
 
 
@@ -220,6 +367,169 @@ static Res eventRead(Bool *eofOut, EventUnion *event, FILE *stream)
   return ResOK;
 }
 
+/* checkEvent -- check an event as it is read
+ *
+ * This is separate from printEvent so that warnings are issued in the
+ * order the events are read, even when they are printed in parallel.
+ */
+
+static void checkEvent(Event event)
+{
+  EventCode code;
+
+  eventTime = event->any.clock;
+  code = event->any.code;
+  ++ eventCount;
+  eventBytes += event->any.size;
+    
+  /* Special handling for some events, prior to text output */
+
+  switch(code) {
+  case EventEventInitCode:
+    if ((event->EventInit.f0 != EVENT_VERSION_MAJOR) ||
+        (event->EventInit.f1 != EVENT_VERSION_MEDIAN) ||
+        (event->EventInit.f2 != EVENT_VERSION_MINOR))
+      evwarn("Event log version does not match: %d.%d.%d vs %d.%d.%d",
+             event->EventInit.f0,
+             event->EventInit.f1,
+             event->EventInit.f2,
+             EVENT_VERSION_MAJOR,
+             EVENT_VERSION_MEDIAN,
+             EVENT_VERSION_MINOR);
+
+    if (event->EventInit.f3 > EventCodeMAX)
+      evwarn("Event log may contain unknown events with codes from %d to %d",
+             EventCodeMAX+1, event->EventInit.f3);
+
+    if (event->EventInit.f5 != MPS_WORD_WIDTH)
+      /* This probably can't happen; other things will break
+       * before we get here */
+      evwarn("Event log has incompatible word width: %d instead of %d",
+             event->EventInit.f5,
+             MPS_WORD_WIDTH);
+    break;
+  default:
+    /* No special treatment needed. */
+    break;
+  }
+
+  switch (code) {
+#define EVENT_CHECK(X, name, code, always, kind) \
+    case code:
+    EVENT_LIST(EVENT_CHECK, X)
+    break;
+  default:
+    evwarn("Unknown event code %d", code);
+  }
+}
+
+
+/* printEvent -- print one event as a line of text */
+
+static void printEvent(Out out, Event event)
+{
+  EventCode code = event->any.code;
+
+  printClock(out, event->any.clock);
+  printCode(out, code);
+
+  switch (code) {
+#define EVENT_PARAM_PRINT(name, index, sort, ident)     \
+    printParam##sort(out, event->name.f##index);
+#define EVENT_PRINT(X, name, code, always, kind)        \
+    case code:                                        \
+      EVENT_##name##_PARAMS(EVENT_PARAM_PRINT, name)  \
+      break;
+    EVENT_LIST(EVENT_PRINT, X)
+  default:
+    break;
+  }
+
+  outBytes(out, "\n", 1);
+}
+
+
+/* writeEvent -- print one event to standard output */
+
+static void writeEvent(Event event)
+{
+  printEvent(&output, event);
+  if (output.count >= OUTPUT_FLUSH)
+    outputFlush();
+}
+
+
+/* Merging
+ *
+ * Each thread writes its events into buffers of its own, and the
+ * buffers are written to the log when they fill, so the log is not
+ * in time order.  With the -s option, all the events are read into
+ * memory and sorted by their timestamps before they are printed.
+ * Events with equal timestamps stay in the order they were read.
+ * See <design/telemetry/#thread.merge>.
+ */
+
+typedef struct MergeEventStruct {
+  EventClock clock;             /* timestamp of event */
+  size_t serial;                /* position of event in the log */
+  Event event;                  /* copy of event, allocated by malloc */
+} MergeEventStruct, *MergeEvent;
+
+static MergeEvent mergeEvents = NULL; /* events read so far */
+static size_t mergeCount = 0;         /* number of events read */
+static size_t mergeSize = 0;          /* number of events allocated */
+
+static void mergeAdd(Event event)
+{
+  Event copy;
+
+  if (mergeCount == mergeSize) {
+    size_t size = mergeSize == 0 ? 1024 : mergeSize * 2;
+    MergeEvent events = realloc(mergeEvents, size * sizeof mergeEvents[0]);
+    if (events == NULL)
+      everror("Out of memory merging events");
+    mergeEvents = events;
+    mergeSize = size;
+  }
+  copy = malloc(event->any.size);
+  if (copy == NULL)
+    everror("Out of memory merging events");
+  memcpy(copy, event, event->any.size);
+  mergeEvents[mergeCount].clock = event->any.clock;
+  mergeEvents[mergeCount].serial = mergeCount;
+  mergeEvents[mergeCount].event = copy;
+  ++mergeCount;
+}
+
+static int mergeCompare(const void *a, const void *b)
+{
+  const MergeEventStruct *ea = a, *eb = b;
+  if (ea->clock < eb->clock)
+    return -1;
+  if (ea->clock > eb->clock)
+    return 1;
+  if (ea->serial < eb->serial)
+    return -1;
+  if (ea->serial > eb->serial)
+    return 1;
+  return 0;
+}
+
+static void mergePrint(void)
+{
+  size_t i;
+
+  qsort(mergeEvents, mergeCount, sizeof mergeEvents[0], mergeCompare);
+  for (i = 0; i < mergeCount; ++i) {
+    writeEvent(mergeEvents[i].event);
+    free(mergeEvents[i].event);
+  }
+  free(mergeEvents);
+  mergeEvents = NULL;
+  mergeCount = mergeSize = 0;
+}
+
+
 /* readLog -- read and parse log */
 
 static void readLog(FILE *stream)
@@ -227,7 +537,6 @@ static void readLog(FILE *stream)
   for(;;) { /* loop for each event */
     EventUnion eventUnion;
     Event event = &eventUnion;
-    EventCode code;
     Res res;
     Bool eof = FALSE; /* suppress warnings about uninitialized use */
 
@@ -242,62 +551,361 @@ static void readLog(FILE *stream)
     if (eof)
       break;
 
-    eventTime = event->any.clock;
-    code = event->any.code;
-    
-    /* Special handling for some events, prior to text output */
-
-    switch(code) {
-    case EventEventInitCode:
-      if ((event->EventInit.f0 != EVENT_VERSION_MAJOR) ||
-          (event->EventInit.f1 != EVENT_VERSION_MEDIAN) ||
-          (event->EventInit.f2 != EVENT_VERSION_MINOR))
-        evwarn("Event log version does not match: %d.%d.%d vs %d.%d.%d",
-               event->EventInit.f0,
-               event->EventInit.f1,
-               event->EventInit.f2,
-               EVENT_VERSION_MAJOR,
-               EVENT_VERSION_MEDIAN,
-               EVENT_VERSION_MINOR);
-
-      if (event->EventInit.f3 > EventCodeMAX)
-        evwarn("Event log may contain unknown events with codes from %d to %d",
-               EventCodeMAX+1, event->EventInit.f3);
-
-      if (event->EventInit.f5 != MPS_WORD_WIDTH)
-        /* This probably can't happen; other things will break
-         * before we get here */
-        evwarn("Event log has incompatible word width: %d instead of %d",
-               event->EventInit.f5,
-               MPS_WORD_WIDTH);
+    checkEvent(event);
+    if (merge)
+      mergeAdd(event);
+    else
+      writeEvent(event);
+  } /* while(!feof(input)) */
+
+  if (merge)
+    mergePrint();
+  outputFlush();
+}
+
+
+/* Rings
+ *
+ * A telemetry ring is a file of fixed size, written by the POSIX I/O
+ * module when the environment variable MPS_TELEMETRY_RING is set.
+ * The producer may overwrite a frame while it is being read here, so
+ * after reading each frame the header is read again to check that the
+ * frame is still in the ring; if not, reading skips to the oldest
+ * frame.  The consumer position in the header is updated after each
+ * frame so that the producer can count the frames that were never
+ * read.  See <design/io/#ring>.
+ */
+
+#define RING_POLL_MS 100 /* milliseconds between polls with -t */
+
+#define ringHolds(header, pos) \
+  ((Word)((pos) - (header)->oldest) \
+   <= (Word)((header)->write - (header)->oldest))
+
+
+/* ringHeaderRead -- read and check the header of a ring */
+
+static Bool ringHeaderRead(EventRingHeaderStruct *header, FILE *stream)
+{
+  Word size;
+
+  if (fseek(stream, 0, SEEK_SET) != 0
+      || fread(header, sizeof *header, 1, stream) != 1)
+    return FALSE;
+  size = header->size;
+  return memcmp(header->sig, EventRingSIG, sizeof header->sig) == 0
+    && header->version == EventRingVERSION
+    && size > sizeof(Word) && (size & (size - 1)) == 0;
+}
+
+
+/* ringReadAt -- read data at an offset in the ring */
+
+static Bool ringReadAt(void *buf, size_t size, Word offset, FILE *stream)
+{
+  long where = (long)(sizeof(EventRingHeaderStruct) + offset);
+  return size == 0
+    || (fseek(stream, where, SEEK_SET) == 0
+        && fread(buf, size, 1, stream) == 1);
+}
+
+
+/* ringUpdate -- update the consumer position in the ring */
+
+static void ringUpdate(Word pos, FILE *stream)
+{
+  long where = (long)offsetof(EventRingHeaderStruct, read);
+  if (fseek(stream, where, SEEK_SET) != 0
+      || fwrite(&pos, sizeof pos, 1, stream) != 1)
+    everror("I/O error updating ring");
+}
+
+
+/* ringEvents -- convert the events in a frame */
+
+static void ringEvents(const char *frame, size_t length)
+{
+  size_t i = 0;
+
+  while (i < length) {
+    EventUnion eventUnion;
+    EventAnyStruct any;
+
+    if (length - i < sizeof any)
+      everror("Truncated frame in ring");
+    memcpy(&any, frame + i, sizeof any);
+    if (any.size < sizeof any || any.size > sizeof eventUnion
+        || any.size > length - i)
+      everror("Invalid event size in ring");
+    memcpy(&eventUnion, frame + i, any.size);
+
+    checkEvent(&eventUnion);
+    if (merge)
+      mergeAdd(&eventUnion);
+    else
+      writeEvent(&eventUnion);
+    i += any.size;
+  }
+}
+
+
+/* ringSleep -- wait before polling the ring again */
+
+static void ringSleep(void)
+{
+#if defined(MPS_OS_W3)
+  Sleep(RING_POLL_MS);
+#elif defined(MPS_OS_FR) || defined(MPS_OS_LI) || defined(MPS_OS_XC)
+  struct timespec ts;
+  ts.tv_sec = 0;
+  ts.tv_nsec = RING_POLL_MS * 1000000L;
+  (void)nanosleep(&ts, NULL);
+#endif
+}
+
+
+/* readRing -- read and parse ring, and with -t, wait for more */
+
+static void readRing(FILE *stream, Bool update)
+{
+  EventRingHeaderStruct header;
+  char *frame = NULL;
+  Word size = 0;
+  Word pos = 0;
+
+  /* Don't buffer, so that every read sees what the producer wrote. */
+  (void)setvbuf(stream, NULL, _IONBF, 0);
+
+  for (;;) {
+    /* The program may be recreating the ring, so wait for it. */
+    if (ringHeaderRead(&header, stream)) {
+      if (header.size != size) {
+        free(frame);
+        size = header.size;
+        frame = malloc((size_t)size / 2);
+        if (frame == NULL)
+          everror("Out of memory reading ring");
+        pos = header.oldest;
+      }
+
+      while (pos != header.write) {
+        Word offset = pos & (size - 1);
+        Word length;
+        Bool ok;
+
+        ok = ringReadAt(&length, sizeof length, offset, stream);
+        if (ok && length != EventRingPAD)
+          ok = length <= size / 2
+            && ringReadAt(frame, (size_t)length, offset + sizeof(Word),
+                          stream);
+
+        if (!ringHeaderRead(&header, stream) || header.size != size)
+          break;
+        if (!ringHolds(&header, pos)) {
+          evwarn("Ring overrun: skipping to oldest event");
+          pos = header.oldest;
+          continue;
+        }
+        if (!ok)
+          everror("Invalid frame in ring");
+
+        if (length == EventRingPAD) {
+          pos += size - offset;
+        } else {
+          ringEvents(frame, (size_t)length);
+          pos += EventRingFrameSIZE(length);
+        }
+        if (update)
+          ringUpdate(pos, stream);
+      }
+    } else if (!follow) {
+      everror("Invalid ring header");
+    }
+
+    if (merge)
+      mergePrint();
+    outputFlush();
+    if (!follow)
       break;
-    default:
-      /* No special treatment needed. */
+    (void)fflush(stdout);
+    ringSleep();
+  }
+
+  if (header.dropped > 0)
+    evwarn("%"PRIuLONGEST" frames were overwritten before being read",
+           (ulongest_t)header.dropped);
+  free(frame);
+}
+
+
+#if defined(MPS_OS_FR) || defined(MPS_OS_LI) || defined(MPS_OS_XC)
+
+/* Decoding in parallel
+ *
+ * A log file is mapped into memory and decoded a round at a time.
+ * Each round divides the next part of the log into one segment per
+ * job, each of about SEGMENT_SIZE bytes and ending before an
+ * EventClockSync event, checking the events on the way.  The segments
+ * are then printed in parallel, each into its own buffer, and the
+ * buffers are written out in order.  So the output is the same as
+ * if the events were printed one at a time, and the memory needed
+ * depends on the number of jobs but not on the size of the log.
+ */
+
+#define SEGMENT_SIZE ((size_t)1 << 20)
+
+typedef struct SegmentStruct {
+  const char *base;             /* first event in segment */
+  const char *limit;            /* end of segment */
+  OutStruct out;                /* printed events */
+  pthread_t thread;             /* thread printing segment */
+  Bool threaded;                /* is it being printed by thread? */
+} SegmentStruct, *Segment;
+
+
+/* segmentEnd -- check events and find the end of a segment
+ *
+ * If the log is truncated, the segment ends at the last whole event,
+ * and *truncatedIO is set to TRUE.
+ */
+
+static const char *segmentEnd(Bool *truncatedIO, const char *base,
+                              const char *limit)
+{
+  const char *p = base;
+
+  while (p < limit) {
+    EventUnion eventUnion;
+    EventAnyStruct any;
+
+    if ((size_t)(limit - p) < sizeof any) {
+      *truncatedIO = TRUE;
+      break;
+    }
+    memcpy(&any, p, sizeof any);
+    if (any.size < sizeof any || any.size > sizeof eventUnion
+        || any.size > (size_t)(limit - p)) {
+      *truncatedIO = TRUE;
       break;
     }
+    if (any.code == EventEventClockSyncCode
+        && (size_t)(p - base) >= SEGMENT_SIZE)
+      break;
+    memcpy(&eventUnion, p, any.size);
+    checkEvent(&eventUnion);
+    p += any.size;
+  }
+  return p;
+}
 
-    (void)EVENT_CLOCK_PRINT(stdout, eventTime);
-    printf(" %4X", (unsigned)code);
 
-    switch (code) {
-#define EVENT_PARAM_PRINT(name, index, sort, ident)     \
-      printParam##sort(event->name.f##index);
-#define EVENT_PRINT(X, name, code, always, kind)        \
-      case code:                                        \
-        EVENT_##name##_PARAMS(EVENT_PARAM_PRINT, name)  \
-        break;
-      EVENT_LIST(EVENT_PRINT, X)
-    default:
-      evwarn("Unknown event code %d", code);
+/* segmentPrint -- print the events in a segment */
+
+static void *segmentPrint(void *closure)
+{
+  Segment seg = closure;
+  const char *p = seg->base;
+
+  while (p < seg->limit) {
+    EventUnion eventUnion;
+    memcpy(&eventUnion.any, p, sizeof eventUnion.any);
+    memcpy(&eventUnion, p, eventUnion.any.size);
+    printEvent(&seg->out, &eventUnion);
+    p += eventUnion.any.size;
+  }
+  return NULL;
+}
+
+
+/* readSegments -- check and print the events in memory */
+
+static void readSegments(const char *base, const char *limit)
+{
+  Segment segs;
+  const char *p = base;
+  Bool truncated = FALSE;
+  size_t i, n;
+
+  segs = calloc(jobs, sizeof segs[0]);
+  if (segs == NULL)
+    everror("Out of memory decoding log");
+
+  while (p < limit && !truncated) {
+    for (n = 0; n < jobs && p < limit && !truncated; ++n) {
+      segs[n].base = p;
+      p = segmentEnd(&truncated, p, limit);
+      segs[n].limit = p;
+      segs[n].out.count = 0;
     }
 
-    putchar('\n');
-    (void)fflush(stdout);
-  } /* while(!feof(input)) */
+    /* If a thread can't be created, print the segment here. */
+    for (i = 1; i < n; ++i)
+      segs[i].threaded = pthread_create(&segs[i].thread, NULL,
+                                        segmentPrint, &segs[i]) == 0;
+    (void)segmentPrint(&segs[0]);
+    for (i = 1; i < n; ++i) {
+      if (segs[i].threaded)
+        (void)pthread_join(segs[i].thread, NULL);
+      else
+        (void)segmentPrint(&segs[i]);
+    }
+
+    for (i = 0; i < n; ++i)
+      (void)fwrite(segs[i].out.base, 1, segs[i].out.count, stdout);
+  }
+  if (truncated)
+    everror("Truncated log");
+
+  for (i = 0; i < jobs; ++i)
+    free(segs[i].out.base);
+  free(segs);
 }
 
 
-/* CHECKCONV -- check t2 can be cast to t1 without loss */
+/* readMapped -- map log into memory and read it
+ *
+ * Returns FALSE if the log can't be mapped, for example because it is
+ * a pipe or too large for the address space.
+ */
+
+static Bool readMapped(FILE *stream)
+{
+  struct stat st;
+  size_t size;
+  void *base;
+  int fd = fileno(stream);
+
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+    return FALSE;
+  size = (size_t)st.st_size;
+  if ((off_t)size != st.st_size)
+    return FALSE;
+  if (size == 0)
+    return TRUE;
+
+  base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (base == MAP_FAILED)
+    return FALSE;
+  readSegments(base, (char *)base + size);
+  (void)munmap(base, size);
+  return TRUE;
+}
+
+#endif /* MPS_OS_FR || MPS_OS_LI || MPS_OS_XC */
+
+
+/* timeNow -- wall-clock time in seconds, for reporting throughput */
+
+static double timeNow(void)
+{
+#if defined(MPS_OS_FR) || defined(MPS_OS_LI) || defined(MPS_OS_XC)
+  struct timeval tv;
+  (void)gettimeofday(&tv, NULL);
+  return (double)tv.tv_sec + (double)tv.tv_usec / 1e6;
+#else
+  return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
 
 #define CHECKCONV(t1, t2) \
   (sizeof(t1) >= sizeof(t2))
@@ -309,6 +917,9 @@ int main(int argc, char *argv[])
 {
   const char *filename;
   FILE *input;
+  EventRingHeaderStruct header;
+  double start = timeNow();
+  double elapsed;
 
   assert(CHECKCONV(ulongest_t, Word));
   assert(CHECKCONV(ulongest_t, Addr));
@@ -322,15 +933,57 @@ int main(int argc, char *argv[])
       filename = DEFAULT_TELEMETRY_FILENAME;
   }
 
+  if (jobs == 0) {
+#if defined(MPS_OS_FR) || defined(MPS_OS_LI) || defined(MPS_OS_XC)
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    jobs = cpus > 0 ? (unsigned long)cpus : 1;
+#else
+    jobs = 1;
+#endif
+  }
+
   if (strcmp(filename, "-") == 0)
     input = stdin;
   else {
     input = fopen(filename, "rb");
     if (input == NULL)
       everror("unable to open \"%s\"\n", filename);
+
+    /* If it's a ring, reopen it for update so that the consumer
+       position can be written, if permitted. */
+    if (ringHeaderRead(&header, input)) {
+      Bool update = TRUE;
+      (void)fclose(input);
+      input = fopen(filename, "r+b");
+      if (input == NULL) {
+        update = FALSE;
+        input = fopen(filename, "rb");
+        if (input == NULL)
+          everror("unable to open \"%s\"\n", filename);
+      }
+      readRing(input, update);
+      goto done;
+    }
+    rewind(input);
   }
 
-  readLog(input);
+  if (follow)
+    everror("\"%s\" is not a telemetry ring", filename);
+#if defined(MPS_OS_FR) || defined(MPS_OS_LI) || defined(MPS_OS_XC)
+  if (merge || input == stdin || !readMapped(input))
+#endif
+    readLog(input);
+
+done:
+  if (verbose) {
+    elapsed = timeNow() - start;
+    (void)fflush(stdout);
+    (void)fprintf(stderr, "%s: %"PRIuLONGEST" events, %"PRIuLONGEST
+                  " bytes in %.3f s: %.1f MB/s with %lu jobs\n",
+                  prog, eventCount, eventBytes, elapsed,
+                  elapsed > 0 ? (double)eventBytes / 1e6 / elapsed : 0.0,
+                  jobs);
+  }
 
   return EXIT_SUCCESS;
 }
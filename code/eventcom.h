@@ -133,6 +133,37 @@ typedef union EventUnion {
 } EventUnion, *Event;
 
 
+/* EventRing -- telemetry ring file layout
+ *
+ * The layout of the memory-mapped ring file written by the POSIX I/O
+ * module <code/mpsioix.c> and read by the event converter
+ * <code/eventcnv.c>.  The header is followed by size bytes of data,
+ * holding frames each consisting of a Word length followed by that
+ * many bytes of events, padded to a multiple of the word size.
+ * Positions count bytes written since the ring was created, and
+ * wrap around on overflow.  See <design/io/#ring>.
+ */
+
+#define EventRingSIG            "MPSRING"  /* identifies a ring file */
+#define EventRingVERSION        ((Word)1)
+#define EventRingPAD            ((Word)-1) /* frame length: skip to end */
+
+/* Size of the frame holding length bytes of events. */
+#define EventRingFrameSIZE(length) \
+  (sizeof(Word) + (((Word)(length) + sizeof(Word) - 1) \
+                   & ~(Word)(sizeof(Word) - 1)))
+
+typedef struct EventRingHeaderStruct {
+  char sig[sizeof(EventRingSIG)]; /* EventRingSIG */
+  Word version;                 /* EventRingVERSION */
+  Word size;                    /* size of data, a power of two */
+  volatile Word write;          /* producer position */
+  volatile Word oldest;         /* position of oldest frame in ring */
+  volatile Word read;           /* consumer position */
+  volatile Word dropped;        /* frames overwritten before being read */
+} EventRingHeaderStruct, *EventRingHeader;
+
+
 #endif /* eventcom_h */
 
 
@@ -36,8 +36,8 @@
  */
 
 #define EVENT_VERSION_MAJOR  ((unsigned)1)
-#define EVENT_VERSION_MEDIAN ((unsigned)6)
-#define EVENT_VERSION_MINOR  ((unsigned)1)
+#define EVENT_VERSION_MEDIAN ((unsigned)7)
+#define EVENT_VERSION_MINOR  ((unsigned)2)
 
 
 /* EVENT_LIST -- list of event types and general properties
@@ -67,7 +67,7 @@
  */
  
 #define EventNameMAX ((size_t)19)
-#define EventCodeMAX ((EventCode)0x0088)
+#define EventCodeMAX ((EventCode)0x008D)
 
 #define EVENT_LIST(EVENT, X) \
   /*       0123456789012345678 <- don't exceed without changing EventNameMAX */ \
@@ -194,7 +194,12 @@
   EVENT(X, ArenaUseFreeZone   , 0x0085,  TRUE, Arena) \
   /* EVENT(X, ArenaBlacklistZone , 0x0086,  TRUE, Arena) */ \
   EVENT(X, PauseTimeSet       , 0x0087,  TRUE, Arena) \
-  EVENT(X, TraceEndGen        , 0x0088,  TRUE, Trace)
+  EVENT(X, TraceEndGen        , 0x0088,  TRUE, Trace) \
+  EVENT(X, ArenaLockWait      , 0x0089,  TRUE, Arena) \
+  EVENT(X, VMPurge            , 0x008A,  TRUE, Seg) \
+  EVENT(X, PoolScanStats      , 0x008B,  TRUE, Trace) \
+  EVENT(X, RootScanStats      , 0x008C,  TRUE, Trace) \
+  EVENT(X, FormatScanStats    , 0x008D,  TRUE, Trace)
 
 
 /* Remember to update EventNameMAX and EventCodeMAX above! 
@@ -388,6 +393,11 @@
   PARAM(X,  1, A, base) \
   PARAM(X,  2, A, limit)
 
+#define EVENT_VMPurge_PARAMS(PARAM, X) \
+  PARAM(X,  0, P, vm) \
+  PARAM(X,  1, A, base) \
+  PARAM(X,  2, A, limit)
+
 #define EVENT_ArenaExtend_PARAMS(PARAM, X) \
   PARAM(X,  0, P, arena) \
   PARAM(X,  1, A, base) \
@@ -457,7 +467,8 @@
   PARAM(X,  9, W, singleCopiedSize) \
   PARAM(X, 10, W, readBarrierHitCount) \
   PARAM(X, 11, W, greySegMax) \
-  PARAM(X, 12, W, pointlessScanCount)
+  PARAM(X, 12, W, pointlessScanCount) \
+  PARAM(X, 13, W, objectScanCount)
 
 #define EVENT_TraceStatFix_PARAMS(PARAM, X) \
   PARAM(X,  0, P, trace) \
@@ -711,6 +722,34 @@
   PARAM(X,  4, W, preservedInPlace) /* bytes preserved in generation */ \
   PARAM(X,  5, D, mortality)    /* updated mortality */
 
+#define EVENT_ArenaLockWait_PARAMS(PARAM, X) \
+  PARAM(X,  0, P, arena)        /* the arena */ \
+  PARAM(X,  1, D, wait)         /* time waited for the lock, in seconds */
+
+#define EVENT_PoolScanStats_PARAMS(PARAM, X) \
+  PARAM(X,  0, P, trace)        /* the trace that finished */ \
+  PARAM(X,  1, P, pool)         /* the pool */ \
+  PARAM(X,  2, W, scans)        /* segments scanned */ \
+  PARAM(X,  3, D, scanned)      /* bytes scanned */ \
+  PARAM(X,  4, W, fixed)        /* refs fixed */ \
+  PARAM(X,  5, D, time)         /* time spent scanning, in seconds */
+
+#define EVENT_RootScanStats_PARAMS(PARAM, X) \
+  PARAM(X,  0, P, trace)        /* the trace that finished */ \
+  PARAM(X,  1, P, root)         /* the root */ \
+  PARAM(X,  2, W, scans)        /* times the root was scanned */ \
+  PARAM(X,  3, D, scanned)      /* bytes scanned */ \
+  PARAM(X,  4, W, fixed)        /* refs fixed */ \
+  PARAM(X,  5, D, time)         /* time spent scanning, in seconds */
+
+#define EVENT_FormatScanStats_PARAMS(PARAM, X) \
+  PARAM(X,  0, P, trace)        /* the trace that finished */ \
+  PARAM(X,  1, P, format)       /* the format */ \
+  PARAM(X,  2, W, scans)        /* segments scanned */ \
+  PARAM(X,  3, D, scanned)      /* bytes scanned */ \
+  PARAM(X,  4, W, fixed)        /* refs fixed */ \
+  PARAM(X,  5, D, time)         /* time spent scanning, in seconds */
+
 
 #endif /* eventdef_h */
 
@@ -147,34 +147,58 @@ static void printStr(const char *str)
 
 
 /* Reading clocks, hex numbers, and doubles, and quoted-and-escaped
- * strings. */
+ * strings.  Clocks and hex numbers are parsed by hand, rather than
+ * with sscanf, because they make up almost all of the input. */
+
+/* parseDigits -- parse up to max hex digits, after any spaces */
+
+static Bool parseDigits(ulongest_t *valReturn, char **pInOut, size_t max)
+{
+  ulongest_t val = 0;
+  char *p = *pInOut;
+  size_t n;
+
+  while (*p == ' ')
+    ++p;
+  for (n = 0; n < max; ++n, ++p) {
+    unsigned digit;
+    if (*p >= '0' && *p <= '9')
+      digit = (unsigned)(*p - '0');
+    else if (*p >= 'A' && *p <= 'F')
+      digit = (unsigned)(*p - 'A' + 10);
+    else if (*p >= 'a' && *p <= 'f')
+      digit = (unsigned)(*p - 'a' + 10);
+    else
+      break;
+    val = (val << 4) | digit;
+  }
+  if (n == 0)
+    return FALSE;
+  *valReturn = val;
+  *pInOut = p;
+  return TRUE;
+}
 
 static EventClock parseClock(char **pInOut)
 {
   EventClock val;
-  int i, l;
-  unsigned long low, high;
+  ulongest_t low, high;
   char *p = *pInOut;
-  
-  i = sscanf(p, "%08lX%08lX%n", &high, &low, &l);
-  if (i != 2)
-    everror("Couldn't read a clock from '%s'", p);
+
+  if (!parseDigits(&high, &p, 8) || !parseDigits(&low, &p, 8))
+    everror("Couldn't read a clock from '%s'", *pInOut);
   EVENT_CLOCK_MAKE(val, low, high);
 
-  *pInOut = p + l;
+  *pInOut = p;
   return val;  
 }
 
 static ulongest_t parseHex(char **pInOut)
 {
   ulongest_t val;
-  int i, l;
-  char *p = *pInOut;
 
-  i = sscanf(p, "%" SCNXLONGEST "%n", &val, &l);
-  if (i != 1)
-    everror("Couldn't read a hex number from '%s'", p);
-  *pInOut = p + l;
+  if (!parseDigits(&val, pInOut, sizeof val * 2))
+    everror("Couldn't read a hex number from '%s'", *pInOut);
   return val;
 }
 
@@ -400,6 +424,23 @@ static void recordLabel(mps_pool_t pool, EventClock clock, char *p)
 
 static int hexWordWidth = (MPS_WORD_WIDTH+3)/4;
 
+/* printHex -- output a ulongest_t like printf("%0*"PRIXLONGEST) */
+
+static void printHex(ulongest_t val, int width)
+{
+  char buf[sizeof val * 2 + 1];
+  size_t i = sizeof buf - 1;
+
+  buf[i] = '\0';
+  do {
+    buf[--i] = "0123456789ABCDEF"[val & 0xF];
+    val >>= 4;
+  } while (val != 0);
+  while (i > 0 && sizeof buf - 1 - i < (size_t)width)
+    buf[--i] = '0';
+  (void)fputs(buf + i, stdout);
+}
+
 /* printAddr -- output a ulongest_t in hex, with the interned string
  * if the value is in the label table */
 
@@ -407,7 +448,9 @@ static void printAddr(EventClock clock, ulongest_t addr, const char *ident)
 {
   void *tmp;
         
-  printf("%s:%0*" PRIXLONGEST, ident, hexWordWidth, addr);
+  (void)fputs(ident, stdout);
+  putchar(':');
+  printHex(addr, hexWordWidth);
   if (TableLookup(&tmp, labelTable, (TableKey)addr)) {
     LabelList list = tmp;
     size_t pos = labelFind(list, clock);
@@ -0,0 +1,264 @@
+/* fixbench.c -- Fix benchmark against number of chunks
+ *
+ * $Id$
+ * Copyright (c) 2016 Ravenbrook Limited.  See end of file for license.
+ *
+ * This measures the rate at which the MPS fixes references, for
+ * arenas with increasing numbers of chunks.  It builds a heap of
+ * vectors whose slots refer to other vectors, in arenas of decreasing
+ * initial size (so that the arena has to extend itself with more
+ * chunks to hold the heap), and times full collections of the heap.
+ * The vectors are allocated in an AMS pool, so that collections don't
+ * move them, and the number of chunks stays the same.
+ * See <design/arena/#chunk.map>.
+ */
+
+#include "mps.c"
+#include "testlib.h"
+#include "fmtdy.h"
+#include "fmtdytst.h"
+#include "mpm.h"
+
+#ifdef MPS_OS_W3
+#include "getopt.h"
+#else
+#include <getopt.h>
+#endif
+
+#include <ctype.h> /* toupper */
+#include <stdio.h> /* fprintf, printf, stderr */
+#include <stdlib.h> /* exit, EXIT_FAILURE, EXIT_SUCCESS, malloc, free */
+#include <time.h> /* clock, CLOCKS_PER_SEC */
+
+#define RESMUST(expr) \
+  do { \
+    mps_res_t res = (expr); \
+    if (res != MPS_RES_OK) { \
+      fprintf(stderr, #expr " returned %d\n", res); \
+      exit(EXIT_FAILURE); \
+    } \
+  } while(0)
+
+typedef mps_word_t obj_t;
+
+static rnd_state_t seed = 0;      /* random number seed */
+static size_t heap_size = 16ul * 1024 * 1024; /* size of heap */
+static size_t min_arena_size = 256ul * 1024; /* smallest arena size */
+static size_t width = 64;         /* width of vectors */
+static unsigned ncoll = 4;        /* collections per arena size */
+
+
+/* fixbench -- build the heap and time collections in one arena */
+
+static void fixbench(size_t arena_size)
+{
+  mps_arena_t arena;
+  mps_fmt_t format;
+  mps_pool_t pool;
+  mps_ap_t ap;
+  mps_root_t root;
+  obj_t *objs;
+  size_t nobjs, i, j;
+  unsigned k;
+  Count chunks;
+  clock_t begin, end;
+  double time, fixes;
+
+  nobjs = heap_size / ((width + 2) * sizeof(obj_t));
+  objs = malloc(nobjs * sizeof objs[0]);
+  if (objs == NULL) {
+    fprintf(stderr, "Couldn't allocate roots\n");
+    exit(EXIT_FAILURE);
+  }
+  for (i = 0; i < nobjs; ++i)
+    objs[i] = DYLAN_INT(0);
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, arena_size);
+    RESMUST(mps_arena_create_k(&arena, mps_arena_class_vm(), args));
+  } MPS_ARGS_END(args);
+  mps_arena_park(arena);
+  RESMUST(dylan_fmt(&format, arena));
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
+    RESMUST(mps_pool_create_k(&pool, arena, mps_class_ams(), args));
+  } MPS_ARGS_END(args);
+  RESMUST(mps_root_create_table(&root, arena, mps_rank_exact(), 0,
+                                (mps_addr_t *)objs, nobjs));
+  RESMUST(mps_ap_create_k(&ap, pool, mps_args_none));
+
+  /* Each slot refers to a random vector made earlier, so that most
+     references are fixed after their target has been marked. */
+  for (i = 0; i < nobjs; ++i) {
+    obj_t v;
+    RESMUST(make_dylan_vector(&v, ap, width));
+    for (j = 0; j < width; ++j)
+      DYLAN_VECTOR_SLOT(v, j) = objs[rnd() % (i + 1)];
+    objs[i] = v;
+  }
+
+  begin = clock();
+  for (k = 0; k < ncoll; ++k)
+    RESMUST(mps_arena_collect(arena));
+  end = clock();
+
+  chunks = RingLength(ArenaChunkRing((Arena)arena));
+  time = (double)(end - begin) / CLOCKS_PER_SEC;
+  fixes = (double)ncoll * (double)nobjs * (double)(width + 1);
+  printf("%10lu %8lu %12.0f %10.3f %14.0f\n",
+         (unsigned long)arena_size, (unsigned long)chunks,
+         fixes, time, time > 0.0 ? fixes / time : 0.0);
+
+  mps_ap_destroy(ap);
+  mps_root_destroy(root);
+  mps_pool_destroy(pool);
+  mps_fmt_destroy(format);
+  mps_arena_destroy(arena);
+  free(objs);
+}
+
+
+/* Command-line options definitions.  See getopt_long(3). */
+
+static struct option longopts[] = {
+  {"help",             no_argument,       NULL, 'h'},
+  {"heap-size",        required_argument, NULL, 'm'},
+  {"min-arena-size",   required_argument, NULL, 'a'},
+  {"width",            required_argument, NULL, 'w'},
+  {"ncoll",            required_argument, NULL, 'n'},
+  {"seed",             required_argument, NULL, 'x'},
+  {NULL,               0,                 NULL, 0  }
+};
+
+
+static size_t parse_size(const char *arg, const char *what)
+{
+  char *p;
+  size_t size = (size_t)strtoul(arg, &p, 10);
+  switch(toupper(*p)) {
+  case 'G': size <<= 30; break;
+  case 'M': size <<= 20; break;
+  case 'K': size <<= 10; break;
+  case '\0': break;
+  default:
+    fprintf(stderr, "Bad %s %s\n", what, arg);
+    exit(EXIT_FAILURE);
+  }
+  return size;
+}
+
+
+/* Command-line driver */
+
+int main(int argc, char *argv[]) {
+  int ch;
+  size_t arena_size;
+  mps_bool_t seed_specified = FALSE;
+
+  seed = rnd_seed();
+
+  while ((ch = getopt_long(argc, argv, "hm:a:w:n:x:", longopts, NULL)) != -1)
+    switch (ch) {
+    case 'm':
+      heap_size = parse_size(optarg, "heap size");
+      break;
+    case 'a':
+      min_arena_size = parse_size(optarg, "minimum arena size");
+      break;
+    case 'w':
+      width = (size_t)strtoul(optarg, NULL, 10);
+      if (width < 1) {
+        fprintf(stderr, "Width must be at least 1\n");
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'n':
+      ncoll = (unsigned)strtoul(optarg, NULL, 10);
+      break;
+    case 'x':
+      seed = strtoul(optarg, NULL, 10);
+      seed_specified = TRUE;
+      break;
+    default:
+      fprintf(stderr,
+              "Usage: %s [option...]\n"
+              "Options:\n"
+              "  -m n, --heap-size=n[KMG]?\n"
+              "    Size of heap to build (default %lu).\n"
+              "  -a n, --min-arena-size=n[KMG]?\n"
+              "    Smallest initial arena size to try (default %lu).\n"
+              "  -w n, --width=n\n"
+              "    Width of vectors made (default %lu).\n"
+              "  -n n, --ncoll=n\n"
+              "    Collections per arena size (default %u).\n"
+              "  -x n, --seed=n\n"
+              "    Random number seed (default from entropy).\n",
+              argv[0],
+              (unsigned long)heap_size,
+              (unsigned long)min_arena_size,
+              (unsigned long)width,
+              ncoll);
+      return EXIT_FAILURE;
+    }
+
+  if (!seed_specified) {
+    printf("seed: %lu\n", seed);
+    (void)fflush(stdout);
+  }
+
+  (void)mps_lib_assert_fail_install(assert_die);
+  RESMUST(dylan_make_wrappers());
+  printf("%10s %8s %12s %10s %14s\n",
+         "arena", "chunks", "fixes", "time", "fixes/sec");
+  /* Start with an arena big enough to hold two copies of the heap in
+     one chunk, and halve it, so the arena needs more chunks. */
+  for (arena_size = heap_size * 4; arena_size >= min_arena_size;
+       arena_size /= 2) {
+    rnd_state_set(seed);
+    fixbench(arena_size);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (c) 2016 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -150,6 +150,14 @@ mps_res_t make_dylan_vector(mps_word_t *v, mps_ap_t ap, size_t slots)
 
 
 void dylan_write(mps_addr_t addr, mps_addr_t *refs, size_t nr_refs)
+{
+  dylan_write_cards(addr, refs, nr_refs, NULL);
+}
+
+/*  Like dylan_write, but if cards is not NULL, marks the card that
+    was written, for arenas with card marking. */
+void dylan_write_cards(mps_addr_t addr, mps_addr_t *refs, size_t nr_refs,
+                       mps_cards_t cards)
 {
   mps_word_t *p = (mps_word_t *)addr;
   mps_word_t t = p[1] >> 2;
@@ -163,6 +171,8 @@ void dylan_write(mps_addr_t addr, mps_addr_t *refs, size_t nr_refs)
       p[i] = ((r & ~(mps_word_t)3) | 1); /* random int */
     else
       p[i] = (mps_word_t)refs[(r >> 1) % nr_refs]; /* random ptr */
+    if(cards != NULL)
+      MPS_WRITE_BARRIER(cards, &p[i]);
   }
 }
 
@@ -14,6 +14,9 @@ extern mps_res_t dylan_init(mps_addr_t addr, size_t size,
                             mps_addr_t *refs, size_t nr_refs);
 extern void dylan_write(mps_addr_t addr,
                         mps_addr_t *refs, size_t nr_refs);
+extern void dylan_write_cards(mps_addr_t addr,
+                              mps_addr_t *refs, size_t nr_refs,
+                              mps_cards_t cards);
 extern void dylan_mutate(mps_addr_t addr);
 extern mps_addr_t dylan_read(mps_addr_t addr);
 extern mps_bool_t dylan_check(mps_addr_t addr);
@@ -149,6 +149,7 @@ Res FormatCreate(Format *formatReturn, Arena arena, ArgList args)
   format->isMoved = fmtIsfwd;
   format->pad = fmtPad;
   format->klass = fmtClass;
+  ScanStatsInit(&format->scanStats);
 
   format->sig = FormatSig;
   format->serial = arena->formatSerial;
@@ -12,11 +12,14 @@
 #include "fmtdy.h"
 #include "fmtdytst.h"
 #include "mpm.h"
+#include "mpscamc.h"
 
 #ifdef MPS_OS_W3
 #include "getopt.h"
+#include "mpswin.h" /* QueryPerformanceCounter */
 #else
 #include <getopt.h>
+#include <sys/time.h> /* gettimeofday */
 #endif
 
 #include <stdio.h> /* fprintf, printf, putchars, sscanf, stderr, stdout */
@@ -56,6 +59,12 @@ static size_t arena_grain_size = 1; /* arena grain size */
 static unsigned pinleaf = FALSE;  /* are leaf objects pinned at start */
 static mps_bool_t zoned = TRUE;   /* arena allocates using zones */
 static double pause_time = ARENA_DEFAULT_PAUSE_TIME; /* maximum pause time */
+static size_t copy_depth = 0;     /* depth of depth-first copying in AMC */
+static mps_bool_t dirty_tracking = FALSE; /* write barrier by dirty pages */
+static mps_bool_t cooperative = FALSE; /* suspend threads at safepoints */
+static mps_bool_t lock_stats = FALSE; /* measure arena lock contention */
+static mps_bool_t huge_pages = FALSE; /* back arena with huge pages */
+static mps_bool_t numa = FALSE;       /* place chunks on NUMA nodes */
 
 typedef struct gcthread_s *gcthread_t;
 
@@ -71,9 +80,11 @@ struct gcthread_s {
 
 typedef mps_word_t obj_t;
 
-static obj_t mkvector(mps_ap_t ap, size_t n) {
+static obj_t mkvector(gcthread_t thread, size_t n) {
   mps_word_t v;
-  RESMUST(make_dylan_vector(&v, ap, n));
+  RESMUST(make_dylan_vector(&v, thread->ap, n));
+  /* Let a cooperative collector stop this thread. */
+  mps_thread_safepoint(thread->mps_thread);
   return v;
 }
 
@@ -86,14 +97,14 @@ static void aset(obj_t v, size_t i, obj_t val) {
 }
 
 /* mktree - make a tree of nodes with depth d. */
-static obj_t mktree(mps_ap_t ap, unsigned d, obj_t leaf) {
+static obj_t mktree(gcthread_t thread, unsigned d, obj_t leaf) {
   obj_t tree;
   size_t i;
   if (d <= 0)
     return leaf;
-  tree = mkvector(ap, width);
+  tree = mkvector(thread, width);
   for (i = 0; i < width; ++i) {
-    aset(tree, i, mktree(ap, d - 1, leaf));
+    aset(tree, i, mktree(thread, d - 1, leaf));
   }
   return tree;
 }
@@ -114,7 +125,7 @@ static obj_t random_subtree(obj_t tree, unsigned levels) {
  * NOTE: Changing preuse will dramatically change how much work
  * is done.  In particular, if preuse==1, the old tree is returned
  * unchanged. */
-static obj_t new_tree(mps_ap_t ap, obj_t oldtree, unsigned d) {
+static obj_t new_tree(gcthread_t thread, obj_t oldtree, unsigned d) {
   obj_t subtree;
   size_t i;
   if (rnd_double() < preuse) {
@@ -122,9 +133,9 @@ static obj_t new_tree(mps_ap_t ap, obj_t oldtree, unsigned d) {
   } else {
     if (d == 0)
       return objNULL;
-    subtree = mkvector(ap, width);
+    subtree = mkvector(thread, width);
     for (i = 0; i < width; ++i) {
-      aset(subtree, i, new_tree(ap, oldtree, d - 1));
+      aset(subtree, i, new_tree(thread, oldtree, d - 1));
     }
   }
   return subtree;
@@ -133,21 +144,21 @@ static obj_t new_tree(mps_ap_t ap, obj_t oldtree, unsigned d) {
 /* Update tree to be identical tree but with nodes reallocated
  * with probability pupdate.  This avoids writing to vector slots
  * if unecessary. */
-static obj_t update_tree(mps_ap_t ap, obj_t oldtree, unsigned d) {
+static obj_t update_tree(gcthread_t thread, obj_t oldtree, unsigned d) {
   obj_t tree;
   size_t i;
   if (oldtree == objNULL || d == 0)
     return oldtree;
   if (rnd_double() < pupdate) {
-    tree = mkvector(ap, width);
+    tree = mkvector(thread, width);
     for (i = 0; i < width; ++i) {
-      aset(tree, i, update_tree(ap, aref(oldtree, i), d - 1));
+      aset(tree, i, update_tree(thread, aref(oldtree, i), d - 1));
     }
   } else {
     tree = oldtree;
     for (i = 0; i < width; ++i) {
       obj_t oldsubtree = aref(oldtree, i);
-      obj_t subtree = update_tree(ap, oldsubtree, d - 1);
+      obj_t subtree = update_tree(thread, oldsubtree, d - 1);
       if (subtree != oldsubtree) {
         aset(tree, i, subtree);
       }
@@ -158,15 +169,14 @@ static obj_t update_tree(mps_ap_t ap, obj_t oldtree, unsigned d) {
 
 static void *gc_tree(gcthread_t thread) {
   unsigned i, j;
-  mps_ap_t ap = thread->ap;
-  obj_t leaf = pinleaf ? mktree(ap, 1, objNULL) : objNULL;
+  obj_t leaf = pinleaf ? mktree(thread, 1, objNULL) : objNULL;
   for (i = 0; i < niter; ++i) {
-    obj_t tree = mktree(ap, depth, leaf);
+    obj_t tree = mktree(thread, depth, leaf);
     for (j = 0 ; j < npass; ++j) {
       if (preuse < 1.0)
-        tree = new_tree(ap, tree, depth);
+        tree = new_tree(thread, tree, depth);
       if (pupdate > 0.0)
-        tree = update_tree(ap, tree, depth);
+        tree = update_tree(thread, tree, depth);
     }
   }
   return NULL;
@@ -211,18 +221,168 @@ static void weave1(gcthread_fn_t fn)
 }
 
 
+/* gc_list -- build lists by adding nodes to the front
+ *
+ * Each node refers to the node allocated before it, which is usually
+ * at a lower address in the same segment, so tracing the list goes
+ * backwards through each segment.  The list has 2^depth nodes of
+ * width slots.  See <design/poolams/#scan.stack.measure>.
+ */
+
+static void *gc_list(gcthread_t thread) {
+  unsigned i, j;
+  size_t k, length = (size_t)1 << depth;
+  for (i = 0; i < niter; ++i) {
+    for (j = 0; j < npass; ++j) {
+      obj_t list = objNULL;
+      for (k = 0; k < length; ++k) {
+        obj_t node = mkvector(thread, width);
+        aset(node, 0, list);
+        list = node;
+      }
+    }
+  }
+  return NULL;
+}
+
+
+/* wall_time -- elapsed real time in seconds
+ *
+ * clock() measures the processor time used by all threads, which
+ * includes the MPS's own threads, so it can't show how long the
+ * benchmark took.
+ */
+
+static double wall_time(void)
+{
+#ifdef MPS_OS_W3
+  LARGE_INTEGER count, frequency;
+  QueryPerformanceCounter(&count);
+  QueryPerformanceFrequency(&frequency);
+  return (double)count.QuadPart / (double)frequency.QuadPart;
+#else
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (double)tv.tv_sec + (double)tv.tv_usec / 1e6;
+#endif
+}
+
+
+/* rewrite_tree -- store every reference in a tree back into its slot */
+
+static void rewrite_tree(obj_t tree, unsigned d) {
+  size_t i;
+  if (d <= 0 || tree == objNULL)
+    return;
+  for (i = 0; i < width; ++i) {
+    obj_t child = aref(tree, i);
+    aset(tree, i, child);
+    rewrite_tree(child, d - 1);
+  }
+}
+
+
+/* gc_barrier -- measure the cost of the write barrier
+ *
+ * After each collection the tree's segments are write-protected (or
+ * tracked as dirty pages, with --dirty-tracking), so rewriting the
+ * tree hits the write barrier once per segment.  Only the time spent
+ * rewriting is reported here; the total time includes collections.
+ */
+
+static void *gc_barrier(gcthread_t thread) {
+  unsigned i, j;
+  obj_t tree = mktree(thread, depth, objNULL);
+  for (i = 0; i < niter; ++i) {
+    double t = 0.0, begin;
+    for (j = 0; j < npass; ++j) {
+      mps_arena_collect(arena);
+      mps_arena_release(arena);
+      begin = wall_time();
+      rewrite_tree(tree, depth);
+      t += wall_time() - begin;
+    }
+    printf("barrier writes: %g\n", t);
+  }
+  return NULL;
+}
+
+
+/* gc_flip -- measure how long it takes to stop the other threads
+ *
+ * One thread repeatedly stops all the others, as the collector does
+ * when it flips, while they are blocked waiting for a lock (as the
+ * worker threads of a server mostly are).  Run with --nthreads to see
+ * how the latency depends on the number of threads, and with
+ * --cooperative to compare safepoints with signals.
+ */
+
+static unsigned long flip_count = 0;
+static double flip_total = 0.0, flip_max = 0.0;
+static gcthread_t flip_thread = NULL;
+static volatile unsigned flip_ready = 0;
+static Lock flip_gate = NULL;   /* held by flip_thread while it measures */
+
+static void *gc_flip(gcthread_t thread) {
+  unsigned i;
+  Bool measure;
+
+  ArenaEnter(arena);
+  measure = flip_thread == NULL;
+  if (measure) {
+    flip_thread = thread;
+    LockClaim(flip_gate);
+  }
+  ++flip_ready;
+  ArenaLeave(arena);
+
+  if (!measure) {
+    (void)mktree(thread, 4, objNULL);
+    mps_thread_enter_native(thread->mps_thread);
+    LockClaim(flip_gate);
+    LockRelease(flip_gate);
+    mps_thread_leave_native(thread->mps_thread);
+    return NULL;
+  }
+
+  /* Wait for all the threads to be running. */
+  while (flip_ready < nthreads)
+    (void)mktree(thread, 4, objNULL);
+
+  for (i = 0; i < niter * npass; ++i) {
+    double begin, t;
+    (void)mktree(thread, 4, objNULL);
+    ArenaEnter(arena);
+    begin = wall_time();
+    ShieldHold(arena);
+    t = wall_time() - begin;
+    ShieldRelease(arena);
+    ArenaLeave(arena);
+    ++flip_count;
+    flip_total += t;
+    if (t > flip_max)
+      flip_max = t;
+  }
+  LockRelease(flip_gate);
+  return NULL;
+}
+
 static void watch(gcthread_fn_t fn, const char *name)
 {
   clock_t begin, end;
+  double wall_begin, wall_end;
   
   begin = clock();
+  wall_begin = wall_time();
   if (nthreads == 1)
     weave1(fn);
   else
     weave(fn);
   end = clock();
+  wall_end = wall_time();
   
-  printf("%s: %g\n", name, (double)(end - begin) / CLOCKS_PER_SEC);
+  printf("%s: %g (wall %g)\n", name,
+         (double)(end - begin) / CLOCKS_PER_SEC, wall_end - wall_begin);
 }
 
 
@@ -237,8 +397,15 @@ static void arena_setup(gcthread_fn_t fn,
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_GRAIN_SIZE, arena_grain_size);
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_ZONED, zoned);
     MPS_ARGS_ADD(args, MPS_KEY_PAUSE_TIME, pause_time);
+    MPS_ARGS_ADD(args, MPS_KEY_DIRTY_TRACKING, dirty_tracking);
+    MPS_ARGS_ADD(args, MPS_KEY_COOPERATIVE_SUSPEND, cooperative);
+    MPS_ARGS_ADD(args, MPS_KEY_LOCK_STATS, lock_stats);
+    MPS_ARGS_ADD(args, MPS_KEY_VM_HUGE_PAGES, huge_pages);
+    MPS_ARGS_ADD(args, MPS_KEY_VM_NUMA, numa);
     RESMUST(mps_arena_create_k(&arena, mps_arena_class_vm(), args));
   } MPS_ARGS_END(args);
+  if (dirty_tracking && !ArenaDirtyTracking(arena))
+    fprintf(stderr, "Dirty tracking not available: using protection.\n");
   RESMUST(dylan_fmt(&format, arena));
   /* Make wrappers now to avoid race condition. */
   /* dylan_make_wrappers() uses malloc. */
@@ -249,10 +416,45 @@ static void arena_setup(gcthread_fn_t fn,
     MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
     if (ngen > 0)
       MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
+    MPS_ARGS_ADD(args, MPS_KEY_AMC_COPY_DEPTH, copy_depth);
     RESMUST(mps_pool_create_k(&pool, arena, pool_class, args));
   } MPS_ARGS_END(args);
+  flip_count = 0;
+  flip_total = flip_max = 0.0;
+  flip_thread = NULL;
+  flip_ready = 0;
+  flip_gate = malloc(LockSize());
+  if (flip_gate == NULL)
+    error("Couldn't allocate lock");
+  LockInit(flip_gate);
   watch(fn, name);
+  LockFinish(flip_gate);
+  free(flip_gate);
+  if (flip_count > 0)
+    printf("flips: %lu (threads %u, mean %g, max %g)\n", flip_count,
+           nthreads, flip_total / (double)flip_count, flip_max);
+  if (lock_stats) {
+    mps_lock_stats_s stats;
+    size_t i;
+    if (mps_arena_lock_stats(&stats, arena)) {
+      printf("lock: claims %lu, contended %lu, wait %g (max %g), "
+             "hold %g (max %g)\nlock hold histogram:",
+             (unsigned long)stats.mps_claims,
+             (unsigned long)stats.mps_contended,
+             stats.mps_wait_total, stats.mps_wait_max,
+             stats.mps_hold_total, stats.mps_hold_max);
+      for (i = 0; i < MPS_LOCK_HOLD_BUCKETS; ++i)
+        printf(" %lu", (unsigned long)stats.mps_hold[i]);
+      putchar('\n');
+    }
+  }
   mps_arena_park(arena);
+  /* Scan throughput: the traced work is the number of bytes scanned
+     in segments and roots. */
+  if (arena->tracedTime > 0.0)
+    printf("scan: %g MB in %g s (%g MB/s)\n",
+           arena->tracedWork / 1048576.0, arena->tracedTime,
+           arena->tracedWork / 1048576.0 / arena->tracedTime);
   mps_pool_destroy(pool);
   mps_fmt_destroy(format);
   if (ngen > 0)
@@ -279,6 +481,12 @@ static struct option longopts[] = {
   {"seed",             required_argument, NULL, 'x'},
   {"arena-unzoned",    no_argument,       NULL, 'z'},
   {"pause-time",       required_argument, NULL, 'P'},
+  {"copy-depth",       required_argument, NULL, 'c'},
+  {"dirty-tracking",   no_argument,       NULL, 'D'},
+  {"cooperative",      no_argument,       NULL, 'C'},
+  {"lock-stats",       no_argument,       NULL, 'L'},
+  {"huge-pages",       no_argument,       NULL, 'H'},
+  {"numa",             no_argument,       NULL, 'N'},
   {NULL,               0,                 NULL, 0  }
 };
 
@@ -290,6 +498,9 @@ static struct {
 } pools[] = {
   {"amc", gc_tree, mps_class_amc},
   {"ams", gc_tree, mps_class_ams},
+  {"amslist", gc_list, mps_class_ams},
+  {"barrier", gc_barrier, mps_class_amc},
+  {"flip", gc_flip, mps_class_amc},
 };
 
 
@@ -302,7 +513,7 @@ int main(int argc, char *argv[]) {
 
   seed = rnd_seed();
   
-  while ((ch = getopt_long(argc, argv, "ht:i:p:g:m:a:w:d:r:u:lx:zP:",
+  while ((ch = getopt_long(argc, argv, "ht:i:p:g:m:a:w:d:r:u:lx:zP:c:DCLHN",
                            longopts, NULL)) != -1)
     switch (ch) {
     case 't':
@@ -396,6 +607,29 @@ int main(int argc, char *argv[]) {
     case 'P':
       pause_time = strtod(optarg, NULL);
       break;
+    case 'c':
+      copy_depth = (size_t)strtoul(optarg, NULL, 10);
+      if (copy_depth > AMC_COPY_DEPTH_MAX) {
+        fprintf(stderr, "Copy depth must be at most %lu\n",
+                (unsigned long)AMC_COPY_DEPTH_MAX);
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'D':
+      dirty_tracking = TRUE;
+      break;
+    case 'C':
+      cooperative = TRUE;
+      break;
+    case 'L':
+      lock_stats = TRUE;
+      break;
+    case 'H':
+      huge_pages = TRUE;
+      break;
+    case 'N':
+      numa = TRUE;
+      break;
     default:
       /* This is printed in parts to keep within the 509 character
          limit for string literals in portable standard C. */
@@ -443,10 +677,28 @@ int main(int argc, char *argv[]) {
               "    Disable zoned allocation in the arena\n"
               "  -P t, --pause-time\n"
               "    Maximum pause time in seconds (default %f) \n"
+              "  -c n, --copy-depth=n\n"
+              "    Copy depth-first to depth n in AMC (default %lu)\n",
+              pause_time,
+              (unsigned long)copy_depth);
+      fprintf(stderr,
+              "  -D, --dirty-tracking\n"
+              "    Keep the write barrier using dirty page tracking\n"
+              "  -C, --cooperative\n"
+              "    Suspend threads at safepoints, not with signals\n"
+              "  -L, --lock-stats\n"
+              "    Report contention for the arena lock\n"
+              "  -H, --huge-pages\n"
+              "    Back the arena with transparent huge pages\n"
+              "  -N, --numa\n"
+              "    Allocate on the NUMA node of the allocating thread\n");
+      fprintf(stderr,
               "Tests:\n"
-              "  amc   pool class AMC\n"
-              "  ams   pool class AMS\n",
-              pause_time);
+              "  amc      pool class AMC\n"
+              "  ams      pool class AMS\n"
+              "  amslist  lists in pool class AMS\n"
+              "  barrier  write barrier hits in pool class AMC\n"
+              "  flip     time to stop all threads\n");
       return EXIT_FAILURE;
     }
   argc -= optind;
@@ -53,6 +53,36 @@ static void arenaReleaseRingLock(void)
 }
 
 
+/* arenaClaimAll -- claim the lock for an arena and its pools
+ *
+ * Pool locks are claimed after the arena lock.
+ * <design/pool/#lock.order>
+ */
+
+static void arenaClaimAll(Arena arena)
+{
+  Ring node, next;
+
+  ArenaEnter(arena);
+  RING_FOR(node, ArenaPoolRing(arena), next) {
+    Pool pool = PoolOfArenaRing(node);
+    PoolLockClaim(pool);
+  }
+}
+
+/* arenaReleaseAll -- release the locks claimed by arenaClaimAll */
+
+static void arenaReleaseAll(Arena arena)
+{
+  Ring node, next;
+
+  RING_FOR(node, ArenaPoolRing(arena), next) {
+    Pool pool = PoolOfArenaRing(node);
+    PoolLockRelease(pool);
+  }
+  ArenaLeave(arena);
+}
+
 /* GlobalsClaimAll -- claim all MPS locks
  * <design/thread-safety/#sol.fork.lock>
  */
@@ -61,7 +91,8 @@ void GlobalsClaimAll(void)
 {
   LockClaimGlobalRecursive();
   arenaClaimRingLock();
-  GlobalsArenaMap(ArenaEnter);
+  GlobalsArenaMap(arenaClaimAll);
+  LockClaimGlobalLeaf();
 }
 
 /* GlobalsReleaseAll -- release all MPS locks. GlobalsClaimAll must
@@ -69,18 +100,28 @@ void GlobalsClaimAll(void)
 
 void GlobalsReleaseAll(void)
 {
-  GlobalsArenaMap(ArenaLeave);
+  LockReleaseGlobalLeaf();
+  GlobalsArenaMap(arenaReleaseAll);
   arenaReleaseRingLock();
   LockReleaseGlobalRecursive();
 }
 
-/* arenaReinitLock -- reinitialize the lock for an arena */
+/* arenaReinitLock -- reinitialize the locks for an arena and its pools */
 
 static void arenaReinitLock(Arena arena)
 {
+  Ring node, next;
+
   AVERT(Arena, arena);
   ShieldLeave(arena);
   LockInit(ArenaGlobals(arena)->lock);
+  if (arena->lockStats)
+    LockStatsStart(ArenaGlobals(arena)->lock);
+  RING_FOR(node, ArenaPoolRing(arena), next) {
+    Pool pool = PoolOfArenaRing(node);
+    if (pool->lock != NULL)
+      LockInit(pool->lock);
+  }
 }
 
 /* GlobalsReinitializeAll -- reinitialize all MPS locks, and leave the
@@ -177,6 +218,7 @@ Bool GlobalsCheck(Globals arenaGlobals)
 
   /* no check possible on pollThreshold */
   CHECKL(BoolCheck(arenaGlobals->insidePoll));
+  CHECKL(BoolCheck(arenaGlobals->insideBackground));
   CHECKL(BoolCheck(arenaGlobals->clamped));
   CHECKL(arenaGlobals->fillMutatorSize >= 0.0);
   CHECKL(arenaGlobals->emptyMutatorSize >= 0.0);
@@ -226,12 +268,26 @@ Bool GlobalsCheck(Globals arenaGlobals)
     CHECKL(TraceIdMessagesCheck(arena, ti));
   TRACE_SET_ITER_END(ti, trace, TraceSetUNIV, arena);
 
+  /* <design/arena/#poll.background> */
+  if (arena->daemon != NULL)
+    CHECKL(DaemonCheck(arena->daemon));
+  CHECKL(BoolCheck(arena->daemonStopping));
+
   for(rank = RankMIN; rank < RankLIMIT; ++rank)
     CHECKD_NOSIG(Ring, &arena->greyRing[rank]);
   CHECKD_NOSIG(Ring, &arena->chainRing);
 
   CHECKL(arena->tracedWork >= 0.0);
   CHECKL(arena->tracedTime >= 0.0);
+  CHECKL(arena->backgroundTime >= 0.0);
+  CHECKL(arena->forwardedSize >= 0.0);
+  CHECKL(arena->reclaimedSize >= 0.0);
+  CHECKL(arena->flipCount >= arena->traceCount);
+  CHECKL(BoolCheck(arena->pauseWork));
+  CHECKL(arena->pauseTotal >= 0.0);
+  CHECKL(arena->pauseMax >= 0.0);
+  CHECKL(arena->pauseNext < ARENA_PAUSE_HISTORY);
+  CHECKL(arena->pauseLogged <= ARENA_PAUSE_HISTORY);
   /* no check for arena->lastWorldCollect (Clock) */
 
   /* can't write a check for arena->epoch */
@@ -264,6 +320,7 @@ Res GlobalsInit(Globals arenaGlobals)
   Arena arena;
   Rank rank;
   TraceId ti;
+  Index i;
 
   /* This is one of the first things that happens, */
   /* so check static consistency here. */
@@ -298,6 +355,7 @@ Res GlobalsInit(Globals arenaGlobals)
 
   arenaGlobals->pollThreshold = 0.0;
   arenaGlobals->insidePoll = FALSE;
+  arenaGlobals->insideBackground = FALSE;
   arenaGlobals->clamped = FALSE;
   arenaGlobals->fillMutatorSize = 0.0;
   arenaGlobals->emptyMutatorSize = 0.0;
@@ -326,8 +384,13 @@ Res GlobalsInit(Globals arenaGlobals)
   arena->finalPool = NULL;
   arena->busyTraces = TraceSetEMPTY;    /* <code/trace.c> */
   arena->flippedTraces = TraceSetEMPTY; /* <code/trace.c> */
+  arena->flipCount = 0;
+  arena->traceCount = 0;
+  arena->forwardedSize = 0.0;
+  arena->reclaimedSize = 0.0;
   arena->tracedWork = 0.0;
   arena->tracedTime = 0.0;
+  arena->backgroundTime = 0.0;
   arena->lastWorldCollect = ClockNow();
   ShieldInit(ArenaShield(arena));
 
@@ -341,9 +404,29 @@ Res GlobalsInit(Globals arenaGlobals)
     arena->tMessage[ti] = NULL;
   }
 
+  /* gcBackground is set by ArenaAbsInit; the daemon is created by
+   * GlobalsCompleteCreate. <design/arena/#poll.background> */
+  arena->daemon = NULL;
+  arena->daemonStopping = FALSE;
+
   for(rank = RankMIN; rank < RankLIMIT; ++rank)
     RingInit(&arena->greyRing[rank]);
-  STATISTIC(arena->writeBarrierHitCount = 0);
+  arena->greySegCount = 0;
+  arena->readBarrierHitCount = 0;
+  arena->writeBarrierHitCount = 0;
+  arena->pauseDepth = 0;
+  arena->pauseWork = FALSE;
+  arena->pauseStart = 0;
+  arena->pauseEpoch = ClockNow();
+  arena->pauseCount = 0;
+  arena->pauseTotal = 0.0;
+  arena->pauseMax = 0.0;
+  for (i = 0; i < NELEMS(arena->pauseHist); ++i)
+    arena->pauseHist[i] = 0;
+  for (i = 0; i < NELEMS(arena->mmu); ++i)
+    arena->mmu[i] = 1.0;
+  arena->pauseNext = 0;
+  arena->pauseLogged = 0;
   RingInit(&arena->chainRing);
 
   HistoryInit(ArenaHistory(arena));
@@ -360,6 +443,11 @@ Res GlobalsInit(Globals arenaGlobals)
 }
 
 
+#if defined(SHIELD)
+static void arenaBackground(void *closure);
+#endif
+
+
 /* GlobalsCompleteCreate -- complete creating the globals of the arena
  *
  * This is like the final initializations in a Create method, except
@@ -399,6 +487,8 @@ Res GlobalsCompleteCreate(Globals arenaGlobals)
     return res;
   arenaGlobals->lock = (Lock)p;
   LockInit(arenaGlobals->lock);
+  if (arena->lockStats)
+    LockStatsStart(arenaGlobals->lock);
 
   {
     GenParamStruct params[] = ChainDEFAULT;
@@ -409,8 +499,31 @@ Res GlobalsCompleteCreate(Globals arenaGlobals)
 
   arenaAnnounce(arena);
 
+#if defined(SHIELD)
+  /* Start the background collector thread last, because it enters the
+   * arena. <design/arena/#poll.background> */
+  if (arena->gcBackground) {
+    res = ControlAlloc(&p, arena, DaemonSize());
+    if (res != ResOK)
+      goto failDaemonAlloc;
+    res = DaemonInit(p, arenaBackground, arena, ARENA_BACKGROUND_INTERVAL);
+    if (res != ResOK) {
+      ControlFree(arena, p, DaemonSize());
+      goto failDaemonInit;
+    }
+    arena->daemon = p;
+  }
+#endif
+
   return ResOK;
 
+#if defined(SHIELD)
+failDaemonInit:
+failDaemonAlloc:
+  arenaDenounce(arena);
+  ChainDestroy(arenaGlobals->defaultChain);
+  arenaGlobals->defaultChain = NULL;
+#endif
 failChainCreate:
   return res;
 }
@@ -459,12 +572,25 @@ void GlobalsPrepareToDestroy(Globals arenaGlobals)
 
   AVERT(Globals, arenaGlobals);
 
+  arena = GlobalsArena(arenaGlobals);
+
+  /* Stop the background collector thread before parking the arena,
+   * so that it can't start another trace.  The thread may be waiting
+   * to enter the arena, so leave the arena while waiting for it to
+   * exit. <design/arena/#poll.background> */
+  if (arena->daemon != NULL) {
+    arena->daemonStopping = TRUE;
+    ArenaLeave(arena);
+    DaemonFinish(arena->daemon);
+    ArenaEnter(arena);
+    ControlFree(arena, arena->daemon, DaemonSize());
+    arena->daemon = NULL;
+  }
+
   /* Park the arena before destroying the default chain, to ensure
    * that there are no traces using that chain. */
   ArenaPark(arenaGlobals);
 
-  arena = GlobalsArena(arenaGlobals);
-
   arenaDenounce(arena);
 
   defaultChain = arenaGlobals->defaultChain;
@@ -565,6 +691,7 @@ void ArenaEnter(Arena arena)
 void ArenaEnterLock(Arena arena, Bool recursive)
 {
   Lock lock;
+  Thread thread = NULL;
 
   /* This check is safe to do outside the lock.  Unless the client
      is also calling ArenaDestroy, but that's a protocol violation by
@@ -577,12 +704,29 @@ void ArenaEnterLock(Arena arena, Bool recursive)
    * the lock first then this would deadlock. */
   StackProbe(StackProbeDEPTH);
   lock = ArenaGlobals(arena)->lock;
+
+  /* With cooperative suspension, a registered thread waiting for the
+     lock must not hold up the collector that has it, so it waits as
+     if in native code.  <design/thread-manager/#coop.lock> */
+  if (ArenaCooperativeSuspend(arena)) {
+    thread = ThreadCurrent(arena);
+    if (thread != NULL)
+      ThreadEnterNative(thread);
+  }
   if(recursive) {
     LockClaimRecursive(lock);
   } else {
     LockClaim(lock);
   }
+  if (thread != NULL)
+    ThreadLeaveNative(thread);
   AVERT(Arena, arena); /* can't AVERT it until we've got the lock */
+  if (arena->lockStats) {
+    /* <design/lock/#stats.event> */
+    LockStatsStruct stats;
+    if (LockStatsGet(&stats, lock) && stats.waitLast > 0.0)
+      EVENT2(ArenaLockWait, arena, stats.waitLast);
+  }
   if(recursive) {
     /* already in shield */
   } else {
@@ -652,6 +796,10 @@ Bool ArenaAccess(Addr addr, AccessSet mode, MutatorContext context)
   Ring node, nextNode;
   Res res;
 
+  /* A thread with cooperative suspension mustn't hold up a collector
+     while it waits for the ring lock, whose holder may be waiting for
+     that collector's arena.  <design/thread-manager/#coop.access> */
+  ThreadEnterNativeAll();
   arenaClaimRingLock();    /* <design/arena/#lock.ring> */
   AVERT(Ring, &arenaRing);
 
@@ -676,22 +824,29 @@ Bool ArenaAccess(Addr addr, AccessSet mode, MutatorContext context)
        * thread. */
       mode &= SegPM(seg);
       if (mode != AccessSetEMPTY) {
+        ArenaPauseBegin(arena);
         res = SegAccess(seg, arena, addr, mode, context);
         AVER(res == ResOK); /* Mutator can't continue unless this succeeds */
+        ArenaPauseEnd(arena, TRUE);
       } else {
         /* Protection was already cleared, for example by another thread
            or a fault in a nested exception handler: nothing to do now. */
       }
       EVENT4(ArenaAccess, arena, count, addr, mode);
       ArenaLeave(arena);
+      ThreadLeaveNativeAll();
       return TRUE;
     } else if (RootOfAddr(&root, arena, addr)) {
       arenaReleaseRingLock();
       mode &= RootPM(root);
-      if (mode != AccessSetEMPTY)
+      if (mode != AccessSetEMPTY) {
+        ArenaPauseBegin(arena);
         RootAccess(root, mode);
+        ArenaPauseEnd(arena, TRUE);
+      }
       EVENT4(ArenaAccess, arena, count, addr, mode);
       ArenaLeave(arena);
+      ThreadLeaveNativeAll();
       return TRUE;
     } else {
       /* No segment or root was found at the address: this must mean
@@ -704,6 +859,7 @@ Bool ArenaAccess(Addr addr, AccessSet mode, MutatorContext context)
   }
 
   arenaReleaseRingLock();
+  ThreadLeaveNativeAll();
   return FALSE;
 }
 
@@ -724,7 +880,7 @@ Bool ArenaAccess(Addr addr, AccessSet mode, MutatorContext context)
  * series of manual steps for looking around.  This might be worthwhile
  * if we introduce background activities other than tracing.  */
 
-void (ArenaPoll)(Globals globals)
+static void arenaPoll(Globals globals)
 {
   Arena arena;
   Clock start;
@@ -733,16 +889,12 @@ void (ArenaPoll)(Globals globals)
   Work tracedWork;
 
   AVERT(Globals, globals);
-
-  if (globals->clamped)
-    return;
-  if (globals->insidePoll)
-    return;
+  AVER(!globals->clamped);
+  AVER(!globals->insidePoll);
   arena = GlobalsArena(globals);
-  if (!PolicyPoll(arena))
-    return;
 
   globals->insidePoll = TRUE;
+  ArenaPauseBegin(arena);
 
   /* fillMutatorSize has advanced; call TracePoll enough to catch up. */
   start = ClockNow();
@@ -762,11 +914,75 @@ void (ArenaPoll)(Globals globals)
     ArenaAccumulateTime(arena, start, ClockNow());
   }
 
+  /* Return some of the memory freed by reclaim, if purging is
+     deferred.  <design/arena/#spare.deferred> */
+  (void)ArenaPurgeSpareStep(arena, 0.0);
+
   EVENT3(ArenaPoll, arena, start, BOOLOF(workWasDone));
 
+  ArenaPauseEnd(arena, workWasDone);
   globals->insidePoll = FALSE;
 }
 
+void (ArenaPoll)(Globals globals)
+{
+  Arena arena;
+
+  AVERT(Globals, globals);
+
+  if (globals->clamped)
+    return;
+  if (globals->insidePoll)
+    return;
+  arena = GlobalsArena(globals);
+  if (!PolicyPoll(arena))
+    return;
+
+  /* If there's a background collector thread, leave the work to it,
+   * unless it has fallen too far behind the mutator.  See
+   * <design/arena/#poll.background>. */
+  if (arena->daemon != NULL
+      && !ArenaEmergency(arena)
+      && globals->fillMutatorSize
+         < globals->pollThreshold + ARENA_BACKGROUND_LAG
+      && DaemonWake(arena->daemon))
+    return;
+
+  arenaPoll(globals);
+}
+
+
+/* arenaBackground -- poll the arena on the background thread
+ *
+ * This is the function run by the arena's daemon.  It does collection
+ * work if there is a trace in progress (so that the trace makes
+ * progress even if the mutator isn't allocating) or if the mutator
+ * has allocated enough to make it worth polling.  Otherwise it returns
+ * some spare memory to the operating system, if purging is deferred.
+ * See <design/arena/#poll.background>.  */
+
+#if defined(SHIELD)
+static void arenaBackground(void *closure)
+{
+  Arena arena = closure;
+  Globals globals;
+
+  ArenaEnter(arena);
+  globals = ArenaGlobals(arena);
+  if (!arena->daemonStopping && !globals->clamped && !globals->insidePoll
+      && (arena->busyTraces != TraceSetEMPTY || PolicyPoll(arena)))
+  {
+    globals->insideBackground = TRUE;
+    arenaPoll(globals);
+    globals->insideBackground = FALSE;
+  } else if (!arena->daemonStopping) {
+    /* <design/arena/#spare.deferred> */
+    (void)ArenaPurgeSpareStep(arena, ARENA_BACKGROUND_INTERVAL);
+  }
+  ArenaLeave(arena);
+}
+#endif
+
 
 /* ArenaStep -- use idle time for collection work */
 
@@ -784,6 +1000,7 @@ Bool ArenaStep(Globals globals, double interval, double multiplier)
   arena = GlobalsArena(globals);
   clocks_per_sec = ClocksPerSec();
 
+  ArenaPauseBegin(arena);
   start = now = ClockNow();
   intervalEnd = start + (Clock)(interval * clocks_per_sec);
   AVER(intervalEnd >= start);
@@ -793,9 +1010,8 @@ Bool ArenaStep(Globals globals, double interval, double multiplier)
   /* loop while there is work to do and time on the clock. */
   do {
     Trace trace;
-    if (arena->busyTraces != TraceSetEMPTY) {
-      trace = ArenaTrace(arena, (TraceId)0);
-    } else {
+    TraceId ti;
+    if (arena->busyTraces == TraceSetEMPTY) {
       /* No traces are running: consider collecting the world. */
       if (PolicyShouldCollectWorld(arena, (double)(availableEnd - now), now,
                                    clocks_per_sec))
@@ -812,9 +1028,11 @@ Bool ArenaStep(Globals globals, double interval, double multiplier)
           break;
       }
     }
-    TraceAdvance(trace);
-    if (trace->state == TraceFINISHED)
-      TraceDestroyFinished(trace);
+    TRACE_SET_ITER(ti, trace, arena->busyTraces, arena) {
+      TraceAdvance(trace);
+      if (trace->state == TraceFINISHED)
+        TraceDestroyFinished(trace);
+    } TRACE_SET_ITER_END(ti, trace, arena->busyTraces, arena);
     workWasDone = TRUE;
     now = ClockNow();
   } while (now < intervalEnd);
@@ -823,6 +1041,11 @@ Bool ArenaStep(Globals globals, double interval, double multiplier)
     ArenaAccumulateTime(arena, start, now);
   }
 
+  /* Idle time is a good time to return memory to the operating system.
+     <design/arena/#spare.deferred> */
+  (void)ArenaPurgeSpareStep(arena, interval);
+
+  ArenaPauseEnd(arena, workWasDone);
   return workWasDone;
 }
 
@@ -952,7 +1175,6 @@ Ref ArenaRead(Arena arena, Ref *p)
 {
   Bool b;
   Seg seg = NULL;       /* suppress "may be used uninitialized" */
-  Rank rank;
 
   AVERT(Arena, arena);
 
@@ -972,10 +1194,8 @@ Ref ArenaRead(Arena arena, Ref *p)
   /* If the segment isn't grey it doesn't need scanning, and in fact it
      would be wrong to even ask what rank to scan it at, since there might
      not be any traces running. */
-  if (TraceSetInter(SegGrey(seg), arena->flippedTraces) != TraceSetEMPTY) {
-    rank = TraceRankForAccess(arena, seg);
-    TraceScanSingleRef(arena->flippedTraces, rank, arena, seg, p);
-  }
+  if (TraceSetInter(SegGrey(seg), arena->flippedTraces) != TraceSetEMPTY)
+    TraceScanSingleRefAccess(arena, seg, p);
 
   /* We don't need to update the Seg Summary as in PoolSingleAccess
    * because we are not changing it after it has been scanned. */
@@ -1028,6 +1248,22 @@ Res GlobalsDescribe(Globals arenaGlobals, mps_lib_FILE *stream, Count depth)
                "threadSerial $U\n", (WriteFU)arena->threadSerial,
                "busyTraces    $B\n", (WriteFB)arena->busyTraces,
                "flippedTraces $B\n", (WriteFB)arena->flippedTraces,
+               "flipCount $U\n", (WriteFU)arena->flipCount,
+               "traceCount $U\n", (WriteFU)arena->traceCount,
+               "forwardedSize $U kB\n",
+               (WriteFU)(arena->forwardedSize / 1024),
+               "reclaimedSize $U kB\n",
+               (WriteFU)(arena->reclaimedSize / 1024),
+               "greySegCount $U\n", (WriteFU)arena->greySegCount,
+               "readBarrierHitCount $U\n",
+               (WriteFU)arena->readBarrierHitCount,
+               "writeBarrierHitCount $U\n",
+               (WriteFU)arena->writeBarrierHitCount,
+               "pauseCount $U\n", (WriteFU)arena->pauseCount,
+               "pauseTotal $D\n", (WriteFD)arena->pauseTotal,
+               "pauseMax $D\n", (WriteFD)arena->pauseMax,
+               "tracedTime $D\n", (WriteFD)arena->tracedTime,
+               "backgroundTime $D\n", (WriteFD)arena->backgroundTime,
                NULL);
   if (res != ResOK)
     return res;
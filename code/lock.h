@@ -88,6 +88,46 @@ extern Bool LockCheck(Lock lock);
 extern Bool LockIsHeld(Lock lock);
 
 
+/* LockStatsStruct -- contention statistics for a lock
+ *
+ * See <design/lock/#stats>.  Times are in seconds.  hold[0] counts
+ * claims held for less than a microsecond, hold[i] those held for
+ * less than 10^i microseconds (and not counted by hold[i-1]), and
+ * hold[LockHoldBUCKETS-1] the rest.
+ */
+
+#define LockHoldBUCKETS 8
+
+typedef struct LockStatsStruct {
+  Count claims;                 /* outermost claims */
+  Count contended;              /* claims that had to wait */
+  double waitTotal;             /* total time spent waiting */
+  double waitMax;               /* longest wait */
+  double waitLast;              /* wait for the current claim */
+  double holdTotal;             /* total time held */
+  double holdMax;               /* longest hold */
+  Count hold[LockHoldBUCKETS];  /* histogram of hold times */
+} LockStatsStruct;
+
+
+/* LockStatsStart -- start gathering statistics for a lock
+ *
+ *  This must be called after LockInit and before the lock is shared
+ *  with other threads.
+ */
+
+extern void LockStatsStart(Lock lock);
+
+
+/* LockStatsGet -- get the statistics for a lock
+ *
+ *  The calling thread must own the lock.  Returns FALSE if
+ *  statistics are not being gathered for the lock.
+ */
+
+extern Bool LockStatsGet(LockStats statsReturn, Lock lock);
+
+
 /*  == Global locks == */
 
 
@@ -133,6 +173,41 @@ extern void LockClaimGlobal(void);
 extern void LockReleaseGlobal(void);
 
 
+/*  LockClaimGlobalLeaf
+ *
+ *  This is called to claim the binary leaf lock, which protects
+ *  global state that is updated while other locks are held, such as
+ *  the telemetry stream.  No other lock may be claimed by a thread
+ *  that owns it, so it can be claimed whatever other locks the
+ *  calling thread owns.  It must be matched by a call to
+ *  LockReleaseGlobalLeaf.
+ */
+
+extern void LockClaimGlobalLeaf(void);
+
+
+/*  LockReleaseGlobalLeaf
+ *
+ *  This must only be used to release the leaf lock symmetrically
+ *  with LockClaimGlobalLeaf.
+ */
+
+extern void LockReleaseGlobalLeaf(void);
+
+
+/*  LockAtThreadExit
+ *
+ *  Arranges for exitFn to be called in the current thread when it
+ *  exits.  Every call must pass the same function.  Does nothing on
+ *  platforms that can't notify thread exit.  This is used to release
+ *  the per-thread event buffers: see <design/lock/#req.thread-exit>.
+ */
+
+typedef void (*LockThreadExitFunction)(void);
+
+extern void LockAtThreadExit(LockThreadExitFunction exitFn);
+
+
 /* LockSetup -- one-time lock initialization */
 
 extern void LockSetup(void);
@@ -20,6 +20,8 @@ SRCID(lockan, "$Id$");
 typedef struct LockStruct {     /* ANSI fake lock structure */
   Sig sig;                      /* <design/sig/> */
   unsigned long claims;         /* # claims held by owner */
+  Bool gather;                  /* gathering statistics? */
+  LockStatsStruct stats;        /* statistics, if gathering */
 } LockStruct;
 
 
@@ -39,6 +41,7 @@ void (LockInit)(Lock lock)
 {
   AVER(lock != NULL);
   lock->claims = 0;
+  lock->gather = FALSE;
   lock->sig = LockSig;
   AVERT(Lock, lock);
 }
@@ -56,6 +59,8 @@ void (LockClaim)(Lock lock)
   AVERT(Lock, lock);
   AVER(lock->claims == 0);
   lock->claims = 1;
+  if (lock->gather)
+    ++lock->stats.claims; /* never contended, and not timed */
 }
 
 void (LockRelease)(Lock lock)
@@ -70,6 +75,8 @@ void (LockClaimRecursive)(Lock lock)
   AVERT(Lock, lock);
   ++lock->claims;
   AVER(lock->claims>0);
+  if (lock->gather && lock->claims == 1)
+    ++lock->stats.claims;
 }
 
 void (LockReleaseRecursive)(Lock lock)
@@ -86,6 +93,36 @@ Bool (LockIsHeld)(Lock lock)
 }
 
 
+void (LockStatsStart)(Lock lock)
+{
+  Index i;
+
+  AVERT(Lock, lock);
+  AVER(lock->claims == 0);
+  lock->stats.claims = 0;
+  lock->stats.contended = 0;
+  lock->stats.waitTotal = 0.0;
+  lock->stats.waitMax = 0.0;
+  lock->stats.waitLast = 0.0;
+  lock->stats.holdTotal = 0.0;
+  lock->stats.holdMax = 0.0;
+  for (i = 0; i < LockHoldBUCKETS; ++i)
+    lock->stats.hold[i] = 0;
+  lock->gather = TRUE;
+}
+
+Bool (LockStatsGet)(LockStats statsReturn, Lock lock)
+{
+  AVER(statsReturn != NULL);
+  AVERT(Lock, lock);
+  AVER(lock->claims > 0);
+  if (!lock->gather)
+    return FALSE;
+  *statsReturn = lock->stats;
+  return TRUE;
+}
+
+
 /* Global locking is performed by normal locks.
  * A separate lock structure is used for recursive and
  * non-recursive locks so that each may be differently ordered
@@ -94,24 +131,39 @@ Bool (LockIsHeld)(Lock lock)
 
 static LockStruct globalLockStruct = {
   LockSig,
-  0
+  0,
+  FALSE,
+  {0, 0, 0.0, 0.0, 0.0, 0.0, 0.0, {0}}
 };
 
 static LockStruct globalRecursiveLockStruct = {
   LockSig,
-  0
+  0,
+  FALSE,
+  {0, 0, 0.0, 0.0, 0.0, 0.0, 0.0, {0}}
+};
+
+static LockStruct globalLeafLockStruct = {
+  LockSig,
+  0,
+  FALSE,
+  {0, 0, 0.0, 0.0, 0.0, 0.0, 0.0, {0}}
 };
 
 static Lock globalLock = &globalLockStruct;
 
 static Lock globalRecLock = &globalRecursiveLockStruct;
 
+static Lock globalLeafLock = &globalLeafLockStruct;
+
 void LockInitGlobal(void)
 {
   globalLock->claims = 0;
   LockInit(globalLock);
   globalRecLock->claims = 0;
   LockInit(globalRecLock);
+  globalLeafLock->claims = 0;
+  LockInit(globalLeafLock);
 }
 
 void (LockClaimGlobalRecursive)(void)
@@ -134,6 +186,22 @@ void (LockReleaseGlobal)(void)
   LockRelease(globalLock);
 }
 
+void (LockClaimGlobalLeaf)(void)
+{
+  LockClaim(globalLeafLock);
+}
+
+void (LockReleaseGlobalLeaf)(void)
+{
+  LockRelease(globalLeafLock);
+}
+
+void (LockAtThreadExit)(LockThreadExitFunction exitFn)
+{
+  /* The only thread exits with the program. */
+  AVER(exitFn != NULL);
+}
+
 void LockSetup(void)
 {
   /* Nothing to do as ANSI platform does not have fork(). */
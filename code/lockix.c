@@ -24,6 +24,12 @@
  * number of claims acquired on a lock.  This field must only be
  * modified while we hold the mutex.
  *
+ * .stats: If statistics are being gathered, claims first try the
+ * mutex with pthread_mutex_trylock, and only time the wait if that
+ * fails, so that an uncontended claim costs one extra clock read (for
+ * the hold time).  The statistics must only be modified while we hold
+ * the mutex.  See <design/lock/#stats>.
+ *
  * .from: This was copied from the FreeBSD implementation (lockfr.c)
  * which was itself a cleaner version of the LinuxThreads
  * implementation (lockli.c).
@@ -40,6 +46,7 @@
 #include <pthread.h> /* see .feature.li in config.h */
 #include <semaphore.h>
 #include <errno.h>
+#include <time.h> /* clock_gettime */
 
 SRCID(lockix, "$Id$");
 
@@ -54,6 +61,9 @@ typedef struct LockStruct {
   Sig sig;                      /* <design/sig/> */
   unsigned long claims;         /* # claims held by owner */
   pthread_mutex_t mut;          /* the mutex itself */
+  Bool gather;                  /* gathering statistics? .stats */
+  double claimed;               /* time of outermost claim */
+  LockStatsStruct stats;        /* statistics, if gathering */
 } LockStruct;
 
 
@@ -70,6 +80,7 @@ size_t (LockSize)(void)
 Bool (LockCheck)(Lock lock)
 {
   CHECKS(Lock, lock);
+  CHECKL(BoolCheck(lock->gather));
   /* While claims can't be very large, I don't dare to put a limit on it. */
   /* There's no way to test the mutex, or check if it's held by somebody. */
   return TRUE;
@@ -85,6 +96,7 @@ void (LockInit)(Lock lock)
 
   AVER(lock != NULL);
   lock->claims = 0;
+  lock->gather = FALSE;
   res = pthread_mutexattr_init(&attr);
   AVER(res == 0);
   res = pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_ERRORCHECK);
@@ -113,6 +125,74 @@ void (LockFinish)(Lock lock)
 }
 
 
+/* lockNow -- current time in seconds, for statistics */
+
+static double lockNow(void)
+{
+  struct timespec ts;
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+    return 0.0;
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+
+/* lockMutexClaim -- claim the mutex, gathering statistics if wanted
+ *
+ * Returns the result of pthread_mutex_lock. See .stats.
+ */
+
+static int lockMutexClaim(Lock lock)
+{
+  double start = 0.0, wait = 0.0;
+  int res;
+
+  if (!lock->gather)
+    return pthread_mutex_lock(&lock->mut);
+
+  res = pthread_mutex_trylock(&lock->mut);
+  if (res == EBUSY) {
+    start = lockNow();
+    res = pthread_mutex_lock(&lock->mut);
+    if (res != 0) {
+      /* Recursive claim: this thread already owns the mutex. */
+      lock->stats.waitLast = 0.0;
+      return res;
+    }
+    lock->claimed = lockNow();
+    wait = lock->claimed - start;
+    ++lock->stats.contended;
+    lock->stats.waitTotal += wait;
+    if (wait > lock->stats.waitMax)
+      lock->stats.waitMax = wait;
+  } else if (res == 0) {
+    lock->claimed = lockNow();
+  }
+  if (res == 0) {
+    ++lock->stats.claims;
+    lock->stats.waitLast = wait;
+  }
+  return res;
+}
+
+
+/* lockMutexRelease -- release the mutex, gathering statistics if wanted */
+
+static int lockMutexRelease(Lock lock)
+{
+  if (lock->gather) {
+    double hold = lockNow() - lock->claimed, limit = 1e-6;
+    Index i;
+    lock->stats.holdTotal += hold;
+    if (hold > lock->stats.holdMax)
+      lock->stats.holdMax = hold;
+    for (i = 0; i < LockHoldBUCKETS - 1 && hold >= limit; ++i)
+      limit *= 10.0;
+    ++lock->stats.hold[i];
+  }
+  return pthread_mutex_unlock(&lock->mut);
+}
+
+
 /* LockClaim -- claim a lock (non-recursive) */
 
 void (LockClaim)(Lock lock)
@@ -121,7 +201,7 @@ void (LockClaim)(Lock lock)
 
   AVERT(Lock, lock);
 
-  res = pthread_mutex_lock(&lock->mut);
+  res = lockMutexClaim(lock);
   /* pthread_mutex_lock will error if we own the lock already. */
   AVER(res == 0); /* <design/check/#.common> */
 
@@ -141,7 +221,7 @@ void (LockRelease)(Lock lock)
   AVERT(Lock, lock);
   AVER(lock->claims == 1);  /* The lock should only be held once */
   lock->claims = 0;  /* Must set this before releasing the lock */
-  res = pthread_mutex_unlock(&lock->mut);
+  res = lockMutexRelease(lock);
   /* pthread_mutex_unlock will error if we didn't own the lock. */
   AVER(res == 0);
 }
@@ -155,7 +235,7 @@ void (LockClaimRecursive)(Lock lock)
 
   AVERT(Lock, lock);
 
-  res = pthread_mutex_lock(&lock->mut);
+  res = lockMutexClaim(lock);
   /* pthread_mutex_lock will return: */
   /*     0 if we have just claimed the lock */
   /*     EDEADLK if we own the lock already. */
@@ -177,7 +257,7 @@ void (LockReleaseRecursive)(Lock lock)
   AVER(lock->claims > 0);
   --lock->claims;
   if (lock->claims == 0) {
-    res = pthread_mutex_unlock(&lock->mut);
+    res = lockMutexRelease(lock);
     /* pthread_mutex_unlock will error if we didn't own the lock. */
     AVER(res == 0);
   }
@@ -199,21 +279,59 @@ Bool (LockIsHeld)(Lock lock)
 }
 
 
+/* LockStatsStart -- start gathering statistics for a lock */
+
+void (LockStatsStart)(Lock lock)
+{
+  Index i;
+
+  AVERT(Lock, lock);
+  AVER(lock->claims == 0);
+  lock->stats.claims = 0;
+  lock->stats.contended = 0;
+  lock->stats.waitTotal = 0.0;
+  lock->stats.waitMax = 0.0;
+  lock->stats.waitLast = 0.0;
+  lock->stats.holdTotal = 0.0;
+  lock->stats.holdMax = 0.0;
+  for (i = 0; i < LockHoldBUCKETS; ++i)
+    lock->stats.hold[i] = 0;
+  lock->gather = TRUE;
+}
+
+
+/* LockStatsGet -- get the statistics for a lock */
+
+Bool (LockStatsGet)(LockStats statsReturn, Lock lock)
+{
+  AVER(statsReturn != NULL);
+  AVERT(Lock, lock);
+  AVER(lock->claims > 0);
+  if (!lock->gather)
+    return FALSE;
+  *statsReturn = lock->stats;
+  return TRUE;
+}
+
+
 /* Global locks
  *
- * .global: The two "global" locks are statically allocated normal locks.
+ * .global: The three "global" locks are statically allocated normal locks.
  */
 
 static LockStruct globalLockStruct;
 static LockStruct globalRecLockStruct;
+static LockStruct globalLeafLockStruct;
 static Lock globalLock = &globalLockStruct;
 static Lock globalRecLock = &globalRecLockStruct;
+static Lock globalLeafLock = &globalLeafLockStruct;
 static pthread_once_t isGlobalLockInit = PTHREAD_ONCE_INIT;
 
 void LockInitGlobal(void)
 {
   LockInit(globalLock);
   LockInit(globalRecLock);
+  LockInit(globalLeafLock);
 }
 
 
@@ -259,6 +377,66 @@ void (LockReleaseGlobal)(void)
 }
 
 
+/* LockClaimGlobalLeaf -- claim the global leaf lock */
+
+void (LockClaimGlobalLeaf)(void)
+{
+  int res;
+
+  /* Ensure the global lock has been initialized */
+  res = pthread_once(&isGlobalLockInit, LockInitGlobal);
+  AVER(res == 0);
+  LockClaim(globalLeafLock);
+}
+
+
+/* LockReleaseGlobalLeaf -- release the global leaf lock */
+
+void (LockReleaseGlobalLeaf)(void)
+{
+  LockRelease(globalLeafLock);
+}
+
+
+/* LockAtThreadExit -- call a function when the current thread exits
+ *
+ * Uses the destructor of a thread-specific data key.  The value of
+ * the key only arms the destructor, which POSIX calls only if the
+ * value is not NULL.
+ */
+
+static pthread_key_t threadExitKey;
+static Bool threadExitKeyValid = FALSE;
+static LockThreadExitFunction threadExitFn = NULL;
+static pthread_once_t isThreadExitInit = PTHREAD_ONCE_INIT;
+
+static void threadExitDestructor(void *value)
+{
+  UNUSED(value);
+  if (threadExitFn != NULL)
+    threadExitFn();
+}
+
+static void threadExitInit(void)
+{
+  threadExitKeyValid =
+    (pthread_key_create(&threadExitKey, threadExitDestructor) == 0);
+}
+
+void (LockAtThreadExit)(LockThreadExitFunction exitFn)
+{
+  int res;
+
+  AVER(exitFn != NULL);
+  AVER(threadExitFn == NULL || threadExitFn == exitFn);
+  threadExitFn = exitFn;
+  res = pthread_once(&isThreadExitInit, threadExitInit);
+  AVER(res == 0);
+  if (threadExitKeyValid)
+    (void)pthread_setspecific(threadExitKey, &threadExitKey);
+}
+
+
 /* LockSetup -- one-time lock initialization */
 
 void LockSetup(void)
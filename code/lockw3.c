@@ -38,6 +38,9 @@ typedef struct LockStruct {
   Sig sig;                      /* <design/sig/> */
   unsigned long claims;         /* # claims held by the owning thread */
   CRITICAL_SECTION cs;          /* Win32's recursive lock thing */
+  Bool gather;                  /* gathering statistics? .stats */
+  double claimed;               /* time of outermost claim */
+  LockStatsStruct stats;        /* statistics, if gathering */
 } LockStruct;
 
 
@@ -49,6 +52,7 @@ size_t (LockSize)(void)
 Bool (LockCheck)(Lock lock)
 {
   CHECKS(Lock, lock);
+  CHECKL(BoolCheck(lock->gather));
   return TRUE;
 }
 
@@ -56,6 +60,7 @@ void (LockInit)(Lock lock)
 {
   AVER(lock != NULL);
   lock->claims = 0;
+  lock->gather = FALSE;
   InitializeCriticalSection(&lock->cs);
   lock->sig = LockSig;
   AVERT(Lock, lock);
@@ -70,10 +75,77 @@ void (LockFinish)(Lock lock)
   lock->sig = SigInvalid;
 }
 
+/* lockNow -- current time in seconds, for statistics */
+
+static double lockNow(void)
+{
+  LARGE_INTEGER count, frequency;
+  if (!QueryPerformanceCounter(&count)
+      || !QueryPerformanceFrequency(&frequency))
+    return 0.0;
+  return (double)count.QuadPart / (double)frequency.QuadPart;
+}
+
+
+/* lockEnter -- enter the critical section, gathering statistics
+ *
+ * .stats: If statistics are being gathered, claims first try the
+ * critical section with TryEnterCriticalSection, and only time the
+ * wait if that fails.  The statistics must only be modified while we
+ * are inside the critical section.  See <design/lock/#stats>.
+ */
+
+static void lockEnter(Lock lock)
+{
+  double start, wait = 0.0;
+
+  if (!lock->gather) {
+    EnterCriticalSection(&lock->cs);
+    return;
+  }
+  if (TryEnterCriticalSection(&lock->cs)) {
+    if (lock->claims > 0) {
+      /* Recursive claim: this thread already owns the lock. */
+      lock->stats.waitLast = 0.0;
+      return;
+    }
+    lock->claimed = lockNow();
+  } else {
+    start = lockNow();
+    EnterCriticalSection(&lock->cs);
+    lock->claimed = lockNow();
+    wait = lock->claimed - start;
+    ++lock->stats.contended;
+    lock->stats.waitTotal += wait;
+    if (wait > lock->stats.waitMax)
+      lock->stats.waitMax = wait;
+  }
+  ++lock->stats.claims;
+  lock->stats.waitLast = wait;
+}
+
+
+/* lockLeave -- leave the critical section, gathering statistics */
+
+static void lockLeave(Lock lock)
+{
+  if (lock->gather && lock->claims == 0) {
+    double hold = lockNow() - lock->claimed, limit = 1e-6;
+    Index i;
+    lock->stats.holdTotal += hold;
+    if (hold > lock->stats.holdMax)
+      lock->stats.holdMax = hold;
+    for (i = 0; i < LockHoldBUCKETS - 1 && hold >= limit; ++i)
+      limit *= 10.0;
+    ++lock->stats.hold[i];
+  }
+  LeaveCriticalSection(&lock->cs);
+}
+
 void (LockClaim)(Lock lock)
 {
   AVERT(Lock, lock);
-  EnterCriticalSection(&lock->cs);
+  lockEnter(lock);
   /* This should be the first claim.  Now we are inside the
    * critical section it is ok to check this. */
   AVER(lock->claims == 0); /* <design/check/#.common> */
@@ -85,13 +157,13 @@ void (LockRelease)(Lock lock)
   AVERT(Lock, lock);
   AVER(lock->claims == 1);  /* The lock should only be held once */
   lock->claims = 0;  /* Must set this before leaving CS */
-  LeaveCriticalSection(&lock->cs);
+  lockLeave(lock);
 }
 
 void (LockClaimRecursive)(Lock lock)
 {
   AVERT(Lock, lock);
-  EnterCriticalSection(&lock->cs);
+  lockEnter(lock);
   ++lock->claims;
   AVER(lock->claims > 0);
 }
@@ -101,7 +173,7 @@ void (LockReleaseRecursive)(Lock lock)
   AVERT(Lock, lock);
   AVER(lock->claims > 0);
   --lock->claims;
-  LeaveCriticalSection(&lock->cs);
+  lockLeave(lock);
 }
 
 Bool (LockIsHeld)(Lock lock)
@@ -115,6 +187,36 @@ Bool (LockIsHeld)(Lock lock)
 }
 
 
+void (LockStatsStart)(Lock lock)
+{
+  Index i;
+
+  AVERT(Lock, lock);
+  AVER(lock->claims == 0);
+  lock->stats.claims = 0;
+  lock->stats.contended = 0;
+  lock->stats.waitTotal = 0.0;
+  lock->stats.waitMax = 0.0;
+  lock->stats.waitLast = 0.0;
+  lock->stats.holdTotal = 0.0;
+  lock->stats.holdMax = 0.0;
+  for (i = 0; i < LockHoldBUCKETS; ++i)
+    lock->stats.hold[i] = 0;
+  lock->gather = TRUE;
+}
+
+Bool (LockStatsGet)(LockStats statsReturn, Lock lock)
+{
+  AVER(statsReturn != NULL);
+  AVERT(Lock, lock);
+  AVER(lock->claims > 0);
+  if (!lock->gather)
+    return FALSE;
+  *statsReturn = lock->stats;
+  return TRUE;
+}
+
+
 /* Global locking is performed by normal locks.
  * A separate lock structure is used for recursive and
  * non-recursive locks so that each may be differently ordered
@@ -123,8 +225,10 @@ Bool (LockIsHeld)(Lock lock)
 
 static LockStruct globalLockStruct;
 static LockStruct globalRecLockStruct;
+static LockStruct globalLeafLockStruct;
 static Lock globalLock = &globalLockStruct;
 static Lock globalRecLock = &globalRecLockStruct;
+static Lock globalLeafLock = &globalLeafLockStruct;
 static Bool globalLockInit = FALSE; /* TRUE iff initialized */
 
 void LockInitGlobal(void)
@@ -133,12 +237,14 @@ void LockInitGlobal(void)
   LockInit(globalLock);
   globalRecLock->claims = 0;
   LockInit(globalRecLock);
+  globalLeafLock->claims = 0;
+  LockInit(globalLeafLock);
   globalLockInit = TRUE;
 }
 
 static void lockEnsureGlobalLock(void)
 {
-  /* Ensure both global locks have been initialized. */
+  /* Ensure all the global locks have been initialized. */
   /* There is a race condition initializing them (job004056). */
   if (!globalLockInit) {
     LockInitGlobal();
@@ -171,6 +277,49 @@ void (LockReleaseGlobal)(void)
   LockRelease(globalLock);
 }
 
+void (LockClaimGlobalLeaf)(void)
+{
+  lockEnsureGlobalLock();
+  AVER(globalLockInit);
+  LockClaim(globalLeafLock);
+}
+
+void (LockReleaseGlobalLeaf)(void)
+{
+  AVER(globalLockInit);
+  LockRelease(globalLeafLock);
+}
+
+
+/* LockAtThreadExit -- call a function when the current thread exits
+ *
+ * Uses the callback of a fiber-local storage index, which Windows
+ * calls when a thread exits if its value is not NULL.  The index is
+ * allocated on first use, so it shares the initialization race of
+ * the global locks (job004056).
+ */
+
+static DWORD threadExitIndex = FLS_OUT_OF_INDEXES;
+static LockThreadExitFunction threadExitFn = NULL;
+
+static VOID WINAPI threadExitCallback(PVOID data)
+{
+  UNUSED(data);
+  if (threadExitFn != NULL)
+    threadExitFn();
+}
+
+void (LockAtThreadExit)(LockThreadExitFunction exitFn)
+{
+  AVER(exitFn != NULL);
+  AVER(threadExitFn == NULL || threadExitFn == exitFn);
+  threadExitFn = exitFn;
+  if (threadExitIndex == FLS_OUT_OF_INDEXES)
+    threadExitIndex = FlsAlloc(threadExitCallback);
+  if (threadExitIndex != FLS_OUT_OF_INDEXES)
+    (void)FlsSetValue(threadExitIndex, &threadExitIndex);
+}
+
 void LockSetup(void)
 {
   /* Nothing to do as MPS does not support fork() on Windows. */
@@ -27,6 +27,8 @@ Bool LocusPrefCheck(LocusPref pref)
   CHECKL(BoolCheck(pref->high));
   /* zones can't be checked because it's arbitrary. */
   /* avoid can't be checked because it's arbitrary. */
+  CHECKL(BoolCheck(pref->hasNode));
+  /* node is arbitrary: PolicyNode reduces it modulo the arena's nodes. */
   return TRUE;
 }
 
@@ -71,6 +73,12 @@ void LocusPrefExpress(LocusPref pref, LocusPrefKind kind, void *p)
     pref->zones = *(ZoneSet *)p;
     break;
 
+  case LocusPrefNODE:
+    AVER(p != NULL);
+    pref->hasNode = TRUE;
+    pref->node = *(Index *)p;
+    break;
+
   default:
     /* Unknown kinds are ignored for binary compatibility. */
     break;
@@ -94,6 +102,8 @@ Res LocusPrefDescribe(LocusPref pref, mps_lib_FILE *stream, Count depth)
                "  high $S\n", WriteFYesNo(pref->high),
                "  zones $B\n", (WriteFB)pref->zones,
                "  avoid $B\n", (WriteFB)pref->avoid,
+               "  hasNode $S\n", WriteFYesNo(pref->hasNode),
+               "  node $U\n", (WriteFU)pref->node,
                "} LocusPref $P\n", (WriteFP)pref,
                NULL);
   return res;
@@ -140,6 +150,7 @@ static void GenDescInit(GenDesc gen, GenParamStruct *params)
   gen->mortality = params->mortality;
   RingInit(&gen->locusRing);
   RingInit(&gen->segRing);
+  gen->collections = 0;
   gen->sig = GenDescSig;
   AVERT(GenDesc, gen);
 }
@@ -208,6 +219,7 @@ static void genDescEndTrace(GenDesc gen, Trace trace)
     double mortality = 1.0 - survived / (double)stats->condemned;
     double alpha = LocusMortalityALPHA;
     gen->mortality = gen->mortality * (1 - alpha) + mortality * alpha;
+    ++gen->collections;
     EVENT6(TraceEndGen, trace, gen, stats->condemned, stats->forwarded,
            stats->preservedInPlace, gen->mortality);
   }
@@ -283,6 +295,7 @@ Res GenDescDescribe(GenDesc gen, mps_lib_FILE *stream, Count depth)
                "  zones $B\n", (WriteFB)gen->zones,
                "  capacity $W\n", (WriteFW)gen->capacity,
                "  mortality $D\n", (WriteFD)gen->mortality,
+               "  collections $U\n", (WriteFU)gen->collections,
                NULL);
   if (res != ResOK)
     return res;
@@ -889,6 +902,7 @@ void LocusInit(Arena arena)
   gen->mortality = 0.5;
   RingInit(&gen->locusRing);
   RingInit(&gen->segRing);
+  gen->collections = 0;
   gen->sig = GenDescSig;
   AVERT(GenDesc, gen);
 }
@@ -917,6 +931,29 @@ Bool LocusCheck(Arena arena)
 }
 
 
+/* LocusGenCollections -- count collections of a generation
+ *
+ * Returns the number of traces that condemned generation gen, summed
+ * over all the chains in the arena that have that many generations.
+ * See mps_arena_stats.
+ */
+
+Count LocusGenCollections(Arena arena, Index gen)
+{
+  Count collections = 0;
+  Ring node, nextNode;
+
+  AVERT(Arena, arena);
+
+  RING_FOR(node, &arena->chainRing, nextNode) {
+    Chain chain = RING_ELT(Chain, chainRing, node);
+    if (gen < chain->genCount)
+      collections += chain->gens[gen].collections;
+  }
+  return collections;
+}
+
+
 /* C. COPYRIGHT AND LICENSE
  *
  * Copyright (C) 2001-2016 Ravenbrook Limited <http://www.ravenbrook.com/>.
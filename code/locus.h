@@ -46,6 +46,7 @@ typedef struct GenDescStruct {
   double mortality;     /* predicted mortality */
   RingStruct locusRing; /* Ring of all PoolGen's in this GenDesc (locus) */
   RingStruct segRing; /* Ring of GCSegs in this generation */
+  Count collections;    /* number of traces that condemned this gen */
   GenTraceStatsStruct trace[TraceLIMIT];
 } GenDescStruct;
 
@@ -73,6 +73,8 @@ Bool MessageClassCheck(MessageClass klass)
   CHECKL(FUNCHECK(klass->gcLiveSize));
   CHECKL(FUNCHECK(klass->gcCondemnedSize));
   CHECKL(FUNCHECK(klass->gcNotCondemnedSize));
+  CHECKL(FUNCHECK(klass->gcPauseTime));
+  CHECKL(FUNCHECK(klass->gcPauseMax));
   CHECKL(FUNCHECK(klass->gcStartWhy));
   CHECKL(klass->endSig == MessageClassSig);
 
@@ -360,6 +362,22 @@ Size MessageGCNotCondemnedSize(Message message)
   return (*message->klass->gcNotCondemnedSize)(message);
 }
 
+double MessageGCPauseTime(Message message)
+{
+  AVERT(Message, message);
+  AVER(MessageGetType(message) == MessageTypeGC);
+
+  return (*message->klass->gcPauseTime)(message);
+}
+
+double MessageGCPauseMax(Message message)
+{
+  AVERT(Message, message);
+  AVER(MessageGetType(message) == MessageTypeGC);
+
+  return (*message->klass->gcPauseMax)(message);
+}
+
 const char *MessageGCStartWhy(Message message)
 {
   AVERT(Message, message);
@@ -414,6 +432,26 @@ Size MessageNoGCNotCondemnedSize(Message message)
   return (Size)0;
 }
 
+double MessageNoGCPauseTime(Message message)
+{
+  AVERT(Message, message);
+  UNUSED(message);
+
+  NOTREACHED;
+
+  return 0.0;
+}
+
+double MessageNoGCPauseMax(Message message)
+{
+  AVERT(Message, message);
+  UNUSED(message);
+
+  NOTREACHED;
+
+  return 0.0;
+}
+
 const char *MessageNoGCStartWhy(Message message)
 {
   AVERT(Message, message);
@@ -22,6 +22,7 @@
 #include "prot.h"
 #include "sp.h"
 #include "th.h"
+#include "wk.h"
 #include "ss.h"
 #include "mpslib.h"
 #include "ring.h"
@@ -225,6 +226,10 @@ extern void PoolDestroy(Pool pool);
 extern BufferClass PoolDefaultBufferClass(Pool pool);
 extern Res PoolAlloc(Addr *pReturn, Pool pool, Size size);
 extern void PoolFree(Pool pool, Addr old, Size size);
+extern Bool PoolTryAlloc(Addr *pReturn, Pool pool, Size size);
+extern Bool PoolTryFree(Pool pool, Addr old, Size size);
+extern void PoolLockClaim(Pool pool);
+extern void PoolLockRelease(Pool pool);
 extern PoolGen PoolSegPoolGen(Pool pool, Seg seg);
 extern Res PoolTraceBegin(Pool pool, Trace trace);
 extern void PoolFreeWalk(Pool pool, FreeBlockVisitor f, void *p);
@@ -237,6 +242,8 @@ extern Res PoolNoAlloc(Addr *pReturn, Pool pool, Size size);
 extern Res PoolTrivAlloc(Addr *pReturn, Pool pool, Size size);
 extern void PoolNoFree(Pool pool, Addr old, Size size);
 extern void PoolTrivFree(Pool pool, Addr old, Size size);
+extern Bool PoolTrivTryAlloc(Addr *pReturn, Pool pool, Size size);
+extern Bool PoolTrivTryFree(Pool pool, Addr old, Size size);
 extern PoolGen PoolNoSegPoolGen(Pool pool, Seg seg);
 extern Res PoolNoBufferFill(Addr *baseReturn, Addr *limitReturn,
                             Pool pool, Buffer buffer, Size size);
@@ -306,6 +313,8 @@ extern void MessageFinalizationRef(Ref *refReturn,
 extern Size MessageGCLiveSize(Message message);
 extern Size MessageGCCondemnedSize(Message message);
 extern Size MessageGCNotCondemnedSize(Message message);
+extern double MessageGCPauseTime(Message message);
+extern double MessageGCPauseMax(Message message);
 extern const char *MessageGCStartWhy(Message message);
 /* -- Message Method Stubs, Type-specific */
 extern void MessageNoFinalizationRef(Ref *refReturn,
@@ -313,6 +322,8 @@ extern void MessageNoFinalizationRef(Ref *refReturn,
 extern Size MessageNoGCLiveSize(Message message);
 extern Size MessageNoGCCondemnedSize(Message message);
 extern Size MessageNoGCNotCondemnedSize(Message message);
+extern double MessageNoGCPauseTime(Message message);
+extern double MessageNoGCPauseMax(Message message);
 extern const char *MessageNoGCStartWhy(Message message);
 
 
@@ -344,6 +355,8 @@ extern void ScanStateFinish(ScanState ss);
 extern Bool ScanStateCheck(ScanState ss);
 extern void ScanStateSetSummary(ScanState ss, RefSet summary);
 extern RefSet ScanStateSummary(ScanState ss);
+extern void ScanStatsInit(ScanStats stats);
+extern void ScanStatsAdd(ScanStats stats, ScanState ss);
 
 /* See impl.h.mpmst.ss */
 #define ScanStateZoneShift(ss)             ((Shift)(ss)->ss_s._zs)
@@ -368,7 +381,7 @@ extern Res TraceStart(Trace trace, double mortality, double finishingTime);
 extern Bool TracePoll(Work *workReturn, Bool *collectWorldReturn,
                       Globals globals, Bool collectWorldAllowed);
 
-extern Rank TraceRankForAccess(Arena arena, Seg seg);
+extern Rank TraceRankForAccess(Trace trace, Seg seg);
 extern void TraceSegAccess(Arena arena, Seg seg, AccessSet mode);
 
 extern void TraceAdvance(Trace trace);
@@ -440,11 +453,13 @@ extern double TraceWorkFactor;
     } \
   END
 
+extern Res TraceFixArray(ScanState ss, mps_addr_t *refs, Count count);
 extern Res TraceScanArea(ScanState ss, Word *base, Word *limit,
                          mps_area_scan_t scan_area,
                          void *closure);
 extern void TraceScanSingleRef(TraceSet ts, Rank rank, Arena arena,
                                Seg seg, Ref *refIO);
+extern void TraceScanSingleRefAccess(Arena arena, Seg seg, Ref *refIO);
 
 
 /* Arena Interface -- see <code/arena.c> */
@@ -490,6 +505,10 @@ extern void GlobalsReinitializeAll(void);
 #define ArenaChunkRing(arena) RVALUE(&(arena)->chunkRing)
 #define ArenaShield(arena)      (&(arena)->shieldStruct)
 #define ArenaHistory(arena)     (&(arena)->historyStruct)
+#define ArenaCardMarking(arena) RVALUE((arena)->cardMarking)
+#define ArenaCards(arena)       (&(arena)->cardsStruct)
+#define ArenaDirtyTracking(arena) RVALUE((arena)->dirtyTracking)
+#define ArenaCooperativeSuspend(arena) RVALUE((arena)->cooperativeSuspend)
 
 extern Bool ArenaGrainSizeCheck(Size size);
 #define AddrArenaGrainUp(addr, arena) AddrAlignUp(addr, ArenaGrainSize(arena))
@@ -574,11 +593,17 @@ Ref ArenaRead(Arena arena, Ref *p);
 extern Size ArenaReserved(Arena arena);
 extern Size ArenaCommitted(Arena arena);
 extern Size ArenaSpareCommitted(Arena arena);
+extern void ArenaStatsGet(ArenaStats stats, Arena arena);
+extern void ArenaPauseBegin(Arena arena);
+extern void ArenaPauseEnd(Arena arena, Bool work);
+extern double ArenaPauseCurrent(Arena arena);
 
 extern Size ArenaCommitLimit(Arena arena);
 extern Res ArenaSetCommitLimit(Arena arena, Size limit);
 extern Size ArenaSpareCommitLimit(Arena arena);
 extern void ArenaSetSpareCommitLimit(Arena arena, Size limit);
+extern Size ArenaPurgeSpareStep(Arena arena, double interval);
+#define ArenaSparePurgeDeferred(arena) ((arena)->sparePurgeRate > 0.0)
 extern double ArenaPauseTime(Arena arena);
 extern void ArenaSetPauseTime(Arena arena, double pauseTime);
 extern Size ArenaNoPurgeSpare(Arena arena, Size size);
@@ -598,6 +623,9 @@ extern Res ArenaAlloc(Addr *baseReturn, LocusPref pref,
                       Size size, Pool pool);
 extern Res ArenaFreeLandAlloc(Tract *tractReturn, Arena arena, ZoneSet zones,
                               Bool high, Size size, Pool pool);
+extern Res ArenaFreeLandAllocOnNode(Tract *tractReturn, Arena arena,
+                                    Index node, ZoneSet zones, Bool high,
+                                    Size size, Pool pool);
 extern void ArenaFree(Addr base, Size size, Pool pool);
 
 extern Res ArenaNoExtend(Arena arena, Addr base, Size size);
@@ -605,6 +633,7 @@ extern Res ArenaNoExtend(Arena arena, Addr base, Size size);
 
 /* Policy interface */
 
+extern Index PolicyNode(Arena arena, LocusPref pref);
 extern Res PolicyAlloc(Tract *tractReturn, Arena arena, LocusPref pref,
                        Size size, Pool pool);
 extern Bool PolicyShouldCollectWorld(Arena arena, double availableTime,
@@ -626,6 +655,7 @@ extern Res LocusPrefDescribe(LocusPref pref, mps_lib_FILE *stream, Count depth);
 extern void LocusInit(Arena arena);
 extern void LocusFinish(Arena arena);
 extern Bool LocusCheck(Arena arena);
+extern Count LocusGenCollections(Arena arena, Index gen);
 
 
 /* Segment interface */
@@ -804,6 +834,18 @@ extern Res FormatDescribe(Format format, mps_lib_FILE *stream, Count depth);
 extern Res FormatScan(Format format, ScanState ss, Addr base, Addr limit);
 
 
+/* Card marking -- see <code/card.c> */
+
+extern void CardTableInit(Arena arena, Bool cardMarking);
+extern Res CardTableCreate(Arena arena);
+extern void CardTableDestroy(Arena arena);
+extern void CardTableUpdate(Arena arena, Chunk removed);
+extern Bool CardIsDirty(Arena arena, Addr base, Addr limit);
+extern void CardSetDirty(Arena arena, Addr base, Addr limit);
+extern void CardClean(Arena arena, Addr base, Addr limit);
+extern Res CardScan(ScanState ss, Format format, Addr base, Addr limit);
+
+
 /* Reference Interface -- see <code/ref.c> */
 
 extern Bool RankCheck(Rank rank);
@@ -875,6 +917,7 @@ extern void (ShieldCover)(Arena arena, Seg seg);
 extern void (ShieldHold)(Arena arena);
 extern void (ShieldRelease)(Arena arena);
 extern void (ShieldFlush)(Arena arena);
+extern void (ShieldResume)(Arena arena);
 
 #if defined(SHIELD)
 /* Nothing to do: functions declared in all shield configurations. */
@@ -892,6 +935,7 @@ extern void (ShieldFlush)(Arena arena);
 #define ShieldHold(arena) BEGIN UNUSED(arena); END
 #define ShieldRelease(arena) BEGIN UNUSED(arena); END
 #define ShieldFlush(arena) BEGIN UNUSED(arena); END
+#define ShieldResume(arena) BEGIN UNUSED(arena); END
 #else
 #error "No shield configuration."
 #endif  /* SHIELD */
@@ -951,6 +995,7 @@ extern RefSet RootSummary(Root root);
 extern void RootGrey(Root root, Trace trace);
 extern Res RootScan(ScanState ss, Root root);
 extern Arena RootArena(Root root);
+extern ScanStats RootScanStats(Root root);
 extern Bool RootOfAddr(Root *root, Arena arena, Addr addr);
 extern void RootAccess(Root root, AccessSet mode);
 typedef Res (*RootIterateFn)(Root root, void *p);
@@ -14,6 +14,7 @@
 #include "mpslib.h"
 #include "mpslib.h"
 #include "testlib.h"
+#include "testthr.h"
 
 #include <stdio.h> /* printf */
 
@@ -22,6 +23,9 @@
 #define smallArenaSIZE  ((((size_t)1)<<20) - 4)
 #define testSetSIZE 200
 #define testLOOPS 10
+#define testTHREADS 4
+#define testThreadSetSIZE 64
+#define testThreadLOOPS 20000
 
 
 /* check_allocated_size -- check the allocated size of the pool */
@@ -112,6 +116,92 @@ static mps_res_t stress(mps_arena_t arena, mps_pool_debug_option_s *options,
 }
 
 
+/* threadStress -- allocate and free in a shared pool from several threads
+ *
+ * Each thread keeps its own set of objects, stamps each one with a tag
+ * and checks the tag when freeing it, so that the pool handing out
+ * overlapping blocks to different threads is detected.  Manual pools
+ * with their own lock <design/pool/#lock> take this path without the
+ * arena lock.
+ */
+
+typedef struct thread_s {
+  mps_pool_t pool;
+  size_t unitSize;              /* object size, or 0 for random sizes */
+  unsigned long seed;
+  unsigned long tag;
+} thread_s;
+
+static unsigned long threadRnd(thread_s *thread)
+{
+  /* Not rnd(), whose state is shared between threads. */
+  thread->seed = (thread->seed * 1103515245ul + 12345ul) & 0x7fffffff;
+  return thread->seed;
+}
+
+static void *threadStress(void *arg)
+{
+  thread_s *thread = arg;
+  unsigned long *ps[testThreadSetSIZE];
+  size_t ss[testThreadSetSIZE];
+  size_t i, k;
+
+  for (i = 0; i < testThreadSetSIZE; ++i)
+    ps[i] = NULL;
+
+  for (k = 0; k < testThreadLOOPS; ++k) {
+    mps_addr_t obj;
+    i = threadRnd(thread) % testThreadSetSIZE;
+    if (ps[i] != NULL) {
+      Insist(*ps[i] == thread->tag + i);
+      mps_free(thread->pool, ps[i], ss[i]);
+    }
+    ss[i] = thread->unitSize;
+    if (ss[i] == 0)
+      ss[i] = sizeof(unsigned long) + threadRnd(thread) % 512;
+    die(mps_alloc(&obj, thread->pool, ss[i]), "mps_alloc");
+    ps[i] = obj;
+    *ps[i] = thread->tag + i;
+  }
+
+  for (i = 0; i < testThreadSetSIZE; ++i) {
+    if (ps[i] != NULL) {
+      Insist(*ps[i] == thread->tag + i);
+      mps_free(thread->pool, ps[i], ss[i]);
+    }
+  }
+
+  return NULL;
+}
+
+static void stressThreads(mps_arena_t arena, size_t unitSize,
+                          const char *name, mps_pool_class_t pool_class,
+                          mps_arg_s *args)
+{
+  mps_pool_t pool;
+  testthr_t threads[testTHREADS];
+  thread_s ts[testTHREADS];
+  size_t i;
+
+  printf("Pool class %s, %d threads\n", name, testTHREADS);
+
+  die(mps_pool_create_k(&pool, arena, pool_class, args), "pool_create");
+
+  for (i = 0; i < testTHREADS; ++i) {
+    ts[i].pool = pool;
+    ts[i].unitSize = unitSize;
+    ts[i].seed = (unsigned long)rnd();
+    ts[i].tag = (unsigned long)(i + 1) << 16;
+    testthr_create(&threads[i], threadStress, &ts[i]);
+  }
+  for (i = 0; i < testTHREADS; ++i)
+    testthr_join(&threads[i], NULL);
+
+  check_allocated_size(pool, 0);
+  mps_pool_destroy(pool);
+}
+
+
 /* randomSize -- produce sizes both large and small */
 
 static size_t randomSize(size_t i)
@@ -215,6 +305,16 @@ static void testInArena(mps_arena_class_t arena_class, mps_arg_s *arena_args,
                mps_class_mfs(), args), "stress MFS");
   } MPS_ARGS_END(args);
 
+  MPS_ARGS_BEGIN(args) {
+    stressThreads(arena, 0, "MVFF", mps_class_mvff(), args);
+  } MPS_ARGS_END(args);
+
+  MPS_ARGS_BEGIN(args) {
+    fixedSizeSize = sizeof(unsigned long) + rnd() % 64;
+    MPS_ARGS_ADD(args, MPS_KEY_MFS_UNIT_SIZE, fixedSizeSize);
+    stressThreads(arena, fixedSizeSize, "MFS", mps_class_mfs(), args);
+  } MPS_ARGS_END(args);
+
   /* Manual allocation should not cause any garbage collections. */
   Insist(mps_collections(arena) == 0);
   mps_arena_destroy(arena);
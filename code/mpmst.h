@@ -57,6 +57,8 @@ typedef struct mps_pool_class_s {
   PoolInitMethod init;          /* initialize the pool descriptor */
   PoolAllocMethod alloc;        /* allocate memory from pool */
   PoolFreeMethod free;          /* free memory to pool */
+  PoolTryAllocMethod tryAlloc;  /* allocate under the pool lock alone */
+  PoolTryFreeMethod tryFree;    /* free under the pool lock alone */
   PoolSegPoolGenMethod segPoolGen; /* get pool generation of segment */
   PoolBufferFillMethod bufferFill;      /* out-of-line reserve */
   PoolBufferEmptyMethod bufferEmpty;    /* out-of-line commit */
@@ -73,6 +75,20 @@ typedef struct mps_pool_class_s {
 } PoolClassStruct;
 
 
+/* ScanStatsStruct -- scanning done on behalf of a pool, root or format
+ *
+ * Accumulated by the tracer when the arena is gathering scan
+ * statistics.  See <design/scan/#stats>.
+ */
+
+typedef struct ScanStatsStruct {
+  Count scans;                  /* segments or roots scanned */
+  double scanned;               /* bytes scanned */
+  Count fixed;                  /* refs which passed the zone check */
+  double time;                  /* time spent scanning, in seconds */
+} ScanStatsStruct;
+
+
 /* PoolStruct -- generic structure
  *
  * .pool: A generic structure is created when a pool is created and
@@ -97,6 +113,8 @@ typedef struct mps_pool_s {     /* generic structure */
   Align alignment;              /* alignment for grains */
   Shift alignShift;             /* log2(alignment) */
   Format format;                /* format or NULL */
+  Lock lock;                    /* pool lock or NULL <design/pool/#lock> */
+  ScanStatsStruct scanStats;    /* <design/scan/#stats> */
 } PoolStruct;
 
 
@@ -174,6 +192,8 @@ typedef struct MessageClassStruct {
   MessageGCLiveSizeMethod gcLiveSize;
   MessageGCCondemnedSizeMethod gcCondemnedSize;
   MessageGCNotCondemnedSizeMethod gcNotCondemnedSize;
+  MessageGCPauseTimeMethod gcPauseTime;
+  MessageGCPauseMaxMethod gcPauseMax;
 
   /* methods specific to MessageTypeGCSTART */
   MessageGCStartWhyMethod gcStartWhy;
@@ -289,6 +309,8 @@ typedef struct LocusPrefStruct { /* locus placement preferences */
   Bool high;                    /* high or low */
   ZoneSet zones;                /* preferred zones */
   ZoneSet avoid;                /* zones to avoid */
+  Bool hasNode;                 /* node given, or calling thread's? */
+  Index node;                   /* preferred NUMA node, if hasNode */
 } LocusPrefStruct;
 
 
@@ -387,6 +409,7 @@ typedef struct mps_fmt_s {
   mps_fmt_pad_t pad;
   mps_fmt_class_t klass;        /* pointer indicating class */
   Size headerSize;              /* size of header */
+  ScanStatsStruct scanStats;    /* <design/scan/#stats> */
 } FormatStruct;
 
 
@@ -429,7 +452,8 @@ typedef struct ScanStateStruct {
   Rank rank;                    /* reference rank of scanning */
   Bool wasMarked;               /* design.mps.fix.protocol.was-ready */
   RefSet fixedSummary;          /* accumulated summary of fixed references */
-  STATISTIC_DECL(Count fixRefCount) /* refs which pass zone check */
+  Bool cardsOnly;               /* <design/write-barrier/#card.scan> */
+  Count fixRefCount;            /* refs which pass zone check */
   STATISTIC_DECL(Count segRefCount) /* refs which refer to segs */
   STATISTIC_DECL(Count whiteSegRefCount) /* refs which refer to white segs */
   STATISTIC_DECL(Count nailCount) /* segments nailed by ambig refs */
@@ -437,7 +461,9 @@ typedef struct ScanStateStruct {
   STATISTIC_DECL(Count forwardedCount) /* objects preserved by moving */
   STATISTIC_DECL(Count preservedInPlaceCount) /* objects preserved in place */
   STATISTIC_DECL(Size copiedSize) /* bytes copied */
+  STATISTIC_DECL(Count objectScanCount) /* objects scanned individually */
   Size scannedSize;             /* bytes scanned */
+  Clock scanClocks;             /* time scanning, <design/scan/#stats> */
 } ScanStateStruct;
 
 
@@ -458,6 +484,7 @@ typedef struct TraceStruct {
   SegFixMethod fix;             /* fix method to apply to references */
   void *fixClosure;             /* see .ss.fix-closure */
   Chain chain;                  /* chain being incrementally collected */
+  Bool exclusive;               /* condemned a seg without AttrMULTITRACE */
   STATISTIC_DECL(Size preTraceArenaReserved) /* ArenaReserved before this trace */
   Size condemned;               /* condemned bytes */
   Size notCondemned;            /* collectable but not condemned */
@@ -481,12 +508,15 @@ typedef struct TraceStruct {
   STATISTIC_DECL(Count snapCount) /* refs snapped to forwarded objs */
   STATISTIC_DECL(Count readBarrierHitCount) /* read barrier faults */
   STATISTIC_DECL(Count pointlessScanCount) /* pointless seg scans */
+  STATISTIC_DECL(Count objectScanCount) /* objects scanned individually */
   STATISTIC_DECL(Count forwardedCount) /* objects preserved by moving */
   Size forwardedSize;           /* bytes preserved by moving */
   STATISTIC_DECL(Count preservedInPlaceCount) /* objects preserved in place */
   Size preservedInPlaceSize;    /* bytes preserved in place */
   STATISTIC_DECL(Count reclaimCount) /* segments reclaimed */
-  STATISTIC_DECL(Count reclaimSize) /* bytes reclaimed */
+  Size reclaimSize;             /* bytes reclaimed */
+  double pauseTime;             /* time paused while trace was busy */
+  double pauseMax;              /* longest pause while trace was busy */
 } TraceStruct;
 
 
@@ -533,6 +563,7 @@ typedef struct GlobalsStruct {
   /* polling fields (<code/global.c>) */
   double pollThreshold;         /* <design/arena/#poll> */
   Bool insidePoll;
+  Bool insideBackground;        /* polling on background thread? */
   Bool clamped;                 /* prevent background activity */
   double fillMutatorSize;       /* total bytes filled, mutator buffers */
   double emptyMutatorSize;      /* total bytes emptied, mutator buffers */
@@ -720,6 +751,36 @@ typedef struct HistoryStruct {
 } HistoryStruct;  
 
 
+/* ArenaStatsStruct -- snapshot of arena statistics
+ *
+ * Filled in by ArenaStatsGet for mps_arena_stats.  See
+ * <design/arena/#stats>.
+ */
+
+#define ArenaStatsGENS 8
+#define ArenaPauseBUCKETS 8
+#define ArenaMMUWINDOWS 6
+
+typedef struct ArenaStatsStruct {
+  Count traces;                 /* traces finished */
+  Count genCollections[ArenaStatsGENS]; /* collections of each gen */
+  Count flips;                  /* traces flipped */
+  double allocated;             /* bytes allocated by the mutator */
+  double forwarded;             /* bytes forwarded by finished traces */
+  double reclaimed;             /* bytes reclaimed by finished traces */
+  Count readBarrierHits;        /* read barrier hits */
+  Count writeBarrierHits;       /* write barrier hits */
+  double pauseTime;             /* total of pauses in client threads */
+  double backgroundTime;        /* time spent tracing in background */
+  Size spareCommitted;          /* spare committed memory */
+  Count greySegs;               /* segments waiting to be scanned */
+  Count pauses;                 /* pauses in client threads */
+  double pauseMax;              /* longest pause */
+  Count pauseHist[ArenaPauseBUCKETS]; /* histogram of pause times */
+  double mmu[ArenaMMUWINDOWS];  /* minimum mutator utilization */
+} ArenaStatsStruct;
+
+
 /* ArenaStruct -- generic arena
  *
  * See <code/arena.c>.
@@ -742,6 +803,8 @@ typedef struct mps_arena_s {
 
   Size spareCommitted;          /* Amount of memory in hysteresis fund */
   Size spareCommitLimit;        /* Limit on spareCommitted */
+  double sparePurgeRate;        /* bytes/s, or 0 to purge at once */
+  Clock sparePurgeClock;        /* time of last deferred purge */
   double pauseTime;             /* Maximum pause time, in seconds. */
 
   Shift zoneShift;              /* see also <code/ref.c> */
@@ -753,6 +816,8 @@ typedef struct mps_arena_s {
   Chunk primary;                /* the primary chunk */
   RingStruct chunkRing;         /* all the chunks, in a ring for iteration */
   Tree chunkTree;               /* all the chunks, in a tree for fast lookup */
+  Shift chunkMapShift;          /* log2 of stripe size in chunkMap */
+  Chunk chunkMap[ARENA_CHUNK_MAP_LENGTH][2]; /* <design/arena/#chunk.map> */
   Serial chunkSerial;           /* next chunk number */
 
   Bool hasFreeLand;              /* Is freeLand available? */
@@ -760,6 +825,7 @@ typedef struct mps_arena_s {
   CBSStruct freeLandStruct;
   ZoneSet freeZones;            /* zones not yet allocated */
   Bool zoned;                   /* use zoned allocation? */
+  Count nodes;                  /* number of NUMA nodes chunks are on */
 
   /* locus fields (<code/locus.c>) */
   GenDescStruct topGen;         /* generation descriptor for dynamic gen */
@@ -787,6 +853,10 @@ typedef struct mps_arena_s {
   /* trace fields (<code/trace.c>) */
   TraceSet busyTraces;          /* set of running traces */
   TraceSet flippedTraces;       /* set of running and flipped traces */
+  Count flipCount;              /* number of traces flipped */
+  Count traceCount;             /* number of traces finished */
+  double forwardedSize;         /* bytes forwarded by finished traces */
+  double reclaimedSize;         /* bytes reclaimed by finished traces */
   TraceStruct trace[TraceLIMIT]; /* trace structures.  See
                                    <design/trace/#intance.limit> */
 
@@ -797,10 +867,49 @@ typedef struct mps_arena_s {
   /* policy fields */
   double tracedWork;
   double tracedTime;
+  double backgroundTime;        /* part of tracedTime on background thread */
   Clock lastWorldCollect;
 
+  /* background collection fields (<design/arena/#poll.background>) */
+  Bool gcBackground;            /* client asked for background thread? */
+  Daemon daemon;                /* background collector thread, or NULL */
+  Bool daemonStopping;          /* background thread must not poll */
+
+  /* card marking fields (<code/card.c>) */
+  /* .cards: The card table is described to the client by a struct
+   * mps_cards_s, so that MPS_WRITE_BARRIER can mark cards without
+   * calling the MPS.  See <design/write-barrier/#card>. */
+  Bool cardMarking;             /* use card marking, not protection? */
+  struct mps_cards_s cardsStruct; /* card table shared with client */
+  Count cardTableLength;        /* entries in card table, or 0 */
+  BT cardCovered;               /* card table entries covered by chunks */
+  BT cardShared;                /* entries covered by several chunks */
+  unsigned char cardDummy;      /* card table if not card marking */
+
+  Bool dirtyTracking;           /* <design/prot/#dirty> */
+  Bool cooperativeSuspend;      /* <design/thread-manager/#coop> */
+  Bool lockStats;               /* <design/lock/#stats> */
+  Bool scanStats;               /* <design/scan/#stats> */
+
   RingStruct greyRing[RankLIMIT]; /* ring of grey segments at each rank */
-  STATISTIC_DECL(Count writeBarrierHitCount) /* write barrier hits */
+  Count greySegCount;           /* number of segments on grey rings */
+  Count readBarrierHitCount;    /* read barrier hits */
+  Count writeBarrierHitCount;   /* write barrier hits */
+
+  /* pause fields (<design/arena/#pause>) */
+  Count pauseDepth;             /* nesting of ArenaPauseBegin */
+  Bool pauseWork;               /* pause being timed did some work? */
+  Clock pauseStart;             /* start of pause being timed */
+  Clock pauseEpoch;             /* when pause timing began */
+  Count pauseCount;             /* number of pauses */
+  double pauseTotal;            /* total time paused, in seconds */
+  double pauseMax;              /* longest pause, in seconds */
+  Count pauseHist[ArenaPauseBUCKETS]; /* histogram of pause times */
+  double mmu[ArenaMMUWINDOWS];  /* <design/arena/#pause.mmu> */
+  Index pauseNext;              /* next entry in pause log */
+  Count pauseLogged;            /* number of entries in pause log */
+  Clock pauseLogStart[ARENA_PAUSE_HISTORY]; /* starts of recent pauses */
+  Clock pauseLogEnd[ARENA_PAUSE_HISTORY]; /* ends of recent pauses */
   RingStruct chainRing;         /* ring of chains */
 
   struct HistoryStruct historyStruct;
@@ -72,11 +72,14 @@ typedef struct BufferClassStruct *BufferClass; /* <design/buffer/> */
 typedef unsigned BufferMode;            /* <design/buffer/> */
 typedef struct mps_fmt_s *Format;       /* design.mps.format */
 typedef struct LockStruct *Lock;        /* <code/lock.c>* */
+typedef struct LockStatsStruct *LockStats; /* <design/lock/#stats> */
+typedef struct ArenaStatsStruct *ArenaStats; /* <design/arena/#stats> */
 typedef struct mps_pool_s *Pool;        /* <design/pool/> */
 typedef Pool AbstractPool;
 typedef struct mps_pool_class_s *PoolClass;  /* <code/poolclas.c> */
 typedef struct TraceStruct *Trace;      /* <design/trace/> */
 typedef struct ScanStateStruct *ScanState; /* <design/trace/> */
+typedef struct ScanStatsStruct *ScanStats; /* <design/scan/#stats> */
 typedef struct mps_chain_s *Chain;      /* <design/trace/> */
 typedef struct TractStruct *Tract;      /* <design/arena/> */
 typedef struct ChunkStruct *Chunk;      /* <code/tract.c> */
@@ -94,6 +97,8 @@ typedef struct GlobalsStruct *Globals;  /* <design/arena/> */
 typedef struct VMStruct *VM;            /* <code/vm.c>* */
 typedef struct RootStruct *Root;        /* <code/root.c> */
 typedef struct mps_thr_s *Thread;       /* <code/th.c>* */
+typedef struct DaemonStruct *Daemon;    /* <code/wk.h> */
+typedef void (*DaemonFunction)(void *closure); /* <code/wk.h> */
 typedef struct MutatorContextStruct *MutatorContext; /* <design/prmc/> */
 typedef struct PoolDebugMixinStruct *PoolDebugMixin;
 typedef struct AllocPatternStruct *AllocPattern;
@@ -198,6 +203,8 @@ typedef void (*PoolVarargsMethod)(ArgStruct args[], va_list varargs);
 typedef Res (*PoolInitMethod)(Pool pool, Arena arena, PoolClass klass, ArgList args);
 typedef Res (*PoolAllocMethod)(Addr *pReturn, Pool pool, Size size);
 typedef void (*PoolFreeMethod)(Pool pool, Addr old, Size size);
+typedef Bool (*PoolTryAllocMethod)(Addr *pReturn, Pool pool, Size size);
+typedef Bool (*PoolTryFreeMethod)(Pool pool, Addr old, Size size);
 typedef PoolGen (*PoolSegPoolGenMethod)(Pool pool, Seg seg);
 typedef Res (*PoolBufferFillMethod)(Addr *baseReturn, Addr *limitReturn,
                                     Pool pool, Buffer buffer, Size size);
@@ -232,6 +239,8 @@ typedef void (*MessageFinalizationRefMethod)
 typedef Size (*MessageGCLiveSizeMethod)(Message message);
 typedef Size (*MessageGCCondemnedSizeMethod)(Message message);
 typedef Size (*MessageGCNotCondemnedSizeMethod)(Message message);
+typedef double (*MessageGCPauseTimeMethod)(Message message);
+typedef double (*MessageGCPauseMaxMethod)(Message message);
 typedef const char * (*MessageGCStartWhyMethod)(Message message);
 
 /* Message Types -- <design/message/> and elsewhere */
@@ -276,7 +285,10 @@ typedef Res (*LandFindInZonesMethod)(Bool *foundReturn, Range rangeReturn, Range
 #define RankSetUNIV     ((RankSet)((1u << RankLIMIT) - 1))
 #define AttrGC          ((Attr)(1<<0))
 #define AttrMOVINGGC    ((Attr)(1<<1))
-#define AttrMASK        (AttrGC | AttrMOVINGGC)
+#define AttrMULTITRACE  ((Attr)(1<<2))
+#define AttrPOOLLOCK    ((Attr)(1<<3))
+#define AttrMASK        (AttrGC | AttrMOVINGGC | AttrMULTITRACE \
+                         | AttrPOOLLOCK)
 
 
 /* Locus preferences */
@@ -284,6 +296,7 @@ enum {
   LocusPrefHIGH = 1,
   LocusPrefLOW, 
   LocusPrefZONESET,
+  LocusPrefNODE,
   LocusPrefLIMIT
 };
 
@@ -49,6 +49,7 @@
 #include "seg.c"
 #include "format.c"
 #include "buffer.c"
+#include "card.c"
 #include "ref.c"
 #include "bt.c"
 #include "ring.c"
@@ -95,8 +96,13 @@
 
 #if defined(PLINTH)     /* see CONFIG_PLINTH_NONE in config.h  */
 #include "mpsliban.c"
+#if !defined(PLATFORM_ANSI) \
+  && (defined(MPS_OS_FR) || defined(MPS_OS_LI) || defined(MPS_OS_XC))
+#include "mpsioix.c"
+#else
 #include "mpsioan.c"
 #endif
+#endif
 
 /* Generic ("ANSI") platform */
 
@@ -106,10 +112,12 @@
 #include "than.c"       /* generic threads manager */
 #include "vman.c"       /* malloc-based pseudo memory mapping */
 #include "protan.c"     /* generic memory protection */
+#include "protsdan.c"   /* no soft-dirty page tracking */
 #include "prmcan.c"     /* generic operating system mutator context */
 #include "prmcanan.c"   /* generic architecture mutator context */
 #include "span.c"       /* generic stack probe */
 #include "ssan.c"       /* generic stack scanner */
+#include "wkan.c"       /* generic daemon threads */
 
 /* macOS on 32-bit Intel built with Clang or GCC */
 
@@ -118,7 +126,9 @@
 #include "lockix.c"     /* Posix locks */
 #include "thxc.c"       /* macOS Mach threading */
 #include "vmix.c"       /* Posix virtual memory */
+#include "wkix.c"       /* Posix daemon threads */
 #include "protix.c"     /* Posix protection */
+#include "protsdan.c"   /* no soft-dirty page tracking */
 #include "protxc.c"     /* macOS Mach exception handling */
 #include "prmci3.c"     /* 32-bit Intel mutator context decoding */
 #include "prmcxc.c"     /* macOS mutator context */
@@ -133,7 +143,9 @@
 #include "lockix.c"     /* Posix locks */
 #include "thxc.c"       /* macOS Mach threading */
 #include "vmix.c"       /* Posix virtual memory */
+#include "wkix.c"       /* Posix daemon threads */
 #include "protix.c"     /* Posix protection */
+#include "protsdan.c"   /* no soft-dirty page tracking */
 #include "protxc.c"     /* macOS Mach exception handling */
 #include "prmci6.c"     /* 64-bit Intel mutator context decoding */
 #include "prmcxc.c"     /* macOS mutator context */
@@ -149,7 +161,9 @@
 #include "thix.c"       /* Posix threading */
 #include "pthrdext.c"   /* Posix thread extensions */
 #include "vmix.c"       /* Posix virtual memory */
+#include "wkix.c"       /* Posix daemon threads */
 #include "protix.c"     /* Posix protection */
+#include "protsdan.c"   /* no soft-dirty page tracking */
 #include "protsgix.c"   /* Posix signal handling */
 #include "prmcanan.c"   /* generic architecture mutator context */
 #include "prmcix.c"     /* Posix mutator context */
@@ -165,7 +179,9 @@
 #include "thix.c"       /* Posix threading */
 #include "pthrdext.c"   /* Posix thread extensions */
 #include "vmix.c"       /* Posix virtual memory */
+#include "wkix.c"       /* Posix daemon threads */
 #include "protix.c"     /* Posix protection */
+#include "protsdan.c"   /* no soft-dirty page tracking */
 #include "protsgix.c"   /* Posix signal handling */
 #include "prmcanan.c"   /* generic architecture mutator context */
 #include "prmcix.c"     /* Posix mutator context */
@@ -181,7 +197,9 @@
 #include "thix.c"       /* Posix threading */
 #include "pthrdext.c"   /* Posix thread extensions */
 #include "vmix.c"       /* Posix virtual memory */
+#include "wkix.c"       /* Posix daemon threads */
 #include "protix.c"     /* Posix protection */
+#include "protsdli.c"   /* Linux soft-dirty page tracking */
 #include "protsgix.c"   /* Posix signal handling */
 #include "prmci3.c"     /* 32-bit Intel mutator context */
 #include "prmcix.c"     /* Posix mutator context */
@@ -197,7 +215,9 @@
 #include "thix.c"       /* Posix threading */
 #include "pthrdext.c"   /* Posix thread extensions */
 #include "vmix.c"       /* Posix virtual memory */
+#include "wkix.c"       /* Posix daemon threads */
 #include "protix.c"     /* Posix protection */
+#include "protsdli.c"   /* Linux soft-dirty page tracking */
 #include "protsgix.c"   /* Posix signal handling */
 #include "prmci6.c"     /* 64-bit Intel mutator context */
 #include "prmcix.c"     /* Posix mutator context */
@@ -212,7 +232,9 @@
 #include "lockw3.c"     /* Windows locks */
 #include "thw3.c"       /* Windows threading */
 #include "vmw3.c"       /* Windows virtual memory */
+#include "wkw3.c"       /* Windows daemon threads */
 #include "protw3.c"     /* Windows protection */
+#include "protsdan.c"   /* no soft-dirty page tracking */
 #include "prmci3.c"     /* 32-bit Intel mutator context decoding */
 #include "prmcw3.c"     /* Windows mutator context */
 #include "prmcw3i3.c"   /* Windows on 32-bit Intel mutator context */
@@ -227,7 +249,9 @@
 #include "lockw3.c"     /* Windows locks */
 #include "thw3.c"       /* Windows threading */
 #include "vmw3.c"       /* Windows virtual memory */
+#include "wkw3.c"       /* Windows daemon threads */
 #include "protw3.c"     /* Windows protection */
+#include "protsdan.c"   /* no soft-dirty page tracking */
 #include "prmci6.c"     /* 64-bit Intel mutator context decoding */
 #include "prmcw3.c"     /* Windows mutator context */
 #include "prmcw3i6.c"   /* Windows on 64-bit Intel mutator context */
@@ -242,7 +266,9 @@
 #include "lockw3.c"     /* Windows locks */
 #include "thw3.c"       /* Windows threading */
 #include "vmw3.c"       /* Windows virtual memory */
+#include "wkw3.c"       /* Windows daemon threads */
 #include "protw3.c"     /* Windows protection */
+#include "protsdan.c"   /* no soft-dirty page tracking */
 #include "prmci3.c"     /* 32-bit Intel mutator context decoding */
 #include "prmcw3.c"     /* Windows mutator context */
 #include "prmcw3i3.c"   /* Windows on 32-bit Intel mutator context */
@@ -257,7 +283,9 @@
 #include "lockw3.c"     /* Windows locks */
 #include "thw3.c"       /* Windows threading */
 #include "vmw3.c"       /* Windows virtual memory */
+#include "wkw3.c"       /* Windows daemon threads */
 #include "protw3.c"     /* Windows protection */
+#include "protsdan.c"   /* no soft-dirty page tracking */
 #include "prmci6.c"     /* 64-bit Intel mutator context decoding */
 #include "prmcw3.c"     /* Windows mutator context */
 #include "prmcw3i6.c"   /* Windows on 64-bit Intel mutator context */
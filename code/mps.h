@@ -57,6 +57,7 @@ typedef struct mps_thr_s    *mps_thr_t;    /* thread registration */
 typedef struct mps_ap_s     *mps_ap_t;     /* allocation point */
 typedef struct mps_ld_s     *mps_ld_t;     /* location dependency */
 typedef struct mps_ss_s     *mps_ss_t;     /* scan state */
+typedef struct mps_cards_s  *mps_cards_t;  /* card table */
 typedef struct mps_message_s
   *mps_message_t;                          /* message */
 typedef struct mps_alloc_pattern_s
@@ -189,9 +190,30 @@ extern const struct mps_key_s _mps_key_COMMIT_LIMIT;
 extern const struct mps_key_s _mps_key_SPARE_COMMIT_LIMIT;
 #define MPS_KEY_SPARE_COMMIT_LIMIT (&_mps_key_SPARE_COMMIT_LIMIT)
 #define MPS_KEY_SPARE_COMMIT_LIMIT_FIELD size
+extern const struct mps_key_s _mps_key_SPARE_PURGE_RATE;
+#define MPS_KEY_SPARE_PURGE_RATE (&_mps_key_SPARE_PURGE_RATE)
+#define MPS_KEY_SPARE_PURGE_RATE_FIELD d
 extern const struct mps_key_s _mps_key_PAUSE_TIME;
 #define MPS_KEY_PAUSE_TIME      (&_mps_key_PAUSE_TIME)
 #define MPS_KEY_PAUSE_TIME_FIELD d
+extern const struct mps_key_s _mps_key_GC_BACKGROUND;
+#define MPS_KEY_GC_BACKGROUND   (&_mps_key_GC_BACKGROUND)
+#define MPS_KEY_GC_BACKGROUND_FIELD b
+extern const struct mps_key_s _mps_key_CARD_MARKING;
+#define MPS_KEY_CARD_MARKING    (&_mps_key_CARD_MARKING)
+#define MPS_KEY_CARD_MARKING_FIELD b
+extern const struct mps_key_s _mps_key_DIRTY_TRACKING;
+#define MPS_KEY_DIRTY_TRACKING  (&_mps_key_DIRTY_TRACKING)
+#define MPS_KEY_DIRTY_TRACKING_FIELD b
+extern const struct mps_key_s _mps_key_COOPERATIVE_SUSPEND;
+#define MPS_KEY_COOPERATIVE_SUSPEND (&_mps_key_COOPERATIVE_SUSPEND)
+#define MPS_KEY_COOPERATIVE_SUSPEND_FIELD b
+extern const struct mps_key_s _mps_key_LOCK_STATS;
+#define MPS_KEY_LOCK_STATS      (&_mps_key_LOCK_STATS)
+#define MPS_KEY_LOCK_STATS_FIELD b
+extern const struct mps_key_s _mps_key_SCAN_STATS;
+#define MPS_KEY_SCAN_STATS      (&_mps_key_SCAN_STATS)
+#define MPS_KEY_SCAN_STATS_FIELD b
 
 extern const struct mps_key_s _mps_key_EXTEND_BY;
 #define MPS_KEY_EXTEND_BY       (&_mps_key_EXTEND_BY)
@@ -221,6 +243,15 @@ extern const struct mps_key_s _mps_key_INTERIOR;
 extern const struct mps_key_s _mps_key_VMW3_TOP_DOWN;
 #define MPS_KEY_VMW3_TOP_DOWN   (&_mps_key_VMW3_TOP_DOWN)
 #define MPS_KEY_VMW3_TOP_DOWN_FIELD b
+extern const struct mps_key_s _mps_key_VM_HUGE_PAGES;
+#define MPS_KEY_VM_HUGE_PAGES   (&_mps_key_VM_HUGE_PAGES)
+#define MPS_KEY_VM_HUGE_PAGES_FIELD b
+extern const struct mps_key_s _mps_key_VM_LAZY_PURGE;
+#define MPS_KEY_VM_LAZY_PURGE   (&_mps_key_VM_LAZY_PURGE)
+#define MPS_KEY_VM_LAZY_PURGE_FIELD b
+extern const struct mps_key_s _mps_key_VM_NUMA;
+#define MPS_KEY_VM_NUMA         (&_mps_key_VM_NUMA)
+#define MPS_KEY_VM_NUMA_FIELD b
 
 extern const struct mps_key_s _mps_key_FMT_ALIGN;
 #define MPS_KEY_FMT_ALIGN   (&_mps_key_FMT_ALIGN)
@@ -370,6 +401,15 @@ typedef struct mps_ss_s {
 } mps_ss_s;
 
 
+/* Card Table */
+/* .cards: See also <code/mpmst.h#cards>. */
+
+typedef struct mps_cards_s {
+  unsigned char *_table;
+  mps_word_t _shift, _mask;
+} mps_cards_s;
+
+
 /* Format Variants */
 
 typedef struct mps_fmt_A_s {
@@ -462,6 +502,58 @@ extern double mps_arena_pause_time(mps_arena_t);
 extern void mps_arena_pause_time_set(mps_arena_t, double);
 
 extern mps_bool_t mps_arena_busy(mps_arena_t);
+extern mps_cards_t mps_arena_cards(mps_arena_t);
+
+#define MPS_LOCK_HOLD_BUCKETS 8
+
+typedef struct mps_lock_stats_s {
+  size_t mps_claims;
+  size_t mps_contended;
+  double mps_wait_total;
+  double mps_wait_max;
+  double mps_hold_total;
+  double mps_hold_max;
+  size_t mps_hold[MPS_LOCK_HOLD_BUCKETS];
+} mps_lock_stats_s;
+
+extern mps_bool_t mps_arena_lock_stats(mps_lock_stats_s *, mps_arena_t);
+
+#define MPS_ARENA_STATS_GENS 8
+#define MPS_PAUSE_BUCKETS 8
+#define MPS_MMU_WINDOWS 6
+
+typedef struct mps_arena_stats_s {
+  size_t mps_size;              /* set to sizeof(mps_arena_stats_s) */
+  size_t mps_collections;
+  size_t mps_gen_collections[MPS_ARENA_STATS_GENS];
+  size_t mps_flips;
+  double mps_allocated;
+  double mps_forwarded;
+  double mps_reclaimed;
+  size_t mps_read_barrier_hits;
+  size_t mps_write_barrier_hits;
+  double mps_pause_total;
+  double mps_background_total;
+  size_t mps_spare_committed;
+  size_t mps_grey_segs;
+  size_t mps_pauses;
+  double mps_pause_max;
+  size_t mps_pause_hist[MPS_PAUSE_BUCKETS];
+  double mps_mmu[MPS_MMU_WINDOWS];
+} mps_arena_stats_s;
+
+extern void mps_arena_stats(mps_arena_stats_s *, mps_arena_t);
+
+typedef struct mps_scan_stats_s {
+  size_t mps_scans;
+  double mps_scanned;
+  size_t mps_fixed;
+  double mps_time;
+} mps_scan_stats_s;
+
+extern mps_bool_t mps_pool_scan_stats(mps_scan_stats_s *, mps_pool_t);
+extern mps_bool_t mps_root_scan_stats(mps_scan_stats_s *, mps_root_t);
+extern mps_bool_t mps_fmt_scan_stats(mps_scan_stats_s *, mps_fmt_t);
 extern mps_bool_t mps_arena_has_addr(mps_arena_t, mps_addr_t);
 extern mps_bool_t mps_addr_pool(mps_pool_t *, mps_arena_t, mps_addr_t);
 extern mps_bool_t mps_addr_fmt(mps_fmt_t *, mps_arena_t, mps_addr_t);
@@ -716,6 +808,9 @@ extern void (mps_tramp)(void **, mps_tramp_t, void *, size_t);
 
 extern mps_res_t mps_thread_reg(mps_thr_t *, mps_arena_t);
 extern void mps_thread_dereg(mps_thr_t);
+extern void mps_thread_safepoint(mps_thr_t);
+extern void mps_thread_enter_native(mps_thr_t);
+extern void mps_thread_leave_native(mps_thr_t);
 
 
 /* Location Dependency */
@@ -754,6 +849,8 @@ extern size_t mps_message_gc_live_size(mps_arena_t, mps_message_t);
 extern size_t mps_message_gc_condemned_size(mps_arena_t, mps_message_t);
 extern size_t mps_message_gc_not_condemned_size(mps_arena_t,
                                                 mps_message_t);
+extern double mps_message_gc_pause_time(mps_arena_t, mps_message_t);
+extern double mps_message_gc_pause_max(mps_arena_t, mps_message_t);
 
 /* -- mps_message_type_gc_start */
 extern const char *mps_message_gc_start_why(mps_arena_t, mps_message_t);
@@ -814,6 +911,14 @@ extern void mps_pool_check_fenceposts(mps_pool_t);
 extern void mps_pool_check_free_space(mps_pool_t);
 
 
+/* Write Barrier */
+/* .write-barrier: Keep in sync with <code/card.c>. */
+
+#define MPS_WRITE_BARRIER(cards, addr) \
+  ((void)((cards)->_table[((mps_word_t)(addr) >> (cards)->_shift) \
+                          & (cards)->_mask] = 1))
+
+
 /* Scanner Support */
 
 extern mps_res_t mps_scan_area(mps_ss_t, void *, void *, void *);
@@ -822,6 +927,7 @@ extern mps_res_t mps_scan_area_tagged(mps_ss_t, void *, void *, void *);
 extern mps_res_t mps_scan_area_tagged_or_zero(mps_ss_t, void *, void *, void *);
 
 extern mps_res_t mps_fix(mps_ss_t, mps_addr_t *);
+extern mps_res_t mps_fix_array(mps_ss_t, mps_addr_t *, size_t);
 
 #define MPS_SCAN_BEGIN(ss) \
   MPS_BEGIN \
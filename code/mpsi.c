@@ -101,6 +101,15 @@ static Bool mpsi_check(void)
   /* out to external. */
   CHECKL(COMPATTYPE(mps_clock_t, Clock));
 
+  /* Lock statistics are copied field by field, but the histograms */
+  /* must be the same size.  See mps_arena_lock_stats. */
+  CHECKL(MPS_LOCK_HOLD_BUCKETS == LockHoldBUCKETS);
+
+  /* Likewise arena statistics.  See mps_arena_stats. */
+  CHECKL(MPS_ARENA_STATS_GENS == ArenaStatsGENS);
+  CHECKL(MPS_PAUSE_BUCKETS == ArenaPauseBUCKETS);
+  CHECKL(MPS_MMU_WINDOWS == ArenaMMUWINDOWS);
+
   return TRUE;
 }
 
@@ -392,6 +401,186 @@ mps_bool_t mps_arena_busy(mps_arena_t arena)
 }
 
 
+/* mps_arena_cards -- return the arena's card table
+ *
+ * See <design/write-barrier/#card.interface>.  The card table lives
+ * as long as the arena, so the client may keep the result.
+ */
+
+mps_cards_t mps_arena_cards(mps_arena_t arena)
+{
+  mps_cards_t cards;
+
+  ArenaEnter(arena);
+  cards = ArenaCards(arena);
+  ArenaLeave(arena);
+
+  return cards;
+}
+
+
+/* mps_arena_lock_stats -- get contention statistics for the arena lock
+ *
+ * See <design/lock/#stats>.  The claim made by this function is
+ * counted, but its hold time is not.
+ */
+
+mps_bool_t mps_arena_lock_stats(mps_lock_stats_s *stats_o, mps_arena_t arena)
+{
+  LockStatsStruct stats;
+  Bool gathering;
+  Index i;
+
+  AVER(stats_o != NULL);
+
+  ArenaEnter(arena);
+  gathering = LockStatsGet(&stats, ArenaGlobals(arena)->lock);
+  ArenaLeave(arena);
+
+  if (!gathering)
+    return FALSE;
+  stats_o->mps_claims = stats.claims;
+  stats_o->mps_contended = stats.contended;
+  stats_o->mps_wait_total = stats.waitTotal;
+  stats_o->mps_wait_max = stats.waitMax;
+  stats_o->mps_hold_total = stats.holdTotal;
+  stats_o->mps_hold_max = stats.holdMax;
+  for (i = 0; i < MPS_LOCK_HOLD_BUCKETS; ++i)
+    stats_o->mps_hold[i] = stats.hold[i];
+  return TRUE;
+}
+
+
+/* mps_arena_stats -- get a snapshot of the arena's statistics
+ *
+ * See <design/arena/#stats>.  The client sets stats_o->mps_size to
+ * the size of the structure it was compiled with, and only the
+ * fields that lie wholly within that size are stored, so that
+ * fields can be added to the end of the structure without breaking
+ * clients compiled against older headers.
+ */
+
+#define STATS_FITS(stats_o, field) \
+  (offsetof(mps_arena_stats_s, field) + sizeof((stats_o)->field) \
+   <= (stats_o)->mps_size)
+
+#define STATS_SET(stats_o, field, value) \
+  BEGIN \
+    if (STATS_FITS(stats_o, field)) \
+      (stats_o)->field = (value); \
+  END
+
+void mps_arena_stats(mps_arena_stats_s *stats_o, mps_arena_t arena)
+{
+  ArenaStatsStruct stats;
+  Index i;
+
+  AVER(stats_o != NULL);
+  AVER(stats_o->mps_size >= sizeof stats_o->mps_size);
+
+  ArenaEnter(arena);
+  ArenaStatsGet(&stats, arena);
+  ArenaLeave(arena);
+
+  if (stats_o->mps_size > sizeof(mps_arena_stats_s))
+    stats_o->mps_size = sizeof(mps_arena_stats_s);
+  STATS_SET(stats_o, mps_collections, stats.traces);
+  if (STATS_FITS(stats_o, mps_gen_collections))
+    for (i = 0; i < MPS_ARENA_STATS_GENS; ++i)
+      stats_o->mps_gen_collections[i] = stats.genCollections[i];
+  STATS_SET(stats_o, mps_flips, stats.flips);
+  STATS_SET(stats_o, mps_allocated, stats.allocated);
+  STATS_SET(stats_o, mps_forwarded, stats.forwarded);
+  STATS_SET(stats_o, mps_reclaimed, stats.reclaimed);
+  STATS_SET(stats_o, mps_read_barrier_hits, stats.readBarrierHits);
+  STATS_SET(stats_o, mps_write_barrier_hits, stats.writeBarrierHits);
+  STATS_SET(stats_o, mps_pause_total, stats.pauseTime);
+  STATS_SET(stats_o, mps_background_total, stats.backgroundTime);
+  STATS_SET(stats_o, mps_spare_committed, stats.spareCommitted);
+  STATS_SET(stats_o, mps_grey_segs, stats.greySegs);
+  STATS_SET(stats_o, mps_pauses, stats.pauses);
+  STATS_SET(stats_o, mps_pause_max, stats.pauseMax);
+  if (STATS_FITS(stats_o, mps_pause_hist))
+    for (i = 0; i < MPS_PAUSE_BUCKETS; ++i)
+      stats_o->mps_pause_hist[i] = stats.pauseHist[i];
+  if (STATS_FITS(stats_o, mps_mmu))
+    for (i = 0; i < MPS_MMU_WINDOWS; ++i)
+      stats_o->mps_mmu[i] = stats.mmu[i];
+}
+
+
+/* mps_pool_scan_stats, mps_root_scan_stats, mps_fmt_scan_stats --
+ * get the scanning done on behalf of a pool, root or format
+ *
+ * See <design/scan/#stats>.  These return FALSE, leaving *stats_o
+ * unchanged, unless the arena was created with MPS_KEY_SCAN_STATS.
+ */
+
+static mps_bool_t scanStatsGet(mps_scan_stats_s *stats_o, Arena arena,
+                               ScanStats stats)
+{
+  Bool gathering = arena->scanStats;
+
+  if (gathering) {
+    stats_o->mps_scans = stats->scans;
+    stats_o->mps_scanned = stats->scanned;
+    stats_o->mps_fixed = stats->fixed;
+    stats_o->mps_time = stats->time;
+  }
+  return gathering;
+}
+
+mps_bool_t mps_pool_scan_stats(mps_scan_stats_s *stats_o, mps_pool_t pool)
+{
+  Arena arena;
+  Bool gathering;
+
+  AVER(stats_o != NULL);
+  AVER(TESTT(Pool, pool));
+  arena = PoolArena(pool);
+
+  ArenaEnter(arena);
+  AVERT(Pool, pool);
+  gathering = scanStatsGet(stats_o, arena, &pool->scanStats);
+  ArenaLeave(arena);
+
+  return gathering;
+}
+
+mps_bool_t mps_root_scan_stats(mps_scan_stats_s *stats_o, mps_root_t mps_root)
+{
+  Root root = (Root)mps_root;
+  Arena arena;
+  Bool gathering;
+
+  AVER(stats_o != NULL);
+  arena = RootArena(root);
+
+  ArenaEnter(arena);
+  gathering = scanStatsGet(stats_o, arena, RootScanStats(root));
+  ArenaLeave(arena);
+
+  return gathering;
+}
+
+mps_bool_t mps_fmt_scan_stats(mps_scan_stats_s *stats_o, mps_fmt_t format)
+{
+  Arena arena;
+  Bool gathering;
+
+  AVER(stats_o != NULL);
+  AVER(TESTT(Format, format));
+  arena = FormatArena(format);
+
+  ArenaEnter(arena);
+  AVERT(Format, format);
+  gathering = scanStatsGet(stats_o, arena, &format->scanStats);
+  ArenaLeave(arena);
+
+  return gathering;
+}
+
+
 /* mps_arena_has_addr -- is this address managed by this arena? */
 
 mps_bool_t mps_arena_has_addr(mps_arena_t arena, mps_addr_t p)
@@ -732,7 +921,9 @@ size_t mps_pool_total_size(mps_pool_t pool)
 
   ArenaEnter(arena);
 
+  PoolLockClaim(pool);
   size = PoolTotalSize(pool);
+  PoolLockRelease(pool);
 
   ArenaLeave(arena);
 
@@ -749,7 +940,9 @@ size_t mps_pool_free_size(mps_pool_t pool)
 
   ArenaEnter(arena);
 
+  PoolLockClaim(pool);
   size = PoolFreeSize(pool);
+  PoolLockRelease(pool);
 
   ArenaLeave(arena);
 
@@ -766,18 +959,26 @@ mps_res_t mps_alloc(mps_addr_t *p_o, mps_pool_t pool, size_t size)
   AVER_CRITICAL(TESTT(Pool, pool));
   arena = PoolArena(pool);
 
+  /* Try holding only the pool lock, see <design/pool/#lock.try>. */
+  AVER_CRITICAL(p_o != NULL);
+  AVER_CRITICAL(size > 0);
+  if (PoolTryAlloc(&p, pool, size)) {
+    *p_o = (mps_addr_t)p;
+    return MPS_RES_OK;
+  }
+
   ArenaEnter(arena);
 
   ArenaPoll(ArenaGlobals(arena)); /* .poll */
 
-  AVER_CRITICAL(p_o != NULL);
   AVERT_CRITICAL(Pool, pool);
-  AVER_CRITICAL(size > 0);
   /* Note: class may allow unaligned size, see */
   /* <design/pool/#method.alloc.size.align>. */
   /* Rest ignored, see .varargs. */
 
+  PoolLockClaim(pool);
   res = PoolAlloc(&p, pool, size);
+  PoolLockRelease(pool);
 
   ArenaLeave(arena);
 
@@ -808,14 +1009,20 @@ void mps_free(mps_pool_t pool, mps_addr_t p, size_t size)
   AVER_CRITICAL(TESTT(Pool, pool));
   arena = PoolArena(pool);
 
+  /* Try holding only the pool lock, see <design/pool/#lock.try>. */
+  AVER_CRITICAL(size > 0);
+  if (PoolTryFree(pool, (Addr)p, size))
+    return;
+
   ArenaEnter(arena);
 
   AVERT_CRITICAL(Pool, pool);
-  AVER_CRITICAL(size > 0);
   /* Note: class may allow unaligned size, see */
   /* <design/pool/#method.free.size.align>. */
 
+  PoolLockClaim(pool);
   PoolFree(pool, (Addr)p, size);
+  PoolLockRelease(pool);
   ArenaLeave(arena);
 }
 
@@ -1638,6 +1845,30 @@ void mps_thread_dereg(mps_thr_t thread)
   ThreadDeregister(thread, arena);
 
   ArenaLeave(arena);
+
+  /* <design/telemetry/#thread.detach> */
+  EventThreadDetach();
+}
+
+
+/* mps_thread_safepoint -- let the collector suspend this thread
+ *
+ * These don't enter the arena: see <design/thread-manager/#coop>.
+ */
+
+void mps_thread_safepoint(mps_thr_t thread)
+{
+  ThreadSafepoint(thread);
+}
+
+void mps_thread_enter_native(mps_thr_t thread)
+{
+  ThreadEnterNative(thread);
+}
+
+void mps_thread_leave_native(mps_thr_t thread)
+{
+  ThreadLeaveNative(thread);
 }
 
 void mps_ld_reset(mps_ld_t ld, mps_arena_t arena)
@@ -1703,6 +1934,12 @@ mps_res_t mps_fix(mps_ss_t mps_ss, mps_addr_t *ref_io)
   return res;
 }
 
+mps_res_t mps_fix_array(mps_ss_t mps_ss, mps_addr_t *refs, size_t count)
+{
+  ScanState ss = PARENT(ScanStateStruct, ss_s, mps_ss);
+  return (mps_res_t)TraceFixArray(ss, refs, (Count)count);
+}
+
 mps_word_t mps_collections(mps_arena_t arena)
 {
   return ArenaEpoch(arena); /* thread safe: see <code/arena.h#epoch.ts> */
@@ -1925,6 +2162,32 @@ size_t mps_message_gc_not_condemned_size(mps_arena_t arena,
   return (size_t)size;
 }
 
+double mps_message_gc_pause_time(mps_arena_t arena, mps_message_t message)
+{
+  double time;
+
+  ArenaEnter(arena);
+
+  AVERT(Arena, arena);
+  time = MessageGCPauseTime(message);
+
+  ArenaLeave(arena);
+  return time;
+}
+
+double mps_message_gc_pause_max(mps_arena_t arena, mps_message_t message)
+{
+  double time;
+
+  ArenaEnter(arena);
+
+  AVERT(Arena, arena);
+  time = MessageGCPauseMax(message);
+
+  ArenaLeave(arena);
+  return time;
+}
+
 /* -- mps_message_type_gc_start */
 
 const char *mps_message_gc_start_why(mps_arena_t arena,
@@ -0,0 +1,332 @@
+/* mpsioix.c: RAVENBROOK MEMORY POOL SYSTEM I/O IMPLEMENTATION (POSIX)
+ *
+ * $Id$
+ * Copyright (c) 2018 Ravenbrook Limited.  See end of file for license.
+ *
+ * .readership: For MPS client application developers and MPS developers.
+ * .sources: <design/io/>
+ *
+ * .purpose: This behaves like the ANSI I/O module <code/mpsioan.c>,
+ * except that if the environment variable MPS_TELEMETRY_RING is set
+ * to a size, the telemetry stream is written into a ring buffer of
+ * that size in a memory-mapped file.  Writing to the ring never
+ * blocks and never grows the file, so telemetry can be left on in a
+ * long-running program, and the ring can be read while the program
+ * runs with "mpseventcnv -t".  See <design/io/#ring>.
+ *
+ * .posix: The implementation uses mmap(2) with MAP_SHARED, and
+ * supports FreeBSD (MPS_OS_FR), Linux (MPS_OS_LI) and macOS
+ * (MPS_OS_XC).
+ */
+
+/* These must come first, as they define symbols which affect system
+ * headers: see .feature.li in config.h.
+ */
+#include "mpstd.h"
+#include "config.h"  /* to get platform configurations */
+
+#include "mpsio.h"
+
+/* See the comment in <code/mpsioan.c> on why we use AVER() rather
+ * than the ANSI assert().
+ */
+#include "check.h"
+#include "eventcom.h" /* for EventRingHeaderStruct */
+
+#if !defined(MPS_OS_FR) && !defined(MPS_OS_LI) && !defined(MPS_OS_XC)
+#error "mpsioix.c is specific to MPS_OS_FR, MPS_OS_LI or MPS_OS_XC"
+#endif
+
+#include <fcntl.h> /* open, O_RDWR, O_CREAT, O_TRUNC */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> /* memcpy */
+#include <sys/mman.h> /* mmap, munmap */
+#include <sys/types.h> /* off_t */
+#include <unistd.h> /* close, ftruncate */
+
+
+static FILE *ioFile = NULL;             /* stdio stream, or NULL */
+static EventRingHeader ioRing = NULL;   /* mapped ring file, or NULL */
+static size_t ioRingMapped = 0;         /* size of ring mapping */
+
+
+/* ringSize -- decode the size of the ring
+ *
+ * The size is a number of bytes, optionally followed by K or M, and
+ * is rounded up to a power of two no smaller than EventRingSizeMIN,
+ * so that positions remain consistent when they wrap around.
+ */
+
+static size_t ringSize(const char *spec)
+{
+  char *end;
+  unsigned long n;
+  size_t size;
+
+  n = strtoul(spec, &end, 10);
+  switch (*end) {
+  case 'k': case 'K':
+    n *= 1024;
+    break;
+  case 'm': case 'M':
+    n *= 1024 * 1024;
+    break;
+  default:
+    break;
+  }
+
+  size = EventRingSizeMIN;
+  while (size < n && (size << 1) != 0)
+    size <<= 1;
+  return size;
+}
+
+
+/* ringCreate -- create and map the ring file */
+
+static mps_res_t ringCreate(mps_io_t *mps_io_r, const char *filename,
+                            size_t size)
+{
+  size_t mapped = sizeof(EventRingHeaderStruct) + size;
+  EventRingHeader ring;
+  void *p;
+  int fd, r;
+
+  fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0666);
+  if (fd == -1)
+    return MPS_RES_IO;
+
+  /* The file is extended with zeros, so all positions start at zero. */
+  r = ftruncate(fd, (off_t)mapped);
+  if (r == -1) {
+    (void)close(fd);
+    return MPS_RES_IO;
+  }
+
+  p = mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  (void)close(fd); /* the mapping keeps the file open */
+  if (p == MAP_FAILED)
+    return MPS_RES_IO;
+
+  ring = p;
+  ring->version = EventRingVERSION;
+  ring->size = size;
+  (void)memcpy(ring->sig, EventRingSIG, sizeof ring->sig);
+
+  *mps_io_r = (mps_io_t)ring;
+  ioRing = ring;
+  ioRingMapped = mapped;
+  return MPS_RES_OK;
+}
+
+
+/* ringData -- the data following the ring header
+ *
+ * .ring.volatile: All stores to the data go through a volatile
+ * pointer, so that the compiler can't move them before the update of
+ * ring->oldest that makes room for them, nor after the update of
+ * ring->write that publishes them.  Ordering between processors then
+ * relies on stores being seen in program order, which holds on the
+ * x86 processors supported by this module.  See <design/io/#ring.order>.
+ */
+
+#define ringData(ring) ((volatile unsigned char *)((ring) + 1))
+
+
+/* ringMakeRoom -- discard the oldest frames until size bytes are free */
+
+static void ringMakeRoom(EventRingHeader ring, Word size)
+{
+  volatile unsigned char *data = ringData(ring);
+  Word mask = ring->size - 1;
+  Word write = ring->write;
+  Word oldest = ring->oldest;
+
+  while (ring->size - (write - oldest) < size) {
+    Word offset = oldest & mask;
+    Word length = *(volatile Word *)(data + offset);
+    Word read = ring->read;
+
+    /* Count the frame as dropped unless the consumer has passed it. */
+    if (read - oldest == 0 || read - oldest > write - oldest)
+      ++ ring->dropped;
+
+    if (length == EventRingPAD)
+      oldest += ring->size - offset;
+    else
+      oldest += EventRingFrameSIZE(length);
+    ring->oldest = oldest;
+  }
+}
+
+
+/* ringWrite -- write a frame to the ring
+ *
+ * Frames never wrap around the end of the data: if the frame doesn't
+ * fit, the rest of the data is filled with a pad frame.
+ */
+
+static mps_res_t ringWrite(EventRingHeader ring, void *buf, size_t size)
+{
+  volatile unsigned char *data = ringData(ring);
+  const unsigned char *from = buf;
+  Word mask = ring->size - 1;
+  Word frame = EventRingFrameSIZE(size);
+  Word write = ring->write;
+  Word offset = write & mask;
+  volatile unsigned char *to;
+  size_t i;
+
+  if (frame > ring->size / 2)
+    return MPS_RES_LIMIT; /* can't be guaranteed to fit */
+
+  if (ring->size - offset < frame) {
+    ringMakeRoom(ring, ring->size - offset);
+    *(volatile Word *)(data + offset) = EventRingPAD;
+    write += ring->size - offset;
+    ring->write = write;
+    offset = 0;
+  }
+
+  ringMakeRoom(ring, frame);
+  *(volatile Word *)(data + offset) = (Word)size;
+  to = data + offset + sizeof(Word);
+  for (i = 0; i < size; ++i)
+    to[i] = from[i];
+  ring->write = write + frame;
+
+  return MPS_RES_OK;
+}
+
+
+mps_res_t mps_io_create(mps_io_t *mps_io_r)
+{
+  FILE *f;
+  const char *filename;
+  const char *spec;
+
+  if(ioFile != NULL || ioRing != NULL) /* See <code/event.c#trans.log> */
+    return MPS_RES_LIMIT; /* Cannot currently open more than one log */
+
+  filename = getenv("MPS_TELEMETRY_FILENAME");
+  if(filename == NULL)
+    filename = "mpsio.log";
+
+  spec = getenv("MPS_TELEMETRY_RING");
+  if(spec != NULL)
+    return ringCreate(mps_io_r, filename, ringSize(spec));
+
+  f = fopen(filename, "wb");
+  if(f == NULL)
+    return MPS_RES_IO;
+ 
+  *mps_io_r = (mps_io_t)f;
+  ioFile = f;
+  return MPS_RES_OK;
+}
+
+
+void mps_io_destroy(mps_io_t mps_io)
+{
+  if(ioRing != NULL) {
+    AVER(mps_io == (mps_io_t)ioRing);
+    /* The file is left behind so that it can be read afterwards. */
+    (void)munmap((void *)ioRing, ioRingMapped);
+    ioRing = NULL;
+  } else {
+    FILE *f = (FILE *)mps_io;
+    AVER(f == ioFile);
+    AVER(f != NULL);
+
+    ioFile = NULL;
+    (void)fclose(f);
+  }
+}
+
+
+mps_res_t mps_io_write(mps_io_t mps_io, void *buf, size_t size)
+{
+  FILE *f;
+  size_t n;
+
+  if(ioRing != NULL) {
+    AVER(mps_io == (mps_io_t)ioRing);
+    return ringWrite(ioRing, buf, size);
+  }
+
+  f = (FILE *)mps_io;
+  AVER(f == ioFile);
+  AVER(f != NULL);
+
+  n = fwrite(buf, size, 1, f);
+  if(n != 1)
+    return MPS_RES_IO;
+ 
+  return MPS_RES_OK;
+}
+
+
+mps_res_t mps_io_flush(mps_io_t mps_io)
+{
+  FILE *f;
+  int e;
+
+  if(ioRing != NULL) {
+    /* Frames are visible to readers as soon as they are written. */
+    AVER(mps_io == (mps_io_t)ioRing);
+    return MPS_RES_OK;
+  }
+
+  f = (FILE *)mps_io;
+  AVER(f == ioFile);
+  AVER(f != NULL);
+ 
+  e = fflush(f);
+  if(e == EOF)
+    return MPS_RES_IO;
+ 
+  return MPS_RES_OK;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -0,0 +1,283 @@
+/* nurstest.c: NURSERY COLLECTIONS DURING A LONG COLLECTION
+ *
+ * $Id$
+ * Copyright (c) 2016 Ravenbrook Limited.  See end of file for license.
+ *
+ * This test builds a heap of long-lived objects in an AMC pool and
+ * promotes it to the older generation of the chain, so that the next
+ * collection of the chain has a lot of live data to trace.  It then
+ * allocates short-lived objects in the nursery, storing some of them
+ * in the long-lived objects, while that collection proceeds
+ * incrementally.
+ *
+ * It checks that the nursery is collected by other traces while the
+ * long collection is running, and that the long-lived objects and
+ * their references survive intact.  It reports the longest time taken
+ * by a single allocation, which includes any collection work done in
+ * that allocation, both overall and while two collections were
+ * running.  See <design/trace/#multi>.
+ */
+
+#include "fmtdy.h"
+#include "fmtdytst.h"
+#include "testlib.h"
+#include "mpscamc.h"
+#include "mpsavm.h"
+#include "mps.h"
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* free, malloc */
+#include <time.h> /* clock, clock_t, CLOCKS_PER_SEC */
+
+
+#define testArenaSIZE     ((size_t)64 << 20)
+#define oldSIZE           ((size_t)16 << 20) /* size of long-lived heap */
+#define oldWIDTH          16    /* slots in a long-lived vector */
+#define youngWIDTH        8     /* slots in a short-lived vector */
+#define youngROOTS        64    /* short-lived vectors kept alive */
+#define allocSIZE         ((size_t)48 << 20) /* total young allocation */
+#define pauseTIME         0.001 /* MPS_KEY_PAUSE_TIME */
+#define genCOUNT          2
+
+/* Slots in a long-lived vector. */
+#define slotINDEX         0     /* DYLAN_INT of own index */
+#define slotREF           1     /* reference to an older long-lived vector */
+#define slotREFINDEX      2     /* DYLAN_INT of that vector's index */
+#define slotYOUNG         3     /* reference to a short-lived vector */
+
+/* testChain -- generation parameters for the test */
+
+static mps_gen_param_s testChain[genCOUNT] = {
+  { 128, 0.9 }, { 4096, 0.5 } };
+
+
+static mps_arena_t arena;
+static mps_word_t *old;         /* long-lived vectors (a root) */
+static size_t oldCount;
+static mps_word_t young[youngROOTS]; /* short-lived vectors (a root) */
+static unsigned long running;   /* collections started but not finished */
+static unsigned long maxRunning;
+static unsigned long collections;
+static unsigned long overlapping; /* started while another was running */
+
+
+/* messages -- get collection messages and count running collections */
+
+static void messages(void)
+{
+  mps_message_type_t type;
+
+  while (mps_message_queue_type(&type, arena)) {
+    mps_message_t message;
+
+    cdie(mps_message_get(&message, arena, type), "message get");
+    if (type == mps_message_type_gc_start()) {
+      if (running > 0)
+        ++overlapping;
+      ++running;
+      if (running > maxRunning)
+        maxRunning = running;
+    } else if (type == mps_message_type_gc()) {
+      Insist(running > 0);
+      --running;
+      ++collections;
+    } else {
+      cdie(0, "unknown message type");
+    }
+    mps_message_discard(arena, message);
+  }
+}
+
+
+/* check -- check that the long-lived vectors are intact */
+
+static void check(void)
+{
+  size_t i;
+
+  for (i = 0; i < oldCount; ++i) {
+    mps_word_t v = old[i], ref, y;
+    cdie(dylan_check((mps_addr_t)v), "dylan_check old");
+    Insist(DYLAN_VECTOR_SLOT(v, slotINDEX) == DYLAN_INT(i));
+    ref = DYLAN_VECTOR_SLOT(v, slotREF);
+    Insist(DYLAN_VECTOR_SLOT(ref, slotINDEX)
+           == DYLAN_VECTOR_SLOT(v, slotREFINDEX));
+    y = DYLAN_VECTOR_SLOT(v, slotYOUNG);
+    if (y != DYLAN_INT(0)) {
+      cdie(dylan_check((mps_addr_t)y), "dylan_check young");
+      Insist(DYLAN_VECTOR_SLOT(y, 0) == DYLAN_INT(i));
+    }
+  }
+}
+
+
+static void test(mps_pool_t pool)
+{
+  mps_ap_t ap;
+  size_t i, j, allocated;
+  double maxPause = 0.0, maxPauseOverlap = 0.0;
+
+  die(mps_ap_create_k(&ap, pool, mps_args_none), "ap_create");
+
+  /* Build the long-lived heap with the arena parked, so that it all
+     survives into the older generation when collected.  Each vector
+     refers to a random earlier one. */
+  mps_arena_park(arena);
+  for (i = 0; i < oldCount; ++i) {
+    mps_word_t v;
+    size_t k = rnd() % (i + 1);
+    die(make_dylan_vector(&v, ap, oldWIDTH), "make_dylan_vector");
+    for (j = 0; j < oldWIDTH; ++j)
+      DYLAN_VECTOR_SLOT(v, j) = DYLAN_INT(0);
+    DYLAN_VECTOR_SLOT(v, slotINDEX) = DYLAN_INT(i);
+    DYLAN_VECTOR_SLOT(v, slotREF) = k < i ? old[k] : v;
+    DYLAN_VECTOR_SLOT(v, slotREFINDEX) = DYLAN_INT(k);
+    old[i] = v;
+  }
+  die(mps_arena_collect(arena), "collect");
+  messages();
+  check();
+  collections = overlapping = maxRunning = 0;
+
+  /* Release the arena and allocate short-lived vectors.  The older
+     generation is over capacity, so this starts a collection of the
+     whole chain, which takes many polls to finish. */
+  mps_arena_release(arena);
+  for (allocated = 0; allocated < allocSIZE;
+       allocated += (youngWIDTH + 2) * sizeof(mps_word_t))
+  {
+    mps_word_t v;
+    size_t k = rnd() % oldCount;
+    clock_t start = clock();
+    double pause;
+
+    die(make_dylan_vector(&v, ap, youngWIDTH), "make_dylan_vector");
+    pause = (double)(clock() - start) / CLOCKS_PER_SEC;
+    if (pause > maxPause)
+      maxPause = pause;
+    if (running > 1 && pause > maxPauseOverlap)
+      maxPauseOverlap = pause;
+
+    for (j = 0; j < youngWIDTH; ++j)
+      DYLAN_VECTOR_SLOT(v, j) = DYLAN_INT(0);
+    DYLAN_VECTOR_SLOT(v, 0) = DYLAN_INT(k);
+    DYLAN_VECTOR_SLOT(v, 1) = old[k];
+    young[rnd() % youngROOTS] = v;
+    if (rnd() % 16 == 0)
+      DYLAN_VECTOR_SLOT(old[k], slotYOUNG) = v;
+
+    if (rnd() % 256 == 0)
+      messages();
+  }
+  mps_arena_park(arena);
+  messages();
+  check();
+
+  printf("collections: %lu, started during another: %lu, "
+         "most running at once: %lu\n",
+         collections, overlapping, maxRunning);
+  printf("longest allocation: %.3fms, while two collections running: "
+         "%.3fms\n", maxPause * 1e3, maxPauseOverlap * 1e3);
+  Insist(overlapping > 0);
+
+  mps_ap_destroy(ap);
+}
+
+
+int main(int argc, char *argv[])
+{
+  mps_fmt_t format;
+  mps_chain_t chain;
+  mps_pool_t pool;
+  mps_root_t oldRoot, youngRoot;
+  size_t i;
+
+  testlib_init(argc, argv);
+
+  oldCount = oldSIZE / ((oldWIDTH + 2) * sizeof(mps_word_t));
+  old = malloc(oldCount * sizeof old[0]);
+  Insist(old != NULL);
+  for (i = 0; i < oldCount; ++i)
+    old[i] = DYLAN_INT(0);
+  for (i = 0; i < youngROOTS; ++i)
+    young[i] = DYLAN_INT(0);
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, testArenaSIZE);
+    MPS_ARGS_ADD(args, MPS_KEY_PAUSE_TIME, pauseTIME);
+    die(mps_arena_create_k(&arena, mps_arena_class_vm(), args),
+        "arena_create");
+  } MPS_ARGS_END(args);
+  mps_message_type_enable(arena, mps_message_type_gc());
+  mps_message_type_enable(arena, mps_message_type_gc_start());
+
+  die(dylan_fmt(&format, arena), "fmt_create");
+  die(mps_chain_create(&chain, arena, genCOUNT, testChain), "chain_create");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
+    MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
+    die(mps_pool_create_k(&pool, arena, mps_class_amc(), args),
+        "pool_create(amc)");
+  } MPS_ARGS_END(args);
+  die(mps_root_create_table(&oldRoot, arena, mps_rank_exact(), 0,
+                            (mps_addr_t *)old, oldCount),
+      "root_create_table(old)");
+  die(mps_root_create_table(&youngRoot, arena, mps_rank_exact(), 0,
+                            (mps_addr_t *)young, youngROOTS),
+      "root_create_table(young)");
+
+  test(pool);
+
+  mps_root_destroy(youngRoot);
+  mps_root_destroy(oldRoot);
+  mps_pool_destroy(pool);
+  mps_chain_destroy(chain);
+  mps_fmt_destroy(format);
+  mps_arena_destroy(arena);
+  free(old);
+
+  printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
+  return 0;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (c) 2016 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
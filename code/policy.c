@@ -11,10 +11,54 @@
 
 #include "locus.h"
 #include "mpm.h"
+#include "vm.h"
 
 SRCID(policy, "$Id$");
 
 
+/* PolicyNode -- choose the NUMA node to allocate on
+ *
+ * This is the node given by pref, if any, and otherwise the node of
+ * the calling thread.  See <design/arena/#numa.node>.
+ */
+
+Index PolicyNode(Arena arena, LocusPref pref)
+{
+  AVERT(Arena, arena);
+  AVERT(LocusPref, pref);
+
+  if (arena->nodes == 1)
+    return 0;
+  if (pref->hasNode)
+    return pref->node % arena->nodes;
+  return VMCurrentNode() % arena->nodes;
+}
+
+
+/* policyAllocOnNode -- allocate from chunks on a NUMA node
+ *
+ * Tries zones and then moreZones, as plans A and B do below.
+ */
+
+static Res policyAllocOnNode(Tract *tractReturn, Arena arena, Index node,
+                             ZoneSet zones, ZoneSet moreZones, Bool high,
+                             Size size, Pool pool)
+{
+  Res res = ResRESOURCE;
+
+  if (zones != ZoneSetEMPTY) {
+    res = ArenaFreeLandAllocOnNode(tractReturn, arena, node, zones, high,
+                                   size, pool);
+    if (res == ResOK)
+      return res;
+  }
+  if (moreZones != zones)
+    res = ArenaFreeLandAllocOnNode(tractReturn, arena, node, moreZones,
+                                   high, size, pool);
+  return res;
+}
+
+
 /* PolicyAlloc -- allocation policy
  *
  * This is the code responsible for making decisions about where to allocate
@@ -35,6 +79,7 @@ Res PolicyAlloc(Tract *tractReturn, Arena arena, LocusPref pref,
   Res res;
   Tract tract;
   ZoneSet zones, moreZones, evenMoreZones;
+  Bool grown = FALSE;
 
   AVER(tractReturn != NULL);
   AVERT(Arena, arena);
@@ -54,8 +99,31 @@ Res PolicyAlloc(Tract *tractReturn, Arena arena, LocusPref pref,
     }
   }
 
-  /* Plan A: allocate from the free land in the requested zones */
   zones = ZoneSetDiff(pref->zones, pref->avoid);
+  moreZones = ZoneSetUnion(pref->zones, ZoneSetDiff(arena->freeZones, pref->avoid));
+
+  /* Plan N: on a NUMA-aware arena, allocate from chunks on the
+   * preferred node, extending the arena on that node if necessary,
+   * before trying the other nodes.  See <design/arena/#numa.alloc>. */
+  if (arena->nodes > 1) {
+    Index node = PolicyNode(arena, pref);
+    res = policyAllocOnNode(&tract, arena, node, zones, moreZones,
+                            pref->high, size, pool);
+    if (res == ResOK)
+      goto found;
+    if (moreZones != ZoneSetEMPTY) {
+      res = Method(Arena, arena, grow)(arena, pref, size);
+      if (res == ResOK) {
+        grown = TRUE;
+        res = policyAllocOnNode(&tract, arena, node, zones, moreZones,
+                                pref->high, size, pool);
+        if (res == ResOK)
+          goto found;
+      }
+    }
+  }
+
+  /* Plan A: allocate from the free land in the requested zones */
   if (zones != ZoneSetEMPTY) {
     res = ArenaFreeLandAlloc(&tract, arena, zones, pref->high, size, pool);
     if (res == ResOK)
@@ -67,15 +135,15 @@ Res PolicyAlloc(Tract *tractReturn, Arena arena, LocusPref pref,
   /* TODO: zones are precious and (currently) never deallocated, so we
    * should consider extending the arena first if address space is plentiful.
    * See also job003384. */
-  moreZones = ZoneSetUnion(pref->zones, ZoneSetDiff(arena->freeZones, pref->avoid));
   if (moreZones != zones) {
     res = ArenaFreeLandAlloc(&tract, arena, moreZones, pref->high, size, pool);
     if (res == ResOK)
       goto found;
   }
 
-  /* Plan C: Extend the arena, then try A and B again. */
-  if (moreZones != ZoneSetEMPTY) {
+  /* Plan C: Extend the arena, then try A and B again, unless plan N
+   * has already extended it. */
+  if (moreZones != ZoneSetEMPTY && !grown) {
     res = Method(Arena, arena, grow)(arena, pref, size);
     /* If we can't extend because we hit the commit limit, try purging
        some spare committed memory and try again.*/
@@ -269,12 +337,95 @@ failBegin:
 }
 
 
+/* policyStartNurseryTrace -- consider starting a trace alongside others
+ *
+ * If no running trace is exclusive, and the nursery generation of
+ * some chain is over capacity, start a trace that condemns the
+ * nursery segments of that chain which are in pools that can share
+ * segments with other traces and are not already condemned.  See
+ * <design/trace/#multi.policy>.
+ *
+ * If a trace was started, update *traceReturn and return TRUE.
+ * Otherwise, leave *traceReturn unchanged and return FALSE.
+ */
+
+static Bool policyStartNurseryTrace(Trace *traceReturn, Arena arena)
+{
+  Ring node, nextNode;
+  double firstTime = 0.0;
+  Chain firstChain = NULL;
+  TraceId ti;
+  Trace trace;
+  GenDesc gen;
+  Res res;
+
+  TRACE_SET_ITER(ti, trace, arena->busyTraces, arena)
+    if (trace->exclusive || trace->state != TraceFLIPPED)
+      return FALSE;
+  TRACE_SET_ITER_END(ti, trace, arena->busyTraces, arena);
+
+  /* Find the chain whose nursery is most over its capacity. */
+  RING_FOR(node, &arena->chainRing, nextNode) {
+    Chain chain = RING_ELT(Chain, chainRing, node);
+    double time;
+
+    AVERT(Chain, chain);
+    gen = ChainGen(chain, 0);
+    time = gen->capacity * 1024.0 - (double)GenDescNewSize(gen);
+    if (time < firstTime) {
+      firstTime = time; firstChain = chain;
+    }
+  }
+  if (firstChain == NULL)
+    return FALSE;
+
+  res = TraceCreate(&trace, arena, TraceStartWhyCHAIN_GEN0CAP);
+  if (res != ResOK)
+    return FALSE;
+  trace->chain = firstChain;
+  ChainStartTrace(firstChain, trace);
+
+  gen = ChainGen(firstChain, 0);
+  res = ResOK;
+  TraceCondemnStart(trace);
+  RING_FOR(node, &gen->segRing, nextNode) {
+    GCSeg gcseg = RING_ELT(GCSeg, genRing, node);
+    Seg seg = &gcseg->segStruct;
+    if (SegWhite(seg) == TraceSetEMPTY
+        && PoolHasAttr(SegPool(seg), AttrMULTITRACE))
+    {
+      res = TraceAddWhite(trace, seg);
+      if (res != ResOK)
+        break;
+    }
+  }
+  TraceCondemnEnd(trace);
+  if (res != ResOK || TraceIsEmpty(trace)) {
+    AVER(TraceIsEmpty(trace));    /* See <code/trace.c#whiten.fail> */
+    TraceDestroyInit(trace);
+    return FALSE;
+  }
+  AVER(!trace->exclusive);
+
+  EVENT3(ChainCondemnAuto, firstChain, 0, ChainGens(firstChain));
+
+  res = TraceStart(trace, gen->mortality, trace->condemned * TraceWorkFactor);
+  /* We don't expect normal GC traces to fail to start. */
+  AVER(res == ResOK);
+  *traceReturn = trace;
+  return TRUE;
+}
+
+
 /* PolicyStartTrace -- consider starting a trace
  *
  * If collectWorldAllowed is TRUE, consider starting a collection of
  * the world. Otherwise, consider only starting collections of individual
  * chains or generations.
  *
+ * If other traces are running, consider only starting a trace of a
+ * nursery generation that can run alongside them.
+ *
  * If a collection of the world was started, set *collectWorldReturn
  * to TRUE. Otherwise leave it unchanged.
  *
@@ -291,6 +442,9 @@ Bool PolicyStartTrace(Trace *traceReturn, Bool *collectWorldReturn,
   AVER(traceReturn != NULL);
   AVERT(Arena, arena);
 
+  if (arena->busyTraces != TraceSetEMPTY)
+    return policyStartNurseryTrace(traceReturn, arena);
+
   if (collectWorldAllowed) {
     Size sFoundation, sCondemned, sSurvivors, sConsTrace;
     double tTracePerScan; /* tTrace/cScan */
@@ -45,6 +45,8 @@ Bool PoolClassCheck(PoolClass klass)
   CHECKL(FUNCHECK(klass->init));
   CHECKL(FUNCHECK(klass->alloc));
   CHECKL(FUNCHECK(klass->free));
+  CHECKL(FUNCHECK(klass->tryAlloc));
+  CHECKL(FUNCHECK(klass->tryFree));
   CHECKL(FUNCHECK(klass->segPoolGen));
   CHECKL(FUNCHECK(klass->bufferFill));
   CHECKL(FUNCHECK(klass->bufferEmpty));
@@ -61,6 +63,11 @@ Bool PoolClassCheck(PoolClass klass)
   /* Check that pool classes overide sets of related methods. */
   CHECKL((klass->init == PoolAbsInit) ==
          (klass->instClassStruct.finish == PoolAbsFinish));
+  CHECKL((klass->tryAlloc == PoolTrivTryAlloc) ==
+         (klass->tryFree == PoolTrivTryFree));
+  CHECKL(((klass->attr & AttrPOOLLOCK) == 0) ==
+         (klass->tryAlloc == PoolTrivTryAlloc));
+  CHECKL(!(klass->attr & AttrPOOLLOCK) || !(klass->attr & AttrGC));
   CHECKL((klass->bufferFill == PoolNoBufferFill) ==
          (klass->bufferEmpty == PoolNoBufferEmpty));
   CHECKL((klass->framePush == PoolNoFramePush) ==
@@ -95,6 +102,7 @@ Bool PoolCheck(Pool pool)
   CHECKL(pool->alignment == PoolGrainsSize(pool, (Align)1));
   if (pool->format != NULL)
     CHECKD(Format, pool->format);
+  CHECKL(pool->lock == NULL || PoolHasAttr(pool, AttrPOOLLOCK));
   return TRUE;
 }
 
@@ -161,12 +169,25 @@ Res PoolCreate(Pool *poolReturn, Arena arena,
   res = PoolInit(pool, arena, klass, args);
   if (res != ResOK)
     goto failPoolInit;
+
+  /* .lock.alloc: Pools that can allocate under their own lock get one */
+  /* here rather than in PoolInit, so that pools the MPS initializes */
+  /* for its own use don't.  See <design/pool/#lock>. */
+  if (PoolHasAttr(pool, AttrPOOLLOCK)) {
+    res = ControlAlloc(&base, arena, LockSize());
+    if (res != ResOK)
+      goto failLockAlloc;
+    pool->lock = (Lock)base;
+    LockInit(pool->lock);
+  }
  
   *poolReturn = pool; 
   return ResOK;
 
+failLockAlloc:
+  PoolFinish(pool);
 failPoolInit:
-  ControlFree(arena, base, klass->size);
+  ControlFree(arena, pool, klass->size);
 failControlAlloc:
   return res;
 }
@@ -187,12 +208,20 @@ void PoolDestroy(Pool pool)
 {
   Arena arena;
   Size size;
+  Lock lock;
 
   AVERT(Pool, pool); 
   arena = pool->arena;
   size = ClassOfPoly(Pool, pool)->size;
+  lock = pool->lock;
   PoolFinish(pool);
 
+  /* .lock.free: Free the pool lock.  See .lock.alloc */
+  if (lock != NULL) {
+    LockFinish(lock);
+    ControlFree(arena, lock, LockSize());
+  }
+
   /* .space.free: Free the pool instance structure.  See .space.alloc */
   ControlFree(arena, pool, size);
 }
@@ -260,6 +289,118 @@ void PoolFree(Pool pool, Addr old, Size size)
 }
 
 
+/* poolObjectEvents -- are per-allocation events being output?
+ *
+ * A thread with event buffers of its own writes the alloc and free
+ * events without the arena lock only if they fit without a flush,
+ * because flushing takes the leaf lock.  Other threads may only write
+ * events while holding the arena lock.  The alloc and free events are
+ * always written, but unless they are being output a thread without
+ * buffers of its own can leave them out rather than taking the arena
+ * lock for them.  See <design/pool/#lock.event>.
+ */
+
+#if defined(EVENT)
+#define poolObjectEvents() BS_IS_MEMBER(EventKindControl, EventKindObject)
+#else
+#define poolObjectEvents() FALSE
+#endif
+
+
+/* PoolTryAlloc -- allocate holding only the pool lock
+ *
+ * Returns FALSE, having done nothing, if the pool has no lock of its
+ * own or can't allocate without the arena.  The caller must then
+ * enter the arena and call PoolAlloc.  See <design/pool/#lock.try>.
+ */
+
+Bool PoolTryAlloc(Addr *pReturn, Pool pool, Size size)
+{
+  Bool b, room;
+
+  AVER_CRITICAL(pReturn != NULL);
+  AVER_CRITICAL(TESTT(Pool, pool));
+  AVER_CRITICAL(size > 0);
+
+  if (pool->lock == NULL)
+    return FALSE;
+  room = EventThreadRoom(PoolAlloc);
+  if (!room && (poolObjectEvents() || EventThreadAttached()))
+    return FALSE;
+
+  LockClaim(pool->lock);
+  AVERT_CRITICAL(Pool, pool);
+  b = Method(Pool, pool, tryAlloc)(pReturn, pool, size);
+  LockRelease(pool->lock);
+
+  if (b && room)
+    EVENT3(PoolAlloc, pool, *pReturn, size);
+
+  /* PoolHasAddr needs the arena lock, so only the alignment is */
+  /* checked here. */
+  AVER_CRITICAL(!b || AddrIsAligned(*pReturn, pool->alignment));
+  return b;
+}
+
+
+/* PoolTryFree -- free holding only the pool lock
+ *
+ * Returns FALSE, having done nothing, if the pool has no lock of its
+ * own or can't free without the arena.  See <design/pool/#lock.try>.
+ */
+
+Bool PoolTryFree(Pool pool, Addr old, Size size)
+{
+  Bool b, room;
+
+  AVER_CRITICAL(TESTT(Pool, pool));
+  AVER_CRITICAL(old != NULL);
+  AVER_CRITICAL(size > 0);
+
+  if (pool->lock == NULL)
+    return FALSE;
+  room = EventThreadRoom(PoolFree);
+  if (!room && (poolObjectEvents() || EventThreadAttached()))
+    return FALSE;
+
+  LockClaim(pool->lock);
+  AVERT_CRITICAL(Pool, pool);
+  AVER_CRITICAL(AddrIsAligned(old, pool->alignment));
+  b = Method(Pool, pool, tryFree)(pool, old, size);
+  LockRelease(pool->lock);
+
+  if (b && room)
+    EVENT3(PoolFree, pool, old, size);
+  return b;
+}
+
+
+/* PoolLockClaim, PoolLockRelease -- claim and release the pool lock
+ *
+ * These do nothing for pools without a lock of their own.  The pool
+ * lock is claimed after the arena lock, never before it.  See
+ * <design/pool/#lock.order>.  A mutator thread may hold the pool
+ * lock, so the mutator is resumed before waiting for it.  See
+ * <design/pool/#lock.suspend>.
+ */
+
+void PoolLockClaim(Pool pool)
+{
+  AVERT(Pool, pool);
+  if (pool->lock != NULL) {
+    ShieldResume(PoolArena(pool));
+    LockClaim(pool->lock);
+  }
+}
+
+void PoolLockRelease(Pool pool)
+{
+  AVERT(Pool, pool);
+  if (pool->lock != NULL)
+    LockRelease(pool->lock);
+}
+
+
 /* PoolSegPoolGen -- get pool generation for a segment */
 
 PoolGen PoolSegPoolGen(Pool pool, Seg seg)
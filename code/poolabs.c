@@ -89,6 +89,8 @@ Res PoolAbsInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
   pool->alignment = MPS_PF_ALIGN;
   pool->alignShift = SizeLog2(pool->alignment);
   pool->format = NULL;
+  pool->lock = NULL;
+  ScanStatsInit(&pool->scanStats);
 
   if (ArgPick(&arg, args, MPS_KEY_FORMAT)) {
     Format format = arg.val.format;
@@ -161,6 +163,8 @@ DEFINE_CLASS(Pool, AbstractPool, klass)
   klass->init = PoolAbsInit;
   klass->alloc = PoolNoAlloc;
   klass->free = PoolNoFree;
+  klass->tryAlloc = PoolTrivTryAlloc;
+  klass->tryFree = PoolTrivTryFree;
   klass->bufferFill = PoolNoBufferFill;
   klass->bufferEmpty = PoolNoBufferEmpty;
   klass->rampBegin = PoolNoRampBegin;
@@ -237,6 +241,22 @@ void PoolTrivFree(Pool pool, Addr old, Size size)
   NOOP;                         /* trivial free has no effect */
 }
 
+Bool PoolTrivTryAlloc(Addr *pReturn, Pool pool, Size size)
+{
+  AVER(pReturn != NULL);
+  AVERT(Pool, pool);
+  AVER(size > 0);
+  return FALSE;                 /* always needs the arena lock */
+}
+
+Bool PoolTrivTryFree(Pool pool, Addr old, Size size)
+{
+  AVERT(Pool, pool);
+  AVER(old != NULL);
+  AVER(size > 0);
+  return FALSE;                 /* always needs the arena lock */
+}
+
 PoolGen PoolNoSegPoolGen(Pool pool, Seg seg)
 {
   AVERT(Pool, pool);
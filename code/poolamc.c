@@ -405,6 +405,12 @@ static amcGen amcSegGen(Seg seg)
 
 #define AMCSig          ((Sig)0x519A3C99) /* SIGnature AMC */
 
+typedef struct amcCopyStruct {  /* <design/poolamc/#fix.depth-first.queue> */
+  Seg seg;                      /* segment containing the copy */
+  Addr base, limit;             /* extent of the copy (client pointers) */
+  Count depth;                  /* depth of the copy */
+} amcCopyStruct;
+
 typedef struct AMCStruct { /* <design/poolamc/#struct> */
   PoolStruct poolStruct;   /* generic pool structure */
   RankSet rankSet;         /* rankSet for entire pool */
@@ -420,6 +426,12 @@ typedef struct AMCStruct { /* <design/poolamc/#struct> */
   amcPinnedFunction pinned; /* function determining if block is pinned */
   Size extendBy;           /* segment size to extend pool by */
   Size largeSize;          /* min size of "large" segments */
+  Size fillSizeMax;        /* <design/poolamc/#fill.grow> */
+  Count copyDepth;         /* <design/poolamc/#fix.depth-first> */
+  ScanState copySS;        /* scan state queueing copies, or NULL */
+  Count scanDepth;         /* depth of the object being scanned */
+  Count copyCount;         /* number of copies in copyQueue */
+  amcCopyStruct copyQueue[AMC_COPY_QUEUE_LENGTH]; /* copies to scan */
   Sig sig;                 /* <design/pool/#outer-structure.sig> */
 } AMCStruct;
 
@@ -455,6 +467,8 @@ typedef struct amcBufStruct {
   SegBufStruct segbufStruct;    /* superclass fields must come first */
   amcGen gen;                   /* The AMC generation */
   Bool forHashArrays;           /* allocates hash table arrays, see AMCBufferFill */
+  Size fillSize;                /* <design/poolamc/#fill.grow> */
+  Epoch fillEpoch;              /* epoch of last fill, <design/poolamc/#fill.shrink> */
   Sig sig;                      /* <design/sig/> */
 } amcBufStruct;
 
@@ -471,6 +485,7 @@ static Bool amcBufCheck(amcBuf amcbuf)
   CHECKL(BoolCheck(amcbuf->forHashArrays));
   /* hash array buffers only created by mutator */
   CHECKL(BufferIsMutator(MustBeA(Buffer, amcbuf)) || !amcbuf->forHashArrays);
+  CHECKL(amcbuf->fillSize > 0);
   return TRUE;
 }
 
@@ -525,6 +540,8 @@ static Res AMCBufInit(Buffer buffer, Pool pool, Bool isMutator, ArgList args)
     amcbuf->gen = NULL;
   }
   amcbuf->forHashArrays = forHashArrays;
+  amcbuf->fillSize = amc->extendBy;
+  amcbuf->fillEpoch = ArenaEpoch(PoolArena(pool));
 
   SetClassOfPoly(buffer, CLASS(amcBuf));
   amcbuf->sig = amcBufSig;
@@ -706,6 +723,9 @@ static void AMCVarargs(ArgStruct args[MPS_ARGS_MAX], va_list varargs)
 }
 
 
+ARG_DEFINE_KEY(AMC_COPY_DEPTH, Count);
+
+
 /* amcInitComm -- initialize AMC/Z pool
  *
  * See <design/poolamc/#init>.
@@ -723,6 +743,7 @@ static Res amcInitComm(Pool pool, Arena arena, PoolClass klass,
   Chain chain;
   Size extendBy = AMC_EXTEND_BY_DEFAULT;
   Size largeSize = AMC_LARGE_SIZE_DEFAULT;
+  Count copyDepth = AMC_COPY_DEPTH_DEFAULT;
   ArgStruct arg;
   
   AVER(pool != NULL);
@@ -741,6 +762,8 @@ static Res amcInitComm(Pool pool, Arena arena, PoolClass klass,
     extendBy = arg.val.size;
   if (ArgPick(&arg, args, MPS_KEY_LARGE_SIZE))
     largeSize = arg.val.size;
+  if (ArgPick(&arg, args, MPS_KEY_AMC_COPY_DEPTH))
+    copyDepth = arg.val.count;
   
   AVERT(Chain, chain);
   AVER(chain->arena == arena);
@@ -751,6 +774,7 @@ static Res amcInitComm(Pool pool, Arena arena, PoolClass klass,
    * unacceptable fragmentation due to the padding objects. This
    * assertion catches this bad case. */
   AVER(largeSize >= extendBy);
+  AVER(copyDepth <= AMC_COPY_DEPTH_MAX);
 
   res = NextMethod(Pool, AMCZPool, init)(pool, arena, klass, args);
   if (res != ResOK)
@@ -784,6 +808,17 @@ static Res amcInitComm(Pool pool, Arena arena, PoolClass klass,
   /* .extend-by.aligned: extendBy is aligned to the arena alignment. */
   amc->extendBy = SizeArenaGrains(extendBy, arena);
   amc->largeSize = largeSize;
+  /* <design/poolamc/#fill.grow.max>: the largest medium segment. */
+  amc->fillSizeMax = amc->extendBy;
+  if (largeSize > amc->extendBy) {
+    Size max = SizeAlignDown(largeSize - 1, ArenaGrainSize(arena));
+    if (max > amc->extendBy)
+      amc->fillSizeMax = max;
+  }
+  amc->copyDepth = copyDepth;
+  amc->copySS = NULL;
+  amc->scanDepth = 0;
+  amc->copyCount = 0;
 
   SetClassOfPoly(pool, klass);
   amc->sig = AMCSig;
@@ -925,6 +960,7 @@ static Res AMCBufferFill(Addr *baseReturn, Addr *limitReturn,
   amcGen gen;
   PoolGen pgen;
   amcBuf amcbuf = MustBeA(amcBuf, buffer);
+  Bool grow = FALSE;
 
   AVER(baseReturn != NULL);
   AVER(limitReturn != NULL);
@@ -938,17 +974,41 @@ static Res AMCBufferFill(Addr *baseReturn, Addr *limitReturn,
   AVERT(amcGen, gen);
   pgen = &gen->pgen;
 
+  /* A mutator buffer that fills again before the next collection */
+  /* grows its fill size.  One that went through whole collections */
+  /* without filling shrinks it.  See <design/poolamc/#fill.shrink>. */
+  if (BufferIsMutator(buffer)) {
+    Epoch epoch = ArenaEpoch(arena);
+    AVER(amcbuf->fillEpoch <= epoch);
+    if (amcbuf->fillEpoch == epoch) {
+      grow = TRUE;
+    } else {
+      Epoch quiet = epoch - amcbuf->fillEpoch - 1;
+      while (quiet > 0 && amcbuf->fillSize > amc->extendBy) {
+        Size half = SizeArenaGrains(amcbuf->fillSize / 2, arena);
+        amcbuf->fillSize = half > amc->extendBy ? half : amc->extendBy;
+        --quiet;
+      }
+    }
+    amcbuf->fillEpoch = epoch;
+  }
+
   /* Create and attach segment.  The location of this segment is */
   /* expressed via the pool generation. We rely on the arena to */
   /* organize locations appropriately.  */
   if (size < amc->extendBy) {
-    grainsSize = amc->extendBy; /* .extend-by.aligned */
+    grainsSize = amcbuf->fillSize; /* .extend-by.aligned */
   } else {
     grainsSize = SizeArenaGrains(size, arena);
   }
   MPS_ARGS_BEGIN(args) {
     MPS_ARGS_ADD_FIELD(args, amcKeySegGen, p, gen);
     res = PoolGenAlloc(&seg, pgen, CLASS(amcSeg), grainsSize, args);
+    if (res != ResOK && grainsSize > amc->extendBy && size < amc->extendBy) {
+      /* <design/poolamc/#fill.grow.fail> */
+      amcbuf->fillSize = grainsSize = amc->extendBy;
+      res = PoolGenAlloc(&seg, pgen, CLASS(amcSeg), grainsSize, args);
+    }
   } MPS_ARGS_END(args);
   if(res != ResOK)
     return res;
@@ -996,6 +1056,14 @@ static Res AMCBufferFill(Addr *baseReturn, Addr *limitReturn,
   PoolGenAccountForFill(pgen, SegSize(seg));
   MustBeA(amcSeg, seg)->accountedAsBuffered = TRUE;
 
+  /* <design/poolamc/#fill.grow> */
+  if (grow && grainsSize == amcbuf->fillSize
+      && grainsSize < amc->fillSizeMax)
+  {
+    Size next = grainsSize * 2;
+    amcbuf->fillSize = next < amc->fillSizeMax ? next : amc->fillSizeMax;
+  }
+
   *baseReturn = base;
   *limitReturn = limit;
   return ResOK;
@@ -1243,8 +1311,6 @@ static Res amcSegWhiten(Seg seg, Trace trace)
   /* Ensure we are forwarding into the right generation. */
 
   /* see <design/poolamc/#gen.ramp> */
-  /* This switching needs to be more complex for multiple traces. */
-  AVER(TraceSetIsSingle(PoolArena(pool)->busyTraces));
   if(amc->rampMode == RampBEGIN && gen == amc->rampGen) {
     BufferDetach(gen->forward, pool);
     amcBufSetGen(gen->forward, gen);
@@ -1396,6 +1462,78 @@ static Res amcSegScanNailed(Bool *totalReturn, ScanState ss, Pool pool,
 }
 
 
+/* amcCopyScan -- scan the copies queued by amcSegFix
+ *
+ * Each copy is scanned with the summaries of the scan state saved, so
+ * that its references go into the summary of its own segment, not
+ * that of the segment being scanned.  See
+ * <design/poolamc/#fix.depth-first.summary>.
+ */
+static Res amcCopyScan(ScanState ss, AMC amc, Format format)
+{
+  Arena arena = ss->arena;
+  RefSet fixed = ss->fixedSummary;
+  RefSet unfixed = ScanStateUnfixedSummary(ss);
+  Res res = ResOK;
+
+  while (amc->copyCount > 0) {
+    amcCopyStruct copy = amc->copyQueue[--amc->copyCount];
+    ss->fixedSummary = RefSetEMPTY;
+    ScanStateSetUnfixedSummary(ss, RefSetEMPTY);
+    amc->scanDepth = copy.depth;
+    ShieldExpose(arena, copy.seg);
+    res = FormatScan(format, ss, copy.base, copy.limit);
+    SegSetSummary(copy.seg, RefSetUnion(SegSummary(copy.seg),
+                                        ScanStateSummary(ss)));
+    ShieldCover(arena, copy.seg);
+    amc->scanDepth = 0;
+    if (res != ResOK) {
+      /* The copies are grey, so they'll be scanned again anyway. */
+      amc->copyCount = 0;
+      break;
+    }
+  }
+
+  ss->fixedSummary = fixed;
+  ScanStateSetUnfixedSummary(ss, unfixed);
+  return res;
+}
+
+
+/* amcSegScanRange -- scan a range of objects in a segment
+ *
+ * If the pool copies depth-first, scans the objects one at a time and
+ * scans the copies of the objects each one refers to before moving on
+ * to the next.  See <design/poolamc/#fix.depth-first>.
+ */
+static Res amcSegScanRange(ScanState ss, AMC amc, Format format,
+                           Addr base, Addr limit)
+{
+  Addr p, next;
+  Res res = ResOK;
+
+  if (amc->copyDepth == 0 || ss->rank != RankEXACT)
+    return CardScan(ss, format, base, limit);
+
+  AVER(amc->copySS == NULL);
+  AVER(amc->copyCount == 0);
+  amc->copySS = ss;
+  for (p = base; p < limit; p = next) {
+    next = (*format->skip)(p);
+    res = CardScan(ss, format, p, next);
+    if (res != ResOK) {
+      amc->copyCount = 0;
+      break;
+    }
+    res = amcCopyScan(ss, amc, format);
+    if (res != ResOK)
+      break;
+  }
+  amc->copySS = NULL;
+  return res;
+}
+
+
 /* amcSegScan -- scan a single seg, turning it black
  *
  * See <design/poolamc/#seg-scan>.
@@ -1417,7 +1555,10 @@ static Res amcSegScan(Bool *totalReturn, Seg seg, ScanState ss)
   amc = MustBeA(AMCZPool, pool);
   format = pool->format;
 
-  if(amcSegHasNailboard(seg)) {
+  /* The nailboard only records which objects are preserved for the */
+  /* traces that nailed the segment.  For any other trace, all the */
+  /* objects must be scanned.  See <design/trace/#multi.nail>. */
+  if(amcSegHasNailboard(seg) && TraceSetSub(ss->traces, SegNailed(seg))) {
     return amcSegScanNailed(totalReturn, ss, pool, seg, amc);
   }
 
@@ -1435,7 +1576,7 @@ static Res amcSegScan(Bool *totalReturn, Seg seg, ScanState ss)
       *totalReturn = TRUE;
       return ResOK;
     }
-    res = FormatScan(format, ss, base, limit);
+    res = amcSegScanRange(ss, amc, format, base, limit);
     if(res != ResOK) {
       *totalReturn = FALSE;
       return res;
@@ -1448,7 +1589,7 @@ static Res amcSegScan(Bool *totalReturn, Seg seg, ScanState ss)
   AVER(SegBase(seg) <= base);
   AVER(base <= AddrAdd(SegLimit(seg), format->headerSize));
   if(base < limit) {
-    res = FormatScan(format, ss, base, limit);
+    res = amcSegScanRange(ss, amc, format, base, limit);
     if(res != ResOK) {
       *totalReturn = FALSE;
       return res;
@@ -1678,6 +1819,21 @@ static Res amcSegFix(Seg seg, ScanState ss, Ref *refIO)
     (*format->move)(ref, newRef);  /* .exposed.seg */
 
     EVENT1(AMCFixForward, newRef);
+
+    /* Queue the new copy to be scanned as soon as the scan method
+     * returns, so that the objects it refers to are copied next to
+     * it.  See <design/poolamc/#fix.depth-first>. */
+    if(amc->copySS == ss && amc->scanDepth < amc->copyDepth
+       && amc->copyCount < NELEMS(amc->copyQueue)
+       && SegRankSet(toSeg) != RankSetEMPTY)
+    {
+      amcCopyStruct *copy = &amc->copyQueue[amc->copyCount];
+      copy->seg = toSeg;
+      copy->base = newRef;
+      copy->limit = AddrAdd(newRef, length);
+      copy->depth = amc->scanDepth + 1;
+      ++amc->copyCount;
+    }
   } else {
     /* reference to broken heart (which should be snapped out -- */
     /* consider adding to (non-existent) snap-out cache here) */
@@ -1703,7 +1859,7 @@ static void amcSegReclaimNailed(Pool pool, Trace trace, Seg seg)
   Addr p, limit;
   Arena arena;
   Format format;
-  STATISTIC_DECL(Size bytesReclaimed = (Size)0)
+  Size bytesReclaimed = (Size)0;
   Count preservedInPlaceCount = (Count)0;
   Size preservedInPlaceSize = (Size)0;
   AMC amc = MustBeA(AMCZPool, pool);
@@ -1750,7 +1906,7 @@ static void amcSegReclaimNailed(Pool pool, Trace trace, Seg seg)
         /* Replace run of forwarding pointers and unreachable objects
          * with a padding object. */
         (*format->pad)(padBase, padLength);
-        STATISTIC(bytesReclaimed += padLength);
+        bytesReclaimed += padLength;
         padLength = 0;
       }
       padBase = q;
@@ -1767,7 +1923,7 @@ static void amcSegReclaimNailed(Pool pool, Trace trace, Seg seg)
     /* Replace final run of forwarding pointers and unreachable
      * objects with a padding object. */
     (*format->pad)(padBase, padLength);
-    STATISTIC(bytesReclaimed += padLength);
+    bytesReclaimed += padLength;
   }
   ShieldCover(arena, seg);
 
@@ -1778,8 +1934,8 @@ static void amcSegReclaimNailed(Pool pool, Trace trace, Seg seg)
     MustBeA(amcSeg, seg)->board = NULL;
   }
 
-  STATISTIC(AVER(bytesReclaimed <= SegSize(seg)));
-  STATISTIC(trace->reclaimSize += bytesReclaimed);
+  AVER(bytesReclaimed <= SegSize(seg));
+  trace->reclaimSize += bytesReclaimed;
   STATISTIC(trace->preservedInPlaceCount += preservedInPlaceCount);
   pgen = &amcSegGen(seg)->pgen;
   if (SegBuffer(&buffer, seg)) {
@@ -1821,9 +1977,9 @@ static void amcSegReclaim(Seg seg, Trace trace)
 
   EVENT3(AMCReclaim, gen, trace, seg);
 
-  /* This switching needs to be more complex for multiple traces. */
-  AVER_CRITICAL(TraceSetIsSingle(PoolArena(pool)->busyTraces));
-  if(amc->rampMode == RampCOLLECTING) {
+  /* Only a trace that condemned the ramp generation finishes the */
+  /* ramp collection, not another trace running alongside it. */
+  if(amc->rampMode == RampCOLLECTING && gen == amc->rampGen) {
     if(amc->rampCount > 0) {
       /* Entered ramp mode before previous one was cleaned up */
       amc->rampMode = RampBEGIN;
@@ -1841,7 +1997,7 @@ static void amcSegReclaim(Seg seg, Trace trace)
   /* segs should have been nailed anyway). */
   AVER(!SegHasBuffer(seg));
 
-  STATISTIC(trace->reclaimSize += SegSize(seg));
+  trace->reclaimSize += SegSize(seg);
 
   GenDescSurvived(gen->pgen.gen, trace, amcseg->forwarded[trace->ti], 0);
   PoolGenFree(&gen->pgen, seg, 0, SegSize(seg), 0, amcseg->deferred);
@@ -2017,7 +2173,7 @@ DEFINE_CLASS(Pool, AMCZPool, klass)
   klass->instClassStruct.describe = AMCDescribe;
   klass->instClassStruct.finish = AMCFinish;
   klass->size = sizeof(AMCStruct);
-  klass->attr |= AttrMOVINGGC;
+  klass->attr |= AttrMOVINGGC | AttrMULTITRACE;
   klass->varargs = AMCVarargs;
   klass->init = AMCZInit;
   klass->bufferFill = AMCBufferFill;
@@ -2129,6 +2285,14 @@ static Bool AMCCheck(AMC amc)
     CHECKD(amcGen, amc->afterRampGen);
   }
 
+  CHECKL(amc->fillSizeMax >= amc->extendBy);
+  CHECKL(amc->fillSizeMax == amc->extendBy
+         || amc->fillSizeMax < amc->largeSize);
+  CHECKL(amc->copyDepth <= AMC_COPY_DEPTH_MAX);
+  CHECKL(amc->scanDepth <= amc->copyDepth);
+  CHECKL(amc->copyCount <= NELEMS(amc->copyQueue));
+  CHECKL(amc->copyCount == 0 || amc->copySS != NULL);
+
   CHECKL(amc->rampMode >= RampOUTSIDE);
   CHECKL(amc->rampMode <= RampCOLLECTING);
 
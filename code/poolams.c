@@ -79,6 +79,8 @@ Bool AMSSegCheck(AMSSeg amsseg)
 
   CHECKL(BoolCheck(amsseg->marksChanged));
   CHECKL(BoolCheck(amsseg->ambiguousFixes));
+  CHECKL(amsseg->markStackCount <= AMS_MARK_STACK_LENGTH);
+  CHECKL(BoolCheck(amsseg->markStackOverflow));
   CHECKL(BoolCheck(amsseg->colourTablesInUse));
   CHECKD_NOSIG(BT, amsseg->nongreyTable);
   CHECKD_NOSIG(BT, amsseg->nonwhiteTable);
@@ -252,6 +254,8 @@ static Res AMSSegInit(Seg seg, Pool pool, Addr base, Size size, ArgList args)
   amsseg->oldGrains = (Count)0;
   amsseg->marksChanged = FALSE; /* <design/poolams/#marked.unused> */
   amsseg->ambiguousFixes = FALSE;
+  amsseg->markStackCount = 0;
+  amsseg->markStackOverflow = FALSE;
 
   res = amsCreateTables(ams, &amsseg->allocTable,
                         &amsseg->nongreyTable, &amsseg->nonwhiteTable,
@@ -482,6 +486,8 @@ static Res AMSSegSplit(Seg seg, Seg segHi,
   amssegHi->oldGrains = (Count)0;
   amssegHi->marksChanged = FALSE; /* <design/poolams/#marked.unused> */
   amssegHi->ambiguousFixes = FALSE;
+  amssegHi->markStackCount = 0;
+  amssegHi->markStackOverflow = FALSE;
 
   /* start off using firstFree, see <design/poolams/#no-bit> */
   amssegHi->allocTableInUse = FALSE;
@@ -1161,6 +1167,8 @@ static Res amsSegWhiten(Seg seg, Trace trace)
   amsseg->newGrains = 0;
   amsseg->marksChanged = FALSE; /* <design/poolams/#marked.condemn> */
   amsseg->ambiguousFixes = FALSE;
+  amsseg->markStackCount = 0;
+  amsseg->markStackOverflow = FALSE;
 
   if (amsseg->oldGrains > 0) {
     GenDescCondemned(pgen->gen, trace,
@@ -1303,6 +1311,12 @@ static Res amsScanObject(Seg seg, Index i, Addr p, Addr next, void *clos)
   format = AMSPool(amsseg->ams)->format;
   AVERT(Format, format);
 
+  /* References on clean cards can't be white, so there's no need to
+     scan them.  <design/write-barrier/#card.scan> */
+  if (closure->scanAllObjects && closure->ss->cardsOnly
+      && !CardIsDirty(closure->ss->arena, p, next))
+    return ResOK;
+
   /* @@@@ This isn't quite right for multiple traces. */
   if (closure->scanAllObjects || AMS_IS_GREY(seg, i)) {
     res = FormatScan(format,
@@ -1311,6 +1325,7 @@ static Res amsScanObject(Seg seg, Index i, Addr p, Addr next, void *clos)
                      AddrAdd(next, format->headerSize));
     if (res != ResOK)
       return res;
+    STATISTIC(++closure->ss->objectScanCount);
     if (!closure->scanAllObjects) {
       Index j = PoolIndexOfAddr(SegBase(seg), SegPool(seg), next);
       AVER(!AMS_IS_INVALID_COLOUR(seg, i));
@@ -1324,6 +1339,46 @@ static Res amsScanObject(Seg seg, Index i, Addr p, Addr next, void *clos)
 }
 
 
+/* amsSegScanGrey -- scan a grey object and turn it black
+ *
+ * Scans the grey object whose first grain is i, and returns the index
+ * of the grain after the object in *nextReturn.
+ */
+static Res amsSegScanGrey(Index *nextReturn, Seg seg, ScanState ss, Index i)
+{
+  Res res;
+  AMSSeg amsseg = Seg2AMSSeg(seg);
+  Pool pool = SegPool(seg);
+  Format format = pool->format;
+  Addr p, next, clientP, clientNext;
+  Index j;
+
+  AVER_CRITICAL(!AMS_IS_INVALID_COLOUR(seg, i));
+  p = PoolAddrOfIndex(SegBase(seg), pool, i);
+  clientP = AddrAdd(p, format->headerSize);
+  if (format->skip != NULL) {
+    clientNext = (*format->skip)(clientP);
+    next = AddrSub(clientNext, format->headerSize);
+  } else {
+    clientNext = AddrAdd(clientP, PoolAlignment(pool));
+    next = AddrAdd(p, PoolAlignment(pool));
+  }
+  j = PoolIndexOfAddr(SegBase(seg), pool, next);
+  *nextReturn = j;
+  res = FormatScan(format, ss, clientP, clientNext);
+  if (res != ResOK)
+    return res;
+  STATISTIC(++ss->objectScanCount);
+  /* Check that there haven't been any ambiguous fixes during the */
+  /* scan, because AMSFindGrey won't work otherwise. */
+  AVER_CRITICAL(!amsseg->ambiguousFixes);
+  AMS_GREY_BLACKEN(seg, i);
+  if (i+1 < j)
+    AMS_RANGE_WHITE_BLACKEN(seg, i+1, j);
+  return ResOK;
+}
+
+
 /* amsSegScan -- the segment scanning method
  *
  * See <design/poolams/#scan>
@@ -1333,11 +1388,8 @@ static Res amsSegScan(Bool *totalReturn, Seg seg, ScanState ss)
   Res res;
   AMSSeg amsseg = MustBeA(AMSSeg, seg);
   Pool pool = SegPool(seg);
-  AMS ams = MustBeA(AMSPool, pool);
   Arena arena = PoolArena(pool);
   struct amsScanClosureStruct closureStruct;
-  Format format;
-  Align alignment;
 
   AVER(totalReturn != NULL);
   AVERT(ScanState, ss);
@@ -1361,51 +1413,58 @@ static Res amsSegScan(Bool *totalReturn, Seg seg, ScanState ss)
   } else {
     AVER(amsseg->marksChanged); /* something must have changed */
     AVER(amsseg->colourTablesInUse);
-    format = pool->format;
-    AVERT(Format, format);
-    alignment = PoolAlignment(AMSPool(ams));
     do { /* <design/poolams/#scan.iter> */
       amsseg->marksChanged = FALSE; /* <design/poolams/#marked.scan> */
       /* <design/poolams/#ambiguous.middle> */
       if (amsseg->ambiguousFixes) {
+        /* The whole segment is about to be scanned, so the stack isn't
+           needed: <design/poolams/#scan.stack.full>. */
+        amsseg->markStackCount = 0;
+        amsseg->markStackOverflow = FALSE;
         res = semSegIterate(seg, amsScanObject, &closureStruct);
         if (res != ResOK) {
           /* <design/poolams/#marked.scan.fail> */
           amsseg->marksChanged = TRUE;
+          amsseg->markStackOverflow = TRUE;
           *totalReturn = FALSE;
           return res;
         }
-      } else {
+      } else if (amsseg->markStackOverflow) {
         Index i, j = 0;
-        Addr p, next;
 
+        /* <design/poolams/#scan.stack.full> */
+        amsseg->markStackCount = 0;
+        amsseg->markStackOverflow = FALSE;
         while(j < amsseg->grains
               && AMSFindGrey(&i, &j, seg, j, amsseg->grains)) {
-          Addr clientP, clientNext;
-          AVER(!AMS_IS_INVALID_COLOUR(seg, i));
-          p = PoolAddrOfIndex(SegBase(seg), pool, i);
-          clientP = AddrAdd(p, format->headerSize);
-          if (format->skip != NULL) {
-            clientNext = (*format->skip)(clientP);
-            next = AddrSub(clientNext, format->headerSize);
-          } else {
-            clientNext = AddrAdd(clientP, alignment);
-            next = AddrAdd(p, alignment);
+          res = amsSegScanGrey(&j, seg, ss, i);
+          if (res != ResOK) {
+            /* <design/poolams/#marked.scan.fail> */
+            amsseg->marksChanged = TRUE;
+            amsseg->markStackOverflow = TRUE;
+            *totalReturn = FALSE;
+            return res;
           }
-          j = PoolIndexOfAddr(SegBase(seg), pool, next);
-          res = FormatScan(format, ss, clientP, clientNext);
+        }
+      } else {
+        Index i, j;
+
+        /* <design/poolams/#scan.stack.pop> */
+        while (amsseg->markStackCount > 0 && !amsseg->markStackOverflow) {
+          --amsseg->markStackCount;
+          i = amsseg->markStack[amsseg->markStackCount];
+          AVER_CRITICAL(i < amsseg->grains);
+          /* <design/poolams/#scan.stack.stale> */
+          if (!AMS_IS_GREY(seg, i))
+            continue;
+          res = amsSegScanGrey(&j, seg, ss, i);
           if (res != ResOK) {
             /* <design/poolams/#marked.scan.fail> */
             amsseg->marksChanged = TRUE;
+            amsseg->markStackOverflow = TRUE;
             *totalReturn = FALSE;
             return res;
           }
-          /* Check that there haven't been any ambiguous fixes during the */
-          /* scan, because AMSFindGrey won't work otherwise. */
-          AVER_CRITICAL(!amsseg->ambiguousFixes);
-          AMS_GREY_BLACKEN(seg, i);
-          if (i+1 < j)
-            AMS_RANGE_WHITE_BLACKEN(seg, i+1, j);
         }
       }
     } while(amsseg->marksChanged);
@@ -1504,6 +1563,13 @@ static Res amsSegFix(Seg seg, ScanState ss, Ref *refIO)
           SegSetGrey(seg, TraceSetUnion(SegGrey(seg), ss->traces));
           /* mark it for scanning - <design/poolams/#marked.fix> */
           amsseg->marksChanged = TRUE;
+          /* <design/poolams/#scan.stack.push> */
+          if (amsseg->markStackCount < AMS_MARK_STACK_LENGTH) {
+            amsseg->markStack[amsseg->markStackCount] = i;
+            ++amsseg->markStackCount;
+          } else {
+            amsseg->markStackOverflow = TRUE;
+          }
         }
       }
     }
@@ -1548,6 +1614,8 @@ static void amsSegBlacken(Seg seg, TraceSet traceSet)
     AVERT(AMSSeg, amsseg);
     AVER(amsseg->marksChanged); /* there must be something grey */
     amsseg->marksChanged = FALSE;
+    amsseg->markStackCount = 0;
+    amsseg->markStackOverflow = FALSE;
     res = semSegIterate(seg, amsSegBlackenObject, UNUSED_POINTER);
     AVER(res == ResOK);
   }
@@ -1608,7 +1676,7 @@ static void amsSegReclaim(Seg seg, Trace trace)
   amsseg->oldGrains -= reclaimedGrains;
   amsseg->freeGrains += reclaimedGrains;
   PoolGenAccountForReclaim(pgen, PoolGrainsSize(pool, reclaimedGrains), FALSE);
-  STATISTIC(trace->reclaimSize += PoolGrainsSize(pool, reclaimedGrains));
+  trace->reclaimSize += PoolGrainsSize(pool, reclaimedGrains);
   /* preservedInPlaceCount is updated on fix */
   preservedInPlaceSize = PoolGrainsSize(pool, amsseg->oldGrains);
   GenDescSurvived(pgen->gen, trace, 0, preservedInPlaceSize);
@@ -66,6 +66,10 @@ typedef struct AMSSegStruct {
   /* <design/poolams/#colour.single> */
   Bool marksChanged;     /* seg has been marked since last scan */
   Bool ambiguousFixes;   /* seg has been ambiguously marked since last scan */
+  /* <design/poolams/#scan.stack.impl> */
+  Count markStackCount;  /* number of grey objects on markStack */
+  Bool markStackOverflow;/* some grey objects are not on markStack */
+  Index markStack[AMS_MARK_STACK_LENGTH]; /* grains of grey objects */
   Bool colourTablesInUse;/* the colour tables are in use */
   BT nonwhiteTable;      /* set if grain not white */
   BT nongreyTable;       /* set if not first grain of grey object */
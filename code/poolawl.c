@@ -343,10 +343,20 @@ static Bool awlSegCanTrySingleAccess(Arena arena, Seg seg, Addr addr)
     return FALSE;
   }
 
-  /* The trace is already in the weak band, so we can scan the whole
+  /* The traces are already in the weak band, so we can scan the whole
      segment without retention anyway.  Go for it. */
-  if (TraceRankForAccess(arena, seg) == RankWEAK)
-    return FALSE;
+  {
+    TraceSet traces = TraceSetInter(SegGrey(seg), arena->flippedTraces);
+    Bool allWeak = TRUE;
+    TraceId ti;
+    Trace trace;
+    TRACE_SET_ITER(ti, trace, traces, arena)
+      if (TraceRankForAccess(trace, seg) != RankWEAK)
+        allWeak = FALSE;
+    TRACE_SET_ITER_END(ti, trace, traces, arena);
+    if (allWeak)
+      return FALSE;
+  }
 
   awlseg = MustBeA(AWLSeg, seg);
   awl = MustBeA(AWLPool, SegPool(seg));
@@ -1086,7 +1096,7 @@ static void awlSegReclaim(Seg seg, Trace trace)
   awlseg->freeGrains += reclaimedGrains;
   PoolGenAccountForReclaim(pgen, PoolGrainsSize(pool, reclaimedGrains), FALSE);
 
-  STATISTIC(trace->reclaimSize += PoolGrainsSize(pool, reclaimedGrains));
+  trace->reclaimSize += PoolGrainsSize(pool, reclaimedGrains);
   STATISTIC(trace->preservedInPlaceCount += preservedInPlaceCount);
   GenDescSurvived(pgen->gen, trace, 0, preservedInPlaceSize);
   SegSetWhite(seg, TraceSetDel(SegWhite(seg), trace));
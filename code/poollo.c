@@ -331,7 +331,7 @@ static void loSegReclaim(Seg seg, Trace trace)
   loseg->freeGrains += reclaimedGrains;
   PoolGenAccountForReclaim(pgen, PoolGrainsSize(pool, reclaimedGrains), FALSE);
 
-  STATISTIC(trace->reclaimSize += PoolGrainsSize(pool, reclaimedGrains));
+  trace->reclaimSize += PoolGrainsSize(pool, reclaimedGrains);
   STATISTIC(trace->preservedInPlaceCount += preservedInPlaceCount);
   GenDescSurvived(pgen->gen, trace, 0, preservedInPlaceSize);
   SegSetWhite(seg, TraceSetDel(SegWhite(seg), trace));
@@ -224,20 +224,43 @@ void MFSExtend(Pool pool, Addr base, Size size)
  *  arena.
  */
 
-static Res MFSAlloc(Addr *pReturn, Pool pool, Size size)
+static Bool MFSTryAlloc(Addr *pReturn, Pool pool, Size size)
 {
   MFS mfs = MustBeA(MFSPool, pool);
   Header f;
-  Res res;
 
   AVER(pReturn != NULL);
   AVER(size == mfs->unroundedUnitSize);
 
   f = mfs->freeList;
 
+  /* If the free list is empty then the pool needs extending. */
+
+  if (f == NULL)
+    return FALSE;
+
+  /* Detach the first free unit from the free list and return its address. */
+
+  mfs->freeList = f->next;
+  AVER(mfs->free >= mfs->unitSize);
+  mfs->free -= mfs->unitSize;
+
+  *pReturn = (Addr)f;
+  return TRUE;
+}
+
+static Res MFSAlloc(Addr *pReturn, Pool pool, Size size)
+{
+  MFS mfs = MustBeA(MFSPool, pool);
+  Bool b;
+  Res res;
+
+  AVER(pReturn != NULL);
+  AVER(size == mfs->unroundedUnitSize);
+
   /* If the free list is empty then extend the pool with a new region. */
 
-  if(f == NULL)
+  if(mfs->freeList == NULL)
   {
     Addr base;
 
@@ -251,20 +274,10 @@ static Res MFSAlloc(Addr *pReturn, Pool pool, Size size)
       return res;
 
     MFSExtend(pool, base, mfs->extendBy);
-
-    /* The first unit in the region is now the head of the new free list. */
-    f = mfs->freeList;
   }
 
-  AVER(f != NULL);
-
-  /* Detach the first free unit from the free list and return its address. */
-
-  mfs->freeList = f->next;
-  AVER(mfs->free >= mfs->unitSize);
-  mfs->free -= mfs->unitSize;
-
-  *pReturn = (Addr)f;
+  b = MFSTryAlloc(pReturn, pool, size);
+  AVER(b);
   return ResOK;
 }
 
@@ -290,6 +303,13 @@ static void MFSFree(Pool pool, Addr old, Size size)
   mfs->free += mfs->unitSize;
 }
 
+static Bool MFSTryFree(Pool pool, Addr old, Size size)
+{
+  /* Freeing never returns memory to the arena. */
+  MFSFree(pool, old, size);
+  return TRUE;
+}
+
 
 /* MFSTotalSize -- total memory allocated from the arena */
 
@@ -343,10 +363,13 @@ DEFINE_CLASS(Pool, MFSPool, klass)
   klass->instClassStruct.describe = MFSDescribe;
   klass->instClassStruct.finish = MFSFinish;
   klass->size = sizeof(MFSStruct);
+  klass->attr |= AttrPOOLLOCK;
   klass->varargs = MFSVarargs;
   klass->init = MFSInit;
   klass->alloc = MFSAlloc;
   klass->free = MFSFree;
+  klass->tryAlloc = MFSTryAlloc;
+  klass->tryFree = MFSTryFree;
   klass->totalSize = MFSTotalSize;
   klass->freeSize = MFSFreeSize;  
   AVERT(PoolClass, klass);
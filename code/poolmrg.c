@@ -490,6 +490,8 @@ static MessageClassStruct MRGMessageClassStruct = {
   MessageNoGCLiveSize,         /* GCLiveSize */   
   MessageNoGCCondemnedSize,    /* GCCondemnedSize */
   MessageNoGCNotCondemnedSize, /* GCNotCondemnedSize */
+  MessageNoGCPauseTime,        /* GCPauseTime */
+  MessageNoGCPauseMax,         /* GCPauseMax */
   MessageNoGCStartWhy,         /* GCStartWhy */
   MessageClassSig              /* <design/message/#class.sig.double> */
 };
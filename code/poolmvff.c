@@ -92,6 +92,34 @@ typedef MVFFDebugStruct *MVFFDebug;
 #define MVFFDebug2MVFF(mvffd) (&((mvffd)->mvffStruct))
 
 
+/* mvffFreeLimit -- free memory above which MVFFReduce returns some
+ *
+ * MVFFReduce tries to return memory when the amount of free memory
+ * reaches a threshold fraction of the total memory.
+ */
+static Size mvffFreeLimit(MVFF mvff)
+{
+  return (Size)(LandSize(MVFFTotalLand(mvff)) * mvff->spare);
+}
+
+
+/* mvffLandsReady -- can the free land change without the arena?
+ *
+ * Inserting a range into a CBS, or deleting one from it, needs at
+ * most one new block from the block pool.  But the free land first
+ * flushes its secondary into its primary (see
+ * <design/failover/#impl.assume.flush>), which may need many.  So the
+ * free land can change without the block pool extending itself from
+ * the arena if the secondary is empty and the block pool has a free
+ * block.  See <design/poolmvff/#lock>.
+ */
+static Bool mvffLandsReady(MVFF mvff)
+{
+  return LandSize(MVFFFreeSecondary(mvff)) == 0
+    && PoolFreeSize(MVFFBlockPool(mvff)) > 0;
+}
+
+
 /* MVFFReduce -- return memory to the arena
  *
  * This is usually called immediately after inserting a range into the
@@ -118,7 +146,7 @@ static void MVFFReduce(MVFF mvff)
   /* Try to return memory when the amount of free memory exceeds a
      threshold fraction of the total memory. */
 
-  freeLimit = (Size)(LandSize(MVFFTotalLand(mvff)) * mvff->spare);
+  freeLimit = mvffFreeLimit(mvff);
   freeSize = LandSize(MVFFFreeLand(mvff));
   if (freeSize < freeLimit)
     return;
@@ -359,6 +387,75 @@ static void MVFFFree(Pool pool, Addr old, Size size)
 }
 
 
+/* MVFFTryAlloc -- allocate a block holding only the pool lock
+ *
+ * This succeeds if there's a free block that can be allocated without
+ * extending the pool or the block pool.  See <design/poolmvff/#lock>.
+ */
+
+static Bool MVFFTryAlloc(Addr *aReturn, Pool pool, Size size)
+{
+  MVFF mvff;
+  RangeStruct range, oldRange;
+  LandFindMethod findMethod;
+  FindDelete findDelete;
+
+  AVER_CRITICAL(aReturn != NULL);
+  AVERT_CRITICAL(Pool, pool);
+  mvff = PoolMVFF(pool);
+  AVERT_CRITICAL(MVFF, mvff);
+  AVER_CRITICAL(size > 0);
+
+  if (!mvffLandsReady(mvff))
+    return FALSE;
+
+  size = SizeAlignUp(size, PoolAlignment(pool));
+  findMethod = mvff->firstFit ? LandFindFirst : LandFindLast;
+  findDelete = mvff->slotHigh ? FindDeleteHIGH : FindDeleteLOW;
+
+  if (!(*findMethod)(&range, &oldRange, MVFFFreeLand(mvff), size,
+                     findDelete))
+    return FALSE;
+
+  AVER_CRITICAL(RangeSize(&range) == size);
+  *aReturn = RangeBase(&range);
+  return TRUE;
+}
+
+
+/* MVFFTryFree -- free a block holding only the pool lock
+ *
+ * This succeeds unless freeing the block would need memory for the
+ * block pool or would make MVFFReduce return memory to the arena.
+ * See <design/poolmvff/#lock>.
+ */
+
+static Bool MVFFTryFree(Pool pool, Addr old, Size size)
+{
+  Res res;
+  RangeStruct range, coalescedRange;
+  MVFF mvff;
+
+  AVERT_CRITICAL(Pool, pool);
+  mvff = PoolMVFF(pool);
+  AVERT_CRITICAL(MVFF, mvff);
+
+  AVER_CRITICAL(old != (Addr)0);
+  AVER_CRITICAL(AddrIsAligned(old, PoolAlignment(pool)));
+  AVER_CRITICAL(size > 0);
+
+  RangeInitSize(&range, old, SizeAlignUp(size, PoolAlignment(pool)));
+  if (!mvffLandsReady(mvff)
+      || LandSize(MVFFFreeLand(mvff)) + RangeSize(&range)
+         >= mvffFreeLimit(mvff))
+    return FALSE;
+
+  res = LandInsert(&coalescedRange, MVFFFreeLand(mvff), &range);
+  AVER_CRITICAL(res == ResOK);
+  return TRUE;
+}
+
+
 /* MVFFBufferFill -- Fill the buffer
  *
  * Fill it with the largest block we can find. This is worst-fit
@@ -734,10 +831,13 @@ DEFINE_CLASS(Pool, MVFFPool, klass)
   klass->instClassStruct.describe = MVFFDescribe;
   klass->instClassStruct.finish = MVFFFinish;
   klass->size = sizeof(MVFFStruct);
+  klass->attr |= AttrPOOLLOCK;
   klass->varargs = MVFFVarargs;
   klass->init = MVFFInit;
   klass->alloc = MVFFAlloc;
   klass->free = MVFFFree;
+  klass->tryAlloc = MVFFTryAlloc;
+  klass->tryFree = MVFFTryFree;
   klass->bufferFill = MVFFBufferFill;
   klass->bufferEmpty = MVFFBufferEmpty;
   klass->totalSize = MVFFTotalSize;
@@ -759,7 +859,11 @@ DEFINE_CLASS(Pool, MVFFDebugPool, klass)
   INHERIT_CLASS(klass, MVFFDebugPool, MVFFPool);
   PoolClassMixInDebug(klass);
   klass->size = sizeof(MVFFDebugStruct);
+  /* Debugging allocation always takes the arena lock. */
+  klass->attr &= ~AttrPOOLLOCK;
   klass->varargs = MVFFDebugVarargs;
+  klass->tryAlloc = PoolTrivTryAlloc;
+  klass->tryFree = PoolTrivTryFree;
   klass->debugMixin = MVFFDebugMixin;
   AVERT(PoolClass, klass);
 }
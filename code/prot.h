@@ -25,6 +25,14 @@ extern void ProtSet(Addr base, Addr limit, AccessSet mode);
 extern void ProtSync(Arena arena);
 
 
+/* Dirty Page Tracking -- see <design/prot/#dirty> */
+
+extern Bool ProtDirtyStart(void);
+extern void ProtDirtyStop(void);
+extern Bool ProtDirtyTest(Addr base, Addr limit);
+extern void ProtDirtyClear(void);
+
+
 #endif /* prot_h */
 
 
@@ -0,0 +1,231 @@
+/* protsdli.c: SOFT-DIRTY PAGE TRACKING FOR LINUX
+ *
+ * $Id$
+ * Copyright (c) 2016 Ravenbrook Limited.  See end of file for license.
+ *
+ * .purpose: An arena created with MPS_KEY_DIRTY_TRACKING keeps its
+ * write barrier using the kernel's soft-dirty bits rather than by
+ * protecting segments and handling faults.  This module is the
+ * interface to the kernel.  See <design/prot/#dirty>.
+ *
+ *
+ * SOURCES
+ *
+ * .source.soft-dirty: "Soft-Dirty PTEs", Linux kernel documentation,
+ * Documentation/admin-guide/mm/soft-dirty.rst.
+ *
+ * .source.pagemap: "Examining Process Page Tables", Linux kernel
+ * documentation, Documentation/admin-guide/mm/pagemap.rst.
+ *
+ *
+ * ASSUMPTIONS
+ *
+ * .assume.process: Clearing the soft-dirty bits is process-wide, so
+ * only one arena may use them at a time (see .claim), and the client
+ * program must not write to /proc/self/clear_refs itself.
+ *
+ * .assume.probe: If a write to a freshly cleared page sets its
+ * soft-dirty bit, the kernel supports soft-dirty tracking.  Kernels
+ * built without CONFIG_MEM_SOFT_DIRTY always report the bit as zero.
+ */
+
+#include "mpm.h"
+
+#if !defined(MPS_OS_LI)
+#error "protsdli.c is specific to MPS_OS_LI"
+#endif
+
+#include "vm.h"
+
+#include <fcntl.h> /* open */
+#include <stdint.h> /* uint64_t */
+#include <sys/mman.h> /* mmap, munmap */
+#include <unistd.h> /* close, pread, write */
+
+SRCID(protsdli, "$Id$");
+
+
+/* The soft-dirty flag in a pagemap entry <.source.pagemap>. */
+#define PAGEMAP_SOFT_DIRTY ((uint64_t)1 << 55)
+
+/* Number of pagemap entries read at a time by ProtDirtyTest. */
+#define PAGEMAP_BATCH 64
+
+static Bool protDirtyClaimed = FALSE;   /* .claim */
+static int protPagemapFd = -1;          /* /proc/self/pagemap */
+static int protClearRefsFd = -1;        /* /proc/self/clear_refs */
+
+
+/* protDirtyEntry -- read the pagemap entry for the page at addr */
+
+static Bool protDirtyEntry(uint64_t *entryReturn, Addr addr)
+{
+  off_t offset = (off_t)((Word)addr / PageSize() * sizeof(uint64_t));
+  return pread(protPagemapFd, entryReturn, sizeof *entryReturn, offset)
+    == (ssize_t)sizeof *entryReturn;
+}
+
+
+/* protDirtyProbe -- check that the kernel tracks soft-dirty pages
+ *
+ * See .assume.probe.
+ */
+
+static Bool protDirtyProbe(void)
+{
+  void *p;
+  volatile char *page;
+  uint64_t before, after;
+  Bool ok;
+
+  p = mmap(NULL, PageSize(), PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED)
+    return FALSE;
+  page = p;
+  page[0] = 1;
+  ProtDirtyClear();
+  ok = protDirtyEntry(&before, (Addr)p);
+  page[0] = 2;
+  ok = ok && protDirtyEntry(&after, (Addr)p)
+    && (before & PAGEMAP_SOFT_DIRTY) == 0
+    && (after & PAGEMAP_SOFT_DIRTY) != 0;
+  (void)munmap(p, PageSize());
+  return ok;
+}
+
+
+/* ProtDirtyStart -- start dirty page tracking for an arena
+ *
+ * .claim: Returns FALSE if the kernel doesn't support soft-dirty
+ * tracking, or if another arena is already using it, in which case
+ * the arena uses protection instead.
+ */
+
+Bool ProtDirtyStart(void)
+{
+  Bool started = FALSE;
+
+  LockClaimGlobal();
+  if (!protDirtyClaimed) {
+    protPagemapFd = open("/proc/self/pagemap", O_RDONLY);
+    protClearRefsFd = open("/proc/self/clear_refs", O_WRONLY);
+    if (protPagemapFd >= 0 && protClearRefsFd >= 0 && protDirtyProbe()) {
+      protDirtyClaimed = TRUE;
+      started = TRUE;
+    } else {
+      if (protPagemapFd >= 0)
+        (void)close(protPagemapFd);
+      if (protClearRefsFd >= 0)
+        (void)close(protClearRefsFd);
+      protPagemapFd = protClearRefsFd = -1;
+    }
+  }
+  LockReleaseGlobal();
+  return started;
+}
+
+
+/* ProtDirtyStop -- stop dirty page tracking */
+
+void ProtDirtyStop(void)
+{
+  LockClaimGlobal();
+  AVER(protDirtyClaimed);
+  (void)close(protPagemapFd);
+  (void)close(protClearRefsFd);
+  protPagemapFd = protClearRefsFd = -1;
+  protDirtyClaimed = FALSE;
+  LockReleaseGlobal();
+}
+
+
+/* ProtDirtyTest -- has any page in [base, limit) been written?
+ *
+ * Returns TRUE if any page has been written since the last call to
+ * ProtDirtyClear, or if the pagemap can't be read.
+ */
+
+Bool ProtDirtyTest(Addr base, Addr limit)
+{
+  uint64_t entry[PAGEMAP_BATCH];
+  Size pageSize = PageSize();
+  Count pages, i, n;
+  off_t offset;
+  ssize_t size;
+
+  AVER(base < limit);
+
+  base = AddrAlignDown(base, pageSize);
+  limit = AddrAlignUp(limit, pageSize);
+  pages = AddrOffset(base, limit) / pageSize;
+  offset = (off_t)((Word)base / pageSize * sizeof entry[0]);
+  while (pages > 0) {
+    n = pages < PAGEMAP_BATCH ? pages : PAGEMAP_BATCH;
+    size = pread(protPagemapFd, entry, n * sizeof entry[0], offset);
+    if (size != (ssize_t)(n * sizeof entry[0]))
+      return TRUE;
+    for (i = 0; i < n; ++i)
+      if ((entry[i] & PAGEMAP_SOFT_DIRTY) != 0)
+        return TRUE;
+    pages -= n;
+    offset += (off_t)(n * sizeof entry[0]);
+  }
+  return FALSE;
+}
+
+
+/* ProtDirtyClear -- clear the soft-dirty bits of the whole process
+ *
+ * If this fails, the bits stay set, which is safe: it just makes
+ * segments look written.
+ */
+
+void ProtDirtyClear(void)
+{
+  static const char clearSoftDirty[] = "4";
+  ssize_t size = write(protClearRefsFd, clearSoftDirty, 1);
+  UNUSED(size);
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2016 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
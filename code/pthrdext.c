@@ -50,7 +50,10 @@ static Bool pthreadextModuleInitialized = FALSE;
  * See <design/pthreadext/#impl.global>.*
  */
 
-static PThreadext suspendingVictim = NULL;  /* current victim */
+static PThreadext volatile suspendingBatch = NULL; /* current batch */
+static Count suspendingPending = 0;         /* signals not acknowledged */
+static Bool suspendingActive = FALSE;       /* batch in progress? */
+static pthread_t suspendingOwner;           /* thread running batch */
 static RingStruct suspendedRing;            /* PThreadext suspend ring */
 
 
@@ -74,17 +77,23 @@ static void suspendSignalHandler(int sig,
     sigset_t signal_set;
     ucontext_t ucontext;
     MutatorContextStruct context;
+    PThreadext victim;
+    pthread_t self = pthread_self();
 
     AVER(sig == PTHREADEXT_SIGSUSPEND);
     UNUSED(sig);
     UNUSED(info);
 
-    AVER(suspendingVictim != NULL);
+    /* Find this thread in the batch <design/pthreadext/#impl.global.batch> */
+    for (victim = suspendingBatch; victim != NULL; victim = victim->nextRequest)
+      if (pthread_equal(victim->id, self))
+        break;
+    AVER(victim != NULL);
     /* copy the ucontext structure so we definitely have it on our stack,
      * not (e.g.) shared with other threads. */
     ucontext = *(ucontext_t *)uap;
     MutatorContextInitThread(&context, &ucontext);
-    suspendingVictim->context = &context;
+    victim->context = &context;
     /* Block all signals except PTHREADEXT_SIGRESUME while suspended. */
     sigfillset(&signal_set);
     sigdelset(&signal_set, PTHREADEXT_SIGRESUME);
@@ -162,30 +171,39 @@ static void PThreadextModuleInit(void)
 extern Bool PThreadextCheck(PThreadext pthreadext)
 {
   int status;
+  Bool locked;
 
-  status = pthread_mutex_lock(&pthreadextMut);
-  AVER(status == 0);
+  /* The thread running a batch already has the mutex. */
+  locked = !(suspendingActive && pthread_equal(suspendingOwner,
+                                               pthread_self()));
+  if (locked) {
+    status = pthread_mutex_lock(&pthreadextMut);
+    AVER(status == 0);
+  }
 
   CHECKS(PThreadext, pthreadext);
   /* can't check ID */
   CHECKD_NOSIG(Ring, &pthreadext->threadRing);
   CHECKD_NOSIG(Ring, &pthreadext->idRing);
-  if (pthreadext->context == NULL) {
+  if (RingIsSingle(&pthreadext->threadRing)) {
     /* not suspended */
-    CHECKL(RingIsSingle(&pthreadext->threadRing));
+    CHECKL(pthreadext->context == NULL);
     CHECKL(RingIsSingle(&pthreadext->idRing));
   } else {
-    /* suspended */
+    /* suspended, or being suspended (in which case the contexts may
+       not have arrived yet) */
     Ring node, next;
-    CHECKL(!RingIsSingle(&pthreadext->threadRing));
     RING_FOR(node, &pthreadext->idRing, next) {
       PThreadext pt = RING_ELT(PThreadext, idRing, node);
       CHECKL(pt->id == pthreadext->id);
-      CHECKL(pt->context == pthreadext->context);
+      CHECKL(pt->context == NULL || pthreadext->context == NULL
+             || pt->context == pthreadext->context);
     }
   }
-  status = pthread_mutex_unlock(&pthreadextMut);
-  AVER(status == 0);
+  if (locked) {
+    status = pthread_mutex_unlock(&pthreadextMut);
+    AVER(status == 0);
+  }
 
   return TRUE;
 }
@@ -205,6 +223,8 @@ extern void PThreadextInit(PThreadext pthreadext, pthread_t id)
   pthreadext->context = NULL;
   RingInit(&pthreadext->threadRing);
   RingInit(&pthreadext->idRing);
+  pthreadext->nextRequest = NULL;
+  pthreadext->contextReturn = NULL;
   pthreadext->sig = PThreadextSig;
   AVERT(PThreadext, pthreadext);
 }
@@ -224,6 +244,7 @@ extern void PThreadextFinish(PThreadext pthreadext)
   status = pthread_mutex_lock(&pthreadextMut);
   AVER(status == 0);
 
+  AVER(pthreadext->contextReturn == NULL); /* not in a batch */
   if(pthreadext->context == NULL) {
     AVER(RingIsSingle(&pthreadext->threadRing));
     AVER(RingIsSingle(&pthreadext->idRing));
@@ -244,25 +265,47 @@ extern void PThreadextFinish(PThreadext pthreadext)
 }
 
 
-/* PThreadextSuspend -- suspend a thread
+/* PThreadextSuspendBegin -- start a batch of suspensions
  *
- * See <design/pthreadext/#impl.suspend>
+ * The mutex is held for the whole batch.  See
+ * <design/pthreadext/#impl.static.mutex>.
  */
 
-Res PThreadextSuspend(PThreadext target, MutatorContext *contextReturn)
+void PThreadextSuspendBegin(void)
+{
+  int status = pthread_mutex_lock(&pthreadextMut);
+  AVER(status == 0);
+  AVER(!suspendingActive);
+  AVER(suspendingBatch == NULL);
+  AVER(suspendingPending == 0);
+  suspendingOwner = pthread_self();
+  suspendingActive = TRUE;
+}
+
+
+/* PThreadextSuspendRequest -- ask a thread to suspend
+ *
+ * See <design/pthreadext/#impl.suspend>.  Called between
+ * PThreadextSuspendBegin and PThreadextSuspendEnd, with the mutex
+ * held.
+ */
+
+Res PThreadextSuspendRequest(PThreadext target, MutatorContext *contextReturn)
 {
   Ring node, next;
-  Res res;
   int status;
 
   AVERT(PThreadext, target);
+  AVER(suspendingActive);
   AVER(contextReturn != NULL);
   AVER(target->context == NULL); /* multiple suspends illegal */
+  AVER(target->contextReturn == NULL);
 
-  /* Serialize access to suspend, makes life easier */
-  status = pthread_mutex_lock(&pthreadextMut);
-  AVER(status == 0);
-  AVER(suspendingVictim == NULL);
+  /* Add the target to the batch before signalling, so that the
+     signal handler can find it. */
+  target->nextRequest = suspendingBatch;
+  target->contextReturn = contextReturn;
+  suspendingBatch = target;
 
   /* Threads are added to the suspended ring on suspension */
   /* If the same thread Id has already been suspended, then */
@@ -271,37 +314,83 @@ Res PThreadextSuspend(PThreadext target, MutatorContext *contextReturn)
     PThreadext alreadySusp = RING_ELT(PThreadext, threadRing, node);
     if (alreadySusp->id == target->id) {
       RingAppend(&alreadySusp->idRing, &target->idRing);
-      target->context = alreadySusp->context;
       goto noteSuspended;
     }
   }
 
   /* Ok, we really need to suspend this thread. */
-  suspendingVictim = target;
   status = pthread_kill(target->id, PTHREADEXT_SIGSUSPEND);
   if (status != 0) {
-    res = ResFAIL;
-    goto unlock;
-  }
-
-  /* Wait for the victim to acknowledge suspension. */
-  while (sem_wait(&pthreadextSem) != 0) {
-    if (errno != EINTR) {
-      res = ResFAIL;
-      goto unlock;
-    }
+    suspendingBatch = target->nextRequest;
+    target->nextRequest = NULL;
+    target->contextReturn = NULL;
+    return ResFAIL;
   }
+  ++suspendingPending;
 
 noteSuspended:
-  AVER(target->context != NULL);
   RingAppend(&suspendedRing, &target->threadRing);
-  *contextReturn = target->context;
-  res = ResOK;
+  return ResOK;
+}
+
+
+/* PThreadextSuspendEnd -- wait for a batch of suspensions
+ *
+ * Waits for every thread that was signalled to acknowledge, then
+ * passes the contexts back.  A thread that was suspended on behalf of
+ * several pthreadexts stores its context in only one of them, so the
+ * others take it from their id ring.
+ */
+
+void PThreadextSuspendEnd(void)
+{
+  PThreadext target, nextTarget;
+  int status;
+
+  while (suspendingPending > 0) {
+    if (sem_wait(&pthreadextSem) == 0)
+      --suspendingPending;
+    else
+      AVER(errno == EINTR);
+  }
+
+  for (target = suspendingBatch; target != NULL; target = nextTarget) {
+    nextTarget = target->nextRequest;
+    if (target->context == NULL) {
+      Ring node, next;
+      RING_FOR(node, &target->idRing, next) {
+        PThreadext pt = RING_ELT(PThreadext, idRing, node);
+        if (pt->context != NULL) {
+          target->context = pt->context;
+          break;
+        }
+      }
+    }
+    AVER(target->context != NULL);
+    *target->contextReturn = target->context;
+    target->contextReturn = NULL;
+    target->nextRequest = NULL;
+  }
+  suspendingBatch = NULL;
+  suspendingActive = FALSE;
 
-unlock:
-  suspendingVictim = NULL;
   status = pthread_mutex_unlock(&pthreadextMut);
   AVER(status == 0);
+}
+
+
+/* PThreadextSuspend -- suspend a thread
+ *
+ * See <design/pthreadext/#impl.suspend>
+ */
+
+Res PThreadextSuspend(PThreadext target, MutatorContext *contextReturn)
+{
+  Res res;
+
+  PThreadextSuspendBegin();
+  res = PThreadextSuspendRequest(target, contextReturn);
+  PThreadextSuspendEnd();
   return res;
 }
 
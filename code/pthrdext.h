@@ -35,6 +35,8 @@ typedef struct PThreadextStruct {
   MutatorContext context;          /* context if suspended */
   RingStruct threadRing;           /* ring of suspended threads */
   RingStruct idRing;               /* duplicate suspensions for id */
+  struct PThreadextStruct *nextRequest; /* next in suspend batch */
+  MutatorContext *contextReturn;   /* where batch stores context */
 } PThreadextStruct;
 
 
@@ -60,6 +62,20 @@ extern Res PThreadextSuspend(PThreadext pthreadext,
                              MutatorContext *contextReturn);
 
 
+/*  PThreadextSuspendBegin/Request/End -- Suspend several pthreadexts
+ *
+ *  PThreadextSuspendRequest signals the thread without waiting for
+ *  it, so that all the threads in a batch stop in parallel.
+ *  PThreadextSuspendEnd waits for all of them, and stores their
+ *  contexts in the locations passed to PThreadextSuspendRequest.
+ */
+
+extern void PThreadextSuspendBegin(void);
+extern Res PThreadextSuspendRequest(PThreadext pthreadext,
+                                    MutatorContext *contextReturn);
+extern void PThreadextSuspendEnd(void);
+
+
 /*  PThreadextResume --  Resume a suspended pthreadext */
 
 extern Res PThreadextResume(PThreadext pthreadext);
@@ -35,6 +35,7 @@ typedef struct RootStruct {
   Addr protBase;                /* base of protectable area */
   Addr protLimit;               /* limit of protectable area */
   AccessSet pm;                 /* Protection Mode */
+  ScanStatsStruct scanStats;    /* <design/scan/#stats> */
   RootVar var;                  /* union discriminator */
   union RootUnion {
     struct {
@@ -209,6 +210,7 @@ static Res rootCreate(Root *rootReturn, Arena arena,
   root->protectable = FALSE;
   root->protBase = (Addr)0;
   root->protLimit = (Addr)0;
+  ScanStatsInit(&root->scanStats);
 
   /* See <design/arena/#root-ring> */
   RingInit(&root->arenaRing);
@@ -461,6 +463,18 @@ Arena RootArena(Root root)
 }
 
 
+/* RootScanStats -- return the scan statistics of a root
+ *
+ * See <design/scan/#stats>.
+ */
+
+ScanStats RootScanStats(Root root)
+{
+  AVERT(Root, root);
+  return &root->scanStats;
+}
+
+
 /* RootRank -- return the rank of a root */
 
 Rank RootRank(Root root)
@@ -1257,13 +1257,9 @@ Res SegSingleAccess(Seg seg, Arena arena, Addr addr,
       /* .tagging: Check that the reference is aligned to a word boundary */
       /* (we assume it is not a reference otherwise). */
       if(WordIsAligned((Word)ref, sizeof(Word))) {
-        Rank rank;
         /* See the note in TraceRankForAccess */
         /* (<code/trace.c#scan.conservative>). */
-        
-        rank = TraceRankForAccess(arena, seg);
-        TraceScanSingleRef(arena->flippedTraces, rank, arena,
-                           seg, (Ref *)addr);
+        TraceScanSingleRefAccess(arena, seg, (Ref *)addr);
       }
     }
     res = MutatorContextStepInstruction(context);
@@ -1439,6 +1435,9 @@ static void gcSegFinish(Inst inst)
   GCSeg gcseg = MustBeA(GCSeg, seg);
 
   if (SegGrey(seg) != TraceSetEMPTY) {
+    Arena arena = PoolArena(SegPool(seg));
+    AVER(arena->greySegCount > 0);
+    --arena->greySegCount;
     RingRemove(&gcseg->greyRing);
     seg->grey = TraceSetEMPTY;
   }
@@ -1493,10 +1492,14 @@ static void gcSegSetGreyInternal(Seg seg, TraceSet oldGrey, TraceSet grey)
           break;
         }
       AVER(rank != RankLIMIT); /* there should've been a match */
+      ++arena->greySegCount;
     }
   } else {
-    if (grey == TraceSetEMPTY)
+    if (grey == TraceSetEMPTY) {
       RingRemove(&gcseg->greyRing);
+      AVER(arena->greySegCount > 0);
+      --arena->greySegCount;
+    }
   }
 
   STATISTIC({
@@ -1628,7 +1631,9 @@ static void gcSegSetRankSet(Seg seg, RankSet rankSet)
   if (oldRankSet == RankSetEMPTY) {
     if (rankSet != RankSetEMPTY) {
       AVER(gcseg->summary == RefSetEMPTY);
-      ShieldRaise(arena, seg, AccessWRITE);
+      /* <design/write-barrier/#card.shield> */
+      if (!ArenaCardMarking(arena))
+        ShieldRaise(arena, seg, AccessWRITE);
     }
   } else {
     if (rankSet == RankSetEMPTY) {
@@ -1642,7 +1647,10 @@ static void gcSegSetRankSet(Seg seg, RankSet rankSet)
 static void gcSegSyncWriteBarrier(Seg seg, Arena arena)
 {
   /* Can't check seg -- this function enforces invariants tested by SegCheck. */
-  if (SegSummary(seg) == RefSetUNIV)
+  /* With card marking, the mutator marks the cards it writes to, so
+     segments are never write-protected.
+     <design/write-barrier/#card.shield> */
+  if (SegSummary(seg) == RefSetUNIV || ArenaCardMarking(arena))
     ShieldLower(arena, seg, AccessWRITE);
   else
     ShieldRaise(arena, seg, AccessWRITE);
@@ -1921,7 +1929,7 @@ static void gcSegGreyen(Seg seg, Trace trace)
   AVER(PoolArena(SegPool(seg)) == trace->arena);
 
   if (!TraceSetIsMember(SegWhite(seg), trace))
-    SegSetGrey(seg, TraceSetSingle(trace));
+    SegSetGrey(seg, TraceSetAdd(SegGrey(seg), trace));
 }
 
 
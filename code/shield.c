@@ -210,6 +210,36 @@ static Bool SegIsExposed(Seg seg)
 }
 
 
+/* shieldProtMode -- the protection to ask of the operating system
+ *
+ * When the arena has dirty tracking, the operating system records
+ * writes for us, so segments are never actually write-protected,
+ * though the protection mode still includes AccessWRITE.  See
+ * <design/prot/#dirty.shield>.
+ */
+
+static AccessSet shieldProtMode(Seg seg, AccessSet mode)
+{
+  if (ArenaDirtyTracking(PoolArena(SegPool(seg))))
+    return BS_DIFF(mode, AccessWRITE);
+  return mode;
+}
+
+
+/* shieldSetProt -- set protection mode and protect a segment
+ *
+ * Skips the system call if the actual protection would not change.
+ */
+
+static void shieldSetProt(Shield shield, Seg seg, AccessSet mode)
+{
+  AccessSet oldProt = shieldProtMode(seg, SegPM(seg));
+  shieldSetPM(shield, seg, mode);
+  if (shieldProtMode(seg, mode) != oldProt)
+    ProtSet(SegBase(seg), SegLimit(seg), shieldProtMode(seg, mode));
+}
+
+
 /* shieldSync -- synchronize a segment's protection
  *
  * See design.mps.shield.inv.prot.shield.
@@ -219,10 +249,8 @@ static void shieldSync(Shield shield, Seg seg)
 {
   SHIELD_AVERT_CRITICAL(Seg, seg);
 
-  if (!SegIsSynced(seg)) {
-    shieldSetPM(shield, seg, SegSM(seg));
-    ProtSet(SegBase(seg), SegLimit(seg), SegPM(seg));
-  }
+  if (!SegIsSynced(seg))
+    shieldSetProt(shield, seg, SegSM(seg));
 }
 
 
@@ -300,10 +328,8 @@ static void shieldProtLower(Shield shield, Seg seg, AccessSet mode)
   SHIELD_AVERT_CRITICAL(Seg, seg);
   AVERT_CRITICAL(AccessSet, mode);
 
-  if (BS_INTER(SegPM(seg), mode) != AccessSetEMPTY) {
-    shieldSetPM(shield, seg, BS_DIFF(SegPM(seg), mode));
-    ProtSet(SegBase(seg), SegLimit(seg), SegPM(seg));
-  }
+  if (BS_INTER(SegPM(seg), mode) != AccessSetEMPTY)
+    shieldSetProt(shield, seg, BS_DIFF(SegPM(seg), mode));
 }
 
 
@@ -393,7 +419,7 @@ static Compare shieldQueueEntryCompare(void *left, void *right, void *closure)
 static void shieldFlushEntries(Shield shield)
 {
   Addr base = NULL, limit;
-  AccessSet mode;
+  AccessSet mode, segMode, oldProt;
   Index i;
 
   if (shield->length == 0) {
@@ -410,14 +436,18 @@ static void shieldFlushEntries(Shield shield)
   for (i = 0; i < shield->limit; ++i) {
     Seg seg = shieldDequeue(shield, i);
     if (!SegIsSynced(seg)) {
+      oldProt = shieldProtMode(seg, SegPM(seg));
       shieldSetPM(shield, seg, SegSM(seg));
-      if (SegSM(seg) != mode || SegBase(seg) != limit) {
+      segMode = shieldProtMode(seg, SegSM(seg));
+      if (segMode == oldProt)
+        continue;
+      if (segMode != mode || SegBase(seg) != limit) {
         if (base != NULL) {
           AVER(base < limit);
           ProtSet(base, limit, mode);
         }
         base = SegBase(seg);
-        mode = SegSM(seg);
+        mode = segMode;
       }
       limit = SegLimit(seg);
     }
@@ -679,9 +709,17 @@ void (ShieldFlush)(Arena arena)
 }
 
 
-/* ShieldLeave -- leave the shield, protect segs from mutator */
+/* ShieldResume -- protect segs from mutator and resume it
+ *
+ * This is the part of ShieldLeave that may be done early, without
+ * leaving the shield, when nothing is exposed or held.  The mutator
+ * is suspended again if the MPS needs access to a shielded segment.
+ * See design.mps.shield.improv.resume.  The MPS calls this before
+ * waiting for a lock that a mutator thread might hold.  See
+ * design.mps.pool.lock.suspend.
+ */
 
-void (ShieldLeave)(Arena arena)
+void (ShieldResume)(Arena arena)
 {
   Shield shield;
   
@@ -695,12 +733,25 @@ void (ShieldLeave)(Arena arena)
 
   AVER(shield->unsynced == 0); /* everything back in sync */
 
-  /* Ensuring the mutator is running at this point guarantees
-     .inv.outside.running */
   if (shield->suspended) {
     ThreadRingResume(ArenaThreadRing(arena), ArenaDeadRing(arena));
     shield->suspended = FALSE;
   }
+}
+
+
+/* ShieldLeave -- leave the shield, protect segs from mutator */
+
+void (ShieldLeave)(Arena arena)
+{
+  Shield shield;
+  
+  AVERT(Arena, arena);
+  shield = ArenaShield(arena);
+
+  /* Ensuring the mutator is running at this point guarantees
+     .inv.outside.running */
+  ShieldResume(arena);
 
   shield->inside = FALSE;
 }
@@ -728,7 +779,11 @@ void (ShieldExpose)(Arena arena, Seg seg)
   ++shield->depth;
   AVER_CRITICAL(shield->depth > 0); /* overflow */
   
-  if (BS_INTER(SegPM(seg), mode) != AccessSetEMPTY)
+  /* With card marking, segments aren't write-protected, so the
+     mutator must be suspended whenever the MPS might look at a
+     segment.  See <design/write-barrier/#card.threads>. */
+  if (BS_INTER(SegPM(seg), mode) != AccessSetEMPTY
+      || ArenaCardMarking(arena))
     shieldSuspend(arena);
 
   /* Ensure design.mps.shield.inv.expose.prot. */
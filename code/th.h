@@ -68,6 +68,41 @@ extern Thread ThreadRingThread(Ring threadRing);
 
 extern Arena ThreadArena(Thread thread);
 
+
+/*  ThreadSafepoint/EnterNative/LeaveNative
+ *
+ *  In an arena with cooperative suspension, a thread is suspended
+ *  only when it calls ThreadSafepoint, or while it is between
+ *  ThreadEnterNative and ThreadLeaveNative.  Elsewhere these do
+ *  nothing.  See <design/thread-manager/#coop>.
+ */
+
+extern void ThreadSafepoint(Thread thread);
+extern void ThreadEnterNative(Thread thread);
+extern void ThreadLeaveNative(Thread thread);
+
+
+/*  ThreadEnterNativeAll/LeaveNativeAll
+ *
+ *  As ThreadEnterNative/LeaveNative, for all the current thread's
+ *  registrations with cooperative arenas.  Used where a thread may
+ *  have to wait for a lock before it knows which arena it needs.
+ */
+
+extern void ThreadEnterNativeAll(void);
+extern void ThreadLeaveNativeAll(void);
+
+
+/*  ThreadCurrent
+ *
+ *  Return the current thread's registration with a cooperative
+ *  arena, or NULL if it has none.  Safe to call without holding the
+ *  arena lock.
+ */
+
+extern Thread ThreadCurrent(Arena arena);
+
+
 extern Res ThreadScan(ScanState ss, Thread thread, Word *stackCold,
                       mps_area_scan_t scan_area,
                       void *closure);
@@ -116,6 +116,44 @@ Arena ThreadArena(Thread thread)
 }
 
 
+/* ThreadSafepoint, ThreadEnterNative, ThreadLeaveNative, etc.
+ *
+ * There is only one thread, so there is nothing to suspend.
+ * See <design/thread-manager/#coop>.
+ */
+
+void ThreadSafepoint(Thread thread)
+{
+  AVER_CRITICAL(TESTT(Thread, thread));
+}
+
+void ThreadEnterNative(Thread thread)
+{
+  AVER(TESTT(Thread, thread));
+}
+
+void ThreadLeaveNative(Thread thread)
+{
+  AVER(TESTT(Thread, thread));
+}
+
+void ThreadEnterNativeAll(void)
+{
+  NOOP;
+}
+
+void ThreadLeaveNativeAll(void)
+{
+  NOOP;
+}
+
+Thread ThreadCurrent(Arena arena)
+{
+  AVER(TESTT(Arena, arena));
+  return NULL;
+}
+
+
 Res ThreadScan(ScanState ss, Thread thread, Word *stackCold,
                mps_area_scan_t scan_area,
                void *closure)
@@ -14,7 +14,7 @@
  *
  * .error.resume: PThreadextResume is assumed to succeed unless the
  * thread has been terminated.
- * .error.suspend: PThreadextSuspend is assumed to succeed unless the
+ * .error.suspend: PThreadextSuspendRequest is assumed to succeed unless the
  * thread has been terminated.
  *
  * .stack.full-descend:  assumes full descending stack.
@@ -30,6 +30,21 @@
  * .stack.align: assume roots on the stack are always word-aligned,
  * but don't assume that the stack pointer is necessarily
  * word-aligned at the time of reading the context of another thread.
+ *
+ * .coop: In an arena with cooperative suspension, threads are not
+ * sent signals.  Instead the collector asks every thread to stop,
+ * then waits for each of them to reach a safepoint or native code,
+ * where it has saved its own context with getcontext.  See
+ * <design/thread-manager/#coop>.
+ *
+ * .coop.primary: A thread may be registered more than once with an
+ * arena <design/thread-manager/#req.register.multi>.  Its latest
+ * cooperative registration is the primary one: it is the one that
+ * stops, on behalf of all of them.
+ *
+ * .coop.dereg: A cooperative thread that goes on running must
+ * deregister itself, because its registrations are found through
+ * its thread-specific data (see .coop.current).
  */
 
 #include "mpm.h"
@@ -38,14 +53,35 @@
 #error "thix.c is specific to MPS_OS_FR or MPS_OS_LI"
 #endif
 
+#include "lock.h"
 #include "prmcix.h"
 #include "pthrdext.h"
 
+#include <errno.h> /* ETIMEDOUT */
 #include <pthread.h>
+#include <signal.h> /* pthread_kill */
+#include <sys/time.h> /* gettimeofday */
+#include <ucontext.h> /* getcontext */
 
 SRCID(thix, "$Id$");
 
 
+/* Cooperative thread states <design/thread-manager/#coop> */
+
+enum {
+  ThreadStateRUNNING,           /* may touch the heap */
+  ThreadStatePARKED,            /* stopped at a safepoint */
+  ThreadStateNATIVE,            /* running code that doesn't touch the heap */
+  ThreadStateLIMIT
+};
+
+
+/* THREAD_COOP_WAIT -- how long the collector waits for a cooperative
+ * thread before checking that it is still alive, in microseconds. */
+
+#define THREAD_COOP_WAIT 10000
+
+
 /* ThreadStruct -- thread descriptor */
 
 typedef struct mps_thr_s {       /* PThreads thread structure */
@@ -57,9 +93,25 @@ typedef struct mps_thr_s {       /* PThreads thread structure */
   PThreadextStruct thrextStruct; /* PThreads extension */
   pthread_t id;                  /* Pthread object of thread */
   MutatorContext context;        /* Context if suspended, NULL if not */
+  Bool cooperative;              /* suspended at safepoints? .coop */
+  pthread_mutex_t coopMutex;     /* protects the fields below */
+  pthread_cond_t coopCond;       /* signalled on change of state */
+  volatile Bool suspendRequest;  /* collector wants the thread stopped */
+  unsigned state;                /* ThreadState* */
+  Count nativeDepth;             /* nesting of ThreadEnterNative */
+  Thread nextOfSelf;             /* next registration of same thread */
+  Thread primary;                /* .coop.primary */
+  ucontext_t ucontext;           /* saved when parked or native */
+  MutatorContextStruct contextStruct; /* context made from ucontext */
 } ThreadStruct;
 
 
+/* .coop.current: The cooperative registrations of each thread, linked
+ * through nextOfSelf, are its thread-specific data for this key. */
+
+static pthread_key_t threadCurrentKey;
+
+
 /* ThreadCheck -- check a thread */
 
 Bool ThreadCheck(Thread thread)
@@ -70,6 +122,9 @@ Bool ThreadCheck(Thread thread)
   CHECKD_NOSIG(Ring, &thread->arenaRing);
   CHECKL(BoolCheck(thread->alive));
   CHECKD(PThreadext, &thread->thrextStruct);
+  CHECKL(BoolCheck(thread->cooperative));
+  CHECKL(thread->state < ThreadStateLIMIT);
+  CHECKL(thread->cooperative || thread->state == ThreadStateRUNNING);
   return TRUE;
 }
 
@@ -106,6 +161,32 @@ Res ThreadRegister(Thread *threadReturn, Arena arena)
   thread->arena = arena;
   thread->alive = TRUE;
   thread->context = NULL;
+  thread->cooperative = ArenaCooperativeSuspend(arena);
+  thread->suspendRequest = FALSE;
+  thread->state = ThreadStateRUNNING;
+  thread->nativeDepth = 0;
+  thread->nextOfSelf = NULL;
+  thread->primary = thread;
+
+  if (thread->cooperative) {
+    Thread t;
+    if (pthread_mutex_init(&thread->coopMutex, NULL) != 0) {
+      res = ResFAIL;
+      goto failMutex;
+    }
+    if (pthread_cond_init(&thread->coopCond, NULL) != 0) {
+      res = ResFAIL;
+      goto failCond;
+    }
+    thread->nextOfSelf = pthread_getspecific(threadCurrentKey);
+    if (pthread_setspecific(threadCurrentKey, thread) != 0) {
+      res = ResMEMORY;
+      goto failSpecific;
+    }
+    for (t = thread; t != NULL; t = t->nextOfSelf)
+      if (t->arena == arena)
+        t->primary = thread;
+  }
 
   PThreadextInit(&thread->thrextStruct, thread->id);
 
@@ -115,6 +196,47 @@ Res ThreadRegister(Thread *threadReturn, Arena arena)
 
   *threadReturn = thread;
   return ResOK;
+
+failSpecific:
+  (void)pthread_cond_destroy(&thread->coopCond);
+failCond:
+  (void)pthread_mutex_destroy(&thread->coopMutex);
+failMutex:
+  RingFinish(&thread->arenaRing);
+  thread->sig = SigInvalid;
+  ControlFree(arena, thread, sizeof(ThreadStruct));
+  return res;
+}
+
+
+/* threadCurrentRemove -- remove from the current thread's registrations */
+
+static void threadCurrentRemove(Thread thread)
+{
+  Thread head = pthread_getspecific(threadCurrentKey);
+  Thread t, primary;
+
+  if (head == thread) {
+    int status = pthread_setspecific(threadCurrentKey, thread->nextOfSelf);
+    AVER(status == 0);
+    head = thread->nextOfSelf;
+  } else {
+    Thread *tp = &head->nextOfSelf;
+    while (*tp != thread) {
+      AVER(*tp != NULL);
+      tp = &(*tp)->nextOfSelf;
+    }
+    *tp = thread->nextOfSelf;
+  }
+
+  /* .coop.primary */
+  primary = NULL;
+  for (t = head; t != NULL; t = t->nextOfSelf)
+    if (t->arena == thread->arena) {
+      if (primary == NULL)
+        primary = t;
+      t->primary = primary;
+    }
 }
 
 
@@ -127,6 +249,14 @@ void ThreadDeregister(Thread thread, Arena arena)
 
   RingRemove(&thread->arenaRing);
 
+  if (thread->cooperative) {
+    AVER(thread->state == ThreadStateRUNNING);
+    if (pthread_equal(pthread_self(), thread->id)) /* .coop.dereg */
+      threadCurrentRemove(thread);
+    (void)pthread_cond_destroy(&thread->coopCond);
+    (void)pthread_mutex_destroy(&thread->coopMutex);
+  }
+
   thread->sig = SigInvalid;
 
   RingFinish(&thread->arenaRing);
@@ -170,6 +300,91 @@ static void mapThreadRing(Ring threadRing, Ring deadRing, Bool (*func)(Thread))
  * current one.
  */
 
+/* threadCoopLock, threadCoopUnlock -- claim the cooperative state */
+
+static void threadCoopLock(Thread thread)
+{
+  int status = pthread_mutex_lock(&thread->coopMutex);
+  AVER(status == 0);
+}
+
+static void threadCoopUnlock(Thread thread)
+{
+  int status = pthread_mutex_unlock(&thread->coopMutex);
+  AVER(status == 0);
+}
+
+static void threadCoopChanged(Thread thread)
+{
+  int status = pthread_cond_broadcast(&thread->coopCond);
+  AVER(status == 0);
+}
+
+
+/* threadCoopRequest -- ask a cooperative thread to stop
+ *
+ * All the threads are asked before the collector waits for any of
+ * them, so that they stop in parallel.
+ */
+
+static Bool threadCoopRequest(Thread thread)
+{
+  if (pthread_equal(pthread_self(), thread->id)) /* .thread.id */
+    return TRUE;
+  /* design.thread-manager.sol.thread.term.attempt */
+  if (pthread_kill(thread->id, 0) != 0)
+    return FALSE;
+  threadCoopLock(thread);
+  AVER(!thread->suspendRequest);
+  thread->suspendRequest = TRUE;
+  threadCoopUnlock(thread);
+  return TRUE;
+}
+
+
+/* threadCoopAwait -- wait for a cooperative thread to stop
+ *
+ * Checks from time to time that the thread is still alive, in case
+ * it exited without deregistering.
+ */
+
+static Bool threadCoopAwait(Thread thread)
+{
+  Thread primary = thread->primary;
+  Bool alive = TRUE;
+
+  if (pthread_equal(pthread_self(), thread->id)) /* .thread.id */
+    return TRUE;
+  threadCoopLock(primary);
+  AVER(primary->suspendRequest);
+  while (primary->state == ThreadStateRUNNING) {
+    struct timeval now;
+    struct timespec timeout;
+    int status;
+    (void)gettimeofday(&now, NULL);
+    timeout.tv_sec = now.tv_sec;
+    timeout.tv_nsec = (now.tv_usec + THREAD_COOP_WAIT) * 1000L;
+    if (timeout.tv_nsec >= 1000000000L) {
+      timeout.tv_sec += timeout.tv_nsec / 1000000000L;
+      timeout.tv_nsec %= 1000000000L;
+    }
+    status = pthread_cond_timedwait(&primary->coopCond, &primary->coopMutex,
+                                    &timeout);
+    AVER(status == 0 || status == ETIMEDOUT);
+    if (status == ETIMEDOUT && pthread_kill(thread->id, 0) != 0) {
+      alive = FALSE;
+      break;
+    }
+  }
+  if (alive) {
+    MutatorContextInitThread(&primary->contextStruct, &primary->ucontext);
+    thread->context = &primary->contextStruct;
+  }
+  threadCoopUnlock(primary);
+  return alive;
+}
+
+
 static Bool threadSuspend(Thread thread)
 {
   Res res;
@@ -178,21 +393,46 @@ static Bool threadSuspend(Thread thread)
   if (pthread_equal(self, thread->id)) /* .thread.id */
     return TRUE;
 
-  /* .error.suspend: if PThreadextSuspend fails, we assume the thread
-   * has been terminated. */
+  if (thread->cooperative)
+    return threadCoopRequest(thread);
+
+  /* .error.suspend: if PThreadextSuspendRequest fails, we assume the
+   * thread has been terminated. */
   AVER(thread->context == NULL);
-  res = PThreadextSuspend(&thread->thrextStruct, &thread->context);
+  res = PThreadextSuspendRequest(&thread->thrextStruct, &thread->context);
   AVER(res == ResOK);
-  AVER(thread->context != NULL);
   /* design.thread-manager.sol.thread.term.attempt */
   return res == ResOK;
 }
 
 
 
+static Bool threadAwait(Thread thread)
+{
+  if (thread->cooperative)
+    return threadCoopAwait(thread);
+  AVER(pthread_equal(pthread_self(), thread->id)
+       || thread->context != NULL);
+  return TRUE;
+}
+
+/* .suspend.batch: All the threads are signalled before the collector
+ * waits for any of them.  See <design/thread-manager/#impl.ix.suspend>.
+ *
+ * .suspend.leaf: The leaf lock is held while threads are signalled, so
+ * that no thread is stopped holding it.  Cooperative threads only stop
+ * outside the MPS, so the lock is released before waiting for them.
+ * See <design/lock/#impl.leaf.suspend>.
+ */
+
 void ThreadRingSuspend(Ring threadRing, Ring deadRing)
 {
+  LockClaimGlobalLeaf();
+  PThreadextSuspendBegin();
   mapThreadRing(threadRing, deadRing, threadSuspend);
+  PThreadextSuspendEnd();
+  LockReleaseGlobalLeaf();
+  mapThreadRing(threadRing, deadRing, threadAwait);
 }
 
 
@@ -207,6 +447,17 @@ static Bool threadResume(Thread thread)
   if (pthread_equal(self, thread->id)) /* .thread.id */
     return TRUE;
 
+  if (thread->cooperative) {
+    threadCoopLock(thread);
+    AVER(thread->suspendRequest);
+    AVER(thread->context != NULL);
+    thread->suspendRequest = FALSE;
+    thread->context = NULL;
+    threadCoopChanged(thread);
+    threadCoopUnlock(thread);
+    return TRUE;
+  }
+
   /* .error.resume: If PThreadextResume fails, we assume the thread
    * has been terminated. */
   AVER(thread->context != NULL);
@@ -247,6 +498,141 @@ Arena ThreadArena(Thread thread)
 }
 
 
+/* threadPark -- stop until the collector resumes the thread
+ *
+ * The context must be saved in this function's frame, which stays
+ * live while the thread is parked.
+ */
+
+static void threadPark(Thread thread)
+{
+  threadCoopLock(thread);
+  if (thread->suspendRequest) {
+    AVER(thread->state == ThreadStateRUNNING);
+    (void)getcontext(&thread->ucontext);
+    thread->state = ThreadStatePARKED;
+    threadCoopChanged(thread);
+    while (thread->suspendRequest) {
+      int status = pthread_cond_wait(&thread->coopCond, &thread->coopMutex);
+      AVER(status == 0);
+    }
+    thread->state = ThreadStateRUNNING;
+  }
+  threadCoopUnlock(thread);
+}
+
+
+/* ThreadSafepoint -- stop here if the collector has asked
+ *
+ * The test of suspendRequest outside the lock is only a hint: if it
+ * is missed, the thread stops at its next safepoint.
+ */
+
+void ThreadSafepoint(Thread thread)
+{
+  AVER_CRITICAL(TESTT(Thread, thread));
+  if (!thread->cooperative || !thread->suspendRequest)
+    return;
+
+  AVER(pthread_equal(pthread_self(), thread->id));
+  threadPark(thread->primary); /* .coop.primary */
+}
+
+
+/* ThreadEnterNative -- promise not to touch the heap
+ *
+ * The thread may be scanned from the context saved here at any time
+ * until it calls ThreadLeaveNative.  Calls may nest, in which case
+ * the outermost context is kept.
+ */
+
+void ThreadEnterNative(Thread thread)
+{
+  Thread primary;
+
+  AVER(TESTT(Thread, thread));
+  if (!thread->cooperative)
+    return;
+
+  AVER(pthread_equal(pthread_self(), thread->id));
+  primary = thread->primary; /* .coop.primary */
+  threadCoopLock(primary);
+  if (primary->nativeDepth == 0) {
+    AVER(primary->state == ThreadStateRUNNING);
+    (void)getcontext(&primary->ucontext);
+    primary->state = ThreadStateNATIVE;
+    threadCoopChanged(primary);
+  }
+  ++primary->nativeDepth;
+  threadCoopUnlock(primary);
+}
+
+
+/* ThreadLeaveNative -- return to the heap, once the collector allows */
+
+void ThreadLeaveNative(Thread thread)
+{
+  AVER(TESTT(Thread, thread));
+  if (!thread->cooperative)
+    return;
+
+  AVER(pthread_equal(pthread_self(), thread->id));
+  thread = thread->primary; /* .coop.primary */
+  threadCoopLock(thread);
+  AVER(thread->state == ThreadStateNATIVE);
+  AVER(thread->nativeDepth > 0);
+  --thread->nativeDepth;
+  if (thread->nativeDepth == 0) {
+    while (thread->suspendRequest) {
+      int status = pthread_cond_wait(&thread->coopCond, &thread->coopMutex);
+      AVER(status == 0);
+    }
+    thread->state = ThreadStateRUNNING;
+  }
+  threadCoopUnlock(thread);
+}
+
+
+/* ThreadEnterNativeAll, ThreadLeaveNativeAll -- the same, for all
+ * the current thread's registrations
+ *
+ * See <design/thread-manager/#coop.access>.
+ */
+
+void ThreadEnterNativeAll(void)
+{
+  Thread thread;
+  for (thread = pthread_getspecific(threadCurrentKey);
+       thread != NULL; thread = thread->nextOfSelf)
+    ThreadEnterNative(thread);
+}
+
+void ThreadLeaveNativeAll(void)
+{
+  Thread thread;
+  for (thread = pthread_getspecific(threadCurrentKey);
+       thread != NULL; thread = thread->nextOfSelf)
+    ThreadLeaveNative(thread);
+}
+
+
+/* ThreadCurrent -- the current thread's cooperative registration
+ *
+ * See .coop.current.
+ */
+
+Thread ThreadCurrent(Arena arena)
+{
+  Thread thread;
+  AVER(TESTT(Arena, arena));
+  for (thread = pthread_getspecific(threadCurrentKey);
+       thread != NULL; thread = thread->nextOfSelf)
+    if (thread->arena == arena)
+      return thread; /* .coop.primary */
+  return NULL;
+}
+
+
 /* ThreadScan -- scan the state of a thread (stack and regs) */
 
 Res ThreadScan(ScanState ss, Thread thread, Word *stackCold,
@@ -308,6 +694,8 @@ Res ThreadDescribe(Thread thread, mps_lib_FILE *stream, Count depth)
                "  arena $P ($U)\n",
                (WriteFP)thread->arena, (WriteFU)thread->arena->serial,
                "  alive $S\n", WriteFYesNo(thread->alive),
+               "  cooperative $S\n", WriteFYesNo(thread->cooperative),
+               "  state $U\n", (WriteFU)thread->state,
                "  id $U\n",          (WriteFU)thread->id,
                "} Thread $P ($U)\n", (WriteFP)thread, (WriteFU)thread->serial,
                NULL);
@@ -341,6 +729,8 @@ static void threadAtForkChild(void)
 
 void ThreadSetup(void)
 {
+  int status = pthread_key_create(&threadCurrentKey, NULL);
+  AVER(status == 0);
   pthread_atfork(NULL, NULL, threadAtForkChild);
 }
 
@@ -58,6 +58,7 @@
 #error "thw3.c is specific to MPS_OS_W3"
 #endif
 
+#include "lock.h"
 #include "prmcw3.h"
 #include "mpswin.h"
 
@@ -202,9 +203,15 @@ static Bool suspendThread(Thread thread)
   return SuspendThread(thread->handle) != (DWORD)-1;
 }
 
+/* .suspend.leaf: The leaf lock is held while threads are suspended,
+ * so that no thread is stopped holding it.  See
+ * <design/lock/#impl.leaf.suspend>. */
+
 void ThreadRingSuspend(Ring threadRing, Ring deadRing)
 {
+  LockClaimGlobalLeaf();
   mapThreadRing(threadRing, deadRing, suspendThread);
+  LockReleaseGlobalLeaf();
 }
 
 static Bool resumeThread(Thread thread)
@@ -239,6 +246,45 @@ Arena ThreadArena(Thread thread)
   return thread->arena;
 }
 
+
+/* ThreadSafepoint, ThreadEnterNative, ThreadLeaveNative, etc.
+ *
+ * Cooperative suspension is not implemented on Windows, so threads
+ * are always suspended by the operating system.
+ * See <design/thread-manager/#coop>.
+ */
+
+void ThreadSafepoint(Thread thread)
+{
+  AVER_CRITICAL(TESTT(Thread, thread));
+}
+
+void ThreadEnterNative(Thread thread)
+{
+  AVER(TESTT(Thread, thread));
+}
+
+void ThreadLeaveNative(Thread thread)
+{
+  AVER(TESTT(Thread, thread));
+}
+
+void ThreadEnterNativeAll(void)
+{
+  NOOP;
+}
+
+void ThreadLeaveNativeAll(void)
+{
+  NOOP;
+}
+
+Thread ThreadCurrent(Arena arena)
+{
+  AVER(TESTT(Arena, arena));
+  return NULL;
+}
+
 Res ThreadDescribe(Thread thread, mps_lib_FILE *stream, Count depth)
 {
   Res res;
@@ -25,6 +25,7 @@
 #error "protw3.c is specific to MPS_OS_XC"
 #endif
 
+#include "lock.h"
 #include "protxc.h"
 
 #include <mach/mach_init.h>
@@ -171,10 +172,16 @@ static Bool threadSuspend(Thread thread)
 
 /* ThreadRingSuspend -- suspend all threads on a ring, except the
  * current one.
+ *
+ * .suspend.leaf: The leaf lock is held while threads are suspended,
+ * so that no thread is stopped holding it.  See
+ * <design/lock/#impl.leaf.suspend>.
  */
 void ThreadRingSuspend(Ring threadRing, Ring deadRing)
 {
+  LockClaimGlobalLeaf();
   mapThreadRing(threadRing, deadRing, threadSuspend);
+  LockReleaseGlobalLeaf();
 }
 
 
@@ -223,6 +230,45 @@ Arena ThreadArena(Thread thread)
 }
 
 
+/* ThreadSafepoint, ThreadEnterNative, ThreadLeaveNative, etc.
+ *
+ * Cooperative suspension is not implemented on macOS, so threads
+ * are always suspended by the operating system.
+ * See <design/thread-manager/#coop>.
+ */
+
+void ThreadSafepoint(Thread thread)
+{
+  AVER_CRITICAL(TESTT(Thread, thread));
+}
+
+void ThreadEnterNative(Thread thread)
+{
+  AVER(TESTT(Thread, thread));
+}
+
+void ThreadLeaveNative(Thread thread)
+{
+  AVER(TESTT(Thread, thread));
+}
+
+void ThreadEnterNativeAll(void)
+{
+  NOOP;
+}
+
+void ThreadLeaveNativeAll(void)
+{
+  NOOP;
+}
+
+Thread ThreadCurrent(Arena arena)
+{
+  AVER(TESTT(Arena, arena));
+  return NULL;
+}
+
+
 /* ThreadScan -- scan the state of a thread (stack and regs) */
 
 #include "prmcxc.h"
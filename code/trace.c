@@ -51,6 +51,7 @@ Bool ScanStateCheck(ScanState ss)
   CHECKL(TraceSetSuper(ss->arena->busyTraces, ss->traces));
   CHECKL(RankCheck(ss->rank));
   CHECKL(BoolCheck(ss->wasMarked));
+  CHECKL(BoolCheck(ss->cardsOnly));
   /* @@@@ checks for counts missing */
   return TRUE;
 }
@@ -98,8 +99,9 @@ void ScanStateInit(ScanState ss, TraceSet ts, Arena arena,
   ss->fixedSummary = RefSetEMPTY;
   ss->arena = arena;
   ss->wasMarked = TRUE;
+  ss->cardsOnly = FALSE;
   ScanStateSetWhite(ss, white);
-  STATISTIC(ss->fixRefCount = (Count)0);
+  ss->fixRefCount = (Count)0;
   STATISTIC(ss->segRefCount = (Count)0);
   STATISTIC(ss->whiteSegRefCount = (Count)0);
   STATISTIC(ss->nailCount = (Count)0);
@@ -107,7 +109,9 @@ void ScanStateInit(ScanState ss, TraceSet ts, Arena arena,
   STATISTIC(ss->forwardedCount = (Count)0);
   STATISTIC(ss->preservedInPlaceCount = (Count)0);
   STATISTIC(ss->copiedSize = (Size)0);
+  STATISTIC(ss->objectScanCount = (Count)0);
   ss->scannedSize = (Size)0; /* see .work */
+  ss->scanClocks = (Clock)0;
   ss->sig = ScanStateSig;
 
   AVERT(ScanState, ss);
@@ -123,6 +127,37 @@ void ScanStateFinish(ScanState ss)
 }
 
 
+/* ScanStatsInit -- initialize scan statistics
+ *
+ * See <design/scan/#stats>.
+ */
+
+void ScanStatsInit(ScanStats stats)
+{
+  AVER(stats != NULL);
+  stats->scans = 0;
+  stats->scanned = 0.0;
+  stats->fixed = 0;
+  stats->time = 0.0;
+}
+
+
+/* ScanStatsAdd -- add the work done by a scan to scan statistics
+ *
+ * See <design/scan/#stats.attrib>.
+ */
+
+void ScanStatsAdd(ScanStats stats, ScanState ss)
+{
+  AVER(stats != NULL);
+  AVERT(ScanState, ss);
+  ++stats->scans;
+  stats->scanned += (double)ss->scannedSize;
+  stats->fixed += ss->fixRefCount;
+  stats->time += (double)ss->scanClocks / (double)ClocksPerSec();
+}
+
+
 /* TraceIdCheck -- check that a TraceId is valid */
 
 Bool TraceIdCheck(TraceId ti)
@@ -191,6 +226,7 @@ Bool TraceCheck(Trace trace)
   if(trace->chain != NULL) {
     CHECKU(Chain, trace->chain);
   }
+  CHECKL(BoolCheck(trace->exclusive));
   CHECKL(FUNCHECK(trace->fix));
   /* Can't check trace->fixClosure. */
 
@@ -295,6 +331,7 @@ static void traceUpdateCounts(Trace trace, ScanState ss,
   STATISTIC(trace->snapCount += ss->snapCount);
   STATISTIC(trace->forwardedCount += ss->forwardedCount);
   STATISTIC(trace->preservedInPlaceCount += ss->preservedInPlaceCount);
+  STATISTIC(trace->objectScanCount += ss->objectScanCount);
 }
 
 
@@ -357,6 +394,7 @@ Res TraceAddWhite(Trace trace, Seg seg)
   AVERT(Trace, trace);
   AVERT(Seg, seg);
   AVER(!TraceSetIsMember(SegWhite(seg), trace)); /* .start.black */
+  AVER(SegWhite(seg) == TraceSetEMPTY); /* <design/trace/#multi.white> */
 
   pool = SegPool(seg);
   AVERT(Pool, pool);
@@ -383,6 +421,12 @@ Res TraceAddWhite(Trace trace, Seg seg)
       trace->mayMove = ZoneSetUnion(trace->mayMove,
                                     ZoneSetOfSeg(trace->arena, seg));
     }
+
+    /* If the pool can't share its segments with another trace, no
+       other trace may run alongside this one. See
+       <design/trace/#multi.exclusive>. */
+    if (!PoolHasAttr(pool, AttrMULTITRACE))
+      trace->exclusive = TRUE;
   }
 
   return ResOK;
@@ -439,6 +483,40 @@ static void traceFlipBuffers(Globals arena)
 }
 
 
+/* traceRootScan, traceSegScan -- scan a root or segment, timing it
+ *
+ * If the arena is gathering scan statistics, the time taken by the
+ * scan is added to the scan state, and attributed when the scan state
+ * is merged into the traces.  See <design/scan/#stats.time>.
+ */
+
+static Res traceRootScan(ScanState ss, Root root)
+{
+  Clock start;
+  Res res;
+
+  if (!ss->arena->scanStats)
+    return RootScan(ss, root);
+  start = ClockNow();
+  res = RootScan(ss, root);
+  ss->scanClocks += ClockNow() - start;
+  return res;
+}
+
+static Res traceSegScan(Bool *totalReturn, Seg seg, ScanState ss)
+{
+  Clock start;
+  Res res;
+
+  if (!ss->arena->scanStats)
+    return SegScan(totalReturn, seg, ss);
+  start = ClockNow();
+  res = SegScan(totalReturn, seg, ss);
+  ss->scanClocks += ClockNow() - start;
+  return res;
+}
+
+
 /* traceScanRootRes -- scan a root, with result code */
 
 static Res traceScanRootRes(TraceSet ts, Rank rank, Arena arena, Root root)
@@ -451,9 +529,11 @@ static Res traceScanRootRes(TraceSet ts, Rank rank, Arena arena, Root root)
 
   ScanStateInit(&ss, ts, arena, rank, white);
 
-  res = RootScan(&ss, root);
+  res = traceRootScan(&ss, root);
 
   traceSetUpdateCounts(ts, arena, &ss, traceAccountingPhaseRootScan);
+  if (arena->scanStats)
+    ScanStatsAdd(RootScanStats(root), &ss);
   ScanStateFinish(&ss);
   return res;
 }
@@ -609,6 +689,7 @@ static Res traceFlip(Trace trace)
   /* Mark the trace as flipped. */
   trace->state = TraceFLIPPED;
   arena->flippedTraces = TraceSetAdd(arena->flippedTraces, trace);
+  ++arena->flipCount;
 
   EVENT2(TraceFlipEnd, trace, arena);
 
@@ -676,6 +757,7 @@ found:
   trace->fix = SegFix;
   trace->fixClosure = NULL;
   trace->chain = NULL;
+  trace->exclusive = FALSE;
   STATISTIC(trace->preTraceArenaReserved = ArenaReserved(arena));
   trace->condemned = (Size)0;   /* nothing condemned yet */
   trace->notCondemned = (Size)0;
@@ -699,12 +781,15 @@ found:
   STATISTIC(trace->snapCount = (Count)0);
   STATISTIC(trace->readBarrierHitCount = (Count)0);
   STATISTIC(trace->pointlessScanCount = (Count)0);
+  STATISTIC(trace->objectScanCount = (Count)0);
   STATISTIC(trace->forwardedCount = (Count)0);
   trace->forwardedSize = (Size)0; /* see .message.data */
   STATISTIC(trace->preservedInPlaceCount = (Count)0);
   trace->preservedInPlaceSize = (Size)0;  /* see .message.data */
   STATISTIC(trace->reclaimCount = (Count)0);
-  STATISTIC(trace->reclaimSize = (Size)0);
+  trace->reclaimSize = (Size)0; /* see mps_arena_stats */
+  trace->pauseTime = 0.0;       /* see .message.data */
+  trace->pauseMax = 0.0;        /* see .message.data */
   trace->sig = TraceSig;
   arena->busyTraces = TraceSetAdd(arena->busyTraces, trace);
   AVERT(Trace, trace);
@@ -782,6 +867,45 @@ void TraceDestroyInit(Trace trace)
 }
 
 
+/* traceScanStatsEvents -- emit the scan statistics at the end of a trace
+ *
+ * Emits the cumulative scan statistics of each pool, root and format,
+ * so that the work done for a trace can be found by subtracting the
+ * previous values.  See <design/scan/#stats.event>.
+ */
+
+static Res traceScanStatsRoot(Root root, void *p)
+{
+  Trace trace = p;
+  ScanStats stats = RootScanStats(root);
+  EVENT6(RootScanStats, trace, root, stats->scans, stats->scanned,
+         stats->fixed, stats->time);
+  return ResOK;
+}
+
+static void traceScanStatsEvents(Trace trace)
+{
+  Arena arena = trace->arena;
+  Ring node, next;
+  Res res;
+
+  RING_FOR(node, &ArenaGlobals(arena)->poolRing, next) {
+    Pool pool = RING_ELT(Pool, arenaRing, node);
+    ScanStats stats = &pool->scanStats;
+    EVENT6(PoolScanStats, trace, pool, stats->scans, stats->scanned,
+           stats->fixed, stats->time);
+  }
+  RING_FOR(node, &arena->formatRing, next) {
+    Format format = RING_ELT(Format, arenaRing, node);
+    ScanStats stats = &format->scanStats;
+    EVENT6(FormatScanStats, trace, format, stats->scans, stats->scanned,
+           stats->fixed, stats->time);
+  }
+  res = RootsIterate(ArenaGlobals(arena), traceScanStatsRoot, trace);
+  AVER(res == ResOK);
+}
+
+
 /* TraceDestroyFinished -- destroy a trace object in state FINISHED
  *
  * Finish and deallocate a Trace object, freeing up a TraceId.
@@ -793,10 +917,21 @@ void TraceDestroyInit(Trace trace)
 
 void TraceDestroyFinished(Trace trace)
 {
+  Arena arena;
+
   AVERT(Trace, trace);
   AVER(trace->state == TraceFINISHED);
 
-  STATISTIC(EVENT13(TraceStatScan, trace,
+  /* Accumulate the totals reported by mps_arena_stats. */
+  arena = trace->arena;
+  ++arena->traceCount;
+  arena->forwardedSize += trace->forwardedSize;
+  arena->reclaimedSize += trace->reclaimSize;
+
+  if (arena->scanStats)
+    traceScanStatsEvents(trace);
+
+  STATISTIC(EVENT14(TraceStatScan, trace,
                     trace->rootScanCount, trace->rootScanSize,
                     trace->rootCopiedSize,
                     trace->segScanCount, trace->segScanSize,
@@ -804,7 +939,7 @@ void TraceDestroyFinished(Trace trace)
                     trace->singleScanCount, trace->singleScanSize,
                     trace->singleCopiedSize,
                     trace->readBarrierHitCount, trace->greySegMax,
-                    trace->pointlessScanCount));
+                    trace->pointlessScanCount, trace->objectScanCount));
   STATISTIC(EVENT10(TraceStatFix, trace,
                     trace->fixRefCount, trace->segRefCount,
                     trace->whiteSegRefCount,
@@ -874,8 +1009,9 @@ static void traceReclaim(Trace trace)
 
 /* TraceRankForAccess -- Returns rank to scan at if we hit a barrier.
  * 
- * We assume a single trace as otherwise we need to implement rank
- * filters on scanning.
+ * The rank depends on the band of the trace, so when more than one
+ * trace is flipped the segment is scanned separately for each of
+ * them.  See <design/trace/#multi.access>.
  *
  * .scan.conservative: It's safe to scan at EXACT unless the band is
  * WEAK and in that case the segment should be weak.
@@ -899,23 +1035,16 @@ static void traceReclaim(Trace trace)
  * See the message <http://info.ravenbrook.com/mail/2012/08/30/16-46-42/0.txt>
  * for a description of these semantics.
  */
-Rank TraceRankForAccess(Arena arena, Seg seg)
+Rank TraceRankForAccess(Trace trace, Seg seg)
 {
-  TraceSet ts;
-  Trace trace;
-  TraceId ti;
   Rank band;
   RankSet rankSet;
 
-  AVERT(Arena, arena);
+  AVERT(Trace, trace);
   AVERT(Seg, seg);
+  AVER(TraceSetIsMember(trace->arena->flippedTraces, trace));
 
-  band = RankLIMIT; /* initialize with invalid rank */
-  ts = arena->flippedTraces;    
-  AVER(TraceSetIsSingle(ts));
-  TRACE_SET_ITER(ti, trace, ts, arena)
-    band = traceBand(trace);
-  TRACE_SET_ITER_END(ti, trace, ts, arena);
+  band = traceBand(trace);
   rankSet = SegRankSet(seg);
   switch(band) {
   case RankAMBIG:
@@ -1077,6 +1206,98 @@ RefSet ScanStateSummary(ScanState ss)
 }
 
 
+/* traceScanSegUpdate -- update the trace and segment after a scan
+ *
+ * Accumulates the scan state's counts into the traces, and updates the
+ * segment's write barrier deferral count and summary from the scan
+ * state.  This is the part of scanning a segment that must be done
+ * with the segment covered, whether or not the scan was successful.  */
+
+static void traceScanSegUpdate(TraceSet ts, Arena arena, Seg seg,
+                               ScanState ss, Res res, Bool wasTotal)
+{
+  ZoneSet white = ScanStateWhite(ss);
+  RefSet summary;
+  Buffer buffer;
+
+  traceSetUpdateCounts(ts, arena, ss, traceAccountingPhaseSegScan);
+  /* Attribute the scan to the pool and format that own the segment.
+     See <design/scan/#stats.attrib>. */
+  if (arena->scanStats) {
+    Pool pool = SegPool(seg);
+    Format format;
+    ScanStatsAdd(&pool->scanStats, ss);
+    if (PoolFormat(&format, pool))
+      ScanStatsAdd(&format->scanStats, ss);
+  }
+  /* Count segments scanned pointlessly */
+  STATISTIC({
+    TraceId ti; Trace trace;
+    Count whiteSegRefCount = 0;
+
+    TRACE_SET_ITER(ti, trace, ts, arena)
+      whiteSegRefCount += trace->whiteSegRefCount;
+    TRACE_SET_ITER_END(ti, trace, ts, arena);
+    if(whiteSegRefCount == 0)
+      TRACE_SET_ITER(ti, trace, ts, arena)
+        ++trace->pointlessScanCount;
+      TRACE_SET_ITER_END(ti, trace, ts, arena);
+  });
+
+  /* With card marking, the summary doesn't cover references on
+     dirty cards, so there's nothing to verify.  Set the summary from
+     the scan and clean the cards if every reference on them was
+     scanned.  See <design/write-barrier/#card.clean>. */
+  if (ArenaCardMarking(arena)) {
+    if (res == ResOK && wasTotal && !ss->cardsOnly)
+      summary = ScanStateSummary(ss);
+    else
+      summary = RefSetUnion(SegSummary(seg), ScanStateSummary(ss));
+    SegSetSummary(seg, summary);
+    if (res == ResOK && wasTotal && SegWhite(seg) == TraceSetEMPTY) {
+      CardClean(arena, SegBase(seg), SegLimit(seg));
+      /* <design/write-barrier/#card.buffer> */
+      if (SegBuffer(&buffer, seg))
+        CardSetDirty(arena, BufferScanLimit(buffer), BufferLimit(buffer));
+    }
+    return;
+  }
+
+  /* Following is true whether or not scan was total. */
+  /* See <design/scan/#summary.subset>. */
+  /* .verify.segsummary: were the seg contents, as found by this 
+   * scan, consistent with the recorded SegSummary?
+   */
+  AVER(RefSetSub(ScanStateUnfixedSummary(ss), SegSummary(seg))); /* <design/check/#.common> */
+
+  /* Write barrier deferral -- see design.mps.write-barrier.deferral. */
+  /* Did the segment refer to the white set? */
+  if (ZoneSetInter(ScanStateUnfixedSummary(ss), white) == ZoneSetEMPTY) {
+    /* Boring scan.  One step closer to raising the write barrier. */
+    if (seg->defer > 0)
+      --seg->defer;
+  } else {
+    /* Interesting scan. Defer raising the write barrier. */
+    if (seg->defer < WB_DEFER_DELAY)
+      seg->defer = WB_DEFER_DELAY;
+  }
+
+  /* Only apply the write barrier if it is not deferred. */
+  if (seg->defer == 0) {
+    /* If we scanned every reference in the segment then we have a
+       complete summary we can set. Otherwise, we just have
+       information about more zones that the segment refers to. */
+    if (res == ResOK && wasTotal)
+      summary = ScanStateSummary(ss);
+    else
+      summary = RefSetUnion(SegSummary(seg), ScanStateSummary(ss));
+  } else {
+    summary = RefSetUNIV;
+  }
+  SegSetSummary(seg, summary);
+}
+
+
 /* traceScanSegRes -- scan a segment to remove greyness
  *
  * @@@@ During scanning, the segment should be write-shielded to prevent
@@ -1086,10 +1307,9 @@ RefSet ScanStateSummary(ScanState ss)
 
 static Res traceScanSegRes(TraceSet ts, Rank rank, Arena arena, Seg seg)
 {
-  Bool wasTotal;
+  Bool wasTotal, cardsOnly;
   ZoneSet white;
   Res res;
-  RefSet summary;
 
   /* The reason for scanning a segment is that it's grey. */
   AVER(TraceSetInter(ts, SegGrey(seg)) != TraceSetEMPTY);
@@ -1097,8 +1317,12 @@ static Res traceScanSegRes(TraceSet ts, Rank rank, Arena arena, Seg seg)
 
   white = traceSetWhiteUnion(ts, arena);
 
-  /* Only scan a segment if it refers to the white set. */
-  if(ZoneSetInter(white, SegSummary(seg)) == ZoneSetEMPTY) {
+  /* Only scan a segment if it refers to the white set, or if it has
+     dirty cards, which might.  <design/write-barrier/#card.scan> */
+  cardsOnly = ZoneSetInter(white, SegSummary(seg)) == ZoneSetEMPTY;
+  if(cardsOnly && !(ArenaCardMarking(arena)
+                    && CardIsDirty(arena, SegBase(seg), SegLimit(seg))))
+  {
     SegBlacken(seg, ts);
     /* Setup result code to return later. */
     res = ResOK;
@@ -1106,60 +1330,15 @@ static Res traceScanSegRes(TraceSet ts, Rank rank, Arena arena, Seg seg)
     ScanStateStruct ssStruct;
     ScanState ss = &ssStruct;
     ScanStateInit(ss, ts, arena, rank, white);
+    ss->cardsOnly = cardsOnly;
 
     /* Expose the segment to make sure we can scan it. */
     ShieldExpose(arena, seg);
-    res = SegScan(&wasTotal, seg, ss);
+    res = traceSegScan(&wasTotal, seg, ss);
     /* Cover, regardless of result */
     ShieldCover(arena, seg);
 
-    traceSetUpdateCounts(ts, arena, ss, traceAccountingPhaseSegScan);
-    /* Count segments scanned pointlessly */
-    STATISTIC({
-      TraceId ti; Trace trace;
-      Count whiteSegRefCount = 0;
-
-      TRACE_SET_ITER(ti, trace, ts, arena)
-        whiteSegRefCount += trace->whiteSegRefCount;
-      TRACE_SET_ITER_END(ti, trace, ts, arena);
-      if(whiteSegRefCount == 0)
-        TRACE_SET_ITER(ti, trace, ts, arena)
-          ++trace->pointlessScanCount;
-        TRACE_SET_ITER_END(ti, trace, ts, arena);
-    });
-
-    /* Following is true whether or not scan was total. */
-    /* See <design/scan/#summary.subset>. */
-    /* .verify.segsummary: were the seg contents, as found by this 
-     * scan, consistent with the recorded SegSummary?
-     */
-    AVER(RefSetSub(ScanStateUnfixedSummary(ss), SegSummary(seg))); /* <design/check/#.common> */
-
-    /* Write barrier deferral -- see design.mps.write-barrier.deferral. */
-    /* Did the segment refer to the white set? */
-    if (ZoneSetInter(ScanStateUnfixedSummary(ss), white) == ZoneSetEMPTY) {
-      /* Boring scan.  One step closer to raising the write barrier. */
-      if (seg->defer > 0)
-        --seg->defer;
-    } else {
-      /* Interesting scan. Defer raising the write barrier. */
-      if (seg->defer < WB_DEFER_DELAY)
-        seg->defer = WB_DEFER_DELAY;
-    }
-
-    /* Only apply the write barrier if it is not deferred. */
-    if (seg->defer == 0) {
-      /* If we scanned every reference in the segment then we have a
-         complete summary we can set. Otherwise, we just have
-         information about more zones that the segment refers to. */
-      if (res == ResOK && wasTotal)
-        summary = ScanStateSummary(ss);
-      else
-        summary = RefSetUnion(SegSummary(seg), ScanStateSummary(ss));
-    } else {
-      summary = RefSetUNIV;
-    }
-    SegSetSummary(seg, summary);
+    traceScanSegUpdate(ts, arena, seg, ss, res, wasTotal);
 
     ScanStateFinish(ss);
   }
@@ -1229,35 +1408,34 @@ void TraceSegAccess(Arena arena, Seg seg, AccessSet mode)
     seg->defer = WB_DEFER_HIT;
 
   if (readHit) {
-    Rank rank;
     TraceSet traces;
+    Trace trace;
+    TraceId ti;
 
     AVER(SegRankSet(seg) != RankSetEMPTY);
     
-    /* Pick set of traces to scan for: */
-    traces = arena->flippedTraces;
-    rank = TraceRankForAccess(arena, seg);
-    res = traceScanSeg(traces, rank, arena, seg);      
-
-    /* Allocation failures should be handled my emergency mode, and we don't
-       expect any other kind of failure in a normal GC that causes access
-       faults. */
-    AVER(res == ResOK);
+    /* Scan for each flipped trace for which the segment is grey, at
+       the rank for that trace's band. See
+       <design/trace/#multi.access>. */
+    traces = TraceSetInter(SegGrey(seg), arena->flippedTraces);
+    TRACE_SET_ITER(ti, trace, traces, arena)
+      res = traceScanSeg(TraceSetSingle(trace),
+                         TraceRankForAccess(trace, seg), arena, seg);
+
+      /* Allocation failures should be handled my emergency mode, and
+         we don't expect any other kind of failure in a normal GC that
+         causes access faults. */
+      AVER(res == ResOK);
+      STATISTIC(++trace->readBarrierHitCount);
+      ++arena->readBarrierHitCount;
+    TRACE_SET_ITER_END(ti, trace, traces, arena);
 
     /* The pool should've done the job of removing the greyness that */
     /* was causing the segment to be protected, so that the mutator */
     /* can go ahead and access it. */
-    AVER(TraceSetInter(SegGrey(seg), traces) == TraceSetEMPTY);
-
-    STATISTIC({
-      Trace trace;
-      TraceId ti;
-      TRACE_SET_ITER(ti, trace, traces, arena)
-        ++trace->readBarrierHitCount;
-      TRACE_SET_ITER_END(ti, trace, traces, arena);
-    });
+    AVER(TraceSetInter(SegGrey(seg), arena->flippedTraces) == TraceSetEMPTY);
   } else {              /* write barrier */
-    STATISTIC(++arena->writeBarrierHitCount);
+    ++arena->writeBarrierHitCount;
   }
 
   /* The write barrier handling must come after the read barrier, */
@@ -1270,58 +1448,24 @@ void TraceSegAccess(Arena arena, Seg seg, AccessSet mode)
 }
 
 
-/* _mps_fix2 (a.k.a. "TraceFix") -- second stage of fixing a reference
+/* traceFixChunk -- fix a reference known to point into a chunk
  *
- * _mps_fix2 is on the [critical path](../design/critical-path.txt).  A
- * one-instruction difference in the early parts of this code will have a
- * significant impact on overall run time.  The priority is to eliminate
- * irrelevant references early and fast using the colour information stored
- * in the tract table.
- *
- * The name "TraceFix" is pervasive in the MPS and its documents to describe
- * this function.  Optimisation and strict aliasing rules have meant that we
- * need to use the external name for it here.
+ * This is the part of _mps_fix2 after the chunk lookup.  It is
+ * separate so that TraceFixArray can skip the lookup when consecutive
+ * references point into the same chunk.
  */
 
-mps_res_t _mps_fix2(mps_ss_t mps_ss, mps_addr_t *mps_ref_io)
+static Res traceFixChunk(ScanState ss, Chunk chunk, mps_addr_t *mps_ref_io)
 {
-  ScanState ss = PARENT(ScanStateStruct, ss_s, mps_ss);
   Ref ref;
-  Chunk chunk;
   Index i;
   Tract tract;
   Seg seg;
   Res res;
 
-  /* Special AVER macros are used on the critical path. */
-  /* See <design/trace/#fix.noaver> */
-  AVERT_CRITICAL(ScanState, ss);
-  AVER_CRITICAL(mps_ref_io != NULL);
-
   ref = (Ref)*mps_ref_io;
-
-  /* The zone test should already have been passed by MPS_FIX1 in mps.h. */
-  AVER_CRITICAL(ZoneSetInter(ScanStateWhite(ss),
-                             ZoneSetAddAddr(ss->arena, ZoneSetEMPTY, ref)) !=
-                ZoneSetEMPTY);
-
-  STATISTIC(++ss->fixRefCount);
-  EVENT4(TraceFix, ss, mps_ref_io, ref, ss->rank);
-
-  /* This sequence of tests is equivalent to calling TractOfAddr(),
-   * but inlined so that we can distinguish between "not pointing to
-   * chunk" and "pointing to chunk but not to tract" so that we can
-   * check the rank in the latter case. See
-   * <design/trace/#fix.tractofaddr.inline>
-   *
-   * If compilers fail to do a good job of inlining ChunkOfAddr and
-   * TreeFind then it may become necessary to inline at least the
-   * comparison against the root of the tree. See
-   * <https://info.ravenbrook.com/mail/2014/06/11/13-32-08/0/>
-   */
-  if (!ChunkOfAddr(&chunk, ss->arena, ref))
-    /* Reference points outside MPS-managed address space: ignore. */
-    goto done;
+  AVER_CRITICAL(chunk->base <= ref);
+  AVER_CRITICAL(ref < chunk->limit);
 
   i = INDEX_OF_ADDR(chunk, ref);
   if (!BTGet(chunk->allocTable, i)) {
@@ -1378,6 +1522,131 @@ done:
 }
 
 
+/* _mps_fix2 (a.k.a. "TraceFix") -- second stage of fixing a reference
+ *
+ * _mps_fix2 is on the [critical path](../design/critical-path.txt).  A
+ * one-instruction difference in the early parts of this code will have a
+ * significant impact on overall run time.  The priority is to eliminate
+ * irrelevant references early and fast using the colour information stored
+ * in the tract table.
+ *
+ * The name "TraceFix" is pervasive in the MPS and its documents to describe
+ * this function.  Optimisation and strict aliasing rules have meant that we
+ * need to use the external name for it here.
+ */
+
+mps_res_t _mps_fix2(mps_ss_t mps_ss, mps_addr_t *mps_ref_io)
+{
+  ScanState ss = PARENT(ScanStateStruct, ss_s, mps_ss);
+  Ref ref;
+  Chunk chunk;
+
+  /* Special AVER macros are used on the critical path. */
+  /* See <design/trace/#fix.noaver> */
+  AVERT_CRITICAL(ScanState, ss);
+  AVER_CRITICAL(mps_ref_io != NULL);
+
+  ref = (Ref)*mps_ref_io;
+
+  /* The zone test should already have been passed by MPS_FIX1 in mps.h. */
+  AVER_CRITICAL(ZoneSetInter(ScanStateWhite(ss),
+                             ZoneSetAddAddr(ss->arena, ZoneSetEMPTY, ref)) !=
+                ZoneSetEMPTY);
+
+  ++ss->fixRefCount;
+  EVENT4(TraceFix, ss, mps_ref_io, ref, ss->rank);
+
+  /* This sequence of tests is equivalent to calling TractOfAddr(),
+   * but inlined so that we can distinguish between "not pointing to
+   * chunk" and "pointing to chunk but not to tract" so that we can
+   * check the rank in the latter case. See
+   * <design/trace/#fix.tractofaddr.inline>
+   *
+   * ChunkOfAddr looks in the arena's chunk map, and only searches
+   * the tree of chunks if the map entry is shared by more than two
+   * chunks.  See <design/arena/#chunk.map>.
+   */
+  if (!ChunkOfAddr(&chunk, ss->arena, ref)) {
+    /* Reference points outside MPS-managed address space: ignore. */
+    /* See <design/trace/#fix.fixed.all> */
+    ss->fixedSummary = RefSetAdd(ss->arena, ss->fixedSummary, ref);
+    return ResOK;
+  }
+
+  return traceFixChunk(ss, chunk, mps_ref_io);
+}
+
+
+/* TraceFixArray -- fix an array of references
+ *
+ * Equivalent to applying MPS_FIX12 to each element of refs in turn,
+ * but the scan state is checked once, the targets of references that
+ * pass the zone test are prefetched, and the chunk lookup is skipped when a reference
+ * points into the same chunk as the previous one.  See
+ * <design/trace/#fix.array>.
+ */
+
+Res TraceFixArray(ScanState ss, mps_addr_t *refs, Count count)
+{
+  mps_addr_t *batch[TRACE_FIX_ARRAY_BATCH];
+  Arena arena;
+  ZoneSet white;
+  RefSet summary;
+  Chunk chunk = NULL;
+  Index base, i, n;
+  Res res = ResOK;
+
+  AVERT(ScanState, ss);
+  AVER(refs != NULL || count == 0);
+
+  arena = ss->arena;
+  white = ScanStateWhite(ss);
+  summary = ScanStateUnfixedSummary(ss);
+
+  for (base = 0; base < count; base += TRACE_FIX_ARRAY_BATCH) {
+    Index limit = base + TRACE_FIX_ARRAY_BATCH;
+    if (limit > count)
+      limit = count;
+
+    /* Filter the batch by zone, as MPS_FIX1 does. */
+    n = 0;
+    for (i = base; i < limit; ++i) {
+      ZoneSet zones = ZoneSetAddAddr(arena, ZoneSetEMPTY, refs[i]);
+      summary = ZoneSetUnion(summary, zones);
+      if (ZoneSetInter(white, zones) != ZoneSetEMPTY) {
+        PREFETCH(refs[i]);
+        batch[n] = &refs[i];
+        ++n;
+      }
+    }
+    if (n == 0)
+      continue;
+
+    for (i = 0; i < n; ++i) {
+      Ref ref = (Ref)*batch[i];
+      ++ss->fixRefCount;
+      EVENT4(TraceFix, ss, batch[i], ref, ss->rank);
+      if (chunk == NULL || ref < chunk->base || ref >= chunk->limit) {
+        if (!ChunkOfAddr(&chunk, arena, ref)) {
+          chunk = NULL;
+          /* See <design/trace/#fix.fixed.all> */
+          ss->fixedSummary = RefSetAdd(arena, ss->fixedSummary, ref);
+          continue;
+        }
+      }
+      res = traceFixChunk(ss, chunk, batch[i]);
+      if (res != ResOK)
+        break;
+    }
+    if (res != ResOK)
+      break;
+  }
+
+  ScanStateSetUnfixedSummary(ss, summary);
+  return res;
+}
+
+
 /* traceScanSingleRefRes -- scan a single reference, with result code */
 
 static Res traceScanSingleRefRes(TraceSet ts, Rank rank, Arena arena,
@@ -1391,7 +1660,10 @@ static Res traceScanSingleRefRes(TraceSet ts, Rank rank, Arena arena,
   EVENT4(TraceScanSingleRef, ts, rank, arena, (Addr)refIO);
 
   white = traceSetWhiteUnion(ts, arena);
-  if(ZoneSetInter(SegSummary(seg), white) == ZoneSetEMPTY) {
+  if(ZoneSetInter(SegSummary(seg), white) == ZoneSetEMPTY
+     && !(ArenaCardMarking(arena)
+          && CardIsDirty(arena, (Addr)refIO, (Addr)(refIO + 1))))
+  {
     return ResOK;
   }
 
@@ -1441,6 +1713,30 @@ void TraceScanSingleRef(TraceSet ts, Rank rank, Arena arena,
 }
 
 
+/* TraceScanSingleRefAccess -- scan a single reference after a barrier hit
+ *
+ * Scans the reference once for each flipped trace for which the
+ * segment is grey, at the rank that TraceRankForAccess chooses for
+ * that trace.  See <design/trace/#multi.access>.  */
+
+void TraceScanSingleRefAccess(Arena arena, Seg seg, Ref *refIO)
+{
+  TraceSet traces;
+  Trace trace;
+  TraceId ti;
+
+  AVERT(Arena, arena);
+  AVERT(Seg, seg);
+  AVER(refIO != NULL);
+
+  traces = TraceSetInter(SegGrey(seg), arena->flippedTraces);
+  TRACE_SET_ITER(ti, trace, traces, arena)
+    TraceScanSingleRef(TraceSetSingle(trace), TraceRankForAccess(trace, seg),
+                       arena, seg, refIO);
+  TRACE_SET_ITER_END(ti, trace, traces, arena);
+}
+
+
 /* TraceScanArea -- scan an area of memory for references
  *
  * This is a wrapper for area scanning functions, which should not
@@ -1591,6 +1887,11 @@ Res TraceStart(Trace trace, double mortality, double finishingTime)
   /* of segments are scannable.  Perhaps we should choose */
   /* dynamically which method to use. */
 
+  /* With dirty tracking, suspend the mutator now so that the summaries */
+  /* include its writes up to the flip: <design/prot/#dirty.harvest>. */
+  if (ArenaDirtyTracking(arena))
+    ShieldHold(arena);
+
   if(SegFirst(&seg, arena)) {
     do {
       Size size = SegSize(seg);
@@ -1600,11 +1901,22 @@ Res TraceStart(Trace trace, double mortality, double finishingTime)
       /* This is indicated by the rankSet begin non-empty.  Such */
       /* segments may only belong to scannable pools. */
       if(SegRankSet(seg) != RankSetEMPTY) {
+        /* A write-protected segment on a dirty page has been written */
+        /* since the last flip, so it takes a write barrier hit now. */
+        if(ArenaDirtyTracking(arena)
+           && BS_INTER(SegPM(seg), AccessWRITE) != AccessSetEMPTY
+           && ProtDirtyTest(SegBase(seg), SegLimit(seg)))
+          TraceSegAccess(arena, seg, AccessWRITE);
+
         /* Turn the segment grey if there might be a reference in it */
         /* to the white set.  This is done by seeing if the summary */
         /* of references in the segment intersects with the */
-        /* approximation to the white set. */
-        if(ZoneSetInter(SegSummary(seg), trace->white) != ZoneSetEMPTY) {
+        /* approximation to the white set, or if the segment has */
+        /* dirty cards: see <design/write-barrier/#card.scan>. */
+        if(ZoneSetInter(SegSummary(seg), trace->white) != ZoneSetEMPTY
+           || (ArenaCardMarking(arena)
+               && CardIsDirty(arena, SegBase(seg), SegLimit(seg))))
+        {
           /* Note: can a white seg get greyed as well?  At this point */
           /* we still assume it may.  (This assumption runs out in */
           /* PoolTrivGrey). */
@@ -1623,6 +1935,13 @@ Res TraceStart(Trace trace, double mortality, double finishingTime)
     } while (SegNext(&seg, arena, seg));
   }
 
+  /* Start recording writes for the next flip. */
+  /* <design/prot/#dirty.clear> */
+  if (ArenaDirtyTracking(arena)) {
+    ProtDirtyClear();
+    ShieldRelease(arena);
+  }
+
   res = RootsIterate(ArenaGlobals(arena), rootGrey, (void *)trace);
   AVER(res == ResOK);
 
@@ -1770,8 +2089,8 @@ failCondemn:
 
 /* TracePoll -- Check if there's any tracing work to be done
  *
- * Consider starting a trace if none is running; advance the running
- * trace (if any) by one quantum.
+ * Consider starting a trace if there's a free trace ID; advance each
+ * running trace by one quantum.
  *
  * The collectWorldReturn and collectWorldAllowed arguments are as for
  * PolicyStartTrace.
@@ -1784,32 +2103,35 @@ Bool TracePoll(Work *workReturn, Bool *collectWorldReturn, Globals globals,
                Bool collectWorldAllowed)
 {
   Trace trace;
+  TraceId ti;
   Arena arena;
-  Work oldWork, newWork, work, endWork;
+  Work work = 0;
 
   AVERT(Globals, globals);
   arena = GlobalsArena(globals);
 
-  if (arena->busyTraces != TraceSetEMPTY) {
-    trace = ArenaTrace(arena, (TraceId)0);
-  } else {
-    /* No traces are running: consider starting one now. */
-    if (!PolicyStartTrace(&trace, collectWorldReturn, arena,
-                          collectWorldAllowed))
-      return FALSE;
-  }
+  /* If traces are already running, the policy only considers starting
+     a trace that can run alongside them. See <design/trace/#multi>. */
+  if (arena->busyTraces != TraceSetUNIV)
+    (void)PolicyStartTrace(&trace, collectWorldReturn, arena,
+                           collectWorldAllowed);
+  if (arena->busyTraces == TraceSetEMPTY)
+    return FALSE;
+
+  TRACE_SET_ITER(ti, trace, arena->busyTraces, arena) {
+    Work oldWork, newWork, endWork;
+    oldWork = traceWork(trace);
+    endWork = oldWork + trace->quantumWork;
+    do {
+      TraceAdvance(trace);
+    } while (trace->state != TraceFINISHED && traceWork(trace) < endWork);
+    newWork = traceWork(trace);
+    AVER(newWork >= oldWork);
+    work += newWork - oldWork;
+    if (trace->state == TraceFINISHED)
+      TraceDestroyFinished(trace);
+  } TRACE_SET_ITER_END(ti, trace, arena->busyTraces, arena);
 
-  AVER(arena->busyTraces == TraceSetSingle(trace));
-  oldWork = traceWork(trace);
-  endWork = oldWork + trace->quantumWork;
-  do {
-    TraceAdvance(trace);
-  } while (trace->state != TraceFINISHED && traceWork(trace) < endWork);
-  newWork = traceWork(trace);
-  AVER(newWork >= oldWork);
-  work = newWork - oldWork;
-  if (trace->state == TraceFINISHED)
-    TraceDestroyFinished(trace);
   *workReturn = work;
   return TRUE;
 }
@@ -1846,6 +2168,7 @@ Res TraceDescribe(Trace trace, mps_lib_FILE *stream, Count depth)
                "  white   $B\n", (WriteFB)trace->white,
                "  mayMove $B\n", (WriteFB)trace->mayMove,
                "  chain $P\n", (WriteFP)trace->chain,
+               "  exclusive $S\n", WriteFYesNo(trace->exclusive),
                "  condemned $U\n", (WriteFU)trace->condemned,
                "  notCondemned $U\n", (WriteFU)trace->notCondemned,
                "  foundation $U\n", (WriteFU)trace->foundation,
@@ -118,6 +118,8 @@ static MessageClassStruct TraceStartMessageClassStruct = {
   MessageNoGCLiveSize,           /* GCLiveSize */
   MessageNoGCCondemnedSize,      /* GCCondemnedSize */
   MessageNoGCNotCondemnedSize,   /* GCNotCondemnedSize */
+  MessageNoGCPauseTime,          /* GCPauseTime */
+  MessageNoGCPauseMax,           /* GCPauseMax */
   TraceStartMessageWhy,          /* GCStartWhy */
   MessageClassSig                /* <design/message/#class.sig.double> */
 };
@@ -281,6 +283,8 @@ typedef struct TraceMessageStruct  {
   Size liveSize;
   Size condemnedSize;
   Size notCondemnedSize;
+  double pauseTime;
+  double pauseMax;
   MessageStruct messageStruct;
 } TraceMessageStruct;
 
@@ -296,6 +300,8 @@ Bool TraceMessageCheck(TraceMessage tMessage)
          MessageTypeGC);
   /* We can't check anything about the statistics.  In particular, */
   /* liveSize may exceed condemnedSize because they are only estimates. */
+  CHECKL(tMessage->pauseTime >= 0.0);
+  CHECKL(tMessage->pauseMax <= tMessage->pauseTime);
 
   return TRUE;
 }
@@ -349,6 +355,28 @@ static Size TraceMessageNotCondemnedSize(Message message)
   return tMessage->notCondemnedSize;
 }
 
+static double TraceMessagePauseTime(Message message)
+{
+  TraceMessage tMessage;
+
+  AVERT(Message, message);
+  tMessage = MessageTraceMessage(message);
+  AVERT(TraceMessage, tMessage);
+
+  return tMessage->pauseTime;
+}
+
+static double TraceMessagePauseMax(Message message)
+{
+  TraceMessage tMessage;
+
+  AVERT(Message, message);
+  tMessage = MessageTraceMessage(message);
+  AVERT(TraceMessage, tMessage);
+
+  return tMessage->pauseMax;
+}
+
 static MessageClassStruct TraceMessageClassStruct = {
   MessageClassSig,               /* sig */
   "TraceGC",                     /* name */
@@ -358,6 +386,8 @@ static MessageClassStruct TraceMessageClassStruct = {
   TraceMessageLiveSize,          /* GCLiveSize */
   TraceMessageCondemnedSize,     /* GCCondemnedSize */
   TraceMessageNotCondemnedSize,  /* GCNotCondemnedSize */
+  TraceMessagePauseTime,         /* GCPauseTime */
+  TraceMessagePauseMax,          /* GCPauseMax */
   MessageNoGCStartWhy,           /* GCStartWhy */
   MessageClassSig                /* <design/message/#class.sig.double> */
 };
@@ -371,6 +401,8 @@ static void traceMessageInit(Arena arena, TraceMessage tMessage)
   tMessage->liveSize = (Size)0;
   tMessage->condemnedSize = (Size)0;
   tMessage->notCondemnedSize = (Size)0;
+  tMessage->pauseTime = 0.0;
+  tMessage->pauseMax = 0.0;
 
   tMessage->sig = TraceMessageSig;
   AVERT(TraceMessage, tMessage);
@@ -380,7 +412,10 @@ static void traceMessageInit(Arena arena, TraceMessage tMessage)
  *
  * .message.data: The trace end message contains the live size
  * (forwardedSize + preservedInPlaceSize), the condemned size
- * (condemned), and the not-condemned size (notCondemned).
+ * (condemned), and the not-condemned size (notCondemned).  It also
+ * contains the total and longest pause in client threads while the
+ * trace was busy, including the pause in progress, in which the
+ * trace usually finishes.  See <design/arena/#pause>.
  */
 
 void TracePostMessage(Trace trace)
@@ -388,6 +423,7 @@ void TracePostMessage(Trace trace)
   Arena arena;
   TraceId ti;
   TraceMessage tMessage;
+  double current;
 
   AVERT(Trace, trace);
   AVER(trace->state == TraceFINISHED);
@@ -405,6 +441,9 @@ void TracePostMessage(Trace trace)
     tMessage->liveSize = trace->forwardedSize + trace->preservedInPlaceSize;
     tMessage->condemnedSize = trace->condemned;
     tMessage->notCondemnedSize = trace->notCondemned;
+    current = ArenaPauseCurrent(arena);
+    tMessage->pauseTime = trace->pauseTime + current;
+    tMessage->pauseMax = trace->pauseMax > current ? trace->pauseMax : current;
 
     arena->tMessage[ti] = NULL;
     MessagePost(arena, TraceMessageMessage(tMessage));
@@ -570,11 +609,14 @@ void ArenaPark(Globals globals)
   Trace trace;
   Arena arena;
   Clock start;
+  Bool workWasDone;
 
   AVERT(Globals, globals);
   arena = GlobalsArena(globals);
 
   globals->clamped = TRUE;
+  ArenaPauseBegin(arena);
+  workWasDone = arena->busyTraces != TraceSetEMPTY;
   start = ClockNow();
 
   while(arena->busyTraces != TraceSetEMPTY) {
@@ -588,6 +630,7 @@ void ArenaPark(Globals globals)
   }
 
   ArenaAccumulateTime(arena, start, ClockNow());
+  ArenaPauseEnd(arena, workWasDone);
 
   /* All traces have finished so there must not be an emergency. */
   AVER(!ArenaEmergency(arena));
@@ -661,15 +704,20 @@ Res ArenaStartCollect(Globals globals, int why)
   AVERT(Globals, globals);
   arena = GlobalsArena(globals);
 
+  /* Time parking, starting the trace (including its flip), and the
+   * poll on release as one pause. <design/arena/#pause> */
+  ArenaPauseBegin(arena);
   ArenaPark(globals);
   res = TraceStartCollectAll(&trace, arena, why);
   if(res != ResOK)
     goto failStart;
   ArenaRelease(globals);
+  ArenaPauseEnd(arena, TRUE);
   return ResOK;
 
 failStart:
   ArenaRelease(globals);
+  ArenaPauseEnd(arena, TRUE);
   return res;
 }
 
@@ -677,15 +725,18 @@ failStart:
 
 Res ArenaCollect(Globals globals, int why)
 {
+  Arena arena;
   Res res;
 
   AVERT(Globals, globals);
-  res = ArenaStartCollect(globals, why);
-  if(res != ResOK)
-    return res;
+  arena = GlobalsArena(globals);
 
-  ArenaPark(globals);
-  return ResOK;
+  ArenaPauseBegin(arena);
+  res = ArenaStartCollect(globals, why);
+  if(res == ResOK)
+    ArenaPark(globals);
+  ArenaPauseEnd(arena, TRUE);
+  return res;
 }
 
 
@@ -130,6 +130,7 @@ Bool ChunkCheck(Chunk chunk)
   CHECKL(TreeCheck(&chunk->chunkTree));
   CHECKL(ChunkPagesToSize(chunk, 1) == ChunkPageSize(chunk));
   CHECKL(ShiftCheck(ChunkPageShift(chunk)));
+  CHECKL(ChunkNode(chunk) < chunk->arena->nodes);
 
   CHECKL(chunk->base != (Addr)0);
   CHECKL(chunk->base < chunk->limit);
@@ -195,6 +196,7 @@ Res ChunkInit(Chunk chunk, Arena arena, Addr base, Addr limit, Size reserved,
   chunk->base = base;
   chunk->limit = limit;
   chunk->reserved = reserved;
+  chunk->node = 0;              /* set by arena class if NUMA-aware */
   size = ChunkSize(chunk);
 
   /* .overhead.pages: Chunk overhead for the page allocation table. */
@@ -318,21 +320,42 @@ TreeKey ChunkKey(Tree tree)
 }
 
 
-/* ChunkOfAddr -- return the chunk which encloses an address */
+/* ChunkOfAddr -- return the chunk which encloses an address
+ *
+ * Look in the arena's chunk map first, and only search the tree of
+ * chunks if the map entry is shared by more than two chunks.  See
+ * <design/arena/#chunk.map>.
+ */
 
 Bool ChunkOfAddr(Chunk *chunkReturn, Arena arena, Addr addr)
 {
   Tree tree;
+  Chunk chunk, *entry;
 
   AVER_CRITICAL(chunkReturn != NULL);
   AVERT_CRITICAL(Arena, arena);
   /* addr is arbitrary */
 
+  entry = arena->chunkMap[ChunkMapIndex(arena, addr)];
+  if (entry[0] != ChunkMapMANY) {
+    chunk = entry[0];
+    if (chunk != NULL && chunk->base <= addr && addr < chunk->limit) {
+      *chunkReturn = chunk;
+      return TRUE;
+    }
+    chunk = entry[1];
+    if (chunk != NULL && chunk->base <= addr && addr < chunk->limit) {
+      *chunkReturn = chunk;
+      return TRUE;
+    }
+    return FALSE;
+  }
+
   if (TreeFind(&tree, ArenaChunkTree(arena), TreeKeyOfAddrVar(addr),
                ChunkCompare)
       == CompareEQUAL)
   {
-    Chunk chunk = ChunkOfTree(tree);
+    chunk = ChunkOfTree(tree);
     AVER_CRITICAL(chunk->base <= addr);
     AVER_CRITICAL(addr < chunk->limit);
     *chunkReturn = chunk;
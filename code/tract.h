@@ -25,6 +25,7 @@
 #define PageStateALLOC 0    /* allocated to a pool as a tract */
 #define PageStateSPARE 1    /* free but mapped to backing store */
 #define PageStateFREE  2    /* free and unmapped (address space only) */
+#define PageStateRELEASED 3 /* free, mapped, but contents released to OS */
 #define PageStateWIDTH 2    /* bitfield width */
 
 typedef union PagePoolUnion {
@@ -145,6 +146,7 @@ typedef struct ChunkStruct {
   Addr limit;           /* limit address of chunk */
   Index allocBase;      /* index of first page allocatable to clients */
   Index pages;          /* index of the page after the last allocatable page */
+  Index node;           /* NUMA node the chunk's memory is on */
   BT allocTable;        /* page allocation table */
   Page pageTable;       /* the page table */
   Count pageTablePages; /* number of pages occupied by page table */
@@ -157,11 +159,20 @@ typedef struct ChunkStruct {
 #define ChunkArena(chunk) RVALUE((chunk)->arena)
 #define ChunkSize(chunk) AddrOffset((chunk)->base, (chunk)->limit)
 #define ChunkPageSize(chunk) RVALUE((chunk)->pageSize)
+#define ChunkNode(chunk) RVALUE((chunk)->node)
 #define ChunkPageShift(chunk) RVALUE((chunk)->pageShift)
 #define ChunkPagesToSize(chunk, pages) ((Size)(pages) << (chunk)->pageShift)
 #define ChunkSizeToPages(chunk, size) ((Count)((size) >> (chunk)->pageShift))
 #define ChunkPage(chunk, pi) (&(chunk)->pageTable[pi])
 #define ChunkOfTree(tree) PARENT(ChunkStruct, chunkTree, tree)
+
+/* ChunkMapMANY marks an entry in the arena's chunk map that is shared
+ * by more than two chunks.  See <design/arena/#chunk.map>. */
+
+#define ChunkMapMANY ((Chunk)1)
+#define ChunkMapIndex(arena, addr) \
+  ((Index)(((Word)(addr) >> (arena)->chunkMapShift) \
+           & (ARENA_CHUNK_MAP_LENGTH - 1)))
 #define ChunkReserved(chunk) RVALUE((chunk)->reserved)
 
 extern Bool ChunkCheck(Chunk chunk);
@@ -23,9 +23,12 @@ Bool VMCheck(VM vm)
   CHECKL(ArenaGrainSizeCheck(vm->pageSize));
   CHECKL(AddrIsAligned(vm->base, vm->pageSize));
   CHECKL(AddrIsAligned(vm->limit, vm->pageSize));
+  CHECKL(SizeIsP2(vm->hugePageSize));
+  CHECKL(SizeIsAligned(vm->hugePageSize, vm->pageSize));
   CHECKL(vm->block != NULL);
   CHECKL((Addr)vm->block <= vm->base);
   CHECKL(vm->mapped <= vm->reserved);
+  CHECKL(BoolCheck(vm->bound));
   return TRUE;
 }
 
@@ -40,6 +43,16 @@ Size (VMPageSize)(VM vm)
 }
 
 
+/* VMHugePageSize -- return the huge page size, or the page size */
+
+Size (VMHugePageSize)(VM vm)
+{
+  AVERT(VM, vm);
+
+  return VMHugePageSize(vm);
+}
+
+
 /* VMBase -- return the base address of the memory reserved */
 
 Addr (VMBase)(VM vm)
@@ -91,6 +104,23 @@ void VMCopy(VM dest, VM src)
 }
 
 
+/* VMBind -- bind the memory of a VM to a NUMA node
+ *
+ * Memory mapped by the VM from now on is placed on the given node, if
+ * the platform supports it.  Must be called before any memory is
+ * mapped.  See <design/vm/#if.bind>.
+ */
+
+void VMBind(VM vm, Index node)
+{
+  AVERT(VM, vm);
+  AVER(VMMapped(vm) == 0);
+
+  vm->bound = TRUE;
+  vm->node = node;
+}
+
+
 /* C. COPYRIGHT AND LICENSE
  *
  * Copyright (C) 2014 Ravenbrook Limited <http://www.ravenbrook.com/>.
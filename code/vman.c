@@ -64,6 +64,7 @@ Res VMInit(VM vm, Size size, Size grainSize, void *params)
   (void)mps_lib_memset(vbase, VMJunkBYTE, reserved);
 
   vm->pageSize = pageSize;
+  vm->hugePageSize = pageSize;
   vm->block = vbase;
   vm->base  = AddrAlignUp(vbase, grainSize);
   vm->limit = AddrAdd(vm->base, size);
@@ -71,6 +72,8 @@ Res VMInit(VM vm, Size size, Size grainSize, void *params)
   AVER(vm->limit < AddrAdd((Addr)vm->block, reserved));
   vm->reserved = reserved;
   vm->mapped = (Size)0;
+  vm->bound = FALSE;
+  vm->node = 0;
  
   vm->sig = VMSig;
   AVERT(VM, vm);
@@ -147,6 +150,52 @@ void VMUnmap(VM vm, Addr base, Addr limit)
 }
 
 
+/* VMPurge -- release the contents of the given range of memory
+ *
+ * The range stays mapped, but its contents are lost, as if the
+ * operating system had reclaimed it.
+ */
+
+void VMPurge(VM vm, Addr base, Addr limit)
+{
+  Size size;
+
+  AVER(base != (Addr)0);
+  AVER(VMBase(vm) <= base);
+  AVER(base < limit);
+  AVER(limit <= VMLimit(vm));
+  AVER(AddrIsAligned(base, vm->pageSize));
+  AVER(AddrIsAligned(limit, vm->pageSize));
+
+  size = AddrOffset(base, limit);
+  AVER(VMMapped(vm) >= size);
+
+  (void)mps_lib_memset((void *)base, VMJunkBYTE, size);
+
+  EVENT3(VMPurge, vm, base, limit);
+}
+
+
+/* VMNodeCount -- return the number of NUMA nodes
+ *
+ * The ANSI implementation has no notion of NUMA, so there is only
+ * one node.
+ */
+
+Count VMNodeCount(void)
+{
+  return 1;
+}
+
+
+/* VMCurrentNode -- return the NUMA node of the calling thread */
+
+Index VMCurrentNode(void)
+{
+  return 0;
+}
+
+
 /* C. COPYRIGHT AND LICENSE
  *
  * Copyright (C) 2001-2014 Ravenbrook Limited <http://www.ravenbrook.com/>.
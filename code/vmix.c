@@ -47,9 +47,16 @@
 #include "vm.h"
 
 #include <errno.h> /* errno */
+#include <limits.h> /* CHAR_BIT */
+#include <stdlib.h> /* getenv, strtoul */
 #include <sys/mman.h> /* see .feature.li in config.h */
 #include <sys/types.h> /* mmap, munmap */
-#include <unistd.h> /* getpagesize */
+#include <unistd.h> /* getpagesize, syscall */
+
+#if defined(MPS_OS_LI)
+#include <linux/mempolicy.h> /* MPOL_PREFERRED, MPOL_F_MEMS_ALLOWED */
+#include <sys/syscall.h> /* SYS_getcpu, SYS_get_mempolicy, SYS_mbind */
+#endif
 
 SRCID(vmix, "$Id$");
 
@@ -70,11 +77,26 @@ Size PageSize(void)
 }
 
 
+typedef struct VMParamsStruct {
+  Bool hugePages;
+} VMParamsStruct, *VMParams;
+
+static const VMParamsStruct vmParamsDefaults = {
+  /* .hugePages = */ FALSE,
+};
+
 Res VMParamFromArgs(void *params, size_t paramSize, ArgList args)
 {
+  VMParams vmParams;
+  ArgStruct arg;
   AVER(params != NULL);
   AVERT(ArgList, args);
+  AVER(paramSize >= sizeof(VMParamsStruct));
   UNUSED(paramSize);
+  vmParams = (VMParams)params;
+  (void)mps_lib_memcpy(vmParams, &vmParamsDefaults, sizeof(VMParamsStruct));
+  if (ArgPick(&arg, args, MPS_KEY_VM_HUGE_PAGES))
+    vmParams->hugePages = arg.val.b;
   return ResOK;
 }
 
@@ -83,8 +105,9 @@ Res VMParamFromArgs(void *params, size_t paramSize, ArgList args)
 
 Res VMInit(VM vm, Size size, Size grainSize, void *params)
 {
-  Size pageSize, reserved;
+  Size pageSize, hugePageSize, align, reserved;
   void *vbase;
+  VMParams vmParams = params;
 
   AVER(vm != NULL);
   AVERT(ArenaGrainSize, grainSize);
@@ -96,12 +119,22 @@ Res VMInit(VM vm, Size size, Size grainSize, void *params)
   /* Grains must consist of whole pages. */
   AVER(grainSize % pageSize == 0);
 
+  /* Align the reservation to huge pages if requested and available,
+   * so that the kernel can back it with them. See
+   * <design/vm/#impl.ix.huge>. */
+  hugePageSize = pageSize;
+#if defined(MADV_HUGEPAGE)
+  if (vmParams->hugePages && VM_HUGE_PAGE_SIZE > pageSize)
+    hugePageSize = VM_HUGE_PAGE_SIZE;
+#endif
+  align = grainSize > hugePageSize ? grainSize : hugePageSize;
+
   /* Check that the rounded-up sizes will fit in a Size. */
   size = SizeRoundUp(size, grainSize);
   if (size < grainSize || size > (Size)(size_t)-1)
     return ResRESOURCE;
-  reserved = size + grainSize - pageSize;
-  if (reserved < grainSize || reserved > (Size)(size_t)-1)
+  reserved = size + align - pageSize;
+  if (reserved < align || reserved > (Size)(size_t)-1)
     return ResRESOURCE;
 
   /* See .assume.not-last. */
@@ -118,13 +151,16 @@ Res VMInit(VM vm, Size size, Size grainSize, void *params)
   }
 
   vm->pageSize = pageSize;
+  vm->hugePageSize = hugePageSize;
   vm->block = vbase;
-  vm->base = AddrAlignUp(vbase, grainSize);
+  vm->base = AddrAlignUp(vbase, align);
   vm->limit = AddrAdd(vm->base, size);
   AVER(vm->base < vm->limit);  /* .assume.not-last */
   AVER(vm->limit <= AddrAdd((Addr)vm->block, reserved));
   vm->reserved = reserved;
   vm->mapped = 0;
+  vm->bound = FALSE;
+  vm->node = 0;
 
   vm->sig = VMSig;
   AVERT(VM, vm);
@@ -181,6 +217,27 @@ Res VMMap(VM vm, Addr base, Addr limit)
     return ResMEMORY;
   }
 
+#if defined(MADV_HUGEPAGE)
+  /* The advice belongs to the mapping just replaced, so it must be
+   * given again.  It is only a hint: ignore failure, for example if
+   * the kernel lacks transparent huge pages. See
+   * <design/vm/#impl.ix.map>. */
+  if (vm->hugePageSize > vm->pageSize)
+    (void)madvise((void *)base, (size_t)size, MADV_HUGEPAGE);
+#endif
+
+#if defined(MPS_OS_LI) && defined(SYS_mbind)
+  /* The memory policy also belongs to the mapping, and like the
+   * advice above it is only a preference.  See
+   * <design/vm/#impl.ix.bind>. */
+  if (vm->bound && vm->node < sizeof(unsigned long) * CHAR_BIT - 1) {
+    unsigned long mask = (unsigned long)1 << vm->node;
+    (void)syscall(SYS_mbind, (void *)base, (unsigned long)size,
+                  MPOL_PREFERRED, &mask,
+                  (unsigned long)(sizeof mask * CHAR_BIT), 0);
+  }
+#endif
+
   vm->mapped += size;
   AVER(VMMapped(vm) <= VMReserved(vm));
 
@@ -218,6 +275,155 @@ void VMUnmap(VM vm, Addr base, Addr limit)
 }
 
 
+/* VMPurge -- release the contents of the given range of memory
+ *
+ * The range stays mapped, so it can be used again without a system
+ * call, but the kernel may reclaim its pages.  See
+ * <design/vm/#impl.ix.purge>.
+ */
+
+void VMPurge(VM vm, Addr base, Addr limit)
+{
+  Size size;
+  int r = -1;
+
+  AVERT(VM, vm);
+  AVER(base < limit);
+  AVER(base >= VMBase(vm));
+  AVER(limit <= VMLimit(vm));
+  AVER(AddrIsAligned(base, vm->pageSize));
+  AVER(AddrIsAligned(limit, vm->pageSize));
+
+  size = AddrOffset(base, limit);
+  AVER(size <= VMMapped(vm));
+
+#if defined(MADV_FREE)
+  /* Linux before 4.5 doesn't support MADV_FREE, and fails with EINVAL. */
+  r = madvise((void *)base, (size_t)size, MADV_FREE);
+#endif
+#if defined(MPS_OS_LI)
+  /* On Linux, MADV_DONTNEED discards the contents immediately. */
+  if (r != 0)
+    r = madvise((void *)base, (size_t)size, MADV_DONTNEED);
+#endif
+  /* The advice is only a hint, so failure is not an error. */
+  UNUSED(r);
+
+  EVENT3(VMPurge, vm, base, limit);
+}
+
+
+/* vmFakeTopology -- get a fake NUMA topology from the environment
+ *
+ * If MPS_NUMA_FAKE is set to "n" or "n:m", pretend that there are n
+ * nodes, and that the calling thread is on node m, or if m is not
+ * given, on its CPU number modulo n.  This allows NUMA support to be
+ * tested on a machine with a single node.  See
+ * <design/vm/#impl.ix.numa.fake>.
+ */
+
+static Bool vmFakeTopology(Count *nodesReturn, Bool *nodeKnownReturn,
+                           Index *nodeReturn)
+{
+  const char *s;
+  char *end;
+  unsigned long nodes, node;
+
+  s = getenv("MPS_NUMA_FAKE");
+  if (s == NULL)
+    return FALSE;
+  nodes = strtoul(s, &end, 10);
+  if (end == s || nodes == 0)
+    return FALSE;
+
+  *nodesReturn = (Count)nodes;
+  *nodeKnownReturn = FALSE;
+  if (*end == ':') {
+    s = end + 1;
+    node = strtoul(s, &end, 10);
+    if (end != s) {
+      *nodeKnownReturn = TRUE;
+      *nodeReturn = (Index)(node % nodes);
+    }
+  }
+  return TRUE;
+}
+
+
+/* vmGetCPU -- get the CPU and NUMA node of the calling thread */
+
+static void vmGetCPU(unsigned *cpuReturn, unsigned *nodeReturn)
+{
+#if defined(MPS_OS_LI) && defined(SYS_getcpu)
+  if (syscall(SYS_getcpu, cpuReturn, nodeReturn, NULL) == 0)
+    return;
+#endif
+  *cpuReturn = 0;
+  *nodeReturn = 0;
+}
+
+
+/* VMNodeCount -- return the number of NUMA nodes
+ *
+ * On Linux, this is one more than the highest node that the process
+ * may allocate memory on.  Elsewhere there is only one node.
+ */
+
+Count VMNodeCount(void)
+{
+  Count nodes;
+  Bool nodeKnown;
+  Index node;
+
+  if (vmFakeTopology(&nodes, &nodeKnown, &node))
+    return nodes;
+
+#if defined(MPS_OS_LI) && defined(SYS_get_mempolicy)
+  {
+    unsigned long mask = 0;
+    if (syscall(SYS_get_mempolicy, NULL, &mask,
+                (unsigned long)(sizeof mask * CHAR_BIT), NULL,
+                MPOL_F_MEMS_ALLOWED) == 0
+        && mask != 0)
+    {
+      nodes = 0;
+      do {
+        ++nodes;
+        mask >>= 1;
+      } while (mask != 0);
+      return nodes;
+    }
+  }
+#endif
+
+  return 1;
+}
+
+
+/* VMCurrentNode -- return the NUMA node of the calling thread
+ *
+ * The thread may migrate at any time, so this is only a hint.
+ */
+
+Index VMCurrentNode(void)
+{
+  Count nodes;
+  Bool nodeKnown;
+  Index node;
+  unsigned cpu, cpuNode;
+
+  if (vmFakeTopology(&nodes, &nodeKnown, &node)) {
+    if (nodeKnown)
+      return node;
+    vmGetCPU(&cpu, &cpuNode);
+    return (Index)cpu % nodes;
+  }
+
+  vmGetCPU(&cpu, &cpuNode);
+  return (Index)cpuNode;
+}
+
+
 /* C. COPYRIGHT AND LICENSE
  *
  * Copyright (C) 2001-2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
@@ -132,6 +132,7 @@ Res VMInit(VM vm, Size size, Size grainSize, void *params)
   AVER(AddrIsAligned(vbase, pageSize));
 
   vm->pageSize = pageSize;
+  vm->hugePageSize = pageSize;
   vm->block = vbase;
   vm->base = AddrAlignUp(vbase, grainSize);
   vm->limit = AddrAdd(vm->base, size);
@@ -139,6 +140,8 @@ Res VMInit(VM vm, Size size, Size grainSize, void *params)
   AVER(vm->limit <= AddrAdd((Addr)vm->block, reserved));
   vm->reserved = reserved;
   vm->mapped = 0;
+  vm->bound = FALSE;
+  vm->node = 0;
 
   vm->sig = VMSig;
   AVERT(VM, vm);
@@ -227,6 +230,57 @@ void VMUnmap(VM vm, Addr base, Addr limit)
 }
 
 
+/* VMPurge -- release the contents of the given range of memory
+ *
+ * MEM_RESET tells the system that the contents are no longer needed,
+ * but leaves the pages committed, so they can be used again without
+ * another call.  The protection argument is ignored but must be
+ * valid.
+ */
+
+void VMPurge(VM vm, Addr base, Addr limit)
+{
+  LPVOID p;
+  Size size;
+
+  AVERT(VM, vm);
+  AVER(AddrIsAligned(base, vm->pageSize));
+  AVER(AddrIsAligned(limit, vm->pageSize));
+  AVER(VMBase(vm) <= base);
+  AVER(base < limit);
+  AVER(limit <= VMLimit(vm));
+
+  size = AddrOffset(base, limit);
+  AVER(size <= VMMapped(vm));
+
+  p = VirtualAlloc((LPVOID)base, (SIZE_T)size, MEM_RESET, PAGE_READWRITE);
+  AVER(p == (LPVOID)base);
+
+  EVENT3(VMPurge, vm, base, limit);
+}
+
+
+/* VMNodeCount -- return the number of NUMA nodes
+ *
+ * Not yet implemented on Windows, so there is only one node, and
+ * VMBind has no effect.  (VirtualAllocExNuma could place memory on
+ * a node.)
+ */
+
+Count VMNodeCount(void)
+{
+  return 1;
+}
+
+
+/* VMCurrentNode -- return the NUMA node of the calling thread */
+
+Index VMCurrentNode(void)
+{
+  return 0;
+}
+
+
 /* C. COPYRIGHT AND LICENSE
  *
  * Copyright (C) 2001-2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
@@ -0,0 +1,92 @@
+/* wk.h: MPS DAEMON THREADS
+ *
+ * $Id$
+ * Copyright (c) 2018 Ravenbrook Limited.  See end of file for license.
+ *
+ * .purpose: Provides threads, owned by the MPS, for doing collection
+ * work.  A daemon runs a function periodically, or when woken: the
+ * arena uses one to do collection work in the background (see
+ * <design/arena/#poll.background>).
+ *
+ * .serial: On platforms without threads (and when the MPS is
+ * configured for single-threaded use) a daemon never runs its
+ * function, so clients of this interface must not depend on it.
+ */
+
+#ifndef wk_h
+#define wk_h
+
+#include "mpmtypes.h"
+
+
+#define DaemonSig       ((Sig)0x519DAE30) /* SIGnature DAEmOn */
+
+extern Bool DaemonCheck(Daemon daemon);
+extern size_t DaemonSize(void);
+
+
+/*  DaemonInit/Finish -- a background thread
+ *
+ *  DaemonInit starts a thread that calls f(closure) whenever it is
+ *  woken by DaemonWake, and otherwise every interval seconds.
+ *  DaemonFinish stops the thread and waits for it to exit, so the
+ *  caller must not hold any lock that f claims.
+ */
+
+extern Res DaemonInit(Daemon daemon, DaemonFunction f, void *closure,
+                      double interval);
+extern void DaemonFinish(Daemon daemon);
+
+
+/*  DaemonWake -- ask the daemon to call its function soon
+ *
+ *  Returns FALSE if there is no thread to wake (see .serial), in which
+ *  case the caller should do the work itself.
+ */
+
+extern Bool DaemonWake(Daemon daemon);
+
+
+#endif /* wk_h */
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
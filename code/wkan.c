@@ -0,0 +1,102 @@
+/* wkan.c: MPS DAEMON THREADS, ANSI VERSION
+ *
+ * $Id$
+ * Copyright (c) 2018 Ravenbrook Limited.  See end of file for license.
+ *
+ * .design: This is a single-threaded implementation of the daemon
+ * threads interface.  No threads are created: DaemonWake tells the
+ * caller to do the work itself.  See <code/wk.h#serial>.
+ */
+
+#include "mpm.h"
+
+SRCID(wkan, "$Id$");
+
+
+typedef struct DaemonStruct {
+  Sig sig;                      /* <design/sig/> */
+} DaemonStruct;
+
+
+Bool DaemonCheck(Daemon daemon)
+{
+  CHECKS(Daemon, daemon);
+  return TRUE;
+}
+
+
+size_t DaemonSize(void)
+{
+  return sizeof(DaemonStruct);
+}
+
+
+Res DaemonInit(Daemon daemon, DaemonFunction f, void *closure,
+               double interval)
+{
+  AVER(daemon != NULL);
+  AVER(FUNCHECK(f));
+  /* Can't check closure. */
+  AVER(interval > 0.0);
+  UNUSED(closure);
+
+  daemon->sig = DaemonSig;
+  AVERT(Daemon, daemon);
+  return ResOK;
+}
+
+
+void DaemonFinish(Daemon daemon)
+{
+  AVERT(Daemon, daemon);
+  daemon->sig = SigInvalid;
+}
+
+
+Bool DaemonWake(Daemon daemon)
+{
+  AVERT(Daemon, daemon);
+  return FALSE;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -0,0 +1,275 @@
+/* wkix.c: MPS DAEMON THREADS FOR POSIX SYSTEMS
+ *
+ * $Id$
+ * Copyright (c) 2018 Ravenbrook Limited.  See end of file for license.
+ *
+ * .posix: The implementation uses the POSIX threads interface, and
+ * supports FreeBSD (MPS_OS_FR), Linux (MPS_OS_LI) and macOS
+ * (MPS_OS_XC).
+ *
+ * .signal: Daemon threads block all asynchronous signals, so that
+ * signals directed at the process are not delivered to threads the
+ * client doesn't know about.  The MPS never sends the thread
+ * suspension signals to daemon threads, because they are not
+ * registered with the arena.
+ *
+ * .fork: Threads do not survive fork(2), so in a child process
+ * DaemonWake returns FALSE, and DaemonFinish doesn't wait for the
+ * thread.
+ *
+ * .daemon: A daemon thread waits on its wake condition variable with
+ * a timeout of the interval, and calls its function when woken or
+ * when the wait times out.
+ */
+
+#include "mpm.h"
+
+#if !defined(MPS_OS_FR) && !defined(MPS_OS_LI) && !defined(MPS_OS_XC)
+#error "wkix.c is specific to MPS_OS_FR, MPS_OS_LI or MPS_OS_XC"
+#endif
+
+#include <errno.h> /* ETIMEDOUT */
+#include <pthread.h> /* see .feature.li in config.h */
+#include <signal.h> /* sigfillset, sigdelset */
+#include <sys/time.h> /* gettimeofday */
+#include <sys/types.h> /* pid_t */
+#include <unistd.h> /* getpid */
+
+SRCID(wkix, "$Id$");
+
+#if defined(LOCK)
+
+/* wkBlockSignals, wkRestoreSignals -- see .signal */
+
+static void wkBlockSignals(sigset_t *oldReturn)
+{
+  sigset_t block;
+  int res;
+
+  sigfillset(&block);
+  sigdelset(&block, SIGSEGV);
+  sigdelset(&block, SIGBUS);
+  sigdelset(&block, SIGILL);
+  sigdelset(&block, SIGFPE);
+  sigdelset(&block, SIGABRT);
+  res = pthread_sigmask(SIG_BLOCK, &block, oldReturn);
+  AVER(res == 0);
+}
+
+static void wkRestoreSignals(sigset_t *old)
+{
+  int res = pthread_sigmask(SIG_SETMASK, old, NULL);
+  AVER(res == 0);
+}
+
+
+/* DaemonStruct -- the state of a daemon thread
+ *
+ * The fields after mut must only be accessed while holding the mutex.
+ */
+
+typedef struct DaemonStruct {
+  Sig sig;                      /* <design/sig/> */
+  pid_t pid;                    /* process that created the thread */
+  pthread_t id;                 /* POSIX thread identifier */
+  double interval;              /* seconds between calls when not woken */
+  DaemonFunction f;             /* function to call */
+  void *closure;                /* closure argument to f */
+  pthread_mutex_t mut;          /* protects the fields below */
+  pthread_cond_t wake;          /* signalled by DaemonWake and to stop */
+  Bool woken;                   /* DaemonWake called since last call? */
+  Bool stopping;                /* thread should exit? */
+} DaemonStruct;
+
+
+Bool DaemonCheck(Daemon daemon)
+{
+  CHECKS(Daemon, daemon);
+  CHECKL(daemon->interval > 0.0);
+  CHECKL(FUNCHECK(daemon->f));
+  /* Other fields can't be checked without claiming the mutex. */
+  return TRUE;
+}
+
+
+size_t DaemonSize(void)
+{
+  return sizeof(DaemonStruct);
+}
+
+
+/* daemonMain -- main loop of a daemon thread */
+
+static void *daemonMain(void *p)
+{
+  Daemon daemon = p;
+  int res;
+
+  res = pthread_mutex_lock(&daemon->mut);
+  AVER(res == 0);
+  while (!daemon->stopping) {
+    if (!daemon->woken) {
+      struct timeval now;
+      struct timespec until;
+      double seconds;
+      res = gettimeofday(&now, NULL);
+      AVER(res == 0);
+      seconds = (double)now.tv_sec + (double)now.tv_usec / 1e6
+        + daemon->interval;
+      until.tv_sec = (time_t)seconds;
+      until.tv_nsec = (long)((seconds - (double)until.tv_sec) * 1e9);
+      res = pthread_cond_timedwait(&daemon->wake, &daemon->mut, &until);
+      AVER(res == 0 || res == ETIMEDOUT);
+      if (daemon->stopping)
+        break;
+    }
+    daemon->woken = FALSE;
+    res = pthread_mutex_unlock(&daemon->mut);
+    AVER(res == 0);
+
+    (*daemon->f)(daemon->closure);
+
+    res = pthread_mutex_lock(&daemon->mut);
+    AVER(res == 0);
+  }
+  res = pthread_mutex_unlock(&daemon->mut);
+  AVER(res == 0);
+  EventThreadDetach(); /* <design/telemetry/#thread.detach> */
+  return NULL;
+}
+
+
+Res DaemonInit(Daemon daemon, DaemonFunction f, void *closure,
+               double interval)
+{
+  sigset_t old;
+  int res;
+
+  AVER(daemon != NULL);
+  AVER(FUNCHECK(f));
+  /* Can't check closure. */
+  AVER(interval > 0.0);
+
+  daemon->pid = getpid();
+  daemon->interval = interval;
+  daemon->f = f;
+  daemon->closure = closure;
+  daemon->woken = FALSE;
+  daemon->stopping = FALSE;
+  res = pthread_mutex_init(&daemon->mut, NULL);
+  AVER(res == 0);
+  res = pthread_cond_init(&daemon->wake, NULL);
+  AVER(res == 0);
+
+  /* See .signal. */
+  wkBlockSignals(&old);
+  res = pthread_create(&daemon->id, NULL, daemonMain, daemon);
+  wkRestoreSignals(&old);
+  if (res != 0)
+    goto failCreate;
+
+  daemon->sig = DaemonSig;
+  AVERT(Daemon, daemon);
+  return ResOK;
+
+failCreate:
+  res = pthread_cond_destroy(&daemon->wake);
+  AVER(res == 0);
+  res = pthread_mutex_destroy(&daemon->mut);
+  AVER(res == 0);
+  return ResRESOURCE;
+}
+
+
+void DaemonFinish(Daemon daemon)
+{
+  int res;
+
+  AVERT(Daemon, daemon);
+
+  if (daemon->pid == getpid()) {
+    res = pthread_mutex_lock(&daemon->mut);
+    AVER(res == 0);
+    daemon->stopping = TRUE;
+    res = pthread_cond_signal(&daemon->wake);
+    AVER(res == 0);
+    res = pthread_mutex_unlock(&daemon->mut);
+    AVER(res == 0);
+    res = pthread_join(daemon->id, NULL);
+    AVER(res == 0);
+    res = pthread_cond_destroy(&daemon->wake);
+    AVER(res == 0);
+    res = pthread_mutex_destroy(&daemon->mut);
+    AVER(res == 0);
+  }
+  daemon->sig = SigInvalid;
+}
+
+
+Bool DaemonWake(Daemon daemon)
+{
+  int res;
+
+  AVERT(Daemon, daemon);
+
+  if (daemon->pid != getpid())
+    return FALSE; /* See .fork. */
+
+  res = pthread_mutex_lock(&daemon->mut);
+  AVER(res == 0);
+  daemon->woken = TRUE;
+  res = pthread_cond_signal(&daemon->wake);
+  AVER(res == 0);
+  res = pthread_mutex_unlock(&daemon->mut);
+  AVER(res == 0);
+  return TRUE;
+}
+
+
+#elif defined(LOCK_NONE)
+#include "wkan.c"
+#else
+#error "No lock configuration."
+#endif
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -0,0 +1,175 @@
+/* wkw3.c: MPS DAEMON THREADS FOR WIN32
+ *
+ * $Id$
+ * Copyright (c) 2018 Ravenbrook Limited.  See end of file for license.
+ *
+ * .daemon: A daemon thread waits for its auto-reset wake event with a
+ * timeout of the interval, and calls its function when the event is
+ * set or the wait times out.
+ */
+
+#include "mpm.h"
+
+#if !defined(MPS_OS_W3)
+#error "wkw3.c is specific to MPS_OS_W3"
+#endif
+
+#include "mpswin.h"
+
+SRCID(wkw3, "$Id$");
+
+#if defined(LOCK)
+
+/* DaemonStruct -- the state of a daemon thread */
+
+typedef struct DaemonStruct {
+  Sig sig;                      /* <design/sig/> */
+  HANDLE thread;                /* thread handle */
+  HANDLE wake;                  /* auto-reset event: DaemonWake called */
+  DWORD interval;               /* milliseconds between calls */
+  Bool volatile stopping;       /* thread should exit? */
+  DaemonFunction f;             /* function to call */
+  void *closure;                /* closure argument to f */
+} DaemonStruct;
+
+
+Bool DaemonCheck(Daemon daemon)
+{
+  CHECKS(Daemon, daemon);
+  CHECKL(daemon->interval > 0);
+  CHECKL(FUNCHECK(daemon->f));
+  return TRUE;
+}
+
+
+size_t DaemonSize(void)
+{
+  return sizeof(DaemonStruct);
+}
+
+
+/* daemonMain -- main loop of a daemon thread */
+
+static DWORD WINAPI daemonMain(LPVOID p)
+{
+  Daemon daemon = p;
+
+  for (;;) {
+    DWORD wres = WaitForSingleObject(daemon->wake, daemon->interval);
+    AVER(wres == WAIT_OBJECT_0 || wres == WAIT_TIMEOUT);
+    if (daemon->stopping)
+      break;
+    (*daemon->f)(daemon->closure);
+  }
+  EventThreadDetach(); /* <design/telemetry/#thread.detach> */
+  return 0;
+}
+
+
+Res DaemonInit(Daemon daemon, DaemonFunction f, void *closure,
+               double interval)
+{
+  AVER(daemon != NULL);
+  AVER(FUNCHECK(f));
+  /* Can't check closure. */
+  AVER(interval > 0.0);
+
+  daemon->interval = (DWORD)(interval * 1000.0);
+  if (daemon->interval == 0)
+    daemon->interval = 1;
+  daemon->stopping = FALSE;
+  daemon->f = f;
+  daemon->closure = closure;
+  daemon->wake = CreateEvent(NULL, FALSE, FALSE, NULL);
+  if (daemon->wake == NULL)
+    goto failEvent;
+  daemon->thread = CreateThread(NULL, 0, daemonMain, daemon, 0, NULL);
+  if (daemon->thread == NULL)
+    goto failThread;
+
+  daemon->sig = DaemonSig;
+  AVERT(Daemon, daemon);
+  return ResOK;
+
+failThread:
+  (void)CloseHandle(daemon->wake);
+failEvent:
+  return ResRESOURCE;
+}
+
+
+void DaemonFinish(Daemon daemon)
+{
+  BOOL b;
+  DWORD wres;
+
+  AVERT(Daemon, daemon);
+  daemon->stopping = TRUE;
+  b = SetEvent(daemon->wake);
+  AVER(b);
+  wres = WaitForSingleObject(daemon->thread, INFINITE);
+  AVER(wres == WAIT_OBJECT_0);
+  (void)CloseHandle(daemon->thread);
+  (void)CloseHandle(daemon->wake);
+  daemon->sig = SigInvalid;
+}
+
+
+Bool DaemonWake(Daemon daemon)
+{
+  BOOL b;
+
+  AVERT(Daemon, daemon);
+  b = SetEvent(daemon->wake);
+  AVER(b);
+  return TRUE;
+}
+
+
+#elif defined(LOCK_NONE)
+#include "wkan.c"
+#else
+#error "No lock configuration."
+#endif
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
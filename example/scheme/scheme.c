@@ -3950,9 +3950,14 @@ static mps_res_t obj_scan(mps_ss_t ss, mps_addr_t base, mps_addr_t limit)
         break;
       case TYPE_VECTOR:
         {
-          size_t i;
-          for (i = 0; i < obj->vector.length; ++i)
-            FIX(obj->vector.vector[i]);
+          /* The slots of a vector are all references, so fix them in
+             one call.  This treats the obj_t slots as mps_addr_t, which
+             have the same representation. */
+          mps_res_t res;
+          MPS_FIX_CALL(ss, res = mps_fix_array(ss,
+                                   (mps_addr_t *)obj->vector.vector,
+                                   obj->vector.length));
+          if (res != MPS_RES_OK) return res;
         }
         base = (char *)base +
           ALIGN_OBJ(offsetof(vector_s, vector) +
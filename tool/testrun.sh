@@ -100,7 +100,8 @@ for TESTCASE in $TEST_CASES; do
     fi
 
     if [ -f "$MPS_TELEMETRY_FILENAME" ]; then
-        "$TEST_DIR/mpseventcnv" -f "$MPS_TELEMETRY_FILENAME" > "$TELEMETRY.cnv"
+        "$TEST_DIR/mpseventcnv" -v -f "$MPS_TELEMETRY_FILENAME" \
+            > "$TELEMETRY.cnv" 2>> "$LOGTEST"
         gzip "$MPS_TELEMETRY_FILENAME"
         "$TEST_DIR/mpseventtxt" < "$TELEMETRY.cnv" > "$TELEMETRY.txt"
         if [ -x "$TEST_DIR/mpseventsql" ]; then